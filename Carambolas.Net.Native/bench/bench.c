@@ -0,0 +1,688 @@
+/*
+ * Micro and macro benchmarks of the native socket layer over loopback.
+ *
+ * Usage: carambolas_net_bench [-d seconds] [-s size,...] [-t threads,...] [-b batch] [-6] [benchmark...]
+ *
+ *   -d  Duration of each case in seconds (default 1).
+ *   -s  Payload sizes in bytes for the macro benchmarks (default 64,512,1200).
+ *   -t  Number of sender/receiver pairs for the macro benchmarks (default 1).
+ *   -b  Datagrams per batch for the batched and segmented variants (default 32).
+ *   -6  Use the IPv6 loopback instead of IPv4.
+ *
+ * Only benchmarks whose name starts with one of the remaining arguments are run (all if none).
+ *
+ * Micro benchmarks repeat a single operation in a tight loop:
+ *   endpoint         sockaddr (IPv4 or IPv6) to carambolas_net_socket_endpoint_t as done by every receive;
+ *   sockaddr         carambolas_net_socket_endpoint_t to sockaddr (IPv4 or IPv6) as done by every send;
+ *   poll             carambolas_net_socket_poll on a socket with a datagram pending;
+ *   poller           carambolas_net_poller_wait with a zero timeout on a poller with a socket added. Readiness may
+ *                    be edge-triggered so this is the cost of checking for more work when there is none.
+ *
+ * Macro benchmarks run each pair in two threads: a sender that sends as fast as it can for the duration of the case
+ * and a receiver that drains its own socket until the sender is done and the socket has been idle for 10ms:
+ *   sendto           carambolas_net_socket_sendto / carambolas_net_socket_recvfrom;
+ *   sendmany         carambolas_net_socket_sendmany / carambolas_net_socket_recvmany;
+ *   segmented        carambolas_net_socket_sendto_segmented / carambolas_net_socket_recvmany_segmented
+ *                    (UDP GSO/GRO where supported, otherwise the same fallback used by the library).
+ *
+ * Results are written to stdout as CSV, one line per case:
+ *
+ *   benchmark,family,size,threads,batch,calls,ns/call,pps,MB/s,loss%,drops
+ *
+ * where calls is the number of operations (send calls for macro benchmarks), ns/call the time per operation (per
+ * thread), pps the operations per second (datagrams received per second for macro benchmarks), loss% the share of
+ * datagrams sent that were not received and drops the number of datagrams the kernel reported dropped for lack of
+ * receive buffer space (SO_RXQ_OVFL where supported). Diagnostics go to stderr.
+ *
+ * The library source is compiled into the benchmark instead of linked so that internal functions such as the end
+ * point conversions can be measured on their own. Every exported function is the very same code.
+ */
+
+#include "native.c"
+
+#include <stdio.h>
+
+#ifdef WINDOWS
+typedef HANDLE bench_thread_t;
+#define BENCH_THREAD                            DWORD WINAPI
+#define BENCH_THREAD_RETURN                     0
+#else
+#include <pthread.h>
+typedef pthread_t bench_thread_t;
+#define BENCH_THREAD                            void*
+#define BENCH_THREAD_RETURN                     NULL
+#endif
+
+#define BENCH_SIZES_MAX                         16
+#define BENCH_NAMES_MAX                         16
+#define BENCH_RECEIVE_BUFFER                    (4 * 1024 * 1024)
+
+/* Time the receiver waits for more datagrams after the sender is done before it gives up. */
+#define BENCH_IDLE_MICROSECONDS                 10000
+
+typedef struct
+{
+    double duration;
+    int32_t sizes[BENCH_SIZES_MAX];
+    int nsizes;
+    int32_t threads[BENCH_SIZES_MAX];
+    int nthreads;
+    int32_t batch;
+    int32_t family;
+    const char* names[BENCH_NAMES_MAX];
+    int nnames;
+} bench_options_t;
+
+enum { SENDTO, SENDMANY, SEGMENTED };
+
+static const char* methods[] = { "sendto", "sendmany", "segmented" };
+
+typedef struct
+{
+    int method;
+    int32_t size;
+    int32_t batch;
+    double duration;
+    carambolas_net_socket_t tx;
+    carambolas_net_socket_t rx;
+    carambolas_net_socket_endpoint_t target;
+    bench_thread_t sender;
+    bench_thread_t receiver;
+    volatile int32_t done;
+
+    /* Written by the sender. */
+    int64_t sendcalls;
+    int64_t sent;
+
+    /* Written by the receiver. */
+    int64_t received;
+    int64_t receivedbytes;
+    carambolas_net_socket_stats_t stats;
+} bench_pair_t;
+
+static volatile uint32_t sink;
+
+static
+double
+seconds(int64_t start)
+{
+    return (double)(carambolas_net_clock_now() - start) * 1e-9;
+}
+
+static
+int
+selected(const bench_options_t* options, const char* name)
+{
+    if (options->nnames == 0)
+        return 1;
+
+    for (int i = 0; i < options->nnames; ++i)
+        if (strncmp(name, options->names[i], strlen(options->names[i])) == 0)
+            return 1;
+
+    return 0;
+}
+
+static
+const char*
+family(int32_t af)
+{
+    return (af == CARAMBOLAS_NET_SOCKET_AF_IPV6) ? "ipv6" : "ipv4";
+}
+
+static
+void
+report(const char* benchmark, int32_t af, int32_t size, int32_t threads, int32_t batch, int64_t calls, double elapsed, double pps, double mbps, double loss, int64_t drops)
+{
+    printf("%s,%s,%d,%d,%d,%lld,%.1f,%.0f,%.1f,%.2f,%lld\n", benchmark, family(af), size, threads, batch, (long long)calls,
+        (calls > 0) ? elapsed * threads * 1e9 / (double)calls : 0.0, pps, mbps, loss, (long long)drops);
+    fflush(stdout);
+}
+
+static
+int
+bench_thread_start(bench_thread_t* thread, BENCH_THREAD (*entry)(void*), void* arg)
+{
+#ifdef WINDOWS
+    *thread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)entry, arg, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, entry, arg) == 0;
+#endif
+}
+
+static
+void
+bench_thread_join(bench_thread_t thread)
+{
+#ifdef WINDOWS
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+static
+carambolas_net_socket_endpoint_t
+loopback(int32_t af)
+{
+    carambolas_net_socket_endpoint_t endpoint = {0};
+    endpoint.family = (uint16_t)af;
+    if (af == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        endpoint.ipv6.s6_addr[15] = 1;
+    }
+    else
+    {
+        endpoint.ipv4.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    return endpoint;
+}
+
+/* Open a socket bound to an ephemeral port of the loopback address. */
+static
+carambolas_net_socket_error_t
+bench_open(int32_t af, carambolas_net_socket_t* sockfd, carambolas_net_socket_endpoint_t* endpoint)
+{
+    carambolas_net_socket_error_t error = carambolas_net_socket_open(af, sockfd);
+    if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        return error;
+
+    int32_t size = BENCH_RECEIVE_BUFFER;
+    setsockopt(*sockfd, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+    setsockopt(*sockfd, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size));
+
+    *endpoint = loopback(af);
+    error = carambolas_net_socket_bind(*sockfd, endpoint);
+    if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        carambolas_net_socket_close(*sockfd);
+
+    return error;
+}
+
+/* Micro benchmarks */
+
+static
+void
+bench_endpoint(const bench_options_t* options)
+{
+    struct sockaddr_storage sas = {0};
+    if (options->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        struct sockaddr_in6* sa = (struct sockaddr_in6*)&sas;
+        sa->sin6_family = AF_INET6;
+        sa->sin6_addr.s6_addr[15] = 1;
+    }
+    else
+    {
+        struct sockaddr_in* sa = (struct sockaddr_in*)&sas;
+        sa->sin_family = AF_INET;
+        sa->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    uint32_t acc = 0;
+    int64_t iterations = 0;
+    int64_t start = carambolas_net_clock_now();
+    double elapsed;
+    do
+    {
+        for (uint16_t i = 0; i < 1024; ++i)
+        {
+            // Vary the port so the conversion cannot be hoisted out of the loop.
+            if (sas.ss_family == AF_INET6)
+                ((struct sockaddr_in6*)&sas)->sin6_port = i;
+            else
+                ((struct sockaddr_in*)&sas)->sin_port = i;
+
+            carambolas_net_socket_endpoint_t endpoint = carambolas_net_socket_endpoint(&sas);
+            acc += endpoint.port ^ endpoint.ipv6.s6_addr[15];
+        }
+
+        iterations += 1024;
+        elapsed = seconds(start);
+    }
+    while (elapsed < options->duration);
+
+    sink += acc;
+    report("endpoint", options->family, 0, 1, 1, iterations, elapsed, (double)iterations / elapsed, 0.0, 0.0, 0);
+}
+
+static
+void
+bench_sockaddr(const bench_options_t* options)
+{
+    carambolas_net_socket_endpoint_t endpoint = loopback(options->family);
+
+    uint32_t acc = 0;
+    int64_t iterations = 0;
+    int64_t start = carambolas_net_clock_now();
+    double elapsed;
+    do
+    {
+        for (uint16_t i = 0; i < 1024; ++i)
+        {
+            endpoint.port = i;
+            if (endpoint.family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+            {
+                struct sockaddr_in6 sa = carambolas_net_socket_sockaddr_in6(&endpoint);
+                acc += sa.sin6_port ^ sa.sin6_addr.s6_addr[15];
+            }
+            else
+            {
+                struct sockaddr_in sa = carambolas_net_socket_sockaddr_in(&endpoint);
+                acc += sa.sin_port ^ (uint32_t)sa.sin_addr.s_addr;
+            }
+        }
+
+        iterations += 1024;
+        elapsed = seconds(start);
+    }
+    while (elapsed < options->duration);
+
+    sink += acc;
+    report("sockaddr", options->family, 0, 1, 1, iterations, elapsed, (double)iterations / elapsed, 0.0, 0.0, 0);
+}
+
+static
+void
+bench_poll(const bench_options_t* options, int poller)
+{
+    carambolas_net_socket_t sockfd;
+    carambolas_net_socket_endpoint_t endpoint;
+    if (bench_open(options->family, &sockfd, &endpoint) != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+    {
+        fprintf(stderr, "poll: could not open a socket\n");
+        return;
+    }
+
+    // A datagram that is never read keeps the socket ready.
+    uint8_t datagram[16] = {0};
+    int32_t nbytes;
+    carambolas_net_socket_sendto(sockfd, datagram, 0, sizeof(datagram), &endpoint, &nbytes, NULL);
+
+    carambolas_net_poller_t pollfd = 0;
+    if (poller && (carambolas_net_poller_open(&pollfd) != CARAMBOLAS_NET_SOCKET_ERROR_NONE || carambolas_net_poller_add(pollfd, sockfd, 1) != CARAMBOLAS_NET_SOCKET_ERROR_NONE))
+    {
+        fprintf(stderr, "poller: not supported\n");
+        carambolas_net_socket_close(sockfd);
+        return;
+    }
+
+    int32_t tokens[1];
+    int32_t result = 0;
+    int64_t ready = 0;
+    int64_t iterations = 0;
+    int64_t start = carambolas_net_clock_now();
+    double elapsed;
+    do
+    {
+        for (int i = 0; i < 1024; ++i)
+        {
+            if (poller)
+                carambolas_net_poller_wait(pollfd, 0, tokens, 1, &result);
+            else
+                carambolas_net_socket_poll(sockfd, 0, CARAMBOLAS_NET_SOCKET_SELECT_READ, &result);
+
+            ready += result;
+        }
+
+        iterations += 1024;
+        elapsed = seconds(start);
+    }
+    while (elapsed < options->duration);
+
+    if (!poller && ready != iterations)
+        fprintf(stderr, "poll: socket was not ready %lld times\n", (long long)(iterations - ready));
+
+    report(poller ? "poller" : "poll", options->family, 0, 1, 1, iterations, elapsed, (double)iterations / elapsed, 0.0, 0.0, 0);
+
+    if (poller)
+        carambolas_net_poller_close(pollfd);
+
+    carambolas_net_socket_close(sockfd);
+}
+
+/* Macro benchmarks */
+
+static
+BENCH_THREAD
+bench_sender(void* arg)
+{
+    bench_pair_t* pair = (bench_pair_t*)arg;
+    int32_t batch = (pair->method == SENDTO) ? 1 : pair->batch;
+    uint8_t* buffer = (uint8_t*)calloc((size_t)batch, (size_t)pair->size);
+    carambolas_net_socket_endpoint_t* endpoints = (carambolas_net_socket_endpoint_t*)calloc((size_t)batch, sizeof(carambolas_net_socket_endpoint_t));
+    int32_t* lengths = (int32_t*)calloc((size_t)batch, sizeof(int32_t));
+    if (buffer == NULL || endpoints == NULL || lengths == NULL)
+        goto done;
+
+    for (int32_t i = 0; i < batch; ++i)
+    {
+        endpoints[i] = pair->target;
+        lengths[i] = pair->size;
+    }
+
+    int64_t start = carambolas_net_clock_now();
+    do
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            carambolas_net_socket_error_t error;
+            int32_t n = 0;
+            switch (pair->method)
+            {
+                case SENDTO:
+                    error = carambolas_net_socket_sendto(pair->tx, buffer, 0, pair->size, &pair->target, &n, NULL);
+                    n = (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE) ? 1 : 0;
+                    break;
+                case SENDMANY:
+                    error = carambolas_net_socket_sendmany(pair->tx, buffer, 0, pair->size, 0, batch, endpoints, lengths, &n, NULL);
+                    break;
+                default:
+                    error = carambolas_net_socket_sendto_segmented(pair->tx, buffer, 0, pair->size * batch, pair->size, &pair->target, &n, NULL);
+                    n = (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE) ? batch : 0;
+                    break;
+            }
+
+            pair->sendcalls++;
+            if (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+                pair->sent += n;
+        }
+    }
+    while (seconds(start) < pair->duration);
+
+done:
+    pair->done = 1;
+    free(lengths);
+    free(endpoints);
+    free(buffer);
+    return BENCH_THREAD_RETURN;
+}
+
+static
+BENCH_THREAD
+bench_receiver(void* arg)
+{
+    bench_pair_t* pair = (bench_pair_t*)arg;
+    int32_t count = (pair->method == SENDTO) ? 1 : CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+    uint8_t* buffer = (uint8_t*)malloc((size_t)count * (size_t)pair->size);
+    carambolas_net_socket_endpoint_t* endpoints = (carambolas_net_socket_endpoint_t*)calloc((size_t)count, sizeof(carambolas_net_socket_endpoint_t));
+    int32_t* lengths = (int32_t*)calloc((size_t)count, sizeof(int32_t));
+    if (buffer == NULL || endpoints == NULL || lengths == NULL)
+        goto done;
+
+    for (;;)
+    {
+        int32_t ready = 0;
+        if (carambolas_net_socket_poll(pair->rx, BENCH_IDLE_MICROSECONDS, CARAMBOLAS_NET_SOCKET_SELECT_READ, &ready) != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+            break;
+
+        if (!ready)
+        {
+            if (pair->done)
+                break;
+
+            continue;
+        }
+
+        for (;;)
+        {
+            carambolas_net_socket_error_t error;
+            int32_t n = 0;
+            switch (pair->method)
+            {
+                case SENDTO:
+                    error = carambolas_net_socket_recvfrom(pair->rx, buffer, 0, pair->size, endpoints, lengths, &pair->stats);
+                    n = (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE) ? 1 : 0;
+                    break;
+                case SENDMANY:
+                    error = carambolas_net_socket_recvmany(pair->rx, buffer, 0, pair->size, count, endpoints, lengths, &n, &pair->stats);
+                    break;
+                default:
+                    error = carambolas_net_socket_recvmany_segmented(pair->rx, buffer, 0, pair->size, count, endpoints, lengths, &n, &pair->stats);
+                    break;
+            }
+
+            if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE && error != CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE)
+                break;
+
+            for (int32_t i = 0; i < n; ++i)
+            {
+                pair->received++;
+                pair->receivedbytes += lengths[i];
+            }
+        }
+    }
+
+done:
+    free(lengths);
+    free(endpoints);
+    free(buffer);
+    return BENCH_THREAD_RETURN;
+}
+
+static
+void
+bench_pairs(const bench_options_t* options, int method, int32_t size, int32_t threads)
+{
+    int32_t batch = (method == SENDTO) ? 1 : options->batch;
+    if (batch > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        batch = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+    if (method == SEGMENTED)
+    {
+        if (batch > CARAMBOLAS_NET_SOCKET_SEGMENT_MAX)
+            batch = CARAMBOLAS_NET_SOCKET_SEGMENT_MAX;
+
+        if (batch > CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX / size)
+            batch = CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX / size;
+    }
+
+    bench_pair_t* pairs = (bench_pair_t*)calloc((size_t)threads, sizeof(bench_pair_t));
+    if (pairs == NULL)
+        return;
+
+    int32_t opened = 0;
+    int32_t offloaded = 1;
+    for (; opened < threads; ++opened)
+    {
+        bench_pair_t* pair = &pairs[opened];
+        pair->method = method;
+        pair->size = size;
+        pair->batch = batch;
+        pair->duration = options->duration;
+
+        carambolas_net_socket_endpoint_t local;
+        if (bench_open(options->family, &pair->rx, &pair->target) != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+            break;
+
+        if (bench_open(options->family, &pair->tx, &local) != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            carambolas_net_socket_close(pair->rx);
+            break;
+        }
+
+        carambolas_net_socket_setblocking(pair->rx, 0);
+        if (method == SEGMENTED)
+        {
+            int32_t enabled = 0;
+            carambolas_net_socket_setoffload(pair->tx, CARAMBOLAS_NET_SOCKET_OFFLOAD_SEGMENTATION, &enabled);
+            offloaded &= (enabled & CARAMBOLAS_NET_SOCKET_OFFLOAD_SEGMENTATION) != 0;
+            carambolas_net_socket_setoffload(pair->rx, CARAMBOLAS_NET_SOCKET_OFFLOAD_COALESCING, &enabled);
+            offloaded &= (enabled & CARAMBOLAS_NET_SOCKET_OFFLOAD_COALESCING) != 0;
+        }
+    }
+
+    if (opened < threads)
+    {
+        fprintf(stderr, "%s: could not open sockets for %d threads\n", methods[method], threads);
+        goto done;
+    }
+
+    if (method == SEGMENTED && !offloaded)
+        fprintf(stderr, "%s: offload not supported, measuring the fallback\n", methods[method]);
+
+    int32_t started = 0;
+    for (; started < threads; ++started)
+    {
+        if (!bench_thread_start(&pairs[started].receiver, bench_receiver, &pairs[started]))
+            break;
+
+        if (!bench_thread_start(&pairs[started].sender, bench_sender, &pairs[started]))
+        {
+            pairs[started].done = 1;
+            bench_thread_join(pairs[started].receiver);
+            break;
+        }
+    }
+
+    int64_t start = carambolas_net_clock_now();
+    for (int32_t i = 0; i < started; ++i)
+        bench_thread_join(pairs[i].sender);
+
+    double elapsed = seconds(start);
+    for (int32_t i = 0; i < started; ++i)
+        bench_thread_join(pairs[i].receiver);
+
+    if (started < threads)
+    {
+        fprintf(stderr, "%s: could not start %d threads\n", methods[method], threads);
+        goto done;
+    }
+
+    int64_t calls = 0, sent = 0, received = 0, bytes = 0, drops = 0;
+    for (int32_t i = 0; i < threads; ++i)
+    {
+        calls += pairs[i].sendcalls;
+        sent += pairs[i].sent;
+        received += pairs[i].received;
+        bytes += pairs[i].receivedbytes;
+        drops += pairs[i].stats.overflows;
+    }
+
+    report(methods[method], options->family, size, threads, batch, calls, elapsed, (double)received / elapsed, (double)bytes / elapsed / 1e6,
+        (sent > 0) ? (double)(sent - received) * 100.0 / (double)sent : 0.0, drops);
+
+done:
+    for (int32_t i = 0; i < opened; ++i)
+    {
+        carambolas_net_socket_close(pairs[i].tx);
+        carambolas_net_socket_close(pairs[i].rx);
+    }
+
+    free(pairs);
+}
+
+static
+int
+parse_list(const char* text, int32_t* values, int max)
+{
+    int n = 0;
+    while (*text && n < max)
+    {
+        char* end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value <= 0 || value > CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX)
+            return 0;
+
+        values[n++] = (int32_t)value;
+        text = (*end == ',') ? end + 1 : end;
+    }
+
+    return n;
+}
+
+static
+int
+usage(void)
+{
+    fprintf(stderr, "usage: carambolas_net_bench [-d seconds] [-s size,...] [-t threads,...] [-b batch] [-6] [benchmark...]\n");
+    return 2;
+}
+
+int
+main(int argc, char** argv)
+{
+    bench_options_t options = {0};
+    options.duration = 1.0;
+    options.sizes[0] = 64;
+    options.sizes[1] = 512;
+    options.sizes[2] = 1200;
+    options.nsizes = 3;
+    options.threads[0] = 1;
+    options.nthreads = 1;
+    options.batch = 32;
+    options.family = CARAMBOLAS_NET_SOCKET_AF_IPV4;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "-6") == 0)
+        {
+            options.family = CARAMBOLAS_NET_SOCKET_AF_IPV6;
+        }
+        else if (arg[0] == '-' && arg[1] != 0 && arg[2] == 0)
+        {
+            if (++i >= argc)
+                return usage();
+
+            switch (arg[1])
+            {
+                case 'd':
+                    options.duration = atof(argv[i]);
+                    if (options.duration <= 0.0)
+                        return usage();
+                    break;
+                case 's':
+                    if ((options.nsizes = parse_list(argv[i], options.sizes, BENCH_SIZES_MAX)) == 0)
+                        return usage();
+                    break;
+                case 't':
+                    if ((options.nthreads = parse_list(argv[i], options.threads, BENCH_SIZES_MAX)) == 0)
+                        return usage();
+                    break;
+                case 'b':
+                    options.batch = atoi(argv[i]);
+                    if (options.batch <= 0)
+                        return usage();
+                    break;
+                default:
+                    return usage();
+            }
+        }
+        else if (options.nnames < BENCH_NAMES_MAX)
+        {
+            options.names[options.nnames++] = arg;
+        }
+    }
+
+    if (carambolas_net_initialize() != 0)
+    {
+        fprintf(stderr, "could not initialize the socket layer\n");
+        return 1;
+    }
+
+    printf("benchmark,family,size,threads,batch,calls,ns/call,pps,MB/s,loss%%,drops\n");
+
+    if (selected(&options, "endpoint"))
+        bench_endpoint(&options);
+
+    if (selected(&options, "sockaddr"))
+        bench_sockaddr(&options);
+
+    if (selected(&options, "poll"))
+        bench_poll(&options, 0);
+
+    if (selected(&options, "poller"))
+        bench_poll(&options, 1);
+
+    for (int method = SENDTO; method <= SEGMENTED; ++method)
+        if (selected(&options, methods[method]))
+            for (int t = 0; t < options.nthreads; ++t)
+                for (int s = 0; s < options.nsizes; ++s)
+                    bench_pairs(&options, method, options.sizes[s], options.threads[t]);
+
+    return 0;
+}
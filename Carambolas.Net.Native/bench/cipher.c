@@ -0,0 +1,117 @@
+/*
+ * Throughput of the native cipher for each implementation supported by the processor.
+ *
+ * Usage: carambolas_net_cipher_bench [seconds per case]
+ *
+ * Results are written to stdout as CSV: operation,implementation,size,ns/op,MB/s
+ */
+
+#include "native.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static
+double
+now(void)
+{
+#ifdef WINDOWS
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+enum { ENCRYPT, SIGN, VERIFY, SEAL };
+
+static const char* operations[] = { "encrypt", "sign", "verify", "seal" };
+static const char* implementations[] = { "portable", "sse2", "avx2" };
+
+/* Typical secure packet layout: a small header as additional data followed by the encrypted payload. */
+#define AAD_SIZE 8
+
+static
+void
+run(int operation, int32_t implementation, int32_t size, double duration, uint8_t* buffer)
+{
+    uint32_t key[8] = { 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c };
+    uint32_t nonce[3] = { 0, 0, 0 };
+    uint32_t mac[4] = { 0 };
+    int32_t text = size - AAD_SIZE;
+
+    carambolas_net_cipher_sign(key, nonce, buffer, 0, AAD_SIZE, text, mac);
+
+    uint64_t iterations = 0;
+    double start = now(), elapsed;
+    do
+    {
+        for (int i = 0; i < 1024; ++i)
+        {
+            switch (operation)
+            {
+                case ENCRYPT:
+                    carambolas_net_cipher_encrypt(key, nonce, buffer, AAD_SIZE, text);
+                    break;
+                case SIGN:
+                    carambolas_net_cipher_sign(key, nonce, buffer, 0, AAD_SIZE, text, mac);
+                    break;
+                case VERIFY:
+                    mac[0] ^= (uint32_t)carambolas_net_cipher_verify(key, nonce, buffer, 0, AAD_SIZE, text, mac);
+                    break;
+                case SEAL:
+                    nonce[2]++;
+                    carambolas_net_cipher_encrypt(key, nonce, buffer, AAD_SIZE, text);
+                    carambolas_net_cipher_sign(key, nonce, buffer, 0, AAD_SIZE, text, mac);
+                    break;
+            }
+        }
+
+        iterations += 1024;
+        elapsed = now() - start;
+    } 
+    while (elapsed < duration);
+
+    printf("%s,%s,%d,%.1f,%.1f\n", operations[operation], implementations[implementation], size, 
+        elapsed * 1e9 / (double)iterations, (double)size * (double)iterations / elapsed / 1e6);
+    fflush(stdout);
+}
+
+int
+main(int argc, char** argv)
+{
+    static const int32_t sizes[] = { 64, 256, 1280, 4096, 16384 };
+    double duration = (argc > 1) ? atof(argv[1]) : 0.5;
+
+    uint8_t* buffer = (uint8_t*)malloc(16384);
+    if (!buffer)
+        return 1;
+
+    for (int i = 0; i < 16384; ++i)
+        buffer[i] = (uint8_t)i;
+
+    int32_t supported = carambolas_net_cipher_select(CARAMBOLAS_NET_CIPHER_AVX2);
+
+    printf("operation,implementation,size,ns/op,MB/s\n");
+    for (int32_t implementation = CARAMBOLAS_NET_CIPHER_PORTABLE; implementation <= supported; ++implementation)
+    {
+        carambolas_net_cipher_select(implementation);
+        for (int operation = ENCRYPT; operation <= SEAL; ++operation)
+            for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+                run(operation, implementation, sizes[i], duration, buffer);
+    }
+
+    free(buffer);
+    return 0;
+}
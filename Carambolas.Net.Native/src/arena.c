@@ -0,0 +1,277 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "native.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Slab arena of fixed size slots used for packet buffers that must not move (e.g. buffers handed to the kernel).
+ *
+ * Memory is reserved in one page-aligned block, committed up front and optionally backed by huge pages so a
+ * whole arena of receive buffers can be covered by a handful of TLB entries. Slots are distributed among a number
+ * of free lists (normally one per worker thread). Each list is a lock-free stack whose head carries a tag that is
+ * incremented on every update to avoid the ABA problem. A slot is always returned to the list it was taken from
+ * originally so that each thread keeps reusing the same (warm) memory even when slots are released by another thread.
+ */
+
+#define CARAMBOLAS_NET_ARENA_CACHELINE          64
+
+/* Size of a huge page on Linux x64. Mappings with MAP_HUGETLB must be a multiple of it. */
+#define CARAMBOLAS_NET_ARENA_HUGEPAGE           (2u * 1024u * 1024u)
+
+#ifdef _MSC_VER
+#define carambolas_net_arena_load(p)            ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+#define carambolas_net_arena_cas(p, e, d)       (InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(d), (LONG64)(e)) == (LONG64)(e))
+#define carambolas_net_arena_load32(p)          (*(volatile uint32_t*)(p))
+#define carambolas_net_arena_store32(p, v)      (*(volatile uint32_t*)(p) = (v))
+#else
+#define carambolas_net_arena_load(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define carambolas_net_arena_cas(p, e, d)       __atomic_compare_exchange_n((p), &(e), (d), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define carambolas_net_arena_load32(p)          __atomic_load_n((p), __ATOMIC_RELAXED)
+#define carambolas_net_arena_store32(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#endif
+
+/* List head: the lower 32 bits hold the index of the first free slot plus 1 (0 if empty) and the upper 32 bits a tag. */
+typedef struct
+{
+    volatile uint64_t head;
+    uint8_t padding[CARAMBOLAS_NET_ARENA_CACHELINE - sizeof(uint64_t)];
+} carambolas_net_arena_list_t;
+
+struct carambolas_net_arena
+{
+    uint8_t* base;
+    size_t length;
+    uint32_t size;
+    uint32_t count;
+    uint32_t lists;
+    uint32_t share;
+    int32_t flags;
+
+    /* Index of the next free slot plus 1 (0 terminates) for each slot. Only meaningful while the slot is free. */
+    uint32_t* next;
+    carambolas_net_arena_list_t* heads;
+};
+
+static
+uint8_t*
+carambolas_net_arena_map(size_t* length, int32_t* flags)
+{
+#ifdef WINDOWS
+    if (*flags & CARAMBOLAS_NET_ARENA_HUGEPAGES)
+    {
+        // Large pages require the SeLockMemoryPrivilege so this fails more often than not.
+        SIZE_T minimum = GetLargePageMinimum();
+        if (minimum > 0)
+        {
+            size_t rounded = (*length + minimum - 1) & ~(minimum - 1);
+            void* p = VirtualAlloc(NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p != NULL)
+            {
+                *length = rounded;
+                return (uint8_t*)p;
+            }
+        }
+
+        *flags &= ~CARAMBOLAS_NET_ARENA_HUGEPAGES;
+    }
+
+    return (uint8_t*)VirtualAlloc(NULL, *length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    int extra = 0;
+#ifdef MAP_POPULATE
+    // Pre-fault all pages so the first datagrams don't pay for page faults.
+    extra |= MAP_POPULATE;
+#endif
+
+#ifdef MAP_HUGETLB
+    if (*flags & CARAMBOLAS_NET_ARENA_HUGEPAGES)
+    {
+        // Fails unless huge pages have been reserved (vm.nr_hugepages) in which case regular pages are used instead.
+        size_t rounded = (*length + CARAMBOLAS_NET_ARENA_HUGEPAGE - 1) & ~((size_t)CARAMBOLAS_NET_ARENA_HUGEPAGE - 1);
+        void* p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | extra, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            *length = rounded;
+            return (uint8_t*)p;
+        }
+    }
+#endif
+    *flags &= ~CARAMBOLAS_NET_ARENA_HUGEPAGES;
+
+    void* p = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    // Still allow transparent huge pages to back the arena if enabled in madvise mode.
+    madvise(p, *length, MADV_HUGEPAGE);
+#endif
+
+    return (uint8_t*)p;
+#endif
+}
+
+static
+void
+carambolas_net_arena_unmap(uint8_t* base, size_t length)
+{
+#ifdef WINDOWS
+    (void)length;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, length);
+#endif
+}
+
+static inline
+void
+carambolas_net_arena_push(carambolas_net_arena_t* arena, uint32_t slot)
+{
+    volatile uint64_t* head = &arena->heads[slot / arena->share].head;
+    uint64_t expected = carambolas_net_arena_load(head);
+    for (;;)
+    {
+        carambolas_net_arena_store32(&arena->next[slot], (uint32_t)expected);
+        uint64_t desired = ((expected & 0xFFFFFFFF00000000ull) + 0x100000000ull) | (uint64_t)(slot + 1);
+        if (carambolas_net_arena_cas(head, expected, desired))
+            return;
+
+        expected = carambolas_net_arena_load(head);
+    }
+}
+
+static inline
+int32_t
+carambolas_net_arena_pop(carambolas_net_arena_t* arena, uint32_t list)
+{
+    volatile uint64_t* head = &arena->heads[list].head;
+    uint64_t expected = carambolas_net_arena_load(head);
+    for (;;)
+    {
+        uint32_t first = (uint32_t)expected;
+        if (first == 0)
+            return -1;
+
+        // The next index may be stale if another thread takes the slot in the meantime but then the tag
+        // will have changed and the exchange fails.
+        uint32_t next = carambolas_net_arena_load32(&arena->next[first - 1]);
+        uint64_t desired = ((expected & 0xFFFFFFFF00000000ull) + 0x100000000ull) | (uint64_t)next;
+        if (carambolas_net_arena_cas(head, expected, desired))
+            return (int32_t)(first - 1);
+
+        expected = carambolas_net_arena_load(head);
+    }
+}
+
+carambolas_net_socket_error_t
+carambolas_net_arena_create(int32_t size, int32_t count, int32_t lists, int32_t flags, carambolas_net_arena_t** arena)
+{
+    *arena = NULL;
+
+    if (size <= 0 || count <= 0 || lists <= 0 || lists > count)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    carambolas_net_arena_t* a = (carambolas_net_arena_t*)calloc(1, sizeof(carambolas_net_arena_t));
+    if (a == NULL)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+
+    // Slots are rounded up to a cache line so that no two slots ever share one.
+    a->size = ((uint32_t)size + CARAMBOLAS_NET_ARENA_CACHELINE - 1) & ~(uint32_t)(CARAMBOLAS_NET_ARENA_CACHELINE - 1);
+    a->count = (uint32_t)count;
+    a->lists = (uint32_t)lists;
+    a->share = (a->count + a->lists - 1) / a->lists;
+    a->flags = flags & CARAMBOLAS_NET_ARENA_HUGEPAGES;
+    a->length = (size_t)a->size * a->count;
+
+    a->next = (uint32_t*)calloc(a->count, sizeof(uint32_t));
+    a->heads = (carambolas_net_arena_list_t*)calloc(a->lists, sizeof(carambolas_net_arena_list_t));
+    a->base = carambolas_net_arena_map(&a->length, &a->flags);
+    if (a->next == NULL || a->heads == NULL || a->base == NULL)
+    {
+        carambolas_net_arena_destroy(a);
+        return CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+    }
+
+    // Build each list in order so that slots are handed out from the lowest address first.
+    for (uint32_t i = a->count; i > 0; --i)
+        carambolas_net_arena_push(a, i - 1);
+
+    *arena = a;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+void
+carambolas_net_arena_destroy(carambolas_net_arena_t* arena)
+{
+    if (arena == NULL)
+        return;
+
+    if (arena->base)
+        carambolas_net_arena_unmap(arena->base, arena->length);
+
+    free(arena->heads);
+    free(arena->next);
+    free(arena);
+}
+
+int32_t
+carambolas_net_arena_acquire(carambolas_net_arena_t* arena, int32_t list, int32_t* slots, int32_t count)
+{
+    if (count <= 0)
+        return 0;
+
+    uint32_t first = (list < 0) ? 0 : (uint32_t)list % arena->lists;
+    int32_t n = 0;
+
+    // Take from the preferred list first and only then from the others.
+    for (uint32_t i = 0; i < arena->lists && n < count; ++i)
+    {
+        uint32_t current = (first + i) % arena->lists;
+        while (n < count)
+        {
+            int32_t slot = carambolas_net_arena_pop(arena, current);
+            if (slot < 0)
+                break;
+
+            slots[n++] = slot;
+        }
+    }
+
+    return n;
+}
+
+void
+carambolas_net_arena_release(carambolas_net_arena_t* arena, const int32_t* slots, int32_t count)
+{
+    for (int32_t i = 0; i < count; ++i)
+        if (slots[i] >= 0 && (uint32_t)slots[i] < arena->count)
+            carambolas_net_arena_push(arena, (uint32_t)slots[i]);
+}
+
+uint8_t*
+carambolas_net_arena_slot(carambolas_net_arena_t* arena, int32_t slot)
+{
+    return arena->base + (size_t)slot * arena->size;
+}
+
+int32_t
+carambolas_net_arena_size(carambolas_net_arena_t* arena)
+{
+    return (int32_t)arena->size;
+}
+
+int32_t
+carambolas_net_arena_flags(carambolas_net_arena_t* arena)
+{
+    return arena->flags;
+}
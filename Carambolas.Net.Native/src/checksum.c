@@ -0,0 +1,331 @@
+#include "native.h"
+#include <string.h>
+
+/*
+ * CRC32-C (Castagnoli) as used to protect insecure packets. This must produce exactly the same output as
+ * Carambolas.Security.Cryptography.Crc32C (managed) because remote peers may be using either implementation.
+ *
+ * The portable implementation uses slicing-by-8 tables. The SSE4.2 implementation uses the crc32 instruction
+ * on three independent streams at a time to hide the instruction latency (3 cycles, 1 per cycle throughput)
+ * and then merges the partial results with precomputed shift tables.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HAVE_X86
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CARAMBOLAS_NET_TARGET(x)                __attribute__((target(x)))
+#else
+#define CARAMBOLAS_NET_TARGET(x)
+#endif
+
+#define CARAMBOLAS_NET_CRC32C_POLYNOMIAL        0x82F63B78u
+
+/* Value of the CRC of a buffer followed by its own CRC (in little endian). */
+#define CARAMBOLAS_NET_CRC32C_RESIDUE           0x48674BC7u
+
+/* Number of bytes processed by each of the three interleaved streams. */
+#define CARAMBOLAS_NET_CRC32C_LONG              256
+#define CARAMBOLAS_NET_CRC32C_SHORT             32
+
+/* Position of the packet flags in a datagram: RTM(4) PFLAGS(1) ... */
+#define CARAMBOLAS_NET_PACKET_FLAGS_OFFSET      4
+
+typedef uint32_t (*carambolas_net_crc32c_update_t)(uint32_t crc, const uint8_t* data, size_t length);
+
+/* Slicing-by-8 tables. */
+static uint32_t carambolas_net_crc32c_table[8][256];
+
+/* Tables to shift a CRC over CARAMBOLAS_NET_CRC32C_LONG and CARAMBOLAS_NET_CRC32C_SHORT zeros respectively. */
+static uint32_t carambolas_net_crc32c_long[4][256];
+static uint32_t carambolas_net_crc32c_short[4][256];
+
+/*
+ * Compute the tables to apply the effect of feeding length zero bytes to a CRC. This is a linear operator
+ * so it's enough to know its effect on each bit of the CRC.
+ */
+static
+void
+carambolas_net_crc32c_zeros(uint32_t table[4][256], size_t length)
+{
+    uint32_t op[32];
+    for (int i = 0; i < 32; ++i)
+    {
+        uint32_t crc = (uint32_t)1 << i;
+        for (size_t n = 0; n < length; ++n)
+            crc = carambolas_net_crc32c_table[0][crc & 0xFF] ^ (crc >> 8);
+
+        op[i] = crc;
+    }
+
+    for (int k = 0; k < 4; ++k)
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            uint32_t crc = 0;
+            for (int i = 0; i < 8; ++i)
+                if (b & (1 << i))
+                    crc ^= op[k * 8 + i];
+
+            table[k][b] = crc;
+        }
+    }
+}
+
+static inline
+uint32_t
+carambolas_net_crc32c_shift(uint32_t table[4][256], uint32_t crc)
+{
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+static
+void
+carambolas_net_crc32c_init(void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; ++k)
+            crc = (crc & 1) ? (crc >> 1) ^ CARAMBOLAS_NET_CRC32C_POLYNOMIAL : (crc >> 1);
+
+        carambolas_net_crc32c_table[0][i] = crc;
+    }
+
+    for (int i = 0; i < 256; ++i)
+        for (int k = 1; k < 8; ++k)
+            carambolas_net_crc32c_table[k][i] = (carambolas_net_crc32c_table[k - 1][i] >> 8) ^ carambolas_net_crc32c_table[0][carambolas_net_crc32c_table[k - 1][i] & 0xFF];
+
+    carambolas_net_crc32c_zeros(carambolas_net_crc32c_long, CARAMBOLAS_NET_CRC32C_LONG);
+    carambolas_net_crc32c_zeros(carambolas_net_crc32c_short, CARAMBOLAS_NET_CRC32C_SHORT);
+}
+
+static
+uint32_t
+carambolas_net_crc32c_update_portable(uint32_t crc, const uint8_t* data, size_t length)
+{
+    while (length >= 8)
+    {
+        uint32_t lo = crc ^ (((uint32_t)data[0]) | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+        crc = carambolas_net_crc32c_table[7][lo & 0xFF]
+            ^ carambolas_net_crc32c_table[6][(lo >> 8) & 0xFF]
+            ^ carambolas_net_crc32c_table[5][(lo >> 16) & 0xFF]
+            ^ carambolas_net_crc32c_table[4][lo >> 24]
+            ^ carambolas_net_crc32c_table[3][data[4]]
+            ^ carambolas_net_crc32c_table[2][data[5]]
+            ^ carambolas_net_crc32c_table[1][data[6]]
+            ^ carambolas_net_crc32c_table[0][data[7]];
+
+        data += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0)
+        crc = carambolas_net_crc32c_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+#ifdef HAVE_X86
+
+#if defined(__x86_64__) || defined(_M_X64)
+typedef uint64_t carambolas_net_crc32c_word_t;
+#define CRC32C_WORD(crc, p)                     ((uint32_t)_mm_crc32_u64((crc), carambolas_net_crc32c_load(p)))
+#else
+typedef uint32_t carambolas_net_crc32c_word_t;
+#define CRC32C_WORD(crc, p)                     (_mm_crc32_u32((crc), carambolas_net_crc32c_load(p)))
+#endif
+
+static inline
+carambolas_net_crc32c_word_t
+carambolas_net_crc32c_load(const uint8_t* p)
+{
+    carambolas_net_crc32c_word_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+CARAMBOLAS_NET_TARGET("sse4.2")
+static
+uint32_t
+carambolas_net_crc32c_update_sse42(uint32_t crc, const uint8_t* data, size_t length)
+{
+    const size_t w = sizeof(carambolas_net_crc32c_word_t);
+
+    // Three streams of consecutive blocks are computed independently, the first starting with the
+    // current crc and the others with zero, then combined as crc(a|b|c) = shift(shift(a) ^ b) ^ c.
+    while (length >= 3 * CARAMBOLAS_NET_CRC32C_LONG)
+    {
+        uint32_t crc1 = 0, crc2 = 0;
+        const uint8_t* end = data + CARAMBOLAS_NET_CRC32C_LONG;
+        do
+        {
+            crc = CRC32C_WORD(crc, data);
+            crc1 = CRC32C_WORD(crc1, data + CARAMBOLAS_NET_CRC32C_LONG);
+            crc2 = CRC32C_WORD(crc2, data + 2 * CARAMBOLAS_NET_CRC32C_LONG);
+            data += w;
+        }
+        while (data < end);
+
+        crc = carambolas_net_crc32c_shift(carambolas_net_crc32c_long, crc) ^ crc1;
+        crc = carambolas_net_crc32c_shift(carambolas_net_crc32c_long, crc) ^ crc2;
+        data += 2 * CARAMBOLAS_NET_CRC32C_LONG;
+        length -= 3 * CARAMBOLAS_NET_CRC32C_LONG;
+    }
+
+    while (length >= 3 * CARAMBOLAS_NET_CRC32C_SHORT)
+    {
+        uint32_t crc1 = 0, crc2 = 0;
+        const uint8_t* end = data + CARAMBOLAS_NET_CRC32C_SHORT;
+        do
+        {
+            crc = CRC32C_WORD(crc, data);
+            crc1 = CRC32C_WORD(crc1, data + CARAMBOLAS_NET_CRC32C_SHORT);
+            crc2 = CRC32C_WORD(crc2, data + 2 * CARAMBOLAS_NET_CRC32C_SHORT);
+            data += w;
+        }
+        while (data < end);
+
+        crc = carambolas_net_crc32c_shift(carambolas_net_crc32c_short, crc) ^ crc1;
+        crc = carambolas_net_crc32c_shift(carambolas_net_crc32c_short, crc) ^ crc2;
+        data += 2 * CARAMBOLAS_NET_CRC32C_SHORT;
+        length -= 3 * CARAMBOLAS_NET_CRC32C_SHORT;
+    }
+
+    while (length >= w)
+    {
+        crc = CRC32C_WORD(crc, data);
+        data += w;
+        length -= w;
+    }
+
+    while (length-- > 0)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+}
+
+/*
+ * Highest implementation supported by the processor.
+ */
+static
+int32_t
+carambolas_net_crc32c_detect(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) ? CARAMBOLAS_NET_CRC32C_SSE42 : CARAMBOLAS_NET_CRC32C_PORTABLE;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") ? CARAMBOLAS_NET_CRC32C_SSE42 : CARAMBOLAS_NET_CRC32C_PORTABLE;
+#endif
+}
+
+#else
+
+static
+int32_t
+carambolas_net_crc32c_detect(void)
+{
+    return CARAMBOLAS_NET_CRC32C_PORTABLE;
+}
+
+#endif
+
+/* Highest supported implementation or -1 if not detected yet. */
+static volatile int32_t carambolas_net_crc32c_supported = -1;
+
+/* Selected implementation or -1 if not selected yet. */
+static volatile int32_t carambolas_net_crc32c_selected = -1;
+
+static carambolas_net_crc32c_update_t carambolas_net_crc32c_update = carambolas_net_crc32c_update_portable;
+
+int32_t
+carambolas_net_crc32c_select(int32_t implementation)
+{
+    if (carambolas_net_crc32c_supported < 0)
+    {
+        // Tables are deterministic so racing threads at worst compute the same values twice.
+        carambolas_net_crc32c_init();
+        carambolas_net_crc32c_supported = carambolas_net_crc32c_detect();
+    }
+
+    if (implementation < 0 || implementation > carambolas_net_crc32c_supported)
+        implementation = carambolas_net_crc32c_supported;
+
+    switch (implementation)
+    {
+#ifdef HAVE_X86
+        case CARAMBOLAS_NET_CRC32C_SSE42:
+            carambolas_net_crc32c_update = carambolas_net_crc32c_update_sse42;
+            break;
+#endif
+        default:
+            implementation = CARAMBOLAS_NET_CRC32C_PORTABLE;
+            carambolas_net_crc32c_update = carambolas_net_crc32c_update_portable;
+            break;
+    }
+
+    carambolas_net_crc32c_selected = implementation;
+    return implementation;
+}
+
+int32_t
+carambolas_net_crc32c_implementation(void)
+{
+    // Racing threads select the same implementation so there is no need for synchronization.
+    int32_t selected = carambolas_net_crc32c_selected;
+    return (selected < 0) ? carambolas_net_crc32c_select(-1) : selected;
+}
+
+uint32_t
+carambolas_net_crc32c_compute(const uint8_t* buffer, int32_t offset, int32_t length)
+{
+    if (carambolas_net_crc32c_selected < 0)
+        carambolas_net_crc32c_select(-1);
+
+    return ~carambolas_net_crc32c_update(~(uint32_t)0, buffer + offset, (size_t)length);
+}
+
+int32_t
+carambolas_net_crc32c_filter(const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, int32_t* lengths)
+{
+    if (carambolas_net_crc32c_selected < 0)
+        carambolas_net_crc32c_select(-1);
+
+    int32_t ndropped = 0;
+    for (int32_t i = 0; i < count; ++i)
+    {
+        int32_t length = lengths[i];
+        if (length <= CARAMBOLAS_NET_PACKET_FLAGS_OFFSET)
+            continue;
+
+        const uint8_t* datagram = buffer + offset + (size_t)i * (size_t)stride;
+        switch (datagram[CARAMBOLAS_NET_PACKET_FLAGS_OFFSET])
+        {
+            case CARAMBOLAS_NET_PACKET_ACCEPT:
+            case CARAMBOLAS_NET_PACKET_CHALLENGE:
+            case CARAMBOLAS_NET_PACKET_CONNECT:
+            case CARAMBOLAS_NET_PACKET_DATA:
+            case CARAMBOLAS_NET_PACKET_RESET:
+            case CARAMBOLAS_NET_PACKET_SECURE_CONNECT:
+                if (length < CARAMBOLAS_NET_PACKET_FLAGS_OFFSET + 1 + 4
+                    || ~carambolas_net_crc32c_update(~(uint32_t)0, datagram, (size_t)length) != CARAMBOLAS_NET_CRC32C_RESIDUE)
+                {
+                    lengths[i] = 0;
+                    ndropped++;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return ndropped;
+}
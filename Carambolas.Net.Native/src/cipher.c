@@ -0,0 +1,773 @@
+#include "native.h"
+#include <string.h>
+
+/*
+ * ChaCha20 and Poly1305 as used by secure sessions. This must produce exactly the same output as
+ * Carambolas.Net.Cipher (managed) because remote peers may be using either implementation:
+ *
+ *  - Payloads are encrypted with ChaCha20 (RFC 8439) starting at block counter 1;
+ *  - The Poly1305 key is the first half of ChaCha20 block 0 for the same nonce;
+ *  - The MAC is computed over the additional data and then the ciphertext, each padded with zeros to a
+ *    multiple of 16 bytes. Unlike RFC 8439 the lengths of the two parts are not appended.
+ *
+ * Keys, nonces and MACs are passed as arrays of 32-bit words in host byte order which is how they are
+ * laid out by the managed structs.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HAVE_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CARAMBOLAS_NET_TARGET(x)                __attribute__((target(x)))
+#else
+#define CARAMBOLAS_NET_TARGET(x)
+#endif
+
+#define CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE      64
+#define CARAMBOLAS_NET_POLY1305_BLOCK_SIZE      16
+
+#define ROTL32(v, n)                            (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define CHACHA20_QUARTERROUND(a, b, c, d)       \
+    a += b; d ^= a; d = ROTL32(d, 16);          \
+    c += d; b ^= c; b = ROTL32(b, 12);          \
+    a += b; d ^= a; d = ROTL32(d, 8);           \
+    c += d; b ^= c; b = ROTL32(b, 7);
+
+typedef void (*carambolas_net_chacha20_xor_t)(uint32_t* state, uint8_t* data, size_t length);
+
+static inline
+uint32_t
+carambolas_net_load32_le(const uint8_t* p)
+{
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline
+uint64_t
+carambolas_net_load64_le(const uint8_t* p)
+{
+    return ((uint64_t)carambolas_net_load32_le(p)) | ((uint64_t)carambolas_net_load32_le(p + 4) << 32);
+}
+
+static inline
+void
+carambolas_net_store32_le(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static
+void
+carambolas_net_chacha20_init(uint32_t* state, const uint32_t* key, const uint32_t* nonce, uint32_t counter)
+{
+    state[0] = 0x61707865;
+    state[1] = 0x3320646E;
+    state[2] = 0x79622D32;
+    state[3] = 0x6B206574;
+
+    for (int i = 0; i < 8; ++i)
+        state[4 + i] = key[i];
+
+    state[12] = counter;
+    state[13] = nonce[0];
+    state[14] = nonce[1];
+    state[15] = nonce[2];
+}
+
+static
+void
+carambolas_net_chacha20_block(const uint32_t* state, uint8_t* block)
+{
+    uint32_t x[16];
+    for (int i = 0; i < 16; ++i)
+        x[i] = state[i];
+
+    for (int i = 0; i < 10; ++i)
+    {
+        CHACHA20_QUARTERROUND(x[0], x[4], x[8],  x[12])
+        CHACHA20_QUARTERROUND(x[1], x[5], x[9],  x[13])
+        CHACHA20_QUARTERROUND(x[2], x[6], x[10], x[14])
+        CHACHA20_QUARTERROUND(x[3], x[7], x[11], x[15])
+        CHACHA20_QUARTERROUND(x[0], x[5], x[10], x[15])
+        CHACHA20_QUARTERROUND(x[1], x[6], x[11], x[12])
+        CHACHA20_QUARTERROUND(x[2], x[7], x[8],  x[13])
+        CHACHA20_QUARTERROUND(x[3], x[4], x[9],  x[14])
+    }
+
+    for (int i = 0; i < 16; ++i)
+        carambolas_net_store32_le(block + 4 * i, x[i] + state[i]);
+}
+
+static
+void
+carambolas_net_chacha20_xor_portable(uint32_t* state, uint8_t* data, size_t length)
+{
+    uint8_t block[CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE];
+    while (length > 0)
+    {
+        carambolas_net_chacha20_block(state, block);
+        state[12]++;
+
+        size_t n = (length < CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE) ? length : CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+        for (size_t i = 0; i < n; ++i)
+            data[i] ^= block[i];
+
+        data += n;
+        length -= n;
+    }
+
+    memset(block, 0, sizeof(block));
+}
+
+#ifdef HAVE_X86
+
+/*
+ * Vectorized implementations process several consecutive blocks at once with each vector holding the same
+ * state word of every block (i.e. lane k belongs to block k). The output is then transposed back into
+ * consecutive blocks. Whatever is left that cannot fill all lanes is handed to a narrower implementation.
+ */
+
+#define CHACHA20_SSE2_ROTL(v, n)                _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+
+#define CHACHA20_SSE2_QUARTERROUND(a, b, c, d)                                      \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = CHACHA20_SSE2_ROTL(d, 16); \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = CHACHA20_SSE2_ROTL(b, 12); \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = CHACHA20_SSE2_ROTL(d, 8);  \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = CHACHA20_SSE2_ROTL(b, 7);
+
+/*
+ * Single block with each vector holding a row of the state. Diagonal rounds are computed by rotating 
+ * rows into columns and back. Used for whatever is left after the wide loops.
+ */
+CARAMBOLAS_NET_TARGET("sse2")
+static
+void
+carambolas_net_chacha20_xor_rows_sse2(uint32_t* state, uint8_t* data, size_t length)
+{
+    while (length > 0)
+    {
+        const __m128i s0 = _mm_loadu_si128((const __m128i*)(state + 0));
+        const __m128i s1 = _mm_loadu_si128((const __m128i*)(state + 4));
+        const __m128i s2 = _mm_loadu_si128((const __m128i*)(state + 8));
+        const __m128i s3 = _mm_loadu_si128((const __m128i*)(state + 12));
+
+        __m128i a = s0, b = s1, c = s2, d = s3;
+        for (int i = 0; i < 10; ++i)
+        {
+            CHACHA20_SSE2_QUARTERROUND(a, b, c, d)
+            b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+            c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+            d = _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 1, 0, 3));
+            CHACHA20_SSE2_QUARTERROUND(a, b, c, d)
+            b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3));
+            c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+            d = _mm_shuffle_epi32(d, _MM_SHUFFLE(0, 3, 2, 1));
+        }
+
+        __m128i k[4];
+        k[0] = _mm_add_epi32(a, s0);
+        k[1] = _mm_add_epi32(b, s1);
+        k[2] = _mm_add_epi32(c, s2);
+        k[3] = _mm_add_epi32(d, s3);
+
+        state[12]++;
+
+        if (length >= CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                __m128i* p = (__m128i*)(data + 16 * i);
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k[i]));
+            }
+
+            data += CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+            length -= CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+        }
+        else
+        {
+            uint8_t block[CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE];
+            for (int i = 0; i < 4; ++i)
+                _mm_storeu_si128((__m128i*)(block + 16 * i), k[i]);
+
+            for (size_t i = 0; i < length; ++i)
+                data[i] ^= block[i];
+
+            memset(block, 0, sizeof(block));
+            length = 0;
+        }
+    }
+}
+
+CARAMBOLAS_NET_TARGET("sse2")
+static
+void
+carambolas_net_chacha20_xor_sse2(uint32_t* state, uint8_t* data, size_t length)
+{
+    while (length >= 4 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE)
+    {
+        __m128i x[16];
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm_set1_epi32((int)state[i]);
+
+        __m128i counter = _mm_add_epi32(x[12], _mm_set_epi32(3, 2, 1, 0));
+        x[12] = counter;
+
+        for (int i = 0; i < 10; ++i)
+        {
+            CHACHA20_SSE2_QUARTERROUND(x[0], x[4], x[8],  x[12])
+            CHACHA20_SSE2_QUARTERROUND(x[1], x[5], x[9],  x[13])
+            CHACHA20_SSE2_QUARTERROUND(x[2], x[6], x[10], x[14])
+            CHACHA20_SSE2_QUARTERROUND(x[3], x[7], x[11], x[15])
+            CHACHA20_SSE2_QUARTERROUND(x[0], x[5], x[10], x[15])
+            CHACHA20_SSE2_QUARTERROUND(x[1], x[6], x[11], x[12])
+            CHACHA20_SSE2_QUARTERROUND(x[2], x[7], x[8],  x[13])
+            CHACHA20_SSE2_QUARTERROUND(x[3], x[4], x[9],  x[14])
+        }
+
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm_add_epi32(x[i], (i == 12) ? counter : _mm_set1_epi32((int)state[i]));
+
+        // Transpose each group of 4 words so that each vector holds 16 consecutive bytes of a single block.
+        for (int g = 0; g < 4; ++g)
+        {
+            __m128i t0 = _mm_unpacklo_epi32(x[4 * g + 0], x[4 * g + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[4 * g + 0], x[4 * g + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+
+            __m128i b[4];
+            b[0] = _mm_unpacklo_epi64(t0, t1);
+            b[1] = _mm_unpackhi_epi64(t0, t1);
+            b[2] = _mm_unpacklo_epi64(t2, t3);
+            b[3] = _mm_unpackhi_epi64(t2, t3);
+
+            for (int k = 0; k < 4; ++k)
+            {
+                __m128i* p = (__m128i*)(data + k * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE + 16 * g);
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), b[k]));
+            }
+        }
+
+        state[12] += 4;
+        data += 4 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+        length -= 4 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+    }
+
+    // A partial batch is still cheaper than the equivalent number of single blocks if it fills most lanes.
+    if (length > 2 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE)
+    {
+        uint8_t block[4 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE];
+        memcpy(block, data, length);
+        carambolas_net_chacha20_xor_sse2(state, block, sizeof(block));
+        memcpy(data, block, length);
+        memset(block, 0, sizeof(block));
+    }
+    else
+    {
+        carambolas_net_chacha20_xor_rows_sse2(state, data, length);
+    }
+}
+
+#define CHACHA20_AVX2_ROTL(v, n)                _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+
+#define CHACHA20_AVX2_QUARTERROUND(a, b, c, d)                                                  \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16);  \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = CHACHA20_AVX2_ROTL(b, 12);      \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8);   \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = CHACHA20_AVX2_ROTL(b, 7);
+
+CARAMBOLAS_NET_TARGET("avx2")
+static
+void
+carambolas_net_chacha20_xor_avx2(uint32_t* state, uint8_t* data, size_t length)
+{
+    // Rotations by a multiple of 8 bits are cheaper as byte shuffles.
+    const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                          13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                         14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+
+    while (length >= 8 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE)
+    {
+        __m256i x[16];
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm256_set1_epi32((int)state[i]);
+
+        __m256i counter = _mm256_add_epi32(x[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        x[12] = counter;
+
+        for (int i = 0; i < 10; ++i)
+        {
+            CHACHA20_AVX2_QUARTERROUND(x[0], x[4], x[8],  x[12])
+            CHACHA20_AVX2_QUARTERROUND(x[1], x[5], x[9],  x[13])
+            CHACHA20_AVX2_QUARTERROUND(x[2], x[6], x[10], x[14])
+            CHACHA20_AVX2_QUARTERROUND(x[3], x[7], x[11], x[15])
+            CHACHA20_AVX2_QUARTERROUND(x[0], x[5], x[10], x[15])
+            CHACHA20_AVX2_QUARTERROUND(x[1], x[6], x[11], x[12])
+            CHACHA20_AVX2_QUARTERROUND(x[2], x[7], x[8],  x[13])
+            CHACHA20_AVX2_QUARTERROUND(x[3], x[4], x[9],  x[14])
+        }
+
+        for (int i = 0; i < 16; ++i)
+            x[i] = _mm256_add_epi32(x[i], (i == 12) ? counter : _mm256_set1_epi32((int)state[i]));
+
+        // Transpose each group of 4 words within 128-bit lanes. Afterwards b[g][k] holds words 4g..4g+3
+        // of block k in the low lane and of block k + 4 in the high lane.
+        __m256i b[4][4];
+        for (int g = 0; g < 4; ++g)
+        {
+            __m256i t0 = _mm256_unpacklo_epi32(x[4 * g + 0], x[4 * g + 1]);
+            __m256i t1 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m256i t2 = _mm256_unpackhi_epi32(x[4 * g + 0], x[4 * g + 1]);
+            __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+
+            b[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            b[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            b[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            b[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+
+        for (int k = 0; k < 4; ++k)
+        {
+            __m256i* lo = (__m256i*)(data + k * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE);
+            __m256i* hi = (__m256i*)(data + (k + 4) * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE);
+
+            _mm256_storeu_si256(lo + 0, _mm256_xor_si256(_mm256_loadu_si256(lo + 0), _mm256_permute2x128_si256(b[0][k], b[1][k], 0x20)));
+            _mm256_storeu_si256(lo + 1, _mm256_xor_si256(_mm256_loadu_si256(lo + 1), _mm256_permute2x128_si256(b[2][k], b[3][k], 0x20)));
+            _mm256_storeu_si256(hi + 0, _mm256_xor_si256(_mm256_loadu_si256(hi + 0), _mm256_permute2x128_si256(b[0][k], b[1][k], 0x31)));
+            _mm256_storeu_si256(hi + 1, _mm256_xor_si256(_mm256_loadu_si256(hi + 1), _mm256_permute2x128_si256(b[2][k], b[3][k], 0x31)));
+        }
+
+        state[12] += 8;
+        data += 8 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+        length -= 8 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE;
+    }
+
+    // A partial batch is still cheaper than the equivalent number of narrower ones if it fills most lanes.
+    if (length > 4 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE)
+    {
+        uint8_t block[8 * CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE];
+        memcpy(block, data, length);
+        carambolas_net_chacha20_xor_avx2(state, block, sizeof(block));
+        memcpy(data, block, length);
+        memset(block, 0, sizeof(block));
+    }
+    else
+    {
+        carambolas_net_chacha20_xor_sse2(state, data, length);
+    }
+}
+
+/*
+ * Highest implementation supported by the processor and the operating system.
+ * AVX2 also requires the OS to preserve YMM registers across context switches.
+ */
+static
+int32_t
+carambolas_net_cipher_detect(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int max = info[0];
+
+    __cpuid(info, 1);
+    int sse2 = (info[3] & (1 << 26)) != 0;
+    int osxsave = (info[2] & (1 << 27)) != 0;
+    int avx = (info[2] & (1 << 28)) != 0;
+
+    int avx2 = 0;
+    if (max >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    if (avx2 && avx && osxsave && (_xgetbv(0) & 0x06) == 0x06)
+        return CARAMBOLAS_NET_CIPHER_AVX2;
+
+    return sse2 ? CARAMBOLAS_NET_CIPHER_SSE2 : CARAMBOLAS_NET_CIPHER_PORTABLE;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return CARAMBOLAS_NET_CIPHER_AVX2;
+
+    return __builtin_cpu_supports("sse2") ? CARAMBOLAS_NET_CIPHER_SSE2 : CARAMBOLAS_NET_CIPHER_PORTABLE;
+#endif
+}
+
+#else
+
+static
+int32_t
+carambolas_net_cipher_detect(void)
+{
+    return CARAMBOLAS_NET_CIPHER_PORTABLE;
+}
+
+#endif
+
+/* Highest supported implementation or -1 if not detected yet. */
+static volatile int32_t carambolas_net_cipher_supported = -1;
+
+/* Selected implementation or -1 if not selected yet. */
+static volatile int32_t carambolas_net_cipher_selected = -1;
+
+static carambolas_net_chacha20_xor_t carambolas_net_chacha20_xor = carambolas_net_chacha20_xor_portable;
+
+int32_t
+carambolas_net_cipher_select(int32_t implementation)
+{
+    if (carambolas_net_cipher_supported < 0)
+        carambolas_net_cipher_supported = carambolas_net_cipher_detect();
+
+    if (implementation < 0 || implementation > carambolas_net_cipher_supported)
+        implementation = carambolas_net_cipher_supported;
+
+    switch (implementation)
+    {
+#ifdef HAVE_X86
+        case CARAMBOLAS_NET_CIPHER_AVX2:
+            carambolas_net_chacha20_xor = carambolas_net_chacha20_xor_avx2;
+            break;
+        case CARAMBOLAS_NET_CIPHER_SSE2:
+            carambolas_net_chacha20_xor = carambolas_net_chacha20_xor_sse2;
+            break;
+#endif
+        default:
+            implementation = CARAMBOLAS_NET_CIPHER_PORTABLE;
+            carambolas_net_chacha20_xor = carambolas_net_chacha20_xor_portable;
+            break;
+    }
+
+    carambolas_net_cipher_selected = implementation;
+    return implementation;
+}
+
+int32_t
+carambolas_net_cipher_implementation(void)
+{
+    // Racing threads select the same implementation so there is no need for synchronization.
+    int32_t selected = carambolas_net_cipher_selected;
+    return (selected < 0) ? carambolas_net_cipher_select(-1) : selected;
+}
+
+void
+carambolas_net_cipher_encrypt(const uint32_t* key, const uint32_t* nonce, uint8_t* buffer, int32_t offset, int32_t length)
+{
+    if (carambolas_net_cipher_selected < 0)
+        carambolas_net_cipher_select(-1);
+
+    uint32_t state[16];
+    carambolas_net_chacha20_init(state, key, nonce, 1);
+    carambolas_net_chacha20_xor(state, buffer + offset, (size_t)length);
+    memset(state, 0, sizeof(state));
+}
+
+#if defined(__SIZEOF_INT128__)
+
+/* Poly1305 with 3 limbs of 44, 44 and 42 bits using 128-bit products (poly1305-donna-64). */
+
+typedef unsigned __int128 carambolas_net_uint128_t;
+
+typedef struct carambolas_net_poly1305
+{
+    uint64_t r[3];
+    uint64_t h[3];
+    uint64_t pad[2];
+} carambolas_net_poly1305_t;
+
+static
+void
+carambolas_net_poly1305_init(carambolas_net_poly1305_t* st, const uint8_t* key)
+{
+    uint64_t t0 = carambolas_net_load64_le(key + 0);
+    uint64_t t1 = carambolas_net_load64_le(key + 8);
+
+    st->r[0] = (t0) & 0xffc0fffffff;
+    st->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffff;
+    st->r[2] = ((t1 >> 24)) & 0x00ffffffc0f;
+
+    st->h[0] = 0;
+    st->h[1] = 0;
+    st->h[2] = 0;
+
+    st->pad[0] = carambolas_net_load64_le(key + 16);
+    st->pad[1] = carambolas_net_load64_le(key + 24);
+}
+
+static
+void
+carambolas_net_poly1305_blocks(carambolas_net_poly1305_t* st, const uint8_t* m, size_t length)
+{
+    const uint64_t hibit = ((uint64_t)1) << 40;
+    const uint64_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2];
+    const uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+
+    uint64_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2];
+
+    while (length >= CARAMBOLAS_NET_POLY1305_BLOCK_SIZE)
+    {
+        uint64_t t0 = carambolas_net_load64_le(m + 0);
+        uint64_t t1 = carambolas_net_load64_le(m + 8);
+
+        h0 += (t0) & 0xfffffffffff;
+        h1 += ((t0 >> 44) | (t1 << 20)) & 0xfffffffffff;
+        h2 += (((t1 >> 24)) & 0x3ffffffffff) | hibit;
+
+        carambolas_net_uint128_t d0 = (carambolas_net_uint128_t)h0 * r0 + (carambolas_net_uint128_t)h1 * s2 + (carambolas_net_uint128_t)h2 * s1;
+        carambolas_net_uint128_t d1 = (carambolas_net_uint128_t)h0 * r1 + (carambolas_net_uint128_t)h1 * r0 + (carambolas_net_uint128_t)h2 * s2;
+        carambolas_net_uint128_t d2 = (carambolas_net_uint128_t)h0 * r2 + (carambolas_net_uint128_t)h1 * r1 + (carambolas_net_uint128_t)h2 * r0;
+
+        // Partial reduction mod 2^130-5
+        uint64_t c = (uint64_t)(d0 >> 44); h0 = (uint64_t)d0 & 0xfffffffffff;
+        d1 += c; c = (uint64_t)(d1 >> 44); h1 = (uint64_t)d1 & 0xfffffffffff;
+        d2 += c; c = (uint64_t)(d2 >> 42); h2 = (uint64_t)d2 & 0x3ffffffffff;
+        h0 += c * 5; c = (h0 >> 44); h0 &= 0xfffffffffff;
+        h1 += c;
+
+        m += CARAMBOLAS_NET_POLY1305_BLOCK_SIZE;
+        length -= CARAMBOLAS_NET_POLY1305_BLOCK_SIZE;
+    }
+
+    st->h[0] = h0;
+    st->h[1] = h1;
+    st->h[2] = h2;
+}
+
+static
+void
+carambolas_net_poly1305_finish(carambolas_net_poly1305_t* st, uint32_t* mac)
+{
+    uint64_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2];
+
+    // Full carry
+    uint64_t c = (h1 >> 44); h1 &= 0xfffffffffff;
+    h2 += c; c = (h2 >> 42); h2 &= 0x3ffffffffff;
+    h0 += c * 5; c = (h0 >> 44); h0 &= 0xfffffffffff;
+    h1 += c; c = (h1 >> 44); h1 &= 0xfffffffffff;
+    h2 += c; c = (h2 >> 42); h2 &= 0x3ffffffffff;
+    h0 += c * 5; c = (h0 >> 44); h0 &= 0xfffffffffff;
+    h1 += c;
+
+    // Compute h - p
+    uint64_t g0 = h0 + 5; c = (g0 >> 44); g0 &= 0xfffffffffff;
+    uint64_t g1 = h1 + c; c = (g1 >> 44); g1 &= 0xfffffffffff;
+    uint64_t g2 = h2 + c - (((uint64_t)1) << 42);
+
+    // Select h if h < p, or h - p if h >= p
+    c = (g2 >> 63) - 1;
+    g0 &= c;
+    g1 &= c;
+    g2 &= c;
+    c = ~c;
+    h0 = (h0 & c) | g0;
+    h1 = (h1 & c) | g1;
+    h2 = (h2 & c) | g2;
+
+    // mac = (h + pad) % (2^128)
+    uint64_t t0 = st->pad[0];
+    uint64_t t1 = st->pad[1];
+
+    h0 += ((t0) & 0xfffffffffff); c = (h0 >> 44); h0 &= 0xfffffffffff;
+    h1 += (((t0 >> 44) | (t1 << 20)) & 0xfffffffffff) + c; c = (h1 >> 44); h1 &= 0xfffffffffff;
+    h2 += (((t1 >> 24)) & 0x3ffffffffff) + c; h2 &= 0x3ffffffffff;
+
+    h0 = ((h0) | (h1 << 44));
+    h1 = ((h1 >> 20) | (h2 << 24));
+
+    mac[0] = (uint32_t)h0;
+    mac[1] = (uint32_t)(h0 >> 32);
+    mac[2] = (uint32_t)h1;
+    mac[3] = (uint32_t)(h1 >> 32);
+}
+
+#else
+
+/* Poly1305 with 5 limbs of 26 bits using 64-bit products (poly1305-donna-32). */
+
+typedef struct carambolas_net_poly1305
+{
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} carambolas_net_poly1305_t;
+
+static
+void
+carambolas_net_poly1305_init(carambolas_net_poly1305_t* st, const uint8_t* key)
+{
+    st->r[0] = (carambolas_net_load32_le(key + 0)) & 0x3ffffff;
+    st->r[1] = (carambolas_net_load32_le(key + 3) >> 2) & 0x3ffff03;
+    st->r[2] = (carambolas_net_load32_le(key + 6) >> 4) & 0x3ffc0ff;
+    st->r[3] = (carambolas_net_load32_le(key + 9) >> 6) & 0x3f03fff;
+    st->r[4] = (carambolas_net_load32_le(key + 12) >> 8) & 0x00fffff;
+
+    for (int i = 0; i < 5; ++i)
+        st->h[i] = 0;
+
+    for (int i = 0; i < 4; ++i)
+        st->pad[i] = carambolas_net_load32_le(key + 16 + 4 * i);
+}
+
+static
+void
+carambolas_net_poly1305_blocks(carambolas_net_poly1305_t* st, const uint8_t* m, size_t length)
+{
+    const uint32_t hibit = ((uint32_t)1) << 24;
+    const uint32_t r0 = st->r[0], r1 = st->r[1], r2 = st->r[2], r3 = st->r[3], r4 = st->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    while (length >= CARAMBOLAS_NET_POLY1305_BLOCK_SIZE)
+    {
+        h0 += (carambolas_net_load32_le(m + 0)) & 0x3ffffff;
+        h1 += (carambolas_net_load32_le(m + 3) >> 2) & 0x3ffffff;
+        h2 += (carambolas_net_load32_le(m + 6) >> 4) & 0x3ffffff;
+        h3 += (carambolas_net_load32_le(m + 9) >> 6) & 0x3ffffff;
+        h4 += (carambolas_net_load32_le(m + 12) >> 8) | hibit;
+
+        uint64_t d0 = ((uint64_t)h0 * r0) + ((uint64_t)h1 * s4) + ((uint64_t)h2 * s3) + ((uint64_t)h3 * s2) + ((uint64_t)h4 * s1);
+        uint64_t d1 = ((uint64_t)h0 * r1) + ((uint64_t)h1 * r0) + ((uint64_t)h2 * s4) + ((uint64_t)h3 * s3) + ((uint64_t)h4 * s2);
+        uint64_t d2 = ((uint64_t)h0 * r2) + ((uint64_t)h1 * r1) + ((uint64_t)h2 * r0) + ((uint64_t)h3 * s4) + ((uint64_t)h4 * s3);
+        uint64_t d3 = ((uint64_t)h0 * r3) + ((uint64_t)h1 * r2) + ((uint64_t)h2 * r1) + ((uint64_t)h3 * r0) + ((uint64_t)h4 * s4);
+        uint64_t d4 = ((uint64_t)h0 * r4) + ((uint64_t)h1 * r3) + ((uint64_t)h2 * r2) + ((uint64_t)h3 * r1) + ((uint64_t)h4 * r0);
+
+        // Partial reduction mod 2^130-5
+        uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = (h0 >> 26); h0 &= 0x3ffffff;
+        h1 += c;
+
+        m += CARAMBOLAS_NET_POLY1305_BLOCK_SIZE;
+        length -= CARAMBOLAS_NET_POLY1305_BLOCK_SIZE;
+    }
+
+    st->h[0] = h0;
+    st->h[1] = h1;
+    st->h[2] = h2;
+    st->h[3] = h3;
+    st->h[4] = h4;
+}
+
+static
+void
+carambolas_net_poly1305_finish(carambolas_net_poly1305_t* st, uint32_t* mac)
+{
+    uint32_t h0 = st->h[0], h1 = st->h[1], h2 = st->h[2], h3 = st->h[3], h4 = st->h[4];
+
+    // Full carry
+    uint32_t c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // Compute h - p
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (((uint32_t)1) << 26);
+
+    // Select h if h < p, or h - p if h >= p
+    uint32_t mask = (g4 >> 31) - 1;
+    g0 &= mask;
+    g1 &= mask;
+    g2 &= mask;
+    g3 &= mask;
+    g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    // h = h % (2^128)
+    h0 = ((h0) | (h1 << 26)) & 0xffffffff;
+    h1 = ((h1 >> 6) | (h2 << 20)) & 0xffffffff;
+    h2 = ((h2 >> 12) | (h3 << 14)) & 0xffffffff;
+    h3 = ((h3 >> 18) | (h4 << 8)) & 0xffffffff;
+
+    // mac = (h + pad) % (2^128)
+    uint64_t f;
+    f = (uint64_t)h0 + st->pad[0]; mac[0] = (uint32_t)f;
+    f = (uint64_t)h1 + st->pad[1] + (f >> 32); mac[1] = (uint32_t)f;
+    f = (uint64_t)h2 + st->pad[2] + (f >> 32); mac[2] = (uint32_t)f;
+    f = (uint64_t)h3 + st->pad[3] + (f >> 32); mac[3] = (uint32_t)f;
+}
+
+#endif
+
+/* Accumulate data padded with zeros to a multiple of the block size. */
+static
+void
+carambolas_net_poly1305_update_padded(carambolas_net_poly1305_t* st, const uint8_t* m, size_t length)
+{
+    size_t n = length & ~(size_t)(CARAMBOLAS_NET_POLY1305_BLOCK_SIZE - 1);
+    carambolas_net_poly1305_blocks(st, m, n);
+
+    if (n < length)
+    {
+        uint8_t block[CARAMBOLAS_NET_POLY1305_BLOCK_SIZE] = { 0 };
+        memcpy(block, m + n, length - n);
+        carambolas_net_poly1305_blocks(st, block, CARAMBOLAS_NET_POLY1305_BLOCK_SIZE);
+    }
+}
+
+static
+void
+carambolas_net_cipher_mac(const uint32_t* key, const uint32_t* nonce, const uint8_t* buffer, int32_t aadlength, int32_t textlength, uint32_t* mac)
+{
+    if (carambolas_net_cipher_selected < 0)
+        carambolas_net_cipher_select(-1);
+
+    // The key stream is obtained by encrypting zeros.
+    uint32_t state[16];
+    uint8_t block[CARAMBOLAS_NET_CHACHA20_BLOCK_SIZE] = { 0 };
+    carambolas_net_chacha20_init(state, key, nonce, 0);
+    carambolas_net_chacha20_xor(state, block, sizeof(block));
+
+    carambolas_net_poly1305_t st;
+    carambolas_net_poly1305_init(&st, block);
+    carambolas_net_poly1305_update_padded(&st, buffer, (size_t)aadlength);
+    carambolas_net_poly1305_update_padded(&st, buffer + aadlength, (size_t)textlength);
+    carambolas_net_poly1305_finish(&st, mac);
+
+    memset(state, 0, sizeof(state));
+    memset(block, 0, sizeof(block));
+    memset(&st, 0, sizeof(st));
+}
+
+void
+carambolas_net_cipher_sign(const uint32_t* key, const uint32_t* nonce, const uint8_t* buffer, int32_t offset, int32_t aadlength, int32_t textlength, uint32_t* mac)
+{
+    carambolas_net_cipher_mac(key, nonce, buffer + offset, aadlength, textlength, mac);
+}
+
+int32_t
+carambolas_net_cipher_verify(const uint32_t* key, const uint32_t* nonce, const uint8_t* buffer, int32_t offset, int32_t aadlength, int32_t textlength, const uint32_t* mac)
+{
+    uint32_t calculated[4];
+    carambolas_net_cipher_mac(key, nonce, buffer + offset, aadlength, textlength, calculated);
+
+    // Compare in constant time.
+    uint32_t diff = (calculated[0] ^ mac[0]) | (calculated[1] ^ mac[1]) | (calculated[2] ^ mac[2]) | (calculated[3] ^ mac[3]);
+    return diff == 0;
+}
@@ -0,0 +1,254 @@
+#include "native.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Admission filter applied to each batch of received datagrams before any of them is handed to managed code.
+ *
+ * Datagrams are dropped (their lengths set to zero) in three stages:
+ *   1. malformed: unknown packet flags or a length that is invalid for the packet type;
+ *   2. corrupted: insecure packets with an invalid CRC32-C (see carambolas_net_crc32c_filter);
+ *   3. throttled: connection requests (CON and SECCON) from a source end point that has run out of tokens.
+ *
+ * Each source end point has a token bucket that is refilled at a constant rate up to a maximum (burst) and each
+ * connection request takes one token. Buckets are kept in a fixed size 4-way set-associative table where each set
+ * occupies exactly one cache line so a lookup touches a single line. When a set is full the least recently seen
+ * source is evicted. A spoofed flood from many sources may evict legitimate entries but a source that has been
+ * evicted simply starts over with a full bucket so the worst case is that the limit is not enforced.
+ *
+ * A filter is not thread-safe. Each worker thread is expected to have its own.
+ */
+
+#define CARAMBOLAS_NET_FILTER_WAYS              4
+
+/* Tokens are kept in thousandths so that the bucket can be refilled by the millisecond. */
+#define CARAMBOLAS_NET_FILTER_TOKEN             1000u
+
+/* Position of the packet flags in a datagram: STM(4) PFLAGS(1) ... */
+#define CARAMBOLAS_NET_FILTER_HEADER            5
+
+typedef struct
+{
+    uint64_t keys[CARAMBOLAS_NET_FILTER_WAYS];      /* Source end point hash (0 if empty). */
+    uint32_t stamps[CARAMBOLAS_NET_FILTER_WAYS];    /* Time of the last refill in milliseconds since the filter was created. */
+    uint32_t tokens[CARAMBOLAS_NET_FILTER_WAYS];    /* Tokens available in thousandths. */
+} carambolas_net_filter_set_t;
+
+struct carambolas_net_filter
+{
+    carambolas_net_filter_set_t* sets;
+    void* block;
+    uint32_t mask;
+    uint32_t rate;
+    uint32_t burst;
+    uint64_t seed;
+    int64_t origin;
+    carambolas_net_filter_counters_t counters;
+};
+
+static inline
+uint64_t
+carambolas_net_filter_mix(uint64_t x)
+{
+    // Finalizer of splitmix64.
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline
+uint64_t
+carambolas_net_filter_hash(const carambolas_net_filter_t* filter, const carambolas_net_socket_endpoint_t* endpoint)
+{
+    uint64_t a, b;
+    memcpy(&a, (const uint8_t*)endpoint, sizeof(a));
+    memcpy(&b, (const uint8_t*)endpoint + sizeof(a), sizeof(b));
+
+    uint64_t h = carambolas_net_filter_mix(filter->seed ^ a);
+    h = carambolas_net_filter_mix(h ^ b);
+    h = carambolas_net_filter_mix(h ^ endpoint->port);
+
+    // Zero marks an empty entry.
+    return h ? h : 1;
+}
+
+/* Returns non-zero if the datagram has valid flags and a valid length for its packet type. */
+static inline
+int
+carambolas_net_filter_validate(uint8_t flags, int32_t length)
+{
+    int32_t n = length - CARAMBOLAS_NET_FILTER_HEADER;
+    switch (flags)
+    {
+        case CARAMBOLAS_NET_PACKET_CONNECT:             // SSN(4) MTU(2) MTC(1) MBW(4) [CTM(4) TAG(4)] CRC(4)
+            return n == 15 || n == 23;
+        case CARAMBOLAS_NET_PACKET_SECURE_CONNECT:      // SSN(4) MTU(2) MTC(1) MBW(4) PUBKEY(32) [CTM(4) TAG(4)] CRC(4)
+            return n == 47 || n == 55;
+        case CARAMBOLAS_NET_PACKET_CHALLENGE:           // SSN(4) TAG(4) CRC(4)
+            return n == 12;
+        case CARAMBOLAS_NET_PACKET_ACCEPT:              // SSN(4) MTU(2) MTC(1) MBW(4) ATM(4) RW(2) ASSN(4) CRC(4)
+            return n == 25;
+        case CARAMBOLAS_NET_PACKET_SECURE_ACCEPT:       // SSN(4) MTU(2) MTC(1) MBW(4) ATM(4) {RW(2)} PUBKEY(32) NONCE(8) MAC(16)
+            return n == 73;
+        case CARAMBOLAS_NET_PACKET_DATA:                // SSN(4) RW(2) MSGS(N) CRC(4)
+            return n > 10;
+        case CARAMBOLAS_NET_PACKET_SECURE_DATA:         // {RW(2) MSGS(N)} NONCE(8) MAC(16)
+            return n > 26;
+        case CARAMBOLAS_NET_PACKET_RESET:               // SSN(4) CRC(4)
+            return n == 8;
+        case CARAMBOLAS_NET_PACKET_SECURE_RESET:        // PUBKEY(32) NONCE(8) MAC(16)
+            return n == 56;
+        default:
+            return 0;
+    }
+}
+
+/* Take one token from the bucket of a source end point. Returns non-zero if there was a token available. */
+static inline
+int
+carambolas_net_filter_take(carambolas_net_filter_t* filter, const carambolas_net_socket_endpoint_t* endpoint, uint32_t now)
+{
+    uint64_t key = carambolas_net_filter_hash(filter, endpoint);
+    carambolas_net_filter_set_t* set = &filter->sets[(uint32_t)(key >> 32) & filter->mask];
+
+    int victim = 0;
+    for (int i = 0; i < CARAMBOLAS_NET_FILTER_WAYS; ++i)
+    {
+        if (set->keys[i] == key)
+        {
+            uint64_t tokens = set->tokens[i] + (uint64_t)(now - set->stamps[i]) * filter->rate;
+            if (tokens > filter->burst)
+                tokens = filter->burst;
+
+            set->stamps[i] = now;
+            if (tokens < CARAMBOLAS_NET_FILTER_TOKEN)
+            {
+                set->tokens[i] = (uint32_t)tokens;
+                return 0;
+            }
+
+            set->tokens[i] = (uint32_t)(tokens - CARAMBOLAS_NET_FILTER_TOKEN);
+            return 1;
+        }
+
+        // Prefer an empty entry otherwise the least recently seen.
+        if (set->keys[victim] != 0 && (set->keys[i] == 0 || (int32_t)(set->stamps[i] - set->stamps[victim]) < 0))
+            victim = i;
+    }
+
+    set->keys[victim] = key;
+    set->stamps[victim] = now;
+    set->tokens[victim] = filter->burst - CARAMBOLAS_NET_FILTER_TOKEN;
+    return 1;
+}
+
+carambolas_net_socket_error_t
+carambolas_net_filter_create(int32_t capacity, int32_t rate, int32_t burst, carambolas_net_filter_t** filter)
+{
+    *filter = NULL;
+
+    if (capacity <= 0 || rate < 0 || burst < 0 || (rate > 0 && burst == 0) || burst > (int32_t)(UINT32_MAX / CARAMBOLAS_NET_FILTER_TOKEN))
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    carambolas_net_filter_t* f = (carambolas_net_filter_t*)calloc(1, sizeof(carambolas_net_filter_t));
+    if (f == NULL)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+
+    // Number of sets rounded up to a power of 2.
+    uint32_t nsets = 1;
+    while (nsets < (uint32_t)(capacity + CARAMBOLAS_NET_FILTER_WAYS - 1) / CARAMBOLAS_NET_FILTER_WAYS && nsets < (1u << 24))
+        nsets <<= 1;
+
+    // Align sets to a cache line by hand because aligned allocation is not portable.
+    f->block = calloc(nsets + 1, sizeof(carambolas_net_filter_set_t));
+    if (f->block == NULL)
+    {
+        free(f);
+        return CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+    }
+
+    f->sets = (carambolas_net_filter_set_t*)(((uintptr_t)f->block + sizeof(carambolas_net_filter_set_t) - 1) & ~(uintptr_t)(sizeof(carambolas_net_filter_set_t) - 1));
+    f->mask = nsets - 1;
+    f->rate = (uint32_t)rate;
+    f->burst = (uint32_t)burst * CARAMBOLAS_NET_FILTER_TOKEN;
+    f->origin = carambolas_net_clock_now();
+
+    // The seed prevents a remote host from choosing end points that collide. It doesn't have to be
+    // cryptographically strong, just unknown.
+    f->seed = carambolas_net_filter_mix((uint64_t)f->origin ^ (uint64_t)(uintptr_t)f ^ ((uint64_t)(uintptr_t)f->block << 32));
+
+    *filter = f;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+void
+carambolas_net_filter_destroy(carambolas_net_filter_t* filter)
+{
+    if (filter == NULL)
+        return;
+
+    free(filter->block);
+    free(filter);
+}
+
+int32_t
+carambolas_net_filter_apply(carambolas_net_filter_t* filter, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths)
+{
+    int32_t nmalformed = 0;
+    int32_t npassed = 0;
+
+    for (int32_t i = 0; i < count; ++i)
+    {
+        int32_t length = lengths[i];
+        if (length <= 0)
+            continue;
+
+        const uint8_t* datagram = buffer + offset + (size_t)i * (size_t)stride;
+        if (length < CARAMBOLAS_NET_FILTER_HEADER || !carambolas_net_filter_validate(datagram[CARAMBOLAS_NET_FILTER_HEADER - 1], length))
+        {
+            lengths[i] = 0;
+            nmalformed++;
+        }
+        else
+        {
+            npassed++;
+        }
+    }
+
+    int32_t ncorrupted = (npassed > 0) ? carambolas_net_crc32c_filter(buffer, offset, stride, count, lengths) : 0;
+    int32_t nthrottled = 0;
+
+    if (filter->rate > 0 && npassed > ncorrupted)
+    {
+        uint32_t now = (uint32_t)((carambolas_net_clock_now() - filter->origin) / 1000000);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            if (lengths[i] <= 0)
+                continue;
+
+            uint8_t flags = buffer[offset + (size_t)i * (size_t)stride + CARAMBOLAS_NET_FILTER_HEADER - 1];
+            if ((flags == CARAMBOLAS_NET_PACKET_CONNECT || flags == CARAMBOLAS_NET_PACKET_SECURE_CONNECT)
+                && !carambolas_net_filter_take(filter, &endpoints[i], now))
+            {
+                lengths[i] = 0;
+                nthrottled++;
+            }
+        }
+    }
+
+    filter->counters.passed += npassed - ncorrupted - nthrottled;
+    filter->counters.malformed += nmalformed;
+    filter->counters.corrupted += ncorrupted;
+    filter->counters.throttled += nthrottled;
+
+    return nmalformed + ncorrupted + nthrottled;
+}
+
+void
+carambolas_net_filter_counters(carambolas_net_filter_t* filter, carambolas_net_filter_counters_t* counters)
+{
+    *counters = filter->counters;
+}
@@ -0,0 +1,407 @@
+#include "native.h"
+#include <string.h>
+
+/*
+ * X25519 (RFC 7748) as used to agree on session keys. This must produce exactly the same output as
+ * Carambolas.Security.Cryptography.NaCl.Curve25519 (managed) because remote peers may be using either
+ * implementation.
+ *
+ * Field elements are represented in radix 2^51 (5 limbs of 64 bits) so that a field multiplication is
+ * 25 64x64->128 bit multiplications. The Montgomery ladder and every field operation run in constant
+ * time regardless of the secret scalar.
+ *
+ * Keys are passed as arrays of 32-bit words in host byte order which is how they are laid out by the
+ * managed struct.
+ */
+
+#define CARAMBOLAS_NET_FE_MASK                  0x7FFFFFFFFFFFFull
+
+typedef uint64_t carambolas_net_fe_t[5];
+
+#if defined(__SIZEOF_INT128__)
+
+typedef unsigned __int128 carambolas_net_u128_t;
+
+static inline carambolas_net_u128_t carambolas_net_mul64(uint64_t a, uint64_t b) { return (carambolas_net_u128_t)a * b; }
+static inline carambolas_net_u128_t carambolas_net_add128(carambolas_net_u128_t a, carambolas_net_u128_t b) { return a + b; }
+static inline carambolas_net_u128_t carambolas_net_add64(carambolas_net_u128_t a, uint64_t b) { return a + b; }
+static inline uint64_t carambolas_net_lo64(carambolas_net_u128_t a) { return (uint64_t)a; }
+static inline uint64_t carambolas_net_shr51(carambolas_net_u128_t a) { return (uint64_t)(a >> 51); }
+
+#else
+
+/* Compilers without a native 128-bit integer (e.g. MSVC) get the same arithmetic on a pair of words. */
+typedef struct { uint64_t lo, hi; } carambolas_net_u128_t;
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+
+static inline
+carambolas_net_u128_t
+carambolas_net_mul64(uint64_t a, uint64_t b)
+{
+    carambolas_net_u128_t r;
+    r.lo = _umul128(a, b, &r.hi);
+    return r;
+}
+
+#else
+
+static inline
+carambolas_net_u128_t
+carambolas_net_mul64(uint64_t a, uint64_t b)
+{
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+    uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    carambolas_net_u128_t r;
+    r.lo = (mid << 32) | (uint32_t)p00;
+    r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return r;
+}
+
+#endif
+
+static inline
+carambolas_net_u128_t
+carambolas_net_add128(carambolas_net_u128_t a, carambolas_net_u128_t b)
+{
+    carambolas_net_u128_t r;
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi + (r.lo < a.lo);
+    return r;
+}
+
+static inline
+carambolas_net_u128_t
+carambolas_net_add64(carambolas_net_u128_t a, uint64_t b)
+{
+    carambolas_net_u128_t r;
+    r.lo = a.lo + b;
+    r.hi = a.hi + (r.lo < a.lo);
+    return r;
+}
+
+static inline uint64_t carambolas_net_lo64(carambolas_net_u128_t a) { return a.lo; }
+static inline uint64_t carambolas_net_shr51(carambolas_net_u128_t a) { return (a.lo >> 51) | (a.hi << 13); }
+
+#endif
+
+#define MUL(a, b)                               carambolas_net_mul64((a), (b))
+#define MAC(t, a, b)                            t = carambolas_net_add128(t, carambolas_net_mul64((a), (b)))
+
+/*
+ * Propagate the carries of 128-bit limbs into an element with limbs of 51 bits (plus a small excess in
+ * the second limb). The carry out of the top limb wraps around multiplied by 19 since 2^255 = 19 (mod p).
+ */
+static inline
+void
+carambolas_net_fe_carry(carambolas_net_fe_t out, carambolas_net_u128_t t0, carambolas_net_u128_t t1, carambolas_net_u128_t t2, carambolas_net_u128_t t3, carambolas_net_u128_t t4)
+{
+    uint64_t r0, r1, r2, r3, r4, c;
+
+    r0 = carambolas_net_lo64(t0) & CARAMBOLAS_NET_FE_MASK; c = carambolas_net_shr51(t0);
+    t1 = carambolas_net_add64(t1, c);
+    r1 = carambolas_net_lo64(t1) & CARAMBOLAS_NET_FE_MASK; c = carambolas_net_shr51(t1);
+    t2 = carambolas_net_add64(t2, c);
+    r2 = carambolas_net_lo64(t2) & CARAMBOLAS_NET_FE_MASK; c = carambolas_net_shr51(t2);
+    t3 = carambolas_net_add64(t3, c);
+    r3 = carambolas_net_lo64(t3) & CARAMBOLAS_NET_FE_MASK; c = carambolas_net_shr51(t3);
+    t4 = carambolas_net_add64(t4, c);
+    r4 = carambolas_net_lo64(t4) & CARAMBOLAS_NET_FE_MASK; c = carambolas_net_shr51(t4);
+
+    r0 += c * 19; c = r0 >> 51; r0 &= CARAMBOLAS_NET_FE_MASK;
+    r1 += c;
+
+    out[0] = r0;
+    out[1] = r1;
+    out[2] = r2;
+    out[3] = r3;
+    out[4] = r4;
+}
+
+static inline
+void
+carambolas_net_fe_copy(carambolas_net_fe_t out, const carambolas_net_fe_t a)
+{
+    memcpy(out, a, sizeof(carambolas_net_fe_t));
+}
+
+static inline
+void
+carambolas_net_fe_add(carambolas_net_fe_t out, const carambolas_net_fe_t a, const carambolas_net_fe_t b)
+{
+    for (int i = 0; i < 5; ++i)
+        out[i] = a[i] + b[i];
+}
+
+/* out = a - b computed as a + 2p - b so that limbs never go negative. */
+static inline
+void
+carambolas_net_fe_sub(carambolas_net_fe_t out, const carambolas_net_fe_t a, const carambolas_net_fe_t b)
+{
+    out[0] = a[0] + 0xFFFFFFFFFFFDAull - b[0];
+    out[1] = a[1] + 0xFFFFFFFFFFFFEull - b[1];
+    out[2] = a[2] + 0xFFFFFFFFFFFFEull - b[2];
+    out[3] = a[3] + 0xFFFFFFFFFFFFEull - b[3];
+    out[4] = a[4] + 0xFFFFFFFFFFFFEull - b[4];
+}
+
+static
+void
+carambolas_net_fe_mul(carambolas_net_fe_t out, const carambolas_net_fe_t a, const carambolas_net_fe_t b)
+{
+    const uint64_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3], a4 = a[4];
+    const uint64_t b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3], b4 = b[4];
+    const uint64_t b1_19 = b1 * 19, b2_19 = b2 * 19, b3_19 = b3 * 19, b4_19 = b4 * 19;
+
+    carambolas_net_u128_t t0, t1, t2, t3, t4;
+
+    t0 = MUL(a0, b0); MAC(t0, a1, b4_19); MAC(t0, a2, b3_19); MAC(t0, a3, b2_19); MAC(t0, a4, b1_19);
+    t1 = MUL(a0, b1); MAC(t1, a1, b0);    MAC(t1, a2, b4_19); MAC(t1, a3, b3_19); MAC(t1, a4, b2_19);
+    t2 = MUL(a0, b2); MAC(t2, a1, b1);    MAC(t2, a2, b0);    MAC(t2, a3, b4_19); MAC(t2, a4, b3_19);
+    t3 = MUL(a0, b3); MAC(t3, a1, b2);    MAC(t3, a2, b1);    MAC(t3, a3, b0);    MAC(t3, a4, b4_19);
+    t4 = MUL(a0, b4); MAC(t4, a1, b3);    MAC(t4, a2, b2);    MAC(t4, a3, b1);    MAC(t4, a4, b0);
+
+    carambolas_net_fe_carry(out, t0, t1, t2, t3, t4);
+}
+
+static
+void
+carambolas_net_fe_sq(carambolas_net_fe_t out, const carambolas_net_fe_t a)
+{
+    const uint64_t a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3], a4 = a[4];
+    const uint64_t d0 = a0 * 2, d1 = a1 * 2, d2 = a2 * 2, d3 = a3 * 2;
+    const uint64_t a3_19 = a3 * 19, a4_19 = a4 * 19;
+
+    carambolas_net_u128_t t0, t1, t2, t3, t4;
+
+    t0 = MUL(a0, a0); MAC(t0, d1, a4_19); MAC(t0, d2, a3_19);
+    t1 = MUL(d0, a1); MAC(t1, d2, a4_19); MAC(t1, a3, a3_19);
+    t2 = MUL(d0, a2); MAC(t2, a1, a1);    MAC(t2, d3, a4_19);
+    t3 = MUL(d0, a3); MAC(t3, d1, a2);    MAC(t3, a4, a4_19);
+    t4 = MUL(d0, a4); MAC(t4, d1, a3);    MAC(t4, a2, a2);
+
+    carambolas_net_fe_carry(out, t0, t1, t2, t3, t4);
+}
+
+static
+void
+carambolas_net_fe_sqn(carambolas_net_fe_t out, const carambolas_net_fe_t a, int n)
+{
+    carambolas_net_fe_sq(out, a);
+    while (--n > 0)
+        carambolas_net_fe_sq(out, out);
+}
+
+/* out = a * 121665 ((486662 - 2) / 4) */
+static
+void
+carambolas_net_fe_mul121665(carambolas_net_fe_t out, const carambolas_net_fe_t a)
+{
+    carambolas_net_fe_carry(out, MUL(a[0], 121665), MUL(a[1], 121665), MUL(a[2], 121665), MUL(a[3], 121665), MUL(a[4], 121665));
+}
+
+/* out = z^(p - 2) = z^(2^255 - 21) = 1/z */
+static
+void
+carambolas_net_fe_invert(carambolas_net_fe_t out, const carambolas_net_fe_t z)
+{
+    carambolas_net_fe_t a, b, c, t;
+
+    carambolas_net_fe_sq(a, z);                 /* 2 */
+    carambolas_net_fe_sqn(t, a, 2);             /* 8 */
+    carambolas_net_fe_mul(b, t, z);             /* 9 */
+    carambolas_net_fe_mul(a, b, a);             /* 11 */
+    carambolas_net_fe_sq(t, a);                 /* 22 */
+    carambolas_net_fe_mul(b, t, b);             /* 2^5 - 2^0 */
+    carambolas_net_fe_sqn(t, b, 5);             /* 2^10 - 2^5 */
+    carambolas_net_fe_mul(b, t, b);             /* 2^10 - 2^0 */
+    carambolas_net_fe_sqn(t, b, 10);            /* 2^20 - 2^10 */
+    carambolas_net_fe_mul(c, t, b);             /* 2^20 - 2^0 */
+    carambolas_net_fe_sqn(t, c, 20);            /* 2^40 - 2^20 */
+    carambolas_net_fe_mul(t, t, c);             /* 2^40 - 2^0 */
+    carambolas_net_fe_sqn(t, t, 10);            /* 2^50 - 2^10 */
+    carambolas_net_fe_mul(b, t, b);             /* 2^50 - 2^0 */
+    carambolas_net_fe_sqn(t, b, 50);            /* 2^100 - 2^50 */
+    carambolas_net_fe_mul(c, t, b);             /* 2^100 - 2^0 */
+    carambolas_net_fe_sqn(t, c, 100);           /* 2^200 - 2^100 */
+    carambolas_net_fe_mul(t, t, c);             /* 2^200 - 2^0 */
+    carambolas_net_fe_sqn(t, t, 50);            /* 2^250 - 2^50 */
+    carambolas_net_fe_mul(t, t, b);             /* 2^250 - 2^0 */
+    carambolas_net_fe_sqn(t, t, 5);             /* 2^255 - 2^5 */
+    carambolas_net_fe_mul(out, t, a);           /* 2^255 - 21 */
+}
+
+/* Swap a and b if swap is 1; do nothing if swap is 0. */
+static inline
+void
+carambolas_net_fe_cswap(carambolas_net_fe_t a, carambolas_net_fe_t b, uint64_t swap)
+{
+    const uint64_t mask = (uint64_t)0 - swap;
+    for (int i = 0; i < 5; ++i)
+    {
+        uint64_t x = mask & (a[i] ^ b[i]);
+        a[i] ^= x;
+        b[i] ^= x;
+    }
+}
+
+static inline
+uint64_t
+carambolas_net_load64_le(const uint8_t* p)
+{
+    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+        | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline
+void
+carambolas_net_key_to_bytes(uint8_t* out, const uint32_t* key)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        out[4 * i + 0] = (uint8_t)(key[i]);
+        out[4 * i + 1] = (uint8_t)(key[i] >> 8);
+        out[4 * i + 2] = (uint8_t)(key[i] >> 16);
+        out[4 * i + 3] = (uint8_t)(key[i] >> 24);
+    }
+}
+
+/* The most significant bit of the input is ignored as required by RFC 7748. */
+static
+void
+carambolas_net_fe_from_key(carambolas_net_fe_t out, const uint32_t* key)
+{
+    uint8_t s[32];
+    carambolas_net_key_to_bytes(s, key);
+
+    out[0] = carambolas_net_load64_le(s) & CARAMBOLAS_NET_FE_MASK;
+    out[1] = (carambolas_net_load64_le(s + 6) >> 3) & CARAMBOLAS_NET_FE_MASK;
+    out[2] = (carambolas_net_load64_le(s + 12) >> 6) & CARAMBOLAS_NET_FE_MASK;
+    out[3] = (carambolas_net_load64_le(s + 19) >> 1) & CARAMBOLAS_NET_FE_MASK;
+    out[4] = (carambolas_net_load64_le(s + 24) >> 12) & CARAMBOLAS_NET_FE_MASK;
+}
+
+static inline
+void
+carambolas_net_fe_carry_full(uint64_t* t)
+{
+    t[1] += t[0] >> 51; t[0] &= CARAMBOLAS_NET_FE_MASK;
+    t[2] += t[1] >> 51; t[1] &= CARAMBOLAS_NET_FE_MASK;
+    t[3] += t[2] >> 51; t[2] &= CARAMBOLAS_NET_FE_MASK;
+    t[4] += t[3] >> 51; t[3] &= CARAMBOLAS_NET_FE_MASK;
+    t[0] += 19 * (t[4] >> 51); t[4] &= CARAMBOLAS_NET_FE_MASK;
+}
+
+/* Fully reduce modulo p and pack into 8 little endian words. */
+static
+void
+carambolas_net_fe_to_key(uint32_t* key, const carambolas_net_fe_t a)
+{
+    uint64_t t[5];
+    memcpy(t, a, sizeof(t));
+
+    carambolas_net_fe_carry_full(t);
+    carambolas_net_fe_carry_full(t);
+
+    // Now 0 <= t < 2^255. Adding 19 makes values >= p overflow into bit 255.
+    t[0] += 19;
+    carambolas_net_fe_carry_full(t);
+
+    // Now 19 <= t < 2^255 + 19 (mod 2^255). Add 2^255 - 19 and drop bit 255 to subtract p if needed.
+    t[0] += 0x8000000000000ull - 19;
+    t[1] += 0x8000000000000ull - 1;
+    t[2] += 0x8000000000000ull - 1;
+    t[3] += 0x8000000000000ull - 1;
+    t[4] += 0x8000000000000ull - 1;
+
+    t[1] += t[0] >> 51; t[0] &= CARAMBOLAS_NET_FE_MASK;
+    t[2] += t[1] >> 51; t[1] &= CARAMBOLAS_NET_FE_MASK;
+    t[3] += t[2] >> 51; t[2] &= CARAMBOLAS_NET_FE_MASK;
+    t[4] += t[3] >> 51; t[3] &= CARAMBOLAS_NET_FE_MASK;
+    t[4] &= CARAMBOLAS_NET_FE_MASK;
+
+    const uint64_t w0 = t[0] | (t[1] << 51);
+    const uint64_t w1 = (t[1] >> 13) | (t[2] << 38);
+    const uint64_t w2 = (t[2] >> 26) | (t[3] << 25);
+    const uint64_t w3 = (t[3] >> 39) | (t[4] << 12);
+
+    key[0] = (uint32_t)w0; key[1] = (uint32_t)(w0 >> 32);
+    key[2] = (uint32_t)w1; key[3] = (uint32_t)(w1 >> 32);
+    key[4] = (uint32_t)w2; key[5] = (uint32_t)(w2 >> 32);
+    key[6] = (uint32_t)w3; key[7] = (uint32_t)(w3 >> 32);
+}
+
+/* result = scalar X point (Montgomery ladder, RFC 7748 section 5) */
+static
+void
+carambolas_net_x25519(uint32_t* result, const uint32_t* scalar, const uint32_t* point)
+{
+    uint8_t k[32];
+    carambolas_net_key_to_bytes(k, scalar);
+    k[0] &= 248;
+    k[31] &= 127;
+    k[31] |= 64;
+
+    carambolas_net_fe_t x1, x2, z2, x3, z3;
+    carambolas_net_fe_t a, aa, b, bb, e, c, d, da, cb;
+
+    carambolas_net_fe_from_key(x1, point);
+    memset(x2, 0, sizeof(x2)); x2[0] = 1;
+    memset(z2, 0, sizeof(z2));
+    carambolas_net_fe_copy(x3, x1);
+    memset(z3, 0, sizeof(z3)); z3[0] = 1;
+
+    uint64_t swap = 0;
+    for (int pos = 254; pos >= 0; --pos)
+    {
+        uint64_t bit = (k[pos >> 3] >> (pos & 7)) & 1;
+        swap ^= bit;
+        carambolas_net_fe_cswap(x2, x3, swap);
+        carambolas_net_fe_cswap(z2, z3, swap);
+        swap = bit;
+
+        carambolas_net_fe_add(a, x2, z2);
+        carambolas_net_fe_sq(aa, a);
+        carambolas_net_fe_sub(b, x2, z2);
+        carambolas_net_fe_sq(bb, b);
+        carambolas_net_fe_sub(e, aa, bb);
+        carambolas_net_fe_add(c, x3, z3);
+        carambolas_net_fe_sub(d, x3, z3);
+        carambolas_net_fe_mul(da, d, a);
+        carambolas_net_fe_mul(cb, c, b);
+
+        carambolas_net_fe_add(x3, da, cb);
+        carambolas_net_fe_sq(x3, x3);
+        carambolas_net_fe_sub(z3, da, cb);
+        carambolas_net_fe_sq(z3, z3);
+        carambolas_net_fe_mul(z3, z3, x1);
+        carambolas_net_fe_mul(x2, aa, bb);
+        carambolas_net_fe_mul121665(z2, e);
+        carambolas_net_fe_add(z2, z2, aa);
+        carambolas_net_fe_mul(z2, z2, e);
+    }
+
+    carambolas_net_fe_cswap(x2, x3, swap);
+    carambolas_net_fe_cswap(z2, z3, swap);
+
+    carambolas_net_fe_invert(z2, z2);
+    carambolas_net_fe_mul(x2, x2, z2);
+    carambolas_net_fe_to_key(result, x2);
+}
+
+static const uint32_t carambolas_net_x25519_basepoint[8] = { 9, 0, 0, 0, 0, 0, 0, 0 };
+
+void
+carambolas_net_keychain_create_public_key(const uint32_t* privatekey, uint32_t* publickey)
+{
+    carambolas_net_x25519(publickey, privatekey, carambolas_net_x25519_basepoint);
+}
+
+void
+carambolas_net_keychain_create_shared_key(const uint32_t* privatekey, const uint32_t* remotekey, uint32_t* sharedkey)
+{
+    carambolas_net_x25519(sharedkey, privatekey, remotekey);
+}
@@ -1,3 +1,7 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "native.h"
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +14,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <errno.h>
 
 #define SOCKET int32_t
@@ -45,7 +50,93 @@
 #else
 
 #ifdef LINUX
+#include <netinet/udp.h>
+
 #define HAVE_IP_MTU_DISCOVER
+#define HAVE_RECVMMSG
+#define HAVE_SENDMMSG
+#define HAVE_UDP_SEGMENT
+#define HAVE_UDP_GRO
+#define HAVE_EPOLL
+#define HAVE_REUSEPORT
+#define HAVE_REUSEPORT_CBPF
+#define HAVE_SO_TIMESTAMPNS
+#define HAVE_SO_RXQ_OVFL
+#define HAVE_IP_RECVTOS
+#define HAVE_SO_TXTIME
+#define HAVE_SO_MAX_PACING_RATE
+#define HAVE_SO_ZEROCOPY
+#define HAVE_IP_PKTINFO
+#define HAVE_IPV6_PKTINFO
+#define HAVE_TIMERFD
+
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+/* Defined by the build when the kernel headers provide io_uring with multishot receive and provided buffer rings. */
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <signal.h>
+#endif
+
+/* Older C libraries may not define these even though the running kernel supports them. */
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT                             103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO                                 104
+#endif
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT                            15
+#endif
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF                51
+#endif
+
+#ifndef SO_TIMESTAMPNS
+#define SO_TIMESTAMPNS                          35
+#endif
+
+#ifndef SCM_TIMESTAMPNS
+#define SCM_TIMESTAMPNS                         SO_TIMESTAMPNS
+#endif
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL                             40
+#endif
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY                             60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY                            0x4000000
+#endif
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY                   5
+#endif
+
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED              1
+#endif
+
+/* 
+ * Maximum number of segments in a datagram train sent with MSG_ZEROCOPY. Each segment is pinned as one or two 
+ * page fragments and the kernel rejects (EMSGSIZE) a datagram with more fragments than MAX_SKB_FRAGS (17 by default).
+ */
+#define CARAMBOLAS_NET_SOCKET_ZEROCOPY_SEGMENT_MAX     8
+
+#include <time.h>
 #endif
 
 enum
@@ -432,7 +523,10 @@ carambolas_net_convert_sockopt(int32_t level, int32_t optname, int32_t *system_l
             return -1;
 #endif
         case SocketOptionName_PacketInformation:
-#ifdef HAVE_IPV6_PKTINFO
+#if defined(HAVE_IPV6_PKTINFO) && defined(IPV6_RECVPKTINFO)
+            /* IPV6_PKTINFO sets the sticky source address on Linux (RFC 3542) */
+            *system_name = IPV6_RECVPKTINFO;
+#elif defined(HAVE_IPV6_PKTINFO)
             *system_name = IPV6_PKTINFO;
 #endif
             break;
@@ -541,6 +635,23 @@ carambolas_net_socket_open(int32_t addressFamily, carambolas_net_socket_t* sockf
     }
 #endif
 
+#ifdef HAVE_SO_RXQ_OVFL
+    // Have the kernel report the number of datagrams it had to drop for lack of buffer space. The count is only 
+    // delivered to receive operations that provide room for control messages. Failure is not an error.
+    int one = 1;
+    setsockopt(handle, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+#endif
+
+#ifdef IPV6_V6ONLY
+    // IPv6 sockets are dual-stack by default so that a single socket can serve both IPv4 and IPv6 peers regardless 
+    // of the platform default (e.g. Windows or Linux with net.ipv6.bindv6only). Failure is not an error.
+    if (addressFamily == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        int v6only = 0;
+        setsockopt(handle, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6only, sizeof(v6only));
+    }
+#endif
+
     *sockfd = (carambolas_net_socket_t)handle;
     return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
 }
@@ -683,6 +794,439 @@ carambolas_net_socket_setblocking(carambolas_net_socket_t sockfd, int32_t value)
     return carambolas_net_socket_getlasterror();
 }
 
+#ifdef HAVE_UDP_SEGMENT
+/*
+ * One if the running kernel supports UDP_SEGMENT, zero if it does not and -1 if it has not been probed yet.
+ * Kernels older than 4.18 silently ignore the control message and would transmit a whole train as a single 
+ * oversized datagram so support must be confirmed before any segmented send.
+ */
+static volatile int32_t carambolas_net_socket_udp_segment_supported = -1;
+
+static
+int32_t
+carambolas_net_socket_udp_segment(carambolas_net_socket_t sockfd)
+{
+    if (carambolas_net_socket_udp_segment_supported < 0)
+    {
+        int32_t value = 0;
+        socklen_t len = sizeof(value);
+        carambolas_net_socket_udp_segment_supported = (getsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &value, &len) == 0) ? 1 : 0;
+    }
+
+    return carambolas_net_socket_udp_segment_supported;
+}
+#endif
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setoffload(carambolas_net_socket_t sockfd, int32_t flags, int32_t* enabled)
+{
+    *enabled = 0;
+
+#ifdef HAVE_UDP_SEGMENT
+    if ((flags & CARAMBOLAS_NET_SOCKET_OFFLOAD_SEGMENTATION) && carambolas_net_socket_udp_segment(sockfd))
+        *enabled |= CARAMBOLAS_NET_SOCKET_OFFLOAD_SEGMENTATION;
+#endif
+
+#ifdef HAVE_UDP_GRO
+    int32_t value = (flags & CARAMBOLAS_NET_SOCKET_OFFLOAD_COALESCING) ? 1 : 0;
+    if (setsockopt(sockfd, SOL_UDP, UDP_GRO, &value, sizeof(value)) == 0)
+    {
+        if (value)
+            *enabled |= CARAMBOLAS_NET_SOCKET_OFFLOAD_COALESCING;
+    }
+    else if (errno != ENOPROTOOPT) // Kernels older than 5.0 do not support UDP_GRO which is simply reported as not enabled.
+    {
+        return carambolas_net_socket_getlasterror();
+    }
+#endif
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_settimestamping(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled)
+{
+    *enabled = 0;
+
+#ifdef HAVE_SO_TIMESTAMPNS
+    value = value ? 1 : 0;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &value, sizeof(value)) == 0)
+    {
+        *enabled = value;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setecn(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled)
+{
+    *enabled = 0;
+
+#ifdef HAVE_IP_RECVTOS
+    // Mark outgoing datagrams ECT(0) keeping the DSCP bits already set and have the kernel report the TOS 
+    // (traffic class) byte of each datagram received. An IPv6 socket may also carry IPv4 traffic (dual-stack) 
+    // so both levels are set and the option is enabled if either succeeds.
+    int32_t ecn = value ? CARAMBOLAS_NET_SOCKET_ECN_ECT0 : CARAMBOLAS_NET_SOCKET_ECN_NOT_ECT;
+    int32_t recv = value ? 1 : 0;
+    int32_t tos = 0;
+    socklen_t size = sizeof(tos);
+    int r4 = getsockopt(sockfd, IPPROTO_IP, IP_TOS, &tos, &size);
+    if (r4 == 0)
+    {
+        tos = (tos & ~0x03) | ecn;
+        r4 = setsockopt(sockfd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+        if (r4 == 0)
+            r4 = setsockopt(sockfd, IPPROTO_IP, IP_RECVTOS, &recv, sizeof(recv));
+    }
+
+    int32_t tclass = 0;
+    size = sizeof(tclass);
+    int r6 = getsockopt(sockfd, IPPROTO_IPV6, IPV6_TCLASS, &tclass, &size);
+    if (r6 == 0)
+    {
+        tclass = (tclass & ~0x03) | ecn;
+        r6 = setsockopt(sockfd, IPPROTO_IPV6, IPV6_TCLASS, &tclass, sizeof(tclass));
+        if (r6 == 0)
+            r6 = setsockopt(sockfd, IPPROTO_IPV6, IPV6_RECVTCLASS, &recv, sizeof(recv));
+    }
+
+    if (r4 == 0 || r6 == 0)
+    {
+        *enabled = recv;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setpacing(carambolas_net_socket_t sockfd, int32_t value, int32_t* mode)
+{
+    *mode = CARAMBOLAS_NET_SOCKET_PACING_NONE;
+
+    if (!value)
+    {
+        // Launch times are only applied to datagrams that carry one so there's nothing to undo for SO_TXTIME.
+#ifdef HAVE_SO_MAX_PACING_RATE
+        uint32_t rate = ~0u;
+        setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate));
+#endif
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+#ifdef HAVE_SO_TXTIME
+    // Launch times are taken from the monotonic clock which is what the fq qdisc expects (earliest departure time).
+    // With a qdisc that is not time-aware datagrams simply leave as soon as possible.
+    struct sock_txtime txtime = { CLOCK_MONOTONIC, 0 };
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) == 0)
+    {
+        *mode = CARAMBOLAS_NET_SOCKET_PACING_LAUNCHTIME;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+#endif
+
+#ifdef HAVE_SO_MAX_PACING_RATE
+    // Older kernels can only pace the socket as a whole at a maximum rate (see carambolas_net_socket_setpacingrate).
+    uint32_t rate = ~0u;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0)
+    {
+        *mode = CARAMBOLAS_NET_SOCKET_PACING_RATE;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setpacingrate(carambolas_net_socket_t sockfd, uint32_t rate)
+{
+#ifdef HAVE_SO_MAX_PACING_RATE
+    // Zero means unlimited.
+    if (rate == 0)
+        rate = ~0u;
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)rate;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setpacketinfo(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled)
+{
+    *enabled = 0;
+
+#if defined(HAVE_IP_PKTINFO) && defined(HAVE_IPV6_PKTINFO)
+    // Have the kernel report the local address each datagram was sent to. An IPv6 socket reports IPv4 traffic 
+    // (dual-stack) as IPv4-mapped addresses too so only one of the options is enabled to avoid duplicates.
+    value = value ? 1 : 0;
+    if (setsockopt(sockfd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &value, sizeof(value)) == 0
+     || setsockopt(sockfd, IPPROTO_IP, IP_PKTINFO, &value, sizeof(value)) == 0)
+    {
+        *enabled = value;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setzerocopy(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled)
+{
+    *enabled = 0;
+
+#ifdef HAVE_SO_ZEROCOPY
+    // Only enables MSG_ZEROCOPY on send. Datagrams sent without the flag are still copied as usual.
+    value = value ? 1 : 0;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == 0)
+    {
+        *enabled = value;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    // Kernels without support reject the option which is not an error for the caller.
+    if (errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_zerocopy_completions(carambolas_net_socket_t sockfd, uint32_t* ranges, int32_t capacity, int32_t* nranges, int32_t* ncopied)
+{
+    *nranges = 0;
+    *ncopied = 0;
+
+    if (capacity <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+#ifdef HAVE_SO_ZEROCOPY
+    // Each notification covers an inclusive range of send calls numbered by the kernel from zero in the order 
+    // they were made with MSG_ZEROCOPY. Consecutive notifications may be merged into one range by the kernel.
+    while (*nranges < capacity)
+    {
+        union { char buf[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))]; struct cmsghdr align; } control;
+        struct msghdr msg = {0};
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        if (recvmsg(sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                break;
+
+            return carambolas_net_socket_getlasterror();
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR) 
+               || (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            ranges[*nranges * 2] = err.ee_info;
+            ranges[*nranges * 2 + 1] = err.ee_data;
+            (*nranges)++;
+
+            // The kernel had to copy the data anyway (e.g. the device cannot transmit from user pages).
+            if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                (*ncopied)++;
+        }
+    }
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    (void)sockfd;
+    (void)ranges;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setmtuprobing(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled)
+{
+    *enabled = 0;
+
+#if defined HAVE_IP_MTU_DISCOVER
+    // In PROBE mode the kernel sets DF on every datagram but ignores its own path MTU estimate (so a stale 
+    // ICMP "fragmentation needed" cannot shrink what the application may send) while still failing with 
+    // EMSGSIZE any datagram larger than the MTU of the outgoing interface. An IPv6 socket may also carry 
+    // IPv4 traffic (dual-stack) so both levels are set and the option is enabled if either succeeds.
+    int32_t ipv4 = value ? IP_PMTUDISC_PROBE : IP_PMTUDISC_DONT;
+    int32_t ipv6 = value ? IPV6_PMTUDISC_PROBE : IPV6_PMTUDISC_DONT;
+    int r4 = setsockopt(sockfd, IPPROTO_IP, IP_MTU_DISCOVER, &ipv4, sizeof(ipv4));
+    int r6 = setsockopt(sockfd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &ipv6, sizeof(ipv6));
+    if (r4 == 0 || r6 == 0)
+    {
+        *enabled = value ? 1 : 0;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#elif defined HAVE_IP_DONTFRAGMENT
+    // Closest approximation: datagrams are sent with DF so that they are dropped instead of fragmented.
+    DWORD flag = value ? 1 : 0;
+    int r4 = setsockopt(sockfd, IPPROTO_IP, IP_DONTFRAGMENT, (const char*)&flag, sizeof(flag));
+    int r6 = setsockopt(sockfd, IPPROTO_IPV6, IPV6_DONTFRAG, (const char*)&flag, sizeof(flag));
+    if (r4 == 0 || r6 == 0)
+    {
+        *enabled = value ? 1 : 0;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_getmtu(carambolas_net_socket_t sockfd, int32_t* mtu)
+{
+    *mtu = 0;
+
+#if defined HAVE_IP_MTU_DISCOVER
+    // Only available for connected sockets. Try IPv6 first as an IPv6 socket may also hold an IPv4 route.
+    int32_t value = 0;
+    socklen_t size = sizeof(value);
+    if (getsockopt(sockfd, IPPROTO_IPV6, IPV6_MTU, &value, &size) == 0 && value > 0)
+    {
+        *mtu = value;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    size = sizeof(value);
+    if (getsockopt(sockfd, IPPROTO_IP, IP_MTU, &value, &size) == 0)
+    {
+        *mtu = value;
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setreuseport(carambolas_net_socket_t sockfd, int32_t value)
+{
+#ifdef HAVE_REUSEPORT
+    // Only Linux distributes datagrams among sockets bound to the same end point. Other platforms 
+    // either lack the option or deliver everything to the last socket bound which is useless here.
+    value = value ? 1 : 0;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value)) == 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    (void)value;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_setsteering(carambolas_net_socket_t sockfd, int32_t count)
+{
+    if (count <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+#ifdef HAVE_REUSEPORT_CBPF
+    // Select a socket of the reuseport group by the source end point of each datagram so that all datagrams 
+    // from a remote host are delivered to the same socket and the socket can be determined in advance: 
+    //
+    //     key = IPv4 source address (or the 4 words of an IPv6 source address xor'ed together)
+    //   index = (((key ^ port) * 0x9E3779B1) >> 16) % count
+    //
+    // Address words and port are taken as unsigned integers in host order from their network representation. 
+    // The same function must be implemented by the user of this socket. IPv6 extension headers are not expected.
+    struct sock_filter code[] = 
+    {
+        /*  0 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF),
+        /*  1 */ BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 4),
+        /*  2 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 6, 8, 0),
+        /* IPv4 */
+        /*  3 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF),
+        /*  4 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x0f),
+        /*  5 */ BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+        /*  6 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        /*  7 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, SKF_NET_OFF),
+        /*  8 */ BPF_STMT(BPF_ST, 0),
+        /*  9 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        /* 10 */ BPF_STMT(BPF_JMP | BPF_JA, 12),
+        /* IPv6 */
+        /* 11 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF + 40),
+        /* 12 */ BPF_STMT(BPF_ST, 0),
+        /* 13 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 8),
+        /* 14 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        /* 15 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        /* 16 */ BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        /* 17 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        /* 18 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 16),
+        /* 19 */ BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        /* 20 */ BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        /* 21 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 20),
+        /* 22 */ BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        /* Hash */
+        /* 23 */ BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 0),
+        /* 24 */ BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        /* 25 */ BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9E3779B1),
+        /* 26 */ BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        /* 27 */ BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)count),
+        /* 28 */ BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+
+    struct sock_fprog program = { (unsigned short)(sizeof(code) / sizeof(code[0])), code };
+    if (setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    (void)sockfd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
 static
 struct sockaddr_in
 carambolas_net_socket_sockaddr_in(const carambolas_net_socket_endpoint_t* endpoint)
@@ -793,6 +1337,34 @@ carambolas_net_socket_bind(carambolas_net_socket_t sockfd, carambolas_net_socket
     return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
 }
 
+carambolas_net_socket_error_t 
+carambolas_net_socket_connect(carambolas_net_socket_t sockfd, const carambolas_net_socket_endpoint_t* endpoint)
+{
+    uint16_t af = endpoint->family;
+
+    if (af == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+    {
+        struct sockaddr_in sa = carambolas_net_socket_sockaddr_in(endpoint);
+
+        if (connect(sockfd, (struct sockaddr*)&sa, sizeof(sa)) == 0)
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+        return carambolas_net_socket_getlasterror();
+    }
+
+    if (af == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        struct sockaddr_in6 sa = carambolas_net_socket_sockaddr_in6(endpoint);
+
+        if (connect(sockfd, (struct sockaddr*)&sa, sizeof(sa)) == 0)
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+        return carambolas_net_socket_getlasterror();
+    }
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
+}
+
 carambolas_net_socket_error_t 
 carambolas_net_socket_available(carambolas_net_socket_t sockfd, int32_t* nbytes)
 {
@@ -818,6 +1390,7 @@ carambolas_net_socket_available(carambolas_net_socket_t sockfd, int32_t* nbytes)
 carambolas_net_socket_error_t 
 carambolas_net_socket_poll(carambolas_net_socket_t sockfd, int32_t microseconds, int32_t mode, int32_t* result)
 {
+#ifdef WINDOWS
     fd_set readfds = {0};
     struct timeval time = {0};
 
@@ -828,6 +1401,17 @@ carambolas_net_socket_poll(carambolas_net_socket_t sockfd, int32_t microseconds,
     time.tv_usec = microseconds % 1000000;
 
     int value = select((int)sockfd + 1, &readfds, NULL, NULL, &time);
+#else
+    // poll is not limited by FD_SETSIZE. Timeout is rounded up to the next millisecond so 
+    // that a sub-millisecond wait does not degenerate into a busy loop.
+    struct pollfd pfd = {0};
+    pfd.fd = sockfd;
+    pfd.events = (mode == CARAMBOLAS_NET_SOCKET_SELECT_WRITE) ? POLLOUT : (mode == CARAMBOLAS_NET_SOCKET_SELECT_ERROR) ? POLLPRI : POLLIN;
+
+    int value = poll(&pfd, 1, (microseconds < 0) ? -1 : (microseconds + 999) / 1000);
+    if (value > 0 && mode == CARAMBOLAS_NET_SOCKET_SELECT_ERROR)
+        value = (pfd.revents & (POLLERR | POLLPRI)) ? 1 : 0;
+#endif
     if (value < 0)
         return carambolas_net_socket_getlasterror();
 
@@ -835,9 +1419,86 @@ carambolas_net_socket_poll(carambolas_net_socket_t sockfd, int32_t microseconds,
     return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
 }
 
-carambolas_net_socket_error_t 
-carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes)
-{
+/*
+ * Account for a receive system call that returned n datagrams with nbytes in total (of which ntruncated were 
+ * discarded) or failed with error.
+ */
+static inline
+void
+carambolas_net_socket_stats_received(carambolas_net_socket_stats_t* stats, carambolas_net_socket_error_t error, int32_t n, int64_t nbytes, int32_t ntruncated)
+{
+    if (stats == NULL)
+        return;
+
+    stats->receivecalls++;
+    if (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+    {
+        stats->received += n;
+        stats->receivedbytes += nbytes;
+        stats->truncated += ntruncated;
+    }
+    else if (error == CARAMBOLAS_NET_SOCKET_ERROR_WOULDBLOCK || error == CARAMBOLAS_NET_SOCKET_ERROR_TIMEDOUT)
+    {
+        stats->receivewouldblock++;
+    }
+    else
+    {
+        stats->receiveerrors++;
+    }
+}
+
+/* Account for a send system call that sent n datagrams with nbytes in total or failed with error. */
+static inline
+void
+carambolas_net_socket_stats_sent(carambolas_net_socket_stats_t* stats, carambolas_net_socket_error_t error, int32_t n, int64_t nbytes)
+{
+    if (stats == NULL)
+        return;
+
+    stats->sendcalls++;
+    if (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+    {
+        stats->sent += n;
+        stats->sentbytes += nbytes;
+    }
+    else if (error == CARAMBOLAS_NET_SOCKET_ERROR_WOULDBLOCK || error == CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE)
+    {
+        stats->sendwouldblock++;
+    }
+    else
+    {
+        stats->senderrors++;
+    }
+}
+
+#ifdef HAVE_SO_RXQ_OVFL
+/* Space required for the kernel drop count in the control buffer of a received datagram. */
+#define CARAMBOLAS_NET_SOCKET_OVFL_SPACE        CMSG_SPACE(sizeof(uint32_t))
+
+/*
+ * Update the kernel drop count from a received datagram. The count is cumulative for the socket so only the 
+ * last datagram of a batch has to be inspected. It's only present once the kernel has dropped something.
+ */
+static
+void
+carambolas_net_socket_stats_overflows(carambolas_net_socket_stats_t* stats, struct msghdr* msg)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            uint32_t value;
+            memcpy(&value, CMSG_DATA(cmsg), sizeof(value));
+            stats->overflows = value;
+            return;
+        }
+    }
+}
+#endif
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats)
+{
     struct sockaddr_storage sas = {0};
     socklen_t sas_len = sizeof(sas);
 
@@ -846,6 +1507,7 @@ carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* bu
     if (*nbytes >= 0)
     {
         *endpoint = carambolas_net_socket_endpoint(&sas);
+        carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 1, *nbytes, 0);
         return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
     }
 #else
@@ -854,45 +1516,1780 @@ carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* bu
     {
         *nbytes = size;
         *endpoint = carambolas_net_socket_endpoint(&sas);
+        carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 1, 0, 1);
         return CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE;
     }
 
     if (*nbytes >= 0)
     {
         *endpoint = carambolas_net_socket_endpoint(&sas);
+        carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 1, *nbytes, 0);
         return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
     }
 #endif        
 
-    return carambolas_net_socket_getlasterror();
+    carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+#ifdef WINDOWS
+    // Windows reports a truncated datagram as an error.
+    if (error == CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE)
+    {
+        carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 1, 0, 1);
+        return error;
+    }
+#endif
+    carambolas_net_socket_stats_received(stats, error, 0, 0, 0);
+    return error;
 }
 
+#ifdef HAVE_RECVMMSG
+/*
+ * Zero if recvmmsg has been found to be unsupported by the running kernel (ENOSYS) 
+ * in which case carambolas_net_socket_recvmany falls back to one recvfrom per datagram.
+ */
+static volatile int32_t carambolas_net_socket_recvmmsg_supported = 1;
+#endif
+
 carambolas_net_socket_error_t 
-carambolas_net_socket_sendto(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes)
+carambolas_net_socket_recvmany(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
 {
-    uint16_t af = endpoint->family;
+    *nmessages = 0;
 
-    if (af == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+    if (count <= 0 || stride <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    if (count > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        count = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+#ifdef HAVE_RECVMMSG
+    if (carambolas_net_socket_recvmmsg_supported)
     {
-        struct sockaddr_in sa = carambolas_net_socket_sockaddr_in(endpoint);
+        struct mmsghdr msgs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct iovec iovecs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct sockaddr_storage addrs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+#ifdef HAVE_SO_RXQ_OVFL
+        union { char buf[CARAMBOLAS_NET_SOCKET_OVFL_SPACE]; struct cmsghdr align; } controls[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+#endif
 
-        *nbytes = sendto(sockfd, (const char*)&buffer[offset], size, 0, (const struct sockaddr*)&sa, sizeof(sa));
-        if (*nbytes >= 0)
+        memset(msgs, 0, sizeof(struct mmsghdr) * count);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            iovecs[i].iov_base = (void*)&buffer[offset + i * stride];
+            iovecs[i].iov_len = stride;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+#ifdef HAVE_SO_RXQ_OVFL
+            if (stats)
+            {
+                msgs[i].msg_hdr.msg_control = controls[i].buf;
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+            }
+#endif
+        }
+
+        // MSG_WAITFORONE makes a blocking socket behave like recvfrom: wait for the 
+        // first datagram and then only collect what is immediately available.
+        int n = recvmmsg(sockfd, msgs, count, MSG_WAITFORONE, NULL);
+        if (n >= 0)
+        {
+            int64_t nbytes = 0;
+            int32_t ntruncated = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                endpoints[i] = carambolas_net_socket_endpoint(&addrs[i]);
+                // A truncated datagram is as good as lost. Report it with zero length so the caller can skip it.
+                lengths[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : (int32_t)msgs[i].msg_len;
+                nbytes += lengths[i];
+                ntruncated += (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 1 : 0;
+            }
+
+            carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, n, nbytes, ntruncated);
+#ifdef HAVE_SO_RXQ_OVFL
+            if (stats && n > 0)
+                carambolas_net_socket_stats_overflows(stats, &msgs[n - 1].msg_hdr);
+#endif
+
+            *nmessages = n;
             return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+        }
 
-        return carambolas_net_socket_getlasterror();
+        if (errno != ENOSYS)
+        {
+            carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+            carambolas_net_socket_stats_received(stats, error, 0, 0, 0);
+            return error;
+        }
+
+        carambolas_net_socket_recvmmsg_supported = 0;
     }
+#endif
 
-    if (af == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    // Fallback: one recvfrom per datagram until the batch is full or there's nothing else immediately available.
+    for (int32_t i = 0; i < count; ++i)
     {
-        struct sockaddr_in6 sa = carambolas_net_socket_sockaddr_in6(endpoint);
+        carambolas_net_socket_error_t error = carambolas_net_socket_recvfrom(sockfd, buffer, offset + i * stride, stride, &endpoints[i], &lengths[i], stats);
+        if (error == CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE)
+        {
+            lengths[i] = 0;
+        }
+        else if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            if (i > 0)
+                break;
 
-        *nbytes = sendto(sockfd, (const char*)&buffer[offset], size, 0, (const struct sockaddr*)&sa, sizeof(sa));
-        if (*nbytes >= 0)
+            return error;
+        }
+
+        *nmessages = i + 1;
+
+        // Only the first datagram may block.
+        int32_t available = 0;
+        if (carambolas_net_socket_available(sockfd, &available) != CARAMBOLAS_NET_SOCKET_ERROR_NONE || available == 0)
+            break;
+    }
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+#ifdef HAVE_SO_TIMESTAMPNS
+/*
+ * Microseconds elapsed between the kernel timestamp of a datagram and now or zero if the datagram has no 
+ * timestamp. Ages are clamped to zero because the realtime clock may be stepped back between the two.
+ */
+static
+int32_t
+carambolas_net_socket_age(struct msghdr* msg, const struct timespec* now)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+
+            int64_t age = ((int64_t)now->tv_sec - (int64_t)ts.tv_sec) * 1000000 + ((int64_t)now->tv_nsec - (int64_t)ts.tv_nsec) / 1000;
+            return (age <= 0) ? 0 : (age > INT32_MAX) ? INT32_MAX : (int32_t)age;
+        }
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef HAVE_IP_RECVTOS
+/*
+ * ECN codepoint of a datagram taken from its TOS (IPv4) or traffic class (IPv6) or zero (Not-ECT) if unknown.
+ */
+static
+uint8_t
+carambolas_net_socket_ecn(struct msghdr* msg)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == IPPROTO_IP && (cmsg->cmsg_type == IP_TOS || cmsg->cmsg_type == IP_RECVTOS))
+        {
+            uint8_t tos;
+            memcpy(&tos, CMSG_DATA(cmsg), sizeof(tos));
+            return tos & 0x03;
+        }
+
+        if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS)
+        {
+            int tclass;
+            memcpy(&tclass, CMSG_DATA(cmsg), sizeof(tclass));
+            return (uint8_t)(tclass & 0x03);
+        }
+    }
+
+    return 0;
+}
+#endif
+
+#if defined(HAVE_IP_PKTINFO) && defined(HAVE_IPV6_PKTINFO)
+/*
+ * Local address a datagram was sent to (with port zero) or an all zero endpoint if unknown. For IPv4 this is 
+ * the local address the kernel would reply from so broadcasts are covered. IPv6 multicast destinations and 
+ * IPv4-mapped multicast or broadcast destinations are reported as unknown because they cannot be used as the 
+ * source of a reply.
+ */
+static
+carambolas_net_socket_endpoint_t
+carambolas_net_socket_destination(struct msghdr* msg)
+{
+    carambolas_net_socket_endpoint_t endpoint = {0};
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO)
+        {
+            struct in_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            endpoint.ipv4 = info.ipi_spec_dst;
+            endpoint.family = CARAMBOLAS_NET_SOCKET_AF_IPV4;
+            break;
+        }
+
+        if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO)
+        {
+            struct in6_pktinfo info;
+            memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+            if (IN6_IS_ADDR_MULTICAST(&info.ipi6_addr))
+                break;
+
+            // IPv4 traffic on a dual-stack socket is reported with the header destination instead of the local address.
+            if (IN6_IS_ADDR_V4MAPPED(&info.ipi6_addr))
+            {
+                uint32_t ipv4 = ntohl(info.ipi6_addr.s6_addr32[3]);
+                if (IN_MULTICAST(ipv4) || ipv4 == INADDR_BROADCAST)
+                    break;
+            }
+
+            endpoint.ipv6 = info.ipi6_addr;
+            endpoint.family = CARAMBOLAS_NET_SOCKET_AF_IPV6;
+            break;
+        }
+    }
+
+    return endpoint;
+}
+
+/*
+ * Append to the control buffer at cmsg a control message that sets the source address of a datagram 
+ * and return the space it takes or zero if the source is unknown (in which case the kernel chooses).
+ */
+static
+size_t
+carambolas_net_socket_source(struct cmsghdr* cmsg, const carambolas_net_socket_endpoint_t* source)
+{
+    if (source->family == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+    {
+        struct in_pktinfo info = {0};
+        info.ipi_spec_dst = source->ipv4;
+        cmsg->cmsg_level = IPPROTO_IP;
+        cmsg->cmsg_type = IP_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(info));
+        memcpy(CMSG_DATA(cmsg), &info, sizeof(info));
+        return CMSG_SPACE(sizeof(info));
+    }
+
+    if (source->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        // An IPv4-mapped source is accepted by a dual-stack socket sending to an IPv4-mapped destination.
+        struct in6_pktinfo info = {0};
+        info.ipi6_addr = source->ipv6;
+        cmsg->cmsg_level = IPPROTO_IPV6;
+        cmsg->cmsg_type = IPV6_PKTINFO;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(info));
+        memcpy(CMSG_DATA(cmsg), &info, sizeof(info));
+        return CMSG_SPACE(sizeof(info));
+    }
+
+    return 0;
+}
+
+#define CARAMBOLAS_NET_SOCKET_PKTINFO_SPACE     CMSG_SPACE(sizeof(struct in6_pktinfo))
+#else
+#define CARAMBOLAS_NET_SOCKET_PKTINFO_SPACE     0
+#endif
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvmany_timestamped(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_recvmany_annotated(sockfd, buffer, offset, stride, count, endpoints, lengths, ages, NULL, nmessages, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvmany_annotated(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, uint8_t* ecn, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_recvmany_addressed(sockfd, buffer, offset, stride, count, endpoints, lengths, ages, ecn, NULL, nmessages, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvmany_addressed(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, uint8_t* ecn, carambolas_net_socket_endpoint_t* destinations, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+#if defined(HAVE_RECVMMSG) && (defined(HAVE_SO_TIMESTAMPNS) || defined(HAVE_IP_RECVTOS) || defined(HAVE_IP_PKTINFO))
+    *nmessages = 0;
+
+    if (count <= 0 || stride <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    if (count > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        count = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+    if (carambolas_net_socket_recvmmsg_supported)
+    {
+        struct mmsghdr msgs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct iovec iovecs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct sockaddr_storage addrs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        union { char buf[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(int)) + CARAMBOLAS_NET_SOCKET_PKTINFO_SPACE + CARAMBOLAS_NET_SOCKET_OVFL_SPACE]; struct cmsghdr align; } controls[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+
+        memset(msgs, 0, sizeof(struct mmsghdr) * count);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            iovecs[i].iov_base = (void*)&buffer[offset + i * stride];
+            iovecs[i].iov_len = stride;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = controls[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+        }
+
+        int n = recvmmsg(sockfd, msgs, count, MSG_WAITFORONE, NULL);
+        if (n >= 0)
+        {
+#ifdef HAVE_SO_TIMESTAMPNS
+            // Kernel timestamps are taken from the realtime clock.
+            struct timespec now;
+            if (ages)
+                clock_gettime(CLOCK_REALTIME, &now);
+#endif
+
+            int64_t nbytes = 0;
+            int32_t ntruncated = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                endpoints[i] = carambolas_net_socket_endpoint(&addrs[i]);
+                lengths[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : (int32_t)msgs[i].msg_len;
+#ifdef HAVE_SO_TIMESTAMPNS
+                if (ages)
+                    ages[i] = carambolas_net_socket_age(&msgs[i].msg_hdr, &now);
+#else
+                if (ages)
+                    ages[i] = 0;
+#endif
+#ifdef HAVE_IP_RECVTOS
+                if (ecn)
+                    ecn[i] = carambolas_net_socket_ecn(&msgs[i].msg_hdr);
+#else
+                if (ecn)
+                    ecn[i] = 0;
+#endif
+#if defined(HAVE_IP_PKTINFO) && defined(HAVE_IPV6_PKTINFO)
+                if (destinations)
+                    destinations[i] = carambolas_net_socket_destination(&msgs[i].msg_hdr);
+#else
+                if (destinations)
+                    memset(&destinations[i], 0, sizeof(carambolas_net_socket_endpoint_t));
+#endif
+                nbytes += lengths[i];
+                ntruncated += (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? 1 : 0;
+            }
+
+            carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, n, nbytes, ntruncated);
+            if (stats && n > 0)
+                carambolas_net_socket_stats_overflows(stats, &msgs[n - 1].msg_hdr);
+
+            *nmessages = n;
             return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+        }
 
-        return carambolas_net_socket_getlasterror();
+        if (errno != ENOSYS)
+        {
+            carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+            carambolas_net_socket_stats_received(stats, error, 0, 0, 0);
+            return error;
+        }
+
+        carambolas_net_socket_recvmmsg_supported = 0;
     }
+#endif
 
-    return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
-}
\ No newline at end of file
+    // Without control messages every datagram is reported as if it had just arrived, not marked and sent to an unknown address.
+    carambolas_net_socket_error_t error = carambolas_net_socket_recvmany(sockfd, buffer, offset, stride, count, endpoints, lengths, nmessages, stats);
+    if (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+    {
+        if (ages)
+            memset(ages, 0, sizeof(int32_t) * (size_t)*nmessages);
+
+        if (ecn)
+            memset(ecn, 0, sizeof(uint8_t) * (size_t)*nmessages);
+
+        if (destinations)
+            memset(destinations, 0, sizeof(carambolas_net_socket_endpoint_t) * (size_t)*nmessages);
+    }
+
+    return error;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvfrom_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, int32_t* segment, carambolas_net_socket_stats_t* stats)
+{
+#ifdef HAVE_UDP_GRO
+    struct sockaddr_storage sas = {0};
+    struct iovec iov = { (void*)&buffer[offset], (size_t)size };
+    // Leave room for a timestamp, the TOS byte and the drop count as well in case the socket has SO_TIMESTAMPNS or IP_RECVTOS enabled or the segment size could be truncated.
+    union { char buf[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(int)) + CARAMBOLAS_NET_SOCKET_OVFL_SPACE]; struct cmsghdr align; } control;
+
+    struct msghdr msg = {0};
+    msg.msg_name = &sas;
+    msg.msg_namelen = sizeof(sas);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    *nbytes = (int32_t)recvmsg(sockfd, &msg, 0);
+    if (*nbytes < 0)
+    {
+        carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+        carambolas_net_socket_stats_received(stats, error, 0, 0, 0);
+        return error;
+    }
+
+    *endpoint = carambolas_net_socket_endpoint(&sas);
+    *segment = *nbytes;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+            int value;
+            memcpy(&value, CMSG_DATA(cmsg), sizeof(value));
+            *segment = value;
+            break;
+        }
+    }
+
+    if (stats)
+    {
+        // A coalesced datagram counts as one datagram per segment. If truncated only whole segments at the front 
+        // survive and the rest counts as a single truncated datagram.
+        int32_t whole = (*segment > 0 && *segment < *nbytes) ? *nbytes / *segment : 0;
+        if (msg.msg_flags & MSG_TRUNC)
+            carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, whole + 1, (int64_t)whole * *segment, 1);
+        else
+            carambolas_net_socket_stats_received(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, (*segment > 0) ? (*nbytes + *segment - 1) / *segment : 1, *nbytes, 0);
+
+        carambolas_net_socket_stats_overflows(stats, &msg);
+    }
+
+    if (msg.msg_flags & MSG_TRUNC)
+        return CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE;
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    carambolas_net_socket_error_t error = carambolas_net_socket_recvfrom(sockfd, buffer, offset, size, endpoint, nbytes, stats);
+    *segment = *nbytes;
+    return error;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_recvmany_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+#ifdef HAVE_UDP_GRO
+    *nmessages = 0;
+
+    if (count <= 0 || stride <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    if (count > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        count = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+    int32_t n = 0;
+    do
+    {
+        // Receive into all remaining slots at once as if they were a single contiguous buffer. A coalesced 
+        // datagram is then split in place moving each segment to the start of its own slot.
+        uint8_t* base = (uint8_t*)&buffer[offset + n * stride];
+        int32_t remaining = count - n;
+        int32_t nbytes, segment;
+        carambolas_net_socket_endpoint_t endpoint;
+        
+        // Only the first datagram may block.
+        if (n > 0)
+        {
+            int32_t available = 0;
+            if (carambolas_net_socket_available(sockfd, &available) != CARAMBOLAS_NET_SOCKET_ERROR_NONE || available == 0)
+                break;
+        }
+
+        carambolas_net_socket_error_t error = carambolas_net_socket_recvfrom_segmented(sockfd, base, 0, remaining * stride, &endpoint, &nbytes, &segment, stats);
+        if (error == CARAMBOLAS_NET_SOCKET_ERROR_MESSAGESIZE)
+        {
+            // A truncated coalesced datagram still carries whole segments at the front. 
+            // A truncated ordinary datagram is as good as lost.
+            nbytes = (segment < nbytes) ? (nbytes / segment) * segment : 0;
+        }
+        else if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            if (n > 0)
+                break;
+
+            return error;
+        }
+
+        if (nbytes == 0 || segment > stride)
+        {
+            // Segments that cannot fit a slot are discarded and reported with zero length.
+            endpoints[n] = endpoint;
+            lengths[n] = 0;
+            n++;
+        }
+        else
+        {
+            int32_t k = (nbytes + segment - 1) / segment;
+            if (k > remaining)
+                k = remaining;
+
+            // Move segments from last to first so no segment is overwritten before it is moved.
+            for (int32_t j = k - 1; j >= 0; --j)
+            {
+                int32_t length = nbytes - j * segment;
+                if (length > segment)
+                    length = segment;
+
+                if (j > 0)
+                    memmove(&base[j * stride], &base[j * segment], length);
+
+                endpoints[n + j] = endpoint;
+                lengths[n + j] = length;
+            }
+
+            n += k;
+        }
+    }
+    while (count - n >= CARAMBOLAS_NET_SOCKET_SEGMENT_MAX); // Stop while a whole coalesced datagram is still guaranteed to fit.
+
+    *nmessages = n;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    return carambolas_net_socket_recvmany(sockfd, buffer, offset, stride, count, endpoints, lengths, nmessages, stats);
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendto(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats)
+{
+    // A connected socket has no use for an address and the kernel can skip the route lookup.
+    if (endpoint == NULL)
+    {
+        *nbytes = send(sockfd, (const char*)&buffer[offset], size, 0);
+    }
+    else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+    {
+        struct sockaddr_in sa = carambolas_net_socket_sockaddr_in(endpoint);
+        *nbytes = sendto(sockfd, (const char*)&buffer[offset], size, 0, (const struct sockaddr*)&sa, sizeof(sa));
+    }
+    else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+    {
+        struct sockaddr_in6 sa = carambolas_net_socket_sockaddr_in6(endpoint);
+        *nbytes = sendto(sockfd, (const char*)&buffer[offset], size, 0, (const struct sockaddr*)&sa, sizeof(sa));
+    }
+    else
+    {
+        return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
+    }
+
+    if (*nbytes >= 0)
+    {
+        carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 1, *nbytes);
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+
+    carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+    carambolas_net_socket_stats_sent(stats, error, 0, 0);
+    return error;
+}
+
+#ifdef HAVE_SENDMMSG
+/*
+ * Zero if sendmmsg has been found to be unsupported by the running kernel (ENOSYS) 
+ * in which case carambolas_net_socket_sendmany falls back to one sendto per datagram.
+ */
+static volatile int32_t carambolas_net_socket_sendmmsg_supported = 1;
+#endif
+
+/*
+ * Common implementation of the batch send operations. Datagrams are sent with the given message flags 
+ * (e.g. MSG_ZEROCOPY) in which case nnotifications (if not null) receives the number of send calls that 
+ * the kernel is going to report as completed on the socket error queue. Sources (if not null) are the 
+ * local addresses each datagram should be sent from (see carambolas_net_socket_recvmany_addressed).
+ */
+static
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_flags(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const carambolas_net_socket_endpoint_t* sources, const int32_t* lengths, const int32_t* delays, int32_t flags, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats)
+{
+    *nmessages = 0;
+    if (nnotifications)
+        *nnotifications = 0;
+
+    if (count <= 0 || stride <= 0 || index < 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    if (count > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        count = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+    buffer = &buffer[offset + index * stride];
+    endpoints = endpoints ? &endpoints[index] : NULL;
+    sources = sources ? &sources[index] : NULL;
+    lengths = &lengths[index];
+    delays = delays ? &delays[index] : NULL;
+
+#ifdef HAVE_SENDMMSG
+    if (carambolas_net_socket_sendmmsg_supported)
+    {
+        struct mmsghdr msgs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct iovec iovecs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct sockaddr_storage addrs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        union { char buf[CMSG_SPACE(sizeof(uint64_t)) + CARAMBOLAS_NET_SOCKET_PKTINFO_SPACE]; struct cmsghdr align; } controls[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+#ifdef HAVE_SO_TXTIME
+        // Launch times are absolute in the clock the socket was configured with (see carambolas_net_socket_setpacing).
+        uint64_t now = delays ? (uint64_t)carambolas_net_clock_now() : 0;
+#endif
+
+        memset(msgs, 0, sizeof(struct mmsghdr) * count);
+        for (int32_t i = 0; i < count; ++i)
+        {
+            const carambolas_net_socket_endpoint_t* endpoint = endpoints ? &endpoints[i] : NULL;
+            if (endpoint == NULL)
+            {
+                // Connected socket
+            }
+            else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+            {
+                *(struct sockaddr_in*)&addrs[i] = carambolas_net_socket_sockaddr_in(endpoint);
+                msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            }
+            else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+            {
+                *(struct sockaddr_in6*)&addrs[i] = carambolas_net_socket_sockaddr_in6(endpoint);
+                msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            }
+            else
+            {
+                // Stop short of the invalid endpoint. It is reported on the next call if it's the first in the batch.
+                if (i == 0)
+                    return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
+
+                count = i;
+                break;
+            }
+
+            iovecs[i].iov_base = (void*)&buffer[i * stride];
+            iovecs[i].iov_len = lengths[i];
+            msgs[i].msg_hdr.msg_name = endpoint ? &addrs[i] : NULL;
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+
+            size_t controllen = 0;
+#ifdef HAVE_SO_TXTIME
+            if (delays && delays[i] > 0)
+            {
+                uint64_t txtime = now + (uint64_t)delays[i] * 1000u;
+
+                struct cmsghdr* cmsg = (struct cmsghdr*)controls[i].buf;
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_TXTIME;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(txtime));
+                memcpy(CMSG_DATA(cmsg), &txtime, sizeof(txtime));
+                controllen += CMSG_SPACE(sizeof(txtime));
+            }
+#endif
+#if defined(HAVE_IP_PKTINFO) && defined(HAVE_IPV6_PKTINFO)
+            if (sources)
+                controllen += carambolas_net_socket_source((struct cmsghdr*)&controls[i].buf[controllen], &sources[i]);
+#endif
+            if (controllen > 0)
+            {
+                msgs[i].msg_hdr.msg_control = controls[i].buf;
+                msgs[i].msg_hdr.msg_controllen = controllen;
+            }
+        }
+
+        // sendmmsg only reports an error if the first datagram fails. Otherwise it returns the number 
+        // of datagrams sent before the failure and the error is reported on the next call.
+        int n = sendmmsg(sockfd, msgs, count, flags);
+        if (n >= 0)
+        {
+            if (stats)
+            {
+                int64_t nbytes = 0;
+                for (int i = 0; i < n; ++i)
+                    nbytes += lengths[i];
+
+                carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, n, nbytes);
+            }
+
+            *nmessages = n;
+            if (nnotifications && (flags & MSG_ZEROCOPY))
+                *nnotifications = n;
+
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+        }
+
+        // A source that is no longer (or never was) a local unicast address (e.g. removed from the interface or 
+        // a subnet broadcast) is rejected so let the kernel choose instead of failing the whole batch.
+        if (sources && (errno == EINVAL || errno == ENETUNREACH || errno == EADDRNOTAVAIL))
+            return carambolas_net_socket_sendmany_flags(sockfd, buffer, 0, stride, 0, count, endpoints, NULL, lengths, delays, flags, nmessages, nnotifications, stats);
+
+        if (errno != ENOSYS)
+        {
+            carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+            carambolas_net_socket_stats_sent(stats, error, 0, 0);
+            return error;
+        }
+
+        carambolas_net_socket_sendmmsg_supported = 0;
+    }
+#endif
+
+    // Fallback: one sendto per datagram until the batch is complete or an error occurs. Launch times, sources and flags are ignored.
+    for (int32_t i = 0; i < count; ++i)
+    {
+        int32_t nbytes;
+        carambolas_net_socket_error_t error = carambolas_net_socket_sendto(sockfd, buffer, i * stride, lengths[i], endpoints ? &endpoints[i] : NULL, &nbytes, stats);
+        if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            if (i > 0)
+                break;
+
+            return error;
+        }
+
+        *nmessages = i + 1;
+    }
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_sendmany_flags(sockfd, buffer, offset, stride, index, count, endpoints, NULL, lengths, NULL, 0, nmessages, NULL, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_paced(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, const int32_t* delays, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_sendmany_flags(sockfd, buffer, offset, stride, index, count, endpoints, NULL, lengths, delays, 0, nmessages, NULL, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendto_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, int32_t segment, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats)
+{
+    *nbytes = 0;
+
+    if (size < 0 || segment <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+#ifdef HAVE_UDP_SEGMENT
+    if (size > segment && carambolas_net_socket_udp_segment(sockfd))
+    {
+        struct sockaddr_storage sas = {0};
+        socklen_t sas_len = 0;
+
+        if (endpoint == NULL)
+        {
+            // Connected socket
+        }
+        else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+        {
+            *(struct sockaddr_in*)&sas = carambolas_net_socket_sockaddr_in(endpoint);
+            sas_len = sizeof(struct sockaddr_in);
+        }
+        else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+        {
+            *(struct sockaddr_in6*)&sas = carambolas_net_socket_sockaddr_in6(endpoint);
+            sas_len = sizeof(struct sockaddr_in6);
+        }
+        else
+        {
+            return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
+        }
+
+        // Each super-buffer is limited both in number of segments and in total size.
+        int32_t limit = CARAMBOLAS_NET_SOCKET_SEGMENT_MAX * segment;
+        if (limit > CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX)
+            limit = (CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX / segment) * segment;
+
+        while (*nbytes < size)
+        {
+            int32_t length = size - *nbytes;
+            if (length > limit)
+                length = limit;
+
+            struct iovec iov = { (void*)&buffer[offset + *nbytes], (size_t)length };
+            union { char buf[CMSG_SPACE(sizeof(uint16_t))]; struct cmsghdr align; } control = {0};
+
+            struct msghdr msg = {0};
+            msg.msg_name = endpoint ? &sas : NULL;
+            msg.msg_namelen = sas_len;
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+
+            if (length > segment)
+            {
+                uint16_t value = (uint16_t)segment;
+                msg.msg_control = control.buf;
+                msg.msg_controllen = sizeof(control.buf);
+
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(value));
+                memcpy(CMSG_DATA(cmsg), &value, sizeof(value));
+            }
+
+            ssize_t n = sendmsg(sockfd, &msg, 0);
+            if (n < 0)
+            {
+                // EIO indicates the outgoing device cannot offload the checksum of segmented datagrams.
+                if (errno == EIO)
+                {
+                    carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 0, 0);
+                    carambolas_net_socket_udp_segment_supported = 0;
+                    break;
+                }
+
+                carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+                carambolas_net_socket_stats_sent(stats, error, 0, 0);
+                if (*nbytes > 0)
+                    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+                return error;
+            }
+
+            carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, (int32_t)((n + segment - 1) / segment), n);
+            *nbytes += (int32_t)n;
+        }
+
+        if (*nbytes == size)
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    }
+#endif
+
+    // Fallback: one sendto per segment.
+    while (*nbytes < size)
+    {
+        int32_t length = size - *nbytes;
+        if (length > segment)
+            length = segment;
+
+        int32_t n;
+        carambolas_net_socket_error_t error = carambolas_net_socket_sendto(sockfd, buffer, offset + *nbytes, length, endpoint, &n, stats);
+        if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            if (*nbytes > 0)
+                break;
+
+            return error;
+        }
+
+        *nbytes += n;
+    }
+
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+
+/*
+ * Common implementation of the segmented batch send operations. See carambolas_net_socket_sendmany_flags.
+ */
+static
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_segmented_flags(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const carambolas_net_socket_endpoint_t* sources, const int32_t* lengths, int32_t flags, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats)
+{
+#if defined(HAVE_UDP_SEGMENT) && defined(HAVE_SENDMMSG)
+    *nmessages = 0;
+    if (nnotifications)
+        *nnotifications = 0;
+
+    if (count <= 0 || stride <= 0 || index < 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    if (count > CARAMBOLAS_NET_SOCKET_BATCH_MAX)
+        count = CARAMBOLAS_NET_SOCKET_BATCH_MAX;
+
+    if (carambolas_net_socket_sendmmsg_supported && carambolas_net_socket_udp_segment(sockfd))
+    {
+        const uint8_t* base = &buffer[offset + index * stride];
+        const carambolas_net_socket_endpoint_t* eps = endpoints ? &endpoints[index] : NULL;
+        const carambolas_net_socket_endpoint_t* srcs = sources ? &sources[index] : NULL;
+        const int32_t* lens = &lengths[index];
+
+        struct mmsghdr msgs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct iovec iovecs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        struct sockaddr_storage addrs[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        union { char buf[CMSG_SPACE(sizeof(uint16_t)) + CARAMBOLAS_NET_SOCKET_PKTINFO_SPACE]; struct cmsghdr align; } controls[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        int32_t segments[CARAMBOLAS_NET_SOCKET_BATCH_MAX];
+        int32_t m = 0;
+        int32_t trains = 0;
+#ifdef HAVE_SO_ZEROCOPY
+        int32_t limit = (flags & MSG_ZEROCOPY) ? CARAMBOLAS_NET_SOCKET_ZEROCOPY_SEGMENT_MAX : CARAMBOLAS_NET_SOCKET_SEGMENT_MAX;
+#else
+        int32_t limit = CARAMBOLAS_NET_SOCKET_SEGMENT_MAX;
+#endif
+
+        for (int32_t i = 0; i < count; ++m)
+        {
+            const carambolas_net_socket_endpoint_t* endpoint = eps ? &eps[i] : NULL;
+
+            memset(&msgs[m], 0, sizeof(struct mmsghdr));
+            if (endpoint == NULL)
+            {
+                // Connected socket so every datagram goes to the same destination.
+            }
+            else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV4)
+            {
+                *(struct sockaddr_in*)&addrs[m] = carambolas_net_socket_sockaddr_in(endpoint);
+                msgs[m].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            }
+            else if (endpoint->family == CARAMBOLAS_NET_SOCKET_AF_IPV6)
+            {
+                *(struct sockaddr_in6*)&addrs[m] = carambolas_net_socket_sockaddr_in6(endpoint);
+                msgs[m].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            }
+            else
+            {
+                // Stop short of the invalid endpoint. It is reported on the next call if it's the first in the batch.
+                if (i == 0)
+                    return CARAMBOLAS_NET_SOCKET_ERROR_ADDRESSFAMILYNOTSUPPORTED;
+
+                break;
+            }
+
+            // Extend the train while datagrams go to the same destination from the same source and all but the last have the same length.
+            int32_t segment = lens[i];
+            int32_t total = segment;
+            int32_t k = 1;
+            while (i + k < count && k < limit && segment > 0
+                && lens[i + k - 1] == segment && lens[i + k] > 0 && lens[i + k] <= segment
+                && total + lens[i + k] <= CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX
+                && (endpoint == NULL || memcmp(&eps[i + k], endpoint, sizeof(carambolas_net_socket_endpoint_t)) == 0)
+                && (srcs == NULL || memcmp(&srcs[i + k], &srcs[i], sizeof(carambolas_net_socket_endpoint_t)) == 0))
+            {
+                total += lens[i + k];
+                k++;
+            }
+
+            for (int32_t j = 0; j < k; ++j)
+            {
+                iovecs[i + j].iov_base = (void*)&base[(i + j) * stride];
+                iovecs[i + j].iov_len = lens[i + j];
+            }
+
+            msgs[m].msg_hdr.msg_name = endpoint ? &addrs[m] : NULL;
+            msgs[m].msg_hdr.msg_iov = &iovecs[i];
+            msgs[m].msg_hdr.msg_iovlen = k;
+
+            size_t controllen = 0;
+            memset(&controls[m], 0, sizeof(controls[m]));
+            if (k > 1)
+            {
+                uint16_t value = (uint16_t)segment;
+
+                struct cmsghdr* cmsg = (struct cmsghdr*)controls[m].buf;
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(value));
+                memcpy(CMSG_DATA(cmsg), &value, sizeof(value));
+                controllen += CMSG_SPACE(sizeof(value));
+                trains++;
+            }
+#if defined(HAVE_IP_PKTINFO) && defined(HAVE_IPV6_PKTINFO)
+            if (srcs)
+                controllen += carambolas_net_socket_source((struct cmsghdr*)&controls[m].buf[controllen], &srcs[i]);
+#endif
+            if (controllen > 0)
+            {
+                msgs[m].msg_hdr.msg_control = controls[m].buf;
+                msgs[m].msg_hdr.msg_controllen = controllen;
+            }
+
+            segments[m] = k;
+            i += k;
+        }
+
+        // Nothing to coalesce so a plain batch will do.
+        if (trains == 0)
+            return carambolas_net_socket_sendmany_flags(sockfd, buffer, offset, stride, index, count, endpoints, sources, lengths, NULL, flags, nmessages, nnotifications, stats);
+
+        int n = sendmmsg(sockfd, msgs, m, flags);
+        if (n >= 0)
+        {
+            for (int32_t i = 0; i < n; ++i)
+                *nmessages += segments[i];
+
+            // One notification per train regardless of the number of segments.
+            if (nnotifications && (flags & MSG_ZEROCOPY))
+                *nnotifications = n;
+
+            if (stats)
+            {
+                int64_t nbytes = 0;
+                for (int32_t i = 0; i < *nmessages; ++i)
+                    nbytes += lens[i];
+
+                carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, *nmessages, nbytes);
+            }
+
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+        }
+
+        // EIO indicates the outgoing device cannot offload the checksum of segmented datagrams so stop trying.
+        // EINVAL may be caused by a segment larger than the path MTU in which case this batch is sent as is
+        // and the error (if any) is reported on the individual datagram. An unusable source is handled the 
+        // same way (see carambolas_net_socket_sendmany_flags).
+        if (errno == EIO)
+        {
+            carambolas_net_socket_udp_segment_supported = 0;
+        }
+        else if (errno != EINVAL && errno != ENOSYS && !(srcs && (errno == ENETUNREACH || errno == EADDRNOTAVAIL)))
+        {
+            carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+            carambolas_net_socket_stats_sent(stats, error, 0, 0);
+            return error;
+        }
+
+        // The attempt still counts as a call even though it's retried.
+        carambolas_net_socket_stats_sent(stats, CARAMBOLAS_NET_SOCKET_ERROR_NONE, 0, 0);
+    }
+#endif
+
+    return carambolas_net_socket_sendmany_flags(sockfd, buffer, offset, stride, index, count, endpoints, sources, lengths, NULL, flags, nmessages, nnotifications, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_sendmany_segmented_flags(sockfd, buffer, offset, stride, index, count, endpoints, NULL, lengths, 0, nmessages, NULL, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_zerocopy(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, const int32_t* delays, int32_t segmented, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats)
+{
+    return carambolas_net_socket_sendmany_sourced(sockfd, buffer, offset, stride, index, count, endpoints, NULL, lengths, delays, 1, segmented, nmessages, nnotifications, stats);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_socket_sendmany_sourced(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const carambolas_net_socket_endpoint_t* sources, const int32_t* lengths, const int32_t* delays, int32_t zerocopy, int32_t segmented, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats)
+{
+#ifdef HAVE_SO_ZEROCOPY
+    // The kernel pins the pages of the buffer instead of copying them so the caller must leave the buffer 
+    // untouched until the send calls reported in nnotifications are completed (see carambolas_net_socket_zerocopy_completions).
+    int32_t flags = zerocopy ? MSG_ZEROCOPY : 0;
+#else
+    int32_t flags = 0;
+#endif
+
+    // Datagrams with launch times of their own cannot be coalesced.
+    if (segmented && !delays)
+        return carambolas_net_socket_sendmany_segmented_flags(sockfd, buffer, offset, stride, index, count, endpoints, sources, lengths, flags, nmessages, nnotifications, stats);
+
+    return carambolas_net_socket_sendmany_flags(sockfd, buffer, offset, stride, index, count, endpoints, sources, lengths, delays, flags, nmessages, nnotifications, stats);
+}
+
+#ifdef HAVE_EPOLL
+#ifdef SYS_epoll_pwait2
+/*
+ * Zero if epoll_pwait2 has been found to be unsupported by the running kernel (ENOSYS) in which 
+ * case carambolas_net_poller_wait falls back to epoll_wait with millisecond resolution.
+ */
+static volatile int32_t carambolas_net_poller_pwait2_supported = 1;
+#endif
+#endif
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_open(carambolas_net_poller_t* pollfd)
+{
+#ifdef HAVE_EPOLL
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0)
+        return carambolas_net_socket_getlasterror();
+
+    *pollfd = (carambolas_net_poller_t)fd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    *pollfd = -1;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+void 
+carambolas_net_poller_close(carambolas_net_poller_t pollfd)
+{
+#ifdef HAVE_EPOLL
+    if (pollfd >= 0)
+        close(pollfd);
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_add(carambolas_net_poller_t pollfd, carambolas_net_socket_t sockfd, int32_t token)
+{
+#ifdef HAVE_EPOLL
+    // Edge-triggered so a socket is only reported again after new data arrives. 
+    // The caller is expected to receive until the socket would block before waiting again.
+    struct epoll_event event = {0};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = (uint32_t)token;
+
+    if (epoll_ctl(pollfd, EPOLL_CTL_ADD, sockfd, &event) == 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_remove(carambolas_net_poller_t pollfd, carambolas_net_socket_t sockfd)
+{
+#ifdef HAVE_EPOLL
+    struct epoll_event event = {0};
+    if (epoll_ctl(pollfd, EPOLL_CTL_DEL, sockfd, &event) == 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    return carambolas_net_socket_getlasterror();
+#else
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_wait(carambolas_net_poller_t pollfd, int32_t microseconds, int32_t* tokens, int32_t count, int32_t* nready)
+{
+    *nready = 0;
+
+    if (count <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+#ifdef HAVE_EPOLL
+    if (count > CARAMBOLAS_NET_POLLER_EVENTS_MAX)
+        count = CARAMBOLAS_NET_POLLER_EVENTS_MAX;
+
+    struct epoll_event events[CARAMBOLAS_NET_POLLER_EVENTS_MAX];
+    int n = -1;
+
+#ifdef SYS_epoll_pwait2
+    if (carambolas_net_poller_pwait2_supported)
+    {
+        // epoll_pwait2 (Linux 5.11) takes a timespec so sub-millisecond timeouts are honoured. 
+        // The raw syscall expects a struct __kernel_timespec which is 64-bit on all architectures.
+        struct { int64_t tv_sec; int64_t tv_nsec; } timeout;
+        timeout.tv_sec = microseconds / 1000000;
+        timeout.tv_nsec = (int64_t)(microseconds % 1000000) * 1000;
+
+        n = (int)syscall(SYS_epoll_pwait2, pollfd, events, count, (microseconds < 0) ? NULL : &timeout, NULL, 0);
+        if (n < 0 && errno == ENOSYS)
+            carambolas_net_poller_pwait2_supported = 0;
+    }
+
+    if (!carambolas_net_poller_pwait2_supported)
+#endif
+    {
+        // Round up to the next millisecond so that a sub-millisecond wait does not degenerate into a busy loop.
+        n = epoll_wait(pollfd, events, count, (microseconds < 0) ? -1 : (microseconds + 999) / 1000);
+    }
+
+    if (n < 0)
+    {
+        // A signal is not an error. It's just as if the timeout expired.
+        if (errno == EINTR)
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+        return carambolas_net_socket_getlasterror();
+    }
+
+    for (int i = 0; i < n; ++i)
+        tokens[i] = (int32_t)events[i].data.u64;
+
+    *nready = n;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    (void)pollfd;
+    (void)microseconds;
+    (void)tokens;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+int64_t 
+carambolas_net_clock_now(void)
+{
+#ifdef WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    // Split to avoid overflowing 64 bits with the multiplication.
+    return (counter.QuadPart / frequency.QuadPart) * 1000000000LL + (counter.QuadPart % frequency.QuadPart) * 1000000000LL / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+void 
+carambolas_net_clock_sleep_until(int64_t deadline)
+{
+#ifdef LINUX
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline / 1000000000LL);
+    ts.tv_nsec = (long)(deadline % 1000000000LL);
+
+    // An absolute deadline is not affected by signals or by the time it takes to get here.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        continue;
+#else
+    int64_t remaining = deadline - carambolas_net_clock_now();
+    if (remaining <= 0)
+        return;
+#ifdef WINDOWS
+    Sleep((DWORD)((remaining + 999999) / 1000000));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(remaining / 1000000000LL);
+    ts.tv_nsec = (long)(remaining % 1000000000LL);
+    nanosleep(&ts, NULL);
+#endif
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_timer_open(carambolas_net_poller_t pollfd, int32_t* timerfd)
+{
+    *timerfd = -1;
+
+#if defined(HAVE_EPOLL) && defined(HAVE_TIMERFD)
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+        return carambolas_net_socket_getlasterror();
+
+    // The timer is never drained. Re-arming it resets the expiration count so it only becomes readable 
+    // (and is only reported) when the current deadline expires.
+    struct epoll_event event = {0};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = CARAMBOLAS_NET_POLLER_TIMER_TOKEN;
+
+    if (epoll_ctl(pollfd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        carambolas_net_socket_error_t error = carambolas_net_socket_getlasterror();
+        close(fd);
+        return error;
+    }
+
+    // The default timer slack of the calling thread (50us) would be added to every deadline. A poller is meant 
+    // to be used by a single thread so it's assumed to be the thread that opens the timer.
+    prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+
+    *timerfd = fd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+#else
+    (void)pollfd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+#endif
+}
+
+void 
+carambolas_net_poller_timer_close(int32_t timerfd)
+{
+#if defined(HAVE_EPOLL) && defined(HAVE_TIMERFD)
+    if (timerfd >= 0)
+        close(timerfd);
+#else
+    (void)timerfd;
+#endif
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_poller_wait_until(carambolas_net_poller_t pollfd, int32_t timerfd, int64_t deadline, int32_t* tokens, int32_t count, int32_t* nready)
+{
+    *nready = 0;
+
+    if (count <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    int64_t remaining = deadline - carambolas_net_clock_now();
+    if (remaining <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+#if defined(HAVE_EPOLL) && defined(HAVE_TIMERFD)
+    if (timerfd >= 0)
+    {
+        // The timer expires at the deadline no matter how long it takes to get to epoll_wait 
+        // so unlike a relative timeout the wait is never extended by a late start.
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = (time_t)(deadline / 1000000000LL);
+        its.it_value.tv_nsec = (long)(deadline % 1000000000LL);
+        if (timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, NULL) != 0)
+            return carambolas_net_socket_getlasterror();
+
+        if (count > CARAMBOLAS_NET_POLLER_EVENTS_MAX)
+            count = CARAMBOLAS_NET_POLLER_EVENTS_MAX;
+
+        struct epoll_event events[CARAMBOLAS_NET_POLLER_EVENTS_MAX];
+        for (;;)
+        {
+            int n = epoll_wait(pollfd, events, count, -1);
+            if (n < 0 && errno != EINTR)
+                return carambolas_net_socket_getlasterror();
+
+            int32_t m = 0;
+            for (int i = 0; i < n; ++i)
+                if (events[i].data.u64 != CARAMBOLAS_NET_POLLER_TIMER_TOKEN)
+                    tokens[m++] = (int32_t)events[i].data.u64;
+
+            // Keep waiting after a signal or a stale timer expiration until the deadline is actually reached.
+            if (m > 0 || carambolas_net_clock_now() >= deadline)
+            {
+                *nready = m;
+                return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+            }
+        }
+    }
+#else
+    (void)timerfd;
+#endif
+
+    // Without a timer the deadline is converted to a timeout rounded up to the next microsecond.
+    remaining = (remaining + 999) / 1000;
+    return carambolas_net_poller_wait(pollfd, (remaining > INT32_MAX) ? INT32_MAX : (int32_t)remaining, tokens, count, nready);
+}
+
+#ifdef HAVE_IO_URING
+/*
+ * Receive completion ring backed by io_uring. A single multishot recvmsg is kept armed on the socket
+ * so the kernel places each incoming datagram in one of the buffers provided to it and posts a completion.
+ * Draining completions requires no system call at all while datagrams keep arriving.
+ */
+struct carambolas_net_ring
+{
+    int fd;
+    carambolas_net_socket_t sockfd;
+    int armed;
+
+    void* sq;
+    size_t sqsize;
+    uint32_t* sqtail;
+    uint32_t* sqmask;
+    uint32_t* sqarray;
+    struct io_uring_sqe* sqes;
+    size_t sqessize;
+
+    void* cq;
+    size_t cqsize;
+    uint32_t* cqhead;
+    uint32_t* cqtail;
+    uint32_t* cqmask;
+    struct io_uring_cqe* cqes;
+
+    struct io_uring_buf_ring* br;
+    size_t brsize;
+    uint16_t brtail;
+    carambolas_net_arena_t* arena;
+    uint32_t size;
+    uint32_t capacity;
+
+    struct msghdr msg;
+};
+
+/* Bytes reserved for the source address in each buffer. Large enough for both IPv4 and IPv6. */
+#define CARAMBOLAS_NET_RING_NAMELEN             ((uint32_t)sizeof(struct sockaddr_in6))
+
+#define CARAMBOLAS_NET_RING_RECVMSG             1
+
+static
+void
+carambolas_net_ring_provide(carambolas_net_ring_t* ring, uint16_t bid)
+{
+    struct io_uring_buf* buf = &ring->br->bufs[ring->brtail & (ring->capacity - 1)];
+    buf->addr = (uint64_t)(uintptr_t)carambolas_net_arena_slot(ring->arena, bid);
+    buf->len = ring->size;
+    buf->bid = bid;
+    ring->brtail++;
+}
+
+static
+int
+carambolas_net_ring_arm(carambolas_net_ring_t* ring)
+{
+    uint32_t tail = *ring->sqtail;
+    uint32_t index = tail & *ring->sqmask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = ring->sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)&ring->msg;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = CARAMBOLAS_NET_RING_RECVMSG;
+
+    ring->sqarray[index] = index;
+    __atomic_store_n(ring->sqtail, tail + 1, __ATOMIC_RELEASE);
+
+    int n = (int)syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+    if (n < 0)
+        return -errno;
+
+    ring->armed = 1;
+    return 0;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_ring_open(carambolas_net_socket_t sockfd, int32_t size, int32_t capacity, carambolas_net_ring_t** ring, int32_t* ringfd)
+{
+    *ring = NULL;
+    *ringfd = -1;
+
+    if (size <= 0 || capacity <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    // The buffer ring must have a power of 2 number of entries.
+    uint32_t entries = 1;
+    while (entries < (uint32_t)capacity && entries < CARAMBOLAS_NET_RING_CAPACITY_MAX)
+        entries <<= 1;
+
+    carambolas_net_ring_t* r = (carambolas_net_ring_t*)calloc(1, sizeof(carambolas_net_ring_t));
+    if (r == NULL)
+        return CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+
+    r->fd = -1;
+    r->sockfd = sockfd;
+    r->capacity = entries;
+    // Each buffer holds a struct io_uring_recvmsg_out, the source address and the payload. Rounded up to keep buffers 8-byte aligned.
+    r->size = ((uint32_t)sizeof(struct io_uring_recvmsg_out) + CARAMBOLAS_NET_RING_NAMELEN + (uint32_t)size + 7u) & ~7u;
+
+    // Completions may lag behind receive buffers being returned so leave room for one per buffer and then some.
+    struct io_uring_params params = {0};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 2;
+
+    carambolas_net_socket_error_t error = CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+
+    r->fd = (int)syscall(__NR_io_uring_setup, 4, &params);
+    if (r->fd < 0)
+        goto fail;
+
+    // Waiting with a timeout requires IORING_ENTER_EXT_ARG (Linux 5.11). Provided buffer rings (Linux 5.19)
+    // and multishot recvmsg (Linux 6.0) are only detected when registered and submitted respectively.
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+        goto fail;
+
+    r->sqsize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    r->cqsize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (r->cqsize > r->sqsize)
+            r->sqsize = r->cqsize;
+        r->cqsize = 0;
+    }
+
+    r->sq = mmap(NULL, r->sqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq == MAP_FAILED)
+    {
+        r->sq = NULL;
+        goto fail;
+    }
+
+    if (r->cqsize == 0)
+    {
+        r->cq = r->sq;
+    }
+    else
+    {
+        r->cq = mmap(NULL, r->cqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (r->cq == MAP_FAILED)
+        {
+            r->cq = NULL;
+            goto fail;
+        }
+    }
+
+    r->sqessize = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqessize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+    {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    r->sqtail = (uint32_t*)((uint8_t*)r->sq + params.sq_off.tail);
+    r->sqmask = (uint32_t*)((uint8_t*)r->sq + params.sq_off.ring_mask);
+    r->sqarray = (uint32_t*)((uint8_t*)r->sq + params.sq_off.array);
+    r->cqhead = (uint32_t*)((uint8_t*)r->cq + params.cq_off.head);
+    r->cqtail = (uint32_t*)((uint8_t*)r->cq + params.cq_off.tail);
+    r->cqmask = (uint32_t*)((uint8_t*)r->cq + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)((uint8_t*)r->cq + params.cq_off.cqes);
+
+    // Receive buffers are registered once with the kernel as a provided buffer ring and recycled 
+    // after their content has been copied out so no per-datagram registration or allocation takes place.
+    r->brsize = entries * sizeof(struct io_uring_buf);
+    r->br = (struct io_uring_buf_ring*)mmap(NULL, r->brsize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (r->br == MAP_FAILED)
+    {
+        r->br = NULL;
+        error = CARAMBOLAS_NET_SOCKET_ERROR_NOBUFFERSPACEAVAILABLE;
+        goto fail;
+    }
+
+    // Buffers are written by the kernel at any time so they come from a pinned arena (huge pages if available)
+    // in which all slots are permanently taken by the ring. Slot indices double as buffer ids.
+    error = carambolas_net_arena_create((int32_t)r->size, (int32_t)entries, 1, CARAMBOLAS_NET_ARENA_HUGEPAGES, &r->arena);
+    if (error != CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        goto fail;
+
+    int32_t slot;
+    while (carambolas_net_arena_acquire(r->arena, 0, &slot, 1) > 0)
+        continue;
+
+    error = CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+
+    struct io_uring_buf_reg reg = {0};
+    reg.ring_addr = (uint64_t)(uintptr_t)r->br;
+    reg.ring_entries = entries;
+    reg.bgid = 0;
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        goto fail;
+
+    for (uint32_t i = 0; i < entries; ++i)
+        carambolas_net_ring_provide(r, (uint16_t)i);
+    __atomic_store_n(&r->br->tail, r->brtail, __ATOMIC_RELEASE);
+
+    // Only the lengths matter for a multishot recvmsg. They determine the layout of each buffer.
+    r->msg.msg_namelen = CARAMBOLAS_NET_RING_NAMELEN;
+    r->msg.msg_controllen = 0;
+
+    int result = carambolas_net_ring_arm(r);
+    if (result < 0)
+    {
+        if (result != -EINVAL && result != -EOPNOTSUPP)
+            error = carambolas_net_socket_geterror(-result);
+        goto fail;
+    }
+
+    // Kernels without multishot recvmsg fail the request as soon as it's submitted.
+    uint32_t head = *r->cqhead;
+    if (head != __atomic_load_n(r->cqtail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe* cqe = &r->cqes[head & *r->cqmask];
+        if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP)
+            goto fail;
+    }
+
+    *ring = r;
+    *ringfd = r->fd;
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+fail:
+    carambolas_net_ring_close(r);
+    return error;
+}
+
+void 
+carambolas_net_ring_close(carambolas_net_ring_t* ring)
+{
+    if (ring == NULL)
+        return;
+
+    // Closing the ring cancels the pending recvmsg and releases the provided buffer ring.
+    if (ring->fd >= 0)
+        close(ring->fd);
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqessize);
+    if (ring->cq && ring->cq != ring->sq)
+        munmap(ring->cq, ring->cqsize);
+    if (ring->sq)
+        munmap(ring->sq, ring->sqsize);
+    carambolas_net_arena_destroy(ring->arena);
+    if (ring->br)
+        munmap(ring->br, ring->brsize);
+
+    free(ring);
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_ring_recvmany(carambolas_net_ring_t* ring, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    *nmessages = 0;
+
+    if (count <= 0)
+        return CARAMBOLAS_NET_SOCKET_ERROR_INVALIDARGUMENT;
+
+    carambolas_net_socket_error_t error = CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+    uint32_t mask = *ring->cqmask;
+    uint32_t head = *ring->cqhead;
+    uint32_t tail = __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE);
+    uint16_t brtail = ring->brtail;
+    int32_t n = 0;
+    int64_t nbytes = 0;
+    int32_t ntruncated = 0;
+
+    while (head != tail && n < count)
+    {
+        struct io_uring_cqe* cqe = &ring->cqes[head & mask];
+        head++;
+
+        if (cqe->user_data != CARAMBOLAS_NET_RING_RECVMSG)
+            continue;
+
+        // The kernel terminates a multishot request on error or when it runs out of buffers. 
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            ring->armed = 0;
+
+        if (cqe->res < 0)
+        {
+            // Running out of buffers is not an error. Datagrams just wait in the socket until the request is re-armed.
+            if (cqe->res != -ENOBUFS && n == 0)
+                error = carambolas_net_socket_geterror(-cqe->res);
+            continue;
+        }
+
+        if (!(cqe->flags & IORING_CQE_F_BUFFER))
+            continue;
+
+        uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        const uint8_t* data = carambolas_net_arena_slot(ring->arena, bid);
+        const struct io_uring_recvmsg_out* out = (const struct io_uring_recvmsg_out*)data;
+        const uint8_t* name = data + sizeof(struct io_uring_recvmsg_out);
+        const uint8_t* payload = name + CARAMBOLAS_NET_RING_NAMELEN;
+
+        struct sockaddr_storage sas = {0};
+        memcpy(&sas, name, (out->namelen < CARAMBOLAS_NET_RING_NAMELEN) ? out->namelen : CARAMBOLAS_NET_RING_NAMELEN);
+        endpoints[n] = carambolas_net_socket_endpoint(&sas);
+
+        // A truncated datagram is as good as lost. Report it with zero length so the caller can skip it.
+        if ((out->flags & MSG_TRUNC) || out->payloadlen > (uint32_t)stride)
+        {
+            lengths[n] = 0;
+            ntruncated++;
+        }
+        else
+        {
+            memcpy((void*)&buffer[offset + n * stride], payload, out->payloadlen);
+            lengths[n] = (int32_t)out->payloadlen;
+            nbytes += lengths[n];
+        }
+
+        carambolas_net_ring_provide(ring, bid);
+        n++;
+    }
+
+    __atomic_store_n(ring->cqhead, head, __ATOMIC_RELEASE);
+    if (ring->brtail != brtail)
+        __atomic_store_n(&ring->br->tail, ring->brtail, __ATOMIC_RELEASE);
+
+    // Buffers have been returned (or are about to be) so a terminated request can be resumed now.
+    if (!ring->armed && head == tail)
+    {
+        int result = carambolas_net_ring_arm(ring);
+        if (result < 0 && n == 0)
+            error = carambolas_net_socket_geterror(-result);
+    }
+
+    *nmessages = n;
+    if (n == 0 && error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        error = CARAMBOLAS_NET_SOCKET_ERROR_WOULDBLOCK;
+    else if (n > 0)
+        error = CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+    // Draining completions is not a system call so only datagrams and failures are counted.
+    if (stats)
+    {
+        if (error == CARAMBOLAS_NET_SOCKET_ERROR_NONE)
+        {
+            stats->received += n;
+            stats->receivedbytes += nbytes;
+            stats->truncated += ntruncated;
+        }
+        else if (error == CARAMBOLAS_NET_SOCKET_ERROR_WOULDBLOCK)
+        {
+            stats->receivewouldblock++;
+        }
+        else
+        {
+            stats->receiveerrors++;
+        }
+    }
+
+    return error;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_ring_wait(carambolas_net_ring_t* ring, int32_t microseconds, int32_t* result)
+{
+    *result = 0;
+
+    if (!ring->armed)
+    {
+        int error = carambolas_net_ring_arm(ring);
+        if (error < 0)
+            return carambolas_net_socket_geterror(-error);
+    }
+
+    if (*ring->cqhead == __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE))
+    {
+        if (microseconds == 0)
+            return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+
+        struct { int64_t tv_sec; int64_t tv_nsec; } timeout;
+        timeout.tv_sec = microseconds / 1000000;
+        timeout.tv_nsec = (int64_t)(microseconds % 1000000) * 1000;
+
+        struct io_uring_getevents_arg arg = {0};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (microseconds < 0) ? 0 : (uint64_t)(uintptr_t)&timeout;
+
+        int n = (int)syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if (n < 0 && errno != ETIME && errno != EINTR)
+            return carambolas_net_socket_getlasterror();
+    }
+
+    *result = (*ring->cqhead != __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE));
+    return CARAMBOLAS_NET_SOCKET_ERROR_NONE;
+}
+#else
+carambolas_net_socket_error_t 
+carambolas_net_ring_open(carambolas_net_socket_t sockfd, int32_t size, int32_t capacity, carambolas_net_ring_t** ring, int32_t* ringfd)
+{
+    (void)sockfd;
+    (void)size;
+    (void)capacity;
+    *ring = NULL;
+    *ringfd = -1;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+}
+
+void 
+carambolas_net_ring_close(carambolas_net_ring_t* ring)
+{
+    (void)ring;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_ring_recvmany(carambolas_net_ring_t* ring, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats)
+{
+    (void)ring;
+    (void)buffer;
+    (void)offset;
+    (void)stride;
+    (void)count;
+    (void)endpoints;
+    (void)lengths;
+    (void)stats;
+    *nmessages = 0;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+}
+
+carambolas_net_socket_error_t 
+carambolas_net_ring_wait(carambolas_net_ring_t* ring, int32_t microseconds, int32_t* result)
+{
+    (void)ring;
+    (void)microseconds;
+    *result = 0;
+    return CARAMBOLAS_NET_SOCKET_ERROR_OPERATIONNOTSUPPORTED;
+}
+#endif
@@ -36,10 +36,58 @@ extern "C" {
 
 typedef int32_t carambolas_net_socket_t;
 typedef int32_t carambolas_net_socket_error_t;
+typedef int32_t carambolas_net_poller_t;
+typedef struct carambolas_net_ring carambolas_net_ring_t;
+typedef struct carambolas_net_arena carambolas_net_arena_t;
+typedef struct carambolas_net_filter carambolas_net_filter_t;
 
 #define CARAMBOLAS_NET_SOCKET_AF_IPV4                                   2
 #define CARAMBOLAS_NET_SOCKET_AF_IPV6                                  23
 
+#define CARAMBOLAS_NET_SOCKET_BATCH_MAX                                64    // Maximum number of datagrams transferred by a single batch operation.
+#define CARAMBOLAS_NET_SOCKET_SEGMENT_MAX                              64    // Maximum number of segments in a single segmented (coalesced) datagram.
+#define CARAMBOLAS_NET_SOCKET_SEGMENT_BYTES_MAX                     65507    // Maximum number of bytes in a single segmented (coalesced) datagram.
+
+#define CARAMBOLAS_NET_SOCKET_OFFLOAD_SEGMENTATION                      1    // UDP generic segmentation offload (GSO).
+#define CARAMBOLAS_NET_SOCKET_OFFLOAD_COALESCING                        2    // UDP generic receive offload (GRO).
+
+#define CARAMBOLAS_NET_SOCKET_PACING_NONE                               0    // Datagrams leave as soon as possible.
+#define CARAMBOLAS_NET_SOCKET_PACING_LAUNCHTIME                         1    // Each datagram may carry a launch time (SO_TXTIME).
+#define CARAMBOLAS_NET_SOCKET_PACING_RATE                               2    // The socket as a whole is paced at a maximum rate (SO_MAX_PACING_RATE).
+
+#define CARAMBOLAS_NET_SOCKET_ECN_NOT_ECT                               0    // Not ECN-capable transport.
+#define CARAMBOLAS_NET_SOCKET_ECN_ECT1                                  1    // ECN-capable transport ECT(1).
+#define CARAMBOLAS_NET_SOCKET_ECN_ECT0                                  2    // ECN-capable transport ECT(0).
+#define CARAMBOLAS_NET_SOCKET_ECN_CE                                    3    // Congestion experienced.
+
+#define CARAMBOLAS_NET_SOCKET_SELECT_READ                               0
+#define CARAMBOLAS_NET_SOCKET_SELECT_WRITE                              1
+#define CARAMBOLAS_NET_SOCKET_SELECT_ERROR                              2
+
+#define CARAMBOLAS_NET_POLLER_EVENTS_MAX                               64    // Maximum number of ready sockets reported by a single wait.
+#define CARAMBOLAS_NET_POLLER_TIMER_TOKEN                      0xFFFFFFFFu    // Token of the deadline timer. Never reported as a ready socket.
+
+#define CARAMBOLAS_NET_RING_CAPACITY_MAX                            32768    // Maximum number of receive buffers provided to a completion ring.
+
+#define CARAMBOLAS_NET_ARENA_HUGEPAGES                                  1    // Back the arena with huge pages if available.
+
+#define CARAMBOLAS_NET_CIPHER_PORTABLE                                  0    // Portable C implementation (one block at a time).
+#define CARAMBOLAS_NET_CIPHER_SSE2                                      1    // SSE2 implementation (4 blocks at a time).
+#define CARAMBOLAS_NET_CIPHER_AVX2                                      2    // AVX2 implementation (8 blocks at a time).
+
+#define CARAMBOLAS_NET_CRC32C_PORTABLE                                  0    // Portable C implementation (slicing-by-8).
+#define CARAMBOLAS_NET_CRC32C_SSE42                                     1    // SSE4.2 crc32 instruction (3 interleaved streams).
+
+#define CARAMBOLAS_NET_PACKET_ACCEPT                                 0x0A    // Packet types (see Carambolas.Net.Protocol.PacketFlags).
+#define CARAMBOLAS_NET_PACKET_CHALLENGE                              0x0B
+#define CARAMBOLAS_NET_PACKET_CONNECT                                0x0C
+#define CARAMBOLAS_NET_PACKET_DATA                                   0x0D
+#define CARAMBOLAS_NET_PACKET_RESET                                  0x0F
+#define CARAMBOLAS_NET_PACKET_SECURE_ACCEPT                          0x1A
+#define CARAMBOLAS_NET_PACKET_SECURE_CONNECT                         0x1C    // Protected by a CRC32-C like the insecure packet types.
+#define CARAMBOLAS_NET_PACKET_SECURE_DATA                            0x1D
+#define CARAMBOLAS_NET_PACKET_SECURE_RESET                           0x1F
+
 #define CARAMBOLAS_NET_SOCKET_ERROR                                    -1    // An unspecified error has occurred.
 #define CARAMBOLAS_NET_SOCKET_ERROR_NONE                                0    // Operation succeeded.    
                                                                      
@@ -106,6 +154,39 @@ typedef struct
     uint16_t port;
 } carambolas_net_socket_endpoint_t;
 
+typedef struct
+{
+    int64_t passed;         // Datagrams that passed the filter.
+    int64_t malformed;      // Datagrams dropped for having invalid packet flags or an invalid length.
+    int64_t corrupted;      // Datagrams dropped for having an invalid checksum.
+    int64_t throttled;      // Connection requests dropped for exceeding the rate allowed per source end point.
+} carambolas_net_filter_counters_t;
+
+/*
+ * Counters of a socket updated by every receive and send operation that is given a pointer to them. Counters are 
+ * only written by the thread that operates the socket and may be read at any time from any other thread (values 
+ * may be slightly out of date but never torn on 64-bit platforms). Receive and send counters occupy separate cache 
+ * lines and the whole block must be 64-byte aligned so that no other data shares a line with it.
+ */
+typedef struct
+{
+    int64_t receivecalls;       // System calls made to receive datagrams.
+    int64_t received;           // Datagrams received including truncated datagrams.
+    int64_t receivedbytes;      // Bytes received excluding truncated datagrams.
+    int64_t truncated;          // Datagrams discarded for being larger than the receive buffer.
+    int64_t overflows;          // Datagrams dropped by the kernel because the socket receive buffer was full (SO_RXQ_OVFL).
+    int64_t receivewouldblock;  // Receive calls that found no datagram available.
+    int64_t receiveerrors;      // Receive calls that failed for any other reason.
+    int64_t reserved0;
+
+    int64_t sendcalls;          // System calls made to send datagrams.
+    int64_t sent;               // Datagrams sent.
+    int64_t sentbytes;          // Bytes sent.
+    int64_t sendwouldblock;     // Send calls that failed because the socket send buffer (or device queue) was full.
+    int64_t senderrors;         // Send calls that failed for any other reason.
+    int64_t reserved1[3];
+} carambolas_net_socket_stats_t;
+
 CARAMBOLAS_NET_EXPORT int32_t carambolas_net_initialize(void);
 
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_open(int32_t addressFamily, carambolas_net_socket_t* sockfd);
@@ -115,15 +196,94 @@ CARAMBOLAS_NET_EXPORT void carambolas_net_socket_close(carambolas_net_socket_t s
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setsockopt(carambolas_net_socket_t sockfd, int32_t level, int32_t optname, int32_t optval);
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_getsockopt(carambolas_net_socket_t sockfd, int32_t level, int32_t optname, int32_t* optval);
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setblocking(carambolas_net_socket_t  sockfd, int32_t value);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setoffload(carambolas_net_socket_t sockfd, int32_t flags, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_settimestamping(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setmtuprobing(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_getmtu(carambolas_net_socket_t sockfd, int32_t* mtu);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setpacing(carambolas_net_socket_t sockfd, int32_t value, int32_t* mode);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setpacingrate(carambolas_net_socket_t sockfd, uint32_t rate);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setecn(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setpacketinfo(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setzerocopy(carambolas_net_socket_t sockfd, int32_t value, int32_t* enabled);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setreuseport(carambolas_net_socket_t sockfd, int32_t value);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_setsteering(carambolas_net_socket_t sockfd, int32_t count);
 
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_bind(carambolas_net_socket_t sockfd, carambolas_net_socket_endpoint_t* endpoint);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_connect(carambolas_net_socket_t sockfd, const carambolas_net_socket_endpoint_t* endpoint);
 
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_available(carambolas_net_socket_t sockfd, int32_t* nbytes);
 
 CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_poll(carambolas_net_socket_t sockfd, int32_t microseconds, int32_t mode, int32_t* result);
 
-CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes);
-CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendto(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvfrom(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvmany(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvmany_timestamped(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvmany_annotated(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, uint8_t* ecn, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvmany_addressed(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* ages, uint8_t* ecn, carambolas_net_socket_endpoint_t* destinations, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvfrom_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, int32_t* segment, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_recvmany_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendto(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendmany(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendto_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t size, int32_t segment, const carambolas_net_socket_endpoint_t* endpoint, int32_t* nbytes, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendmany_paced(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, const int32_t* delays, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendmany_segmented(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendmany_zerocopy(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const int32_t* lengths, const int32_t* delays, int32_t segmented, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_sendmany_sourced(carambolas_net_socket_t sockfd, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t index, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, const carambolas_net_socket_endpoint_t* sources, const int32_t* lengths, const int32_t* delays, int32_t zerocopy, int32_t segmented, int32_t* nmessages, int32_t* nnotifications, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_socket_zerocopy_completions(carambolas_net_socket_t sockfd, uint32_t* ranges, int32_t capacity, int32_t* nranges, int32_t* ncopied);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_open(carambolas_net_poller_t* pollfd);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_poller_close(carambolas_net_poller_t pollfd);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_add(carambolas_net_poller_t pollfd, carambolas_net_socket_t sockfd, int32_t token);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_remove(carambolas_net_poller_t pollfd, carambolas_net_socket_t sockfd);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_wait(carambolas_net_poller_t pollfd, int32_t microseconds, int32_t* tokens, int32_t count, int32_t* nready);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_timer_open(carambolas_net_poller_t pollfd, int32_t* timerfd);
+CARAMBOLAS_NET_EXPORT void carambolas_net_poller_timer_close(int32_t timerfd);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_poller_wait_until(carambolas_net_poller_t pollfd, int32_t timerfd, int64_t deadline, int32_t* tokens, int32_t count, int32_t* nready);
+
+CARAMBOLAS_NET_EXPORT int64_t carambolas_net_clock_now(void);
+CARAMBOLAS_NET_EXPORT void carambolas_net_clock_sleep_until(int64_t deadline);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_ring_open(carambolas_net_socket_t sockfd, int32_t size, int32_t capacity, carambolas_net_ring_t** ring, int32_t* ringfd);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_ring_close(carambolas_net_ring_t* ring);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_ring_recvmany(carambolas_net_ring_t* ring, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths, int32_t* nmessages, carambolas_net_socket_stats_t* stats);
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_ring_wait(carambolas_net_ring_t* ring, int32_t microseconds, int32_t* result);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_arena_create(int32_t size, int32_t count, int32_t lists, int32_t flags, carambolas_net_arena_t** arena);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_arena_destroy(carambolas_net_arena_t* arena);
+
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_arena_acquire(carambolas_net_arena_t* arena, int32_t list, int32_t* slots, int32_t count);
+CARAMBOLAS_NET_EXPORT void carambolas_net_arena_release(carambolas_net_arena_t* arena, const int32_t* slots, int32_t count);
+CARAMBOLAS_NET_EXPORT uint8_t* carambolas_net_arena_slot(carambolas_net_arena_t* arena, int32_t slot);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_arena_size(carambolas_net_arena_t* arena);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_arena_flags(carambolas_net_arena_t* arena);
+
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_cipher_select(int32_t implementation);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_cipher_implementation(void);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_cipher_encrypt(const uint32_t* key, const uint32_t* nonce, uint8_t* buffer, int32_t offset, int32_t length);
+CARAMBOLAS_NET_EXPORT void carambolas_net_cipher_sign(const uint32_t* key, const uint32_t* nonce, const uint8_t* buffer, int32_t offset, int32_t aadlength, int32_t textlength, uint32_t* mac);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_cipher_verify(const uint32_t* key, const uint32_t* nonce, const uint8_t* buffer, int32_t offset, int32_t aadlength, int32_t textlength, const uint32_t* mac);
+
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_crc32c_select(int32_t implementation);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_crc32c_implementation(void);
+
+CARAMBOLAS_NET_EXPORT uint32_t carambolas_net_crc32c_compute(const uint8_t* buffer, int32_t offset, int32_t length);
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_crc32c_filter(const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, int32_t* lengths);
+
+CARAMBOLAS_NET_EXPORT carambolas_net_socket_error_t carambolas_net_filter_create(int32_t capacity, int32_t rate, int32_t burst, carambolas_net_filter_t** filter);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_filter_destroy(carambolas_net_filter_t* filter);
+
+CARAMBOLAS_NET_EXPORT int32_t carambolas_net_filter_apply(carambolas_net_filter_t* filter, const uint8_t* buffer, int32_t offset, int32_t stride, int32_t count, const carambolas_net_socket_endpoint_t* endpoints, int32_t* lengths);
+CARAMBOLAS_NET_EXPORT void carambolas_net_filter_counters(carambolas_net_filter_t* filter, carambolas_net_filter_counters_t* counters);
+
+CARAMBOLAS_NET_EXPORT void carambolas_net_keychain_create_public_key(const uint32_t* privatekey, uint32_t* publickey);
+CARAMBOLAS_NET_EXPORT void carambolas_net_keychain_create_shared_key(const uint32_t* privatekey, const uint32_t* remotekey, uint32_t* sharedkey);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1 @@
+call %~dp0\host.bat -load %*
\ No newline at end of file
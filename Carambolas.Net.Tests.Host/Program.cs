@@ -24,6 +24,8 @@ public enum Mode
         private static CommandLineArguments CommandLineArguments = new CommandLineArguments();
 
         private static bool client;
+        private static bool load;
+        private static int clients = 16;
 
         private static IPEndPoint bind = IPEndPoint.Any;
         private static IPEndPoint remote = new IPEndPoint(IPAddress.Loopback, 1313);
@@ -47,6 +49,8 @@ public enum Mode
 
         private static ILog Log = new Logger();
 
+        private static readonly double TicksToMicrosecondsFactor = 1000000.0 / Stopwatch.Frequency;
+
         private class Logger: ILog
         {
             private static string timestamp => DateTime.Now.ToString("yyyy-MM-dd'T'HH:mm:ss.fffK", CultureInfo.InvariantCulture);
@@ -63,6 +67,7 @@ private class Logger: ILog
         private static void ParseParameters()
         {
             client = CommandLineArguments.Contains("client");
+            load = !client && CommandLineArguments.Contains("load");
 
             if (CommandLineArguments.TryGetValue("b", out string value) || CommandLineArguments.TryGetValue("bind", out value))
                 bind = IPEndPoint.Parse(value);
@@ -98,6 +103,22 @@ private static void ParseParameters()
 
             if (CommandLineArguments.Contains("secure"))
                 secure = true;
+
+            if (load)
+            {
+                if (CommandLineArguments.TryGetValue("n", out value) || CommandLineArguments.TryGetValue("clients", out value))
+                    clients = Math.Max(1, int.Parse(value));
+
+                // Each message carries the time it was sent.
+                length = Math.Max(length, sizeof(long));
+
+                // Latency includes the time a message waits to be picked up so poll as often as possible by default.
+                if (!CommandLineArguments.Contains("s") && !CommandLineArguments.Contains("sleep"))
+                    sleep = 1;
+
+                if (duration < 0)
+                    duration = 10;
+            }
         }
 
         private static void PrintParameters()
@@ -108,6 +129,11 @@ private static void PrintParameters()
                 Console.WriteLine($"Local: {bind}");
                 Console.WriteLine($"Remote: {remote}");
             }
+            else if (load)
+            {
+                Console.WriteLine($"[LOAD]");
+                Console.WriteLine($"Clients: {clients}");
+            }
             else
             {
                 Console.WriteLine($"[SERVER]");
@@ -231,6 +257,119 @@ private static void Server(Host host)
 
         }
 
+        /// <summary>
+        /// Runs a number of client hosts against a server host in the same process over in-process sockets 
+        /// and reports the throughput, latency and CPU time per message received by the server.
+        /// </summary>
+        private static void Load()
+        {
+            var settings = new Host.Settings((ushort)Math.Min(ushort.MaxValue, clients), mtc, mtu, uint.MaxValue, int.MaxValue, new Host.Stream.Settings(256000, 0.8f), new Host.Stream.Settings(256000, 0.8f), inProcess: true);
+            var clientSettings = new Host.Settings(0, mtc, mtu, inProcess: true);
+
+            var hosts = new Host[clients];
+            var peers = new Peer[clients];
+            var latencies = new Histogram();
+            var received = 0L;
+            var bytes = 0L;
+            var buffer = new byte[length];
+
+            using (var server = new Host("SERVER", Log))
+            {
+                try
+                {
+                    server.Open(bind, in settings, ConnectionTypes.Insecure | ConnectionTypes.Secure);
+                    Log.Info($"STARTED: {server.EndPoint}");
+
+                    var endPoint = new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port);
+                    for (int i = 0; i < clients; ++i)
+                    {
+                        hosts[i] = new Host($"CLIENT{i}", Log);
+                        hosts[i].Open(IPEndPoint.Any, in clientSettings);
+                        hosts[i].Connect(endPoint, secure ? ConnectionMode.Secure : ConnectionMode.Insecure, out peers[i]);
+                    }
+
+                    var connected = 0;
+                    var process = Process.GetCurrentProcess();
+                    var cpu = process.TotalProcessorTime;
+                    var stopwatch = Stopwatch.StartNew();
+                    var sent = stopwatch.Elapsed;
+
+                    while (stopwatch.Elapsed < TimeSpan.FromSeconds(duration))
+                    {
+                        if (interval >= 0 && (stopwatch.Elapsed - sent) >= TimeSpan.FromMilliseconds(interval))
+                        {
+                            for (int i = 0; i < clients; ++i)
+                            {
+                                var peer = peers[i];
+                                if (peer.State == PeerState.Connected)
+                                {
+                                    var delivery = mode == Mode.Random ? (Protocol.Delivery)(random.Next() % 3) : (Protocol.Delivery)mode;
+                                    for (int j = 0; j < count; j++)
+                                    {
+                                        BitConverter.TryWriteBytes(data[0], Stopwatch.GetTimestamp());
+                                        peer.Send(data[0], delivery);
+                                    }
+                                }
+                            }
+
+                            sent = stopwatch.Elapsed;
+                        }
+
+                        for (int i = 0; i < clients; ++i)
+                        {
+                            while (hosts[i].TryGetEvent(out Event e))
+                            {
+                                switch (e.EventType)
+                                {
+                                    case EventType.Connection:
+                                        connected++;
+                                        break;
+                                    case EventType.Disconnection:
+                                        Log.Info($"DISCONNECTED: {e.Peer} {e.Reason}");
+                                        connected--;
+                                        break;
+                                    case EventType.Data:
+                                        e.Data.Dispose();
+                                        break;
+                                    default:
+                                        break;
+                                }
+                            }
+                        }
+
+                        while (server.TryGetEvent(out Event e))
+                        {
+                            if (e.EventType == EventType.Data)
+                            {
+                                e.Data.CopyTo(0, buffer, 0, sizeof(long));
+                                latencies.Record((long)((Stopwatch.GetTimestamp() - BitConverter.ToInt64(buffer, 0)) * TicksToMicrosecondsFactor));
+                                received++;
+                                bytes += e.Data.Length;
+                                e.Data.Dispose();
+                            }
+                        }
+
+                        Thread.Sleep(sleep);
+                    }
+
+                    var elapsed = stopwatch.Elapsed.TotalSeconds;
+                    var time = (process.TotalProcessorTime - cpu).TotalMilliseconds * 1000;
+
+                    Console.WriteLine();
+                    Console.WriteLine($"Connected: {connected}/{clients}");
+                    Console.WriteLine($"Messages: {received} in {elapsed:F1} s ({received / elapsed:F0} msg/s, {bytes * 8 / elapsed / 1000000:F1} Mbit/s)");
+                    Console.WriteLine($"Latency (us): {latencies}");
+                    Console.WriteLine($"CPU: {time / 1000000:F2} s ({(received > 0 ? time / received : 0):F2} us/msg)");
+                    Console.WriteLine($"Server: {server.Counters}");
+                }
+                finally
+                {
+                    foreach (var host in hosts)
+                        host?.Dispose();
+                }
+            }
+        }
+
         private static void Main(string[] args)
         {
             ParseParameters();
@@ -245,12 +384,19 @@ private static void Main(string[] args)
                 data[1][i] = (byte)i;
             }
             
-            using (var host = new Host(client ? "CLIENT" : "SERVER", Log))
+            if (load)
             {
-                if (client)
-                    Client(host);
-                else
-                    Server(host);
+                Load();
+            }
+            else
+            {
+                using (var host = new Host(client ? "CLIENT" : "SERVER", Log))
+                {
+                    if (client)
+                        Client(host);
+                    else
+                        Server(host);
+                }
             }
 
             if (Debugger.IsAttached)
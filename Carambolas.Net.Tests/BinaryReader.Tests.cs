@@ -2,9 +2,22 @@
 using System.Collections.Generic;
 using System.Text;
 
+using Xunit;
+
 namespace Carambolas.Net.Tests
 {
-    class BinaryReaderTest
+    public class BinaryReaderTest
     {
+        [Fact]
+        public void UncheckedReadULong()
+        {
+            var buffer = new byte[8];
+            var writer = new BinaryWriter(buffer);
+            writer.UncheckedWrite(0xDAB9D8C17757932Bul);
+
+            var reader = new BinaryReader(buffer);
+            reader.UncheckedRead(out ulong value);
+            Assert.Equal(0xDAB9D8C17757932Bul, value);
+        }
     }
 }
@@ -0,0 +1,111 @@
+﻿using System;
+using System.Collections.Generic;
+
+using Xunit;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net.Tests
+{
+    /// <summary>
+    /// Tests of the native CRC32-C against the managed implementation. Tests are inconclusive (and pass) 
+    /// if the native library is not available.
+    /// </summary>
+    public class ChecksumTests
+    {
+        private static readonly Native.ChecksumImplementation[] Implementations = new[]
+        {
+            Native.ChecksumImplementation.Portable,
+            Native.ChecksumImplementation.SSE42
+        };
+
+        public static IEnumerable<object[]> RandomData(int n)
+        {
+            var list = new List<object[]>(n);
+            var random = new Random(n);
+            for (int i = 0; i < n; ++i)
+            {
+                // Cover both the interleaved and the serial paths with arbitrary alignment.
+                var data = new byte[random.Next(0, 4096)];
+                var offset = random.Next(0, Math.Min(data.Length, 16) + 1);
+                random.NextBytes(data);
+                list.Add(new object[] { data, offset });
+            }
+            return list;
+        }
+
+        [Fact]
+        public void NativeCheckValue()
+        {
+            if (!Native.Checksum.IsSupported)
+                return;
+
+            var buffer = System.Text.Encoding.ASCII.GetBytes("123456789");
+            try
+            {
+                foreach (var implementation in Implementations)
+                {
+                    if (Native.SelectChecksum(implementation) != implementation)
+                        continue;
+
+                    Assert.Equal(0xE3069283u, (uint)Native.Checksum.Compute(buffer, 0, buffer.Length));
+                }
+            }
+            finally
+            {
+                Native.SelectChecksum(Native.ChecksumImplementation.SSE42);
+            }
+        }
+
+        [Theory]
+        [MemberData(nameof(RandomData), parameters: 64)]
+        public void NativeMatchesManaged(byte[] data, int offset)
+        {
+            if (!Native.Checksum.IsSupported)
+                return;
+
+            var expected = Crc32C.Compute(data, offset, data.Length - offset);
+            try
+            {
+                foreach (var implementation in Implementations)
+                {
+                    if (Native.SelectChecksum(implementation) != implementation)
+                        continue;
+
+                    Assert.Equal((uint)expected, (uint)Native.Checksum.Compute(data, offset, data.Length - offset));
+                }
+            }
+            finally
+            {
+                Native.SelectChecksum(Native.ChecksumImplementation.SSE42);
+            }
+        }
+
+        [Fact]
+        public void NativeFilterDropsCorruptedInsecurePackets()
+        {
+            if (!Native.Checksum.IsSupported)
+                return;
+
+            const int stride = 64;
+            const int length = 32;
+
+            var buffer = new byte[stride * 4];
+            var lengths = new int[] { length, length, length, length };
+            var random = new Random(0);
+            random.NextBytes(buffer);
+            for (int i = 0; i < lengths.Length; ++i)
+            {
+                buffer[i * stride + 4] = (byte)Protocol.PacketFlags.Data;
+                Crc32C.Compute(buffer, i * stride, length - Crc32C.Size).CopyTo(buffer, i * stride + length - Crc32C.Size);
+            }
+
+            // Corrupt an insecure packet and a secure packet. Secure packets are left to be authenticated later.
+            buffer[1 * stride + 8] ^= 0x01;
+            buffer[2 * stride + 4] = (byte)(Protocol.PacketFlags.Data | Protocol.PacketFlags.Secure);
+
+            Assert.Equal(1, Native.Checksum.Filter(buffer, 0, stride, lengths.Length, lengths));
+            Assert.Equal(new int[] { length, 0, length, length }, lengths);
+        }
+    }
+}
@@ -0,0 +1,185 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Security.Cryptography;
+
+using Xunit;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net.Tests
+{
+    /// <summary>
+    /// Known-answer tests of the native cipher against the managed cipher. Remote peers may use either 
+    /// implementation so they must produce exactly the same output. Tests are inconclusive (and pass) 
+    /// if the native library is not available.
+    /// </summary>
+    public class CipherTests
+    {
+        private static readonly Native.CipherImplementation[] Implementations = new[] 
+        { 
+            Native.CipherImplementation.Portable, 
+            Native.CipherImplementation.SSE2, 
+            Native.CipherImplementation.AVX2 
+        };
+
+        public static IEnumerable<object[]> RandomData(int n)
+        {
+            var list = new List<object[]>(n);
+            using (var rng = RandomNumberGenerator.Create())
+            {
+                var random = new Random(n);
+                for (int i = 0; i < n; ++i)
+                {
+                    var keybytes = new byte[Key.Size];
+                    var noncebytes = new byte[Nonce.Size];
+                    
+                    // Cover every combination of whole and partial blocks up to a large datagram.
+                    var data = new byte[random.Next(0, 2048)];
+                    var aadLength = random.Next(0, Math.Min(data.Length, 64) + 1);
+
+                    rng.GetBytes(keybytes);
+                    rng.GetBytes(noncebytes);
+                    rng.GetBytes(data);
+
+                    list.Add(new object[] { keybytes, noncebytes, data, aadLength });
+                }
+            }
+            return list;
+        }
+
+        // Test vector in section 2.4.2 of RFC 8439. https://tools.ietf.org/html/rfc8439#section-2.4.2
+        private static readonly byte[] Plaintext = System.Text.Encoding.ASCII.GetBytes("Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.");
+
+        private static readonly byte[] Ciphertext = new byte[]
+        {
+            0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+            0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+            0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+            0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+            0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+            0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+            0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+            0x87, 0x4d
+        };
+
+        private static Key TestVectorKey
+        {
+            get
+            {
+                var keybytes = new byte[Key.Size];
+                for (int i = 0; i < keybytes.Length; ++i)
+                    keybytes[i] = (byte)i;
+
+                return new Key(keybytes);
+            }
+        }
+
+        private static readonly Nonce TestVectorNonce = new Nonce(new byte[] { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00 });
+
+        [Fact]
+        public void ManagedEncryptTestVector()
+        {
+            var cipher = new Cipher { Key = TestVectorKey };
+            var buffer = (byte[])Plaintext.Clone();
+
+            cipher.EncryptInPlace(buffer, 0, buffer.Length, in TestVectorNonce);
+
+            Assert.Equal(Ciphertext, buffer);
+        }
+
+        [Fact]
+        public void NativeEncryptTestVector()
+        {
+            if (!Native.CipherFactory.IsSupported)
+                return;
+
+            try
+            {
+                foreach (var implementation in Implementations)
+                {
+                    if (Native.SelectCipher(implementation) != implementation)
+                        continue;
+
+                    var cipher = new Native.Cipher { Key = TestVectorKey };
+                    var buffer = (byte[])Plaintext.Clone();
+
+                    cipher.EncryptInPlace(buffer, 0, buffer.Length, in TestVectorNonce);
+
+                    Assert.Equal(Ciphertext, buffer);
+                }
+            }
+            finally
+            {
+                Native.SelectCipher(Native.CipherImplementation.AVX2);
+            }
+        }
+
+        [Theory]
+        [MemberData(nameof(RandomData), parameters: 64)]
+        public void NativeMatchesManaged(byte[] keybytes, byte[] noncebytes, byte[] data, int aadLength)
+        {
+            if (!Native.CipherFactory.IsSupported)
+                return;
+
+            var key = new Key(keybytes);
+            var nonce = new Nonce(noncebytes);
+            var textLength = data.Length - aadLength;
+
+            var managed = new Cipher { Key = key };
+            var expected = (byte[])data.Clone();
+            managed.EncryptInPlace(expected, aadLength, textLength, in nonce);
+            managed.Sign(expected, 0, aadLength, textLength, in nonce, out Mac expectedMac);
+
+            try
+            {
+                foreach (var implementation in Implementations)
+                {
+                    if (Native.SelectCipher(implementation) != implementation)
+                        continue;
+
+                    var cipher = new Native.Cipher { Key = key };
+                    var buffer = (byte[])data.Clone();
+
+                    cipher.EncryptInPlace(buffer, aadLength, textLength, in nonce);
+                    Assert.Equal(expected, buffer);
+
+                    cipher.Sign(buffer, 0, aadLength, textLength, in nonce, out Mac mac);
+                    Assert.Equal(expectedMac, mac);
+
+                    Assert.True(cipher.Verify(buffer, 0, aadLength, textLength, in nonce, in mac));
+                    var (m0, m1, m2, m3) = mac;
+                    Assert.False(cipher.Verify(buffer, 0, aadLength, textLength, in nonce, new Mac(m0 ^ 1, m1, m2, m3)));
+
+                    cipher.DecryptInPlace(buffer, aadLength, textLength, in nonce);
+                    Assert.Equal(data, buffer);
+                }
+            }
+            finally
+            {
+                Native.SelectCipher(Native.CipherImplementation.AVX2);
+            }
+        }
+
+        [Fact]
+        public void NativeVerifyFailsOnTamperedData()
+        {
+            if (!Native.CipherFactory.IsSupported)
+                return;
+
+            var cipher = new Native.Cipher { Key = TestVectorKey };
+            var buffer = (byte[])Plaintext.Clone();
+
+            cipher.EncryptInPlace(buffer, 16, buffer.Length - 16, in TestVectorNonce);
+            cipher.Sign(buffer, 0, 16, buffer.Length - 16, in TestVectorNonce, out Mac mac);
+
+            for (int i = 0; i < buffer.Length; ++i)
+            {
+                buffer[i] ^= 0x01;
+                Assert.False(cipher.Verify(buffer, 0, 16, buffer.Length - 16, in TestVectorNonce, in mac));
+                buffer[i] ^= 0x01;
+            }
+
+            Assert.True(cipher.Verify(buffer, 0, 16, buffer.Length - 16, in TestVectorNonce, in mac));
+        }
+    }
+}
@@ -0,0 +1,169 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Threading;
+
+using Xunit;
+
+namespace Carambolas.Net.Tests
+{
+    public class ConcurrentRingTests
+    {
+        [Theory]
+        [InlineData(1, 1)]
+        [InlineData(4, 3)]
+        [InlineData(4, 4)]
+        [InlineData(4, 100)]
+        [InlineData(256, 10000)]
+        public void EnqueueAndDequeueInOrder(int capacity, int n)
+        {
+            var ring = new ConcurrentRing<int>(capacity);
+            Assert.True(ring.IsEmpty);
+
+            for (int i = 0; i < n; ++i)
+                ring.Enqueue(i);
+
+            Assert.False(ring.IsEmpty);
+
+            for (int i = 0; i < n; ++i)
+            {
+                Assert.True(ring.TryDequeue(out int item));
+                Assert.Equal(i, item);
+            }
+
+            Assert.True(ring.IsEmpty);
+            Assert.False(ring.TryDequeue(out int _));
+        }
+
+        [Fact]
+        public void InterleavedEnqueueAndDequeue()
+        {
+            var ring = new ConcurrentRing<int>(4);
+            var expected = 0;
+            var next = 0;
+            for (int i = 0; i < 1000; ++i)
+            {
+                for (int j = 0; j < i % 7; ++j)
+                    ring.Enqueue(next++);
+
+                for (int j = 0; j < i % 5; ++j)
+                {
+                    if (!ring.TryDequeue(out int item))
+                        break;
+
+                    Assert.Equal(expected++, item);
+                }
+            }
+
+            while (ring.TryDequeue(out int item))
+                Assert.Equal(expected++, item);
+
+            Assert.Equal(next, expected);
+        }
+
+        [Theory]
+        [InlineData(0, 0, 0)]
+        [InlineData(3, 0, 3)]
+        [InlineData(10, 2, 5)]
+        [InlineData(10, 0, 20)]
+        public void DequeueBatch(int n, int index, int count)
+        {
+            var ring = new ConcurrentRing<int>(8);
+            for (int i = 0; i < n; ++i)
+                ring.Enqueue(i);
+
+            var items = new int[index + count];
+            var dequeued = ring.TryDequeue(items, index, count);
+
+            Assert.Equal(Math.Min(n, count), dequeued);
+            for (int i = 0; i < dequeued; ++i)
+                Assert.Equal(i, items[index + i]);
+        }
+
+        [Fact]
+        public void Clear()
+        {
+            var ring = new ConcurrentRing<int>(2);
+            for (int i = 0; i < 10; ++i)
+                ring.Enqueue(i);
+
+            ring.Clear();
+
+            Assert.True(ring.IsEmpty);
+
+            ring.Enqueue(42);
+            Assert.True(ring.TryDequeue(out int item));
+            Assert.Equal(42, item);
+        }
+
+        [Fact]
+        public void MultipleProducersAndConsumers()
+        {
+            const int producers = 4;
+            const int consumers = 2;
+            const int n = 100000;
+
+            var ring = new ConcurrentRing<long>(16);
+            var received = new List<long>[consumers];
+            var remaining = producers;
+
+            var threads = new List<Thread>();
+            for (int p = 0; p < producers; ++p)
+            {
+                var id = (long)p;
+                threads.Add(new Thread(() =>
+                {
+                    for (int i = 0; i < n; ++i)
+                        ring.Enqueue((id << 32) | (uint)i);
+
+                    Interlocked.Decrement(ref remaining);
+                }));
+            }
+
+            for (int c = 0; c < consumers; ++c)
+            {
+                var list = received[c] = new List<long>(producers * n);
+                threads.Add(new Thread(() =>
+                {
+                    while (true)
+                    {
+                        if (ring.TryDequeue(out long item))
+                            list.Add(item);
+                        else if (Volatile.Read(ref remaining) == 0 && ring.IsEmpty)
+                            break;
+                    }
+                }));
+            }
+
+            foreach (var thread in threads)
+                thread.Start();
+
+            foreach (var thread in threads)
+                thread.Join();
+
+            // Every item must be received exactly once and each consumer must see the items of each producer in order.
+            var seen = new bool[producers, n];
+            var total = 0;
+            foreach (var list in received)
+            {
+                var last = new long[producers];
+                for (int p = 0; p < producers; ++p)
+                    last[p] = -1;
+
+                foreach (var item in list)
+                {
+                    var p = (int)(item >> 32);
+                    var i = (int)(item & 0xFFFFFFFF);
+
+                    Assert.True(i > last[p]);
+                    Assert.False(seen[p, i]);
+
+                    last[p] = i;
+                    seen[p, i] = true;
+                    total++;
+                }
+            }
+
+            Assert.Equal(producers * n, total);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+﻿using System;
+
+using Xunit;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net.Tests
+{
+    /// <summary>
+    /// Tests of the native admission filter. Tests are inconclusive (and pass) if the native library is not available.
+    /// </summary>
+    public class FilterTests
+    {
+        private const int Stride = 64;
+
+        private static void Write(byte[] buffer, int index, Protocol.PacketFlags flags, int length)
+        {
+            var offset = index * Stride;
+            buffer[offset + 4] = (byte)flags;
+            Crc32C.Compute(buffer, offset, length - Crc32C.Size).CopyTo(buffer, offset + length - Crc32C.Size);
+        }
+
+        [Fact]
+        public void NativeFilterDropsMalformedAndCorruptedPackets()
+        {
+            if (!Native.Filter.IsSupported)
+                return;
+
+            using (var filter = new Native.Filter(64, 0, 0))
+            {
+                var buffer = new byte[Stride * 6];
+                new Random(0).NextBytes(buffer);
+
+                var endPoints = new IPEndPoint[6];
+                for (int i = 0; i < endPoints.Length; ++i)
+                    endPoints[i] = new IPEndPoint(IPAddress.Loopback, (ushort)(1000 + i));
+
+                Write(buffer, 0, Protocol.PacketFlags.Connect, 20);
+                Write(buffer, 1, Protocol.PacketFlags.Connect, 20);
+                Write(buffer, 2, Protocol.PacketFlags.Secure | Protocol.PacketFlags.Connect, 52);
+                Write(buffer, 3, Protocol.PacketFlags.Data, 32);
+                Write(buffer, 4, Protocol.PacketFlags.Data, 32);
+                buffer[5 * Stride + 4] = (byte)(Protocol.PacketFlags.Secure | Protocol.PacketFlags.Reset);
+
+                // Wrong length for a connect, a corrupted secure connect, unknown flags and a secure reset.
+                var lengths = new int[] { 20, 21, 52, 32, 32, 61 };
+                buffer[2 * Stride + 8] ^= 0x01;
+                buffer[4 * Stride + 4] = 0x33;
+
+                Assert.Equal(3, filter.Apply(buffer, 0, Stride, lengths.Length, endPoints, lengths, out var verified));
+                Assert.True(verified);
+                Assert.Equal(new int[] { 20, 0, 0, 32, 0, 61 }, lengths);
+
+                var counters = filter.Counters;
+                Assert.Equal(3, counters.Passed);
+                Assert.Equal(2, counters.Malformed);
+                Assert.Equal(1, counters.Corrupted);
+                Assert.Equal(0, counters.Throttled);
+            }
+        }
+
+        [Fact]
+        public void NativeFilterThrottlesConnectionRequestsPerSource()
+        {
+            if (!Native.Filter.IsSupported)
+                return;
+
+            const int burst = 3;
+
+            using (var filter = new Native.Filter(64, 1, burst))
+            {
+                var buffer = new byte[Stride * 10];
+                var endPoints = new IPEndPoint[10];
+                var lengths = new int[10];
+                for (int i = 0; i < lengths.Length; ++i)
+                {
+                    // Last two requests are from a different source.
+                    Write(buffer, i, Protocol.PacketFlags.Connect, 20);
+                    endPoints[i] = new IPEndPoint(IPAddress.Loopback, (ushort)(i < 8 ? 1000 : 1001));
+                    lengths[i] = 20;
+                }
+
+                Assert.Equal(8 - burst, filter.Apply(buffer, 0, Stride, lengths.Length, endPoints, lengths, out _));
+                Assert.Equal(new int[] { 20, 20, 20, 0, 0, 0, 0, 0, 20, 20 }, lengths);
+                Assert.Equal(8 - burst, filter.Counters.Throttled);
+            }
+        }
+    }
+}
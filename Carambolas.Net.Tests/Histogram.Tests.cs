@@ -0,0 +1,76 @@
+﻿using System;
+
+using Xunit;
+
+namespace Carambolas.Net.Tests
+{
+    public class HistogramTests
+    {
+        [Fact]
+        public void PercentilesAreWithinPrecision()
+        {
+            var histogram = new Histogram();
+            for (long i = 1; i <= 100000; ++i)
+                histogram.Record(i);
+
+            Assert.Equal(100000, histogram.Count);
+            Assert.Equal(100000, histogram.Max);
+            Assert.Equal(50000.5, histogram.Mean, 6);
+
+            foreach (var p in new double[] { 1.0, 50.0, 90.0, 99.0, 99.9 })
+            {
+                var expected = p * 1000.0;
+                var actual = histogram.Percentile(p);
+                Assert.True(actual >= expected && actual <= expected * (1.0 + 1.0 / 32.0), $"p{p}={actual}");
+            }
+
+            Assert.Equal(100000, histogram.Percentile(100.0));
+        }
+
+        [Fact]
+        public void SmallValuesAreExact()
+        {
+            var histogram = new Histogram();
+            for (long i = 0; i < 64; ++i)
+                histogram.Record(i);
+
+            Assert.Equal(0, histogram.Percentile(0.0));
+            Assert.Equal(31, histogram.Percentile(50.0));
+            Assert.Equal(63, histogram.Percentile(100.0));
+        }
+
+        [Fact]
+        public void ValuesOutOfRangeAreClamped()
+        {
+            var histogram = new Histogram();
+            histogram.Record(-1);
+            histogram.Record(long.MaxValue);
+
+            Assert.Equal(0, histogram.Percentile(50.0));
+            Assert.Equal(Histogram.MaxValue, histogram.Percentile(100.0));
+        }
+
+        [Fact]
+        public void AddMergesValues()
+        {
+            var a = new Histogram();
+            var b = new Histogram();
+            a.Record(10);
+            b.Record(1000);
+            b.Record(1000);
+
+            var merged = new Histogram();
+            merged.Add(a);
+            merged.Add(b);
+
+            Assert.Equal(3, merged.Count);
+            Assert.Equal(1000, merged.Max);
+            Assert.Equal(10, merged.Percentile(33.0));
+            Assert.InRange(merged.Percentile(50.0), 1000, 1000 + 1000 / 32);
+
+            merged.Clear();
+            Assert.Equal(0, merged.Count);
+            Assert.Equal(0, merged.Percentile(50.0));
+        }
+    }
+}
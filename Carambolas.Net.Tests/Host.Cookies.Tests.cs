@@ -0,0 +1,103 @@
+﻿using System;
+using System.Diagnostics;
+using System.Threading;
+
+using Xunit;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net.Tests
+{
+    public class HostCookiesTests
+    {
+        private static readonly Key Secret = new Key(1, 2, 3, 4, 5, 6, 7, 8);
+
+        [Fact]
+        public void CookieIsValidForTheSameSourceAndSession()
+        {
+            var cookies = new Host.Cookies(in Secret);
+            var endPoint = new IPEndPoint(IPAddress.Loopback, 1234);
+            var time = new Protocol.Time(5000);
+
+            var tag = cookies.Compute(in endPoint, 42, time);
+            Assert.True(cookies.Verify(in endPoint, 42, time + 100u, time, tag));
+
+            // Another instance with the same secret must agree.
+            Assert.True(new Host.Cookies(in Secret).Verify(in endPoint, 42, time, time, tag));
+        }
+
+        [Fact]
+        public void CookieIsInvalidForAnotherSourceSessionOrSecret()
+        {
+            var cookies = new Host.Cookies(in Secret);
+            var endPoint = new IPEndPoint(IPAddress.Loopback, 1234);
+            var time = new Protocol.Time(5000);
+
+            var tag = cookies.Compute(in endPoint, 42, time);
+            Assert.False(cookies.Verify(new IPEndPoint(IPAddress.Loopback, 1235), 42, time, time, tag));
+            Assert.False(cookies.Verify(new IPEndPoint(IPAddress.IPv6Loopback, 1234), 42, time, time, tag));
+            Assert.False(cookies.Verify(in endPoint, 43, time, time, tag));
+            Assert.False(cookies.Verify(in endPoint, 42, time, time, tag ^ 1));
+            Assert.False(new Host.Cookies(new Key(8, 7, 6, 5, 4, 3, 2, 1)).Verify(in endPoint, 42, time, time, tag));
+        }
+
+        [Fact]
+        public void CookieExpires()
+        {
+            var cookies = new Host.Cookies(in Secret);
+            var endPoint = new IPEndPoint(IPAddress.Loopback, 1234);
+            var time = new Protocol.Time(5000);
+
+            var tag = cookies.Compute(in endPoint, 42, time);
+            Assert.True(cookies.Verify(in endPoint, 42, time + Protocol.Packet.Cookie.LifeTime, time, tag));
+            Assert.False(cookies.Verify(in endPoint, 42, time + Protocol.Packet.Cookie.LifeTime + 1, time, tag));
+
+            // Cookies from the future are never valid.
+            Assert.False(cookies.Verify(in endPoint, 42, time - 1u, time, tag));
+        }
+
+        [Fact]
+        public void ChallengeIsNoLargerThanConnect()
+        {
+            // A spoofed CONNECT must not be answered with more bytes than it carried.
+            const int challenge = Protocol.Packet.Header.Size + sizeof(uint) + sizeof(uint) + Protocol.Packet.Insecure.Checksum.Size;
+            const int connect = Protocol.Packet.Header.Size + sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Insecure.Checksum.Size;
+            Assert.True(challenge <= connect);
+        }
+
+        [Fact]
+        public void ConnectionIsAcceptedAfterChallenge()
+        {
+            var serverSettings = new Host.Settings(1, inProcess: true, connectionCookies: true);
+            var clientSettings = new Host.Settings(0, inProcess: true);
+
+            using (var server = new Host("SERVER"))
+            using (var client = new Host("CLIENT"))
+            {
+                server.Open(new IPEndPoint(IPAddress.Loopback, 0), in serverSettings, ConnectionTypes.Insecure);
+                client.Open(new IPEndPoint(IPAddress.Loopback, 0), in clientSettings);
+
+                client.Connect(new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port), ConnectionMode.Insecure, out Peer peer);
+
+                var (connected, accepted) = (false, false);
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(10) && !(connected && accepted))
+                {
+                    while (client.TryGetEvent(out Event e))
+                        connected |= e.EventType == EventType.Connection;
+
+                    while (server.TryGetEvent(out Event e))
+                        accepted |= e.EventType == EventType.Connection;
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.True(connected);
+                Assert.True(accepted);
+
+                // Answered right away rather than after an ack timeout.
+                Assert.True(stopwatch.Elapsed < TimeSpan.FromMilliseconds(Protocol.Limits.Ack.Timeout.Default));
+            }
+        }
+    }
+}
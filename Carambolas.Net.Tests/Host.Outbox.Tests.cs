@@ -0,0 +1,94 @@
+﻿using System;
+
+using Xunit;
+
+namespace Carambolas.Net.Tests
+{
+    public class HostOutboxTests
+    {
+        private static Host.Outbox.Staging Stage(uint first, uint count) => new Host.Outbox.Staging() { First = first, Count = count };
+
+        [Fact]
+        public void StagingCompletesWhenAllSendCallsAreReported()
+        {
+            var stage = Stage(10, 3);
+            Assert.False(stage.Complete(10, 10));
+            Assert.Equal(1u, stage.Completed);
+            Assert.False(stage.Complete(11, 11));
+            Assert.True(stage.Complete(12, 12));
+            Assert.False(stage.Busy);
+            Assert.Equal(0u, stage.Completed);
+
+            stage = Stage(10, 3);
+            Assert.True(stage.Complete(10, 12));
+            Assert.False(stage.Busy);
+        }
+
+        [Fact]
+        public void StagingIgnoresRangesOutsideItsSendCalls()
+        {
+            var stage = Stage(10, 3);
+            Assert.False(stage.Complete(5, 9));
+            Assert.False(stage.Complete(13, 20));
+            Assert.False(stage.Complete(0, 0));
+            Assert.Equal(0u, stage.Completed);
+            Assert.True(stage.Busy);
+        }
+
+        [Fact]
+        public void StagingCountsRangesThatStraddleFirst()
+        {
+            var stage = Stage(10, 3);
+            Assert.False(stage.Complete(8, 11));
+            Assert.Equal(2u, stage.Completed);
+            Assert.True(stage.Complete(12, 12));
+
+            // A range that covers the whole buffer from both sides.
+            stage = Stage(10, 3);
+            Assert.True(stage.Complete(5, 20));
+        }
+
+        [Fact]
+        public void StagingCountsRangesThatPartlyOverlapCount()
+        {
+            var stage = Stage(10, 3);
+            Assert.False(stage.Complete(11, 20));
+            Assert.Equal(2u, stage.Completed);
+            Assert.True(stage.Complete(10, 10));
+
+            stage = Stage(10, 3);
+            Assert.False(stage.Complete(12, 100));
+            Assert.Equal(1u, stage.Completed);
+            Assert.True(stage.Complete(7, 11));
+        }
+
+        [Fact]
+        public void StagingCountsRangesThatWrapAround()
+        {
+            // Send calls uint.MaxValue - 1, uint.MaxValue, 0 and 1.
+            var stage = Stage(uint.MaxValue - 1, 4);
+            Assert.False(stage.Complete(uint.MaxValue - 1, 0));
+            Assert.Equal(3u, stage.Completed);
+            Assert.True(stage.Complete(1, 1));
+
+            stage = Stage(uint.MaxValue - 1, 4);
+            Assert.False(stage.Complete(uint.MaxValue, 5));
+            Assert.Equal(3u, stage.Completed);
+            Assert.False(stage.Complete(2, 10));
+            Assert.True(stage.Complete(uint.MaxValue - 10, uint.MaxValue - 1));
+
+            // Range that wraps around and straddles first.
+            stage = Stage(1, 2);
+            Assert.False(stage.Complete(uint.MaxValue - 2, 1));
+            Assert.Equal(1u, stage.Completed);
+            Assert.True(stage.Complete(2, 2));
+
+            // Ranges entirely on the other side of the wrap are ignored.
+            stage = Stage(uint.MaxValue - 1, 2);
+            Assert.False(stage.Complete(0, 3));
+            Assert.False(stage.Complete(uint.MaxValue - 5, uint.MaxValue - 2));
+            Assert.Equal(0u, stage.Completed);
+            Assert.True(stage.Complete(uint.MaxValue - 1, 0));
+        }
+    }
+}
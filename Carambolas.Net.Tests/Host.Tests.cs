@@ -0,0 +1,272 @@
+﻿using System;
+using System.Diagnostics;
+using System.Threading;
+
+using Xunit;
+
+namespace Carambolas.Net.Tests
+{
+    public class HostTests
+    {
+        [Fact]
+        public void PathMtuDiscoveryRaisesPacketSizeUpToTheNegotiatedMtu()
+        {
+            const ushort mtu = 4000;
+
+            var serverSettings = new Host.Settings(1, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: true);
+            var clientSettings = new Host.Settings(0, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: true);
+
+            using (var server = new Host("SERVER"))
+            using (var client = new Host("CLIENT"))
+            {
+                server.Open(new IPEndPoint(IPAddress.Loopback, 0), in serverSettings, ConnectionTypes.Insecure);
+                client.Open(new IPEndPoint(IPAddress.Loopback, 0), in clientSettings);
+                Assert.True(server.PathMtuDiscovery);
+                Assert.True(client.PathMtuDiscovery);
+
+                client.Connect(new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port), ConnectionMode.Insecure, out Peer peer);
+
+                var data = new byte[3000];
+                for (int i = 0; i < data.Length; ++i)
+                    data[i] = (byte)i;
+
+                var received = default(byte[]);
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(10) && (received == null || peer.MaxTransmissionUnit <= mtu - Protocol.MTU.Probe.Granularity))
+                {
+                    while (client.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                            peer.Send(data, Protocol.Delivery.Reliable);
+                    }
+
+                    while (server.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Data)
+                        {
+                            received = new byte[e.Data.Length];
+                            e.Data.CopyTo(0, received, 0, received.Length);
+                            e.Data.Dispose();
+                        }
+                    }
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.InRange(peer.MaxTransmissionUnit, mtu - Protocol.MTU.Probe.Granularity + 1, mtu);
+                Assert.True(peer.PathMtuDiscovery);
+
+                // Packets grow but segments and fragments are still sized for the default MTU by both ends.
+                Assert.Equal(Protocol.Segment.Size.MaxValue(Protocol.MTU.Default, false), peer.MaxSegmentSize);
+                Assert.Equal(Protocol.Fragment.Size.MaxValue(Protocol.MTU.Default, false), peer.MaxFragmentSize);
+
+                Assert.NotNull(received);
+                Assert.Equal(data, received);
+            }
+        }
+
+        [Fact]
+        public void DeliveryCompletesWhenLargerPacketsStopGoingThroughAfterProbing()
+        {
+            const ushort mtu = 4000;
+
+            var serverSettings = new Host.Settings(1, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: true);
+            var clientSettings = new Host.Settings(0, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: true);
+
+            using (var server = new Host("SERVER"))
+            using (var client = new Host("CLIENT"))
+            {
+                server.Open(new IPEndPoint(IPAddress.Loopback, 0), in serverSettings, ConnectionTypes.Insecure);
+                client.Open(new IPEndPoint(IPAddress.Loopback, 0), in clientSettings);
+
+                client.Connect(new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port), ConnectionMode.Insecure, out Peer peer);
+
+                var connected = false;
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(10) && (!connected || peer.MaxTransmissionUnit <= mtu - Protocol.MTU.Probe.Granularity))
+                {
+                    while (client.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                            connected = true;
+                    }
+
+                    while (server.TryGetEvent(out Event e)) { }
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.InRange(peer.MaxTransmissionUnit, mtu - Protocol.MTU.Probe.Granularity + 1, mtu);
+
+                // From now on the path drops anything larger than the default MTU without telling.
+                Sockets.Loopback.SetBlackHole((ushort)client.EndPoint.Port, Protocol.MTU.Default);
+
+                // Enough messages, fragmented or not, to fill several packets at the probed size.
+                const int count = 32;
+                for (int i = 0; i < count; ++i)
+                {
+                    var data = new byte[i % 2 == 0 ? peer.MaxSegmentSize : 3000];
+                    for (int j = 0; j < data.Length; ++j)
+                        data[j] = (byte)(i + j);
+
+                    peer.Send(data, Protocol.Delivery.Reliable);
+                }
+
+                var received = 0;
+                stopwatch.Restart();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(30) && received < count)
+                {
+                    while (client.TryGetEvent(out Event e)) { }
+
+                    while (server.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Data)
+                        {
+                            var data = new byte[e.Data.Length];
+                            e.Data.CopyTo(0, data, 0, data.Length);
+                            e.Data.Dispose();
+
+                            Assert.Equal(received % 2 == 0 ? peer.MaxSegmentSize : 3000, data.Length);
+                            for (int j = 0; j < data.Length; ++j)
+                                Assert.Equal((byte)(received + j), data[j]);
+
+                            received++;
+                        }
+                    }
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.Equal(count, received);
+                Assert.True(peer.MaxTransmissionUnit <= Protocol.MTU.Default);
+            }
+        }
+
+        [Fact]
+        public void PathMtuDiscoveryIsNotAdvertisedByAClientWithABandwidthLimit()
+        {
+            const ushort mtu = 4000;
+            const uint bandwidth = Protocol.Bandwidth.MaxValue / 2;
+
+            // A host unaware of path MTU discovery would clamp a flagged MBW to the maximum bandwidth.
+            var serverSettings = new Host.Settings(1, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: true);
+            var clientSettings = new Host.Settings(0, maxTranmissionUnit: mtu, maxBandwidth: bandwidth, inProcess: true, pathMtuDiscovery: true);
+
+            using (var server = new Host("SERVER"))
+            using (var client = new Host("CLIENT"))
+            {
+                server.Open(new IPEndPoint(IPAddress.Loopback, 0), in serverSettings, ConnectionTypes.Insecure);
+                client.Open(new IPEndPoint(IPAddress.Loopback, 0), in clientSettings);
+                Assert.True(client.PathMtuDiscovery);
+
+                client.Connect(new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port), ConnectionMode.Insecure, out Peer peer);
+
+                var connected = false;
+                var remote = default(Peer);
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(10) && (!connected || remote == null))
+                {
+                    while (client.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                            connected = true;
+                    }
+
+                    while (server.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                            remote = e.Peer;
+                    }
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.True(connected);
+                Assert.NotNull(remote);
+                Assert.Equal(bandwidth >> 3, remote.RemoteBandwidth);
+                foreach (var p in new[] { peer, remote })
+                {
+                    Assert.False(p.PathMtuDiscovery);
+                    Assert.Equal(Protocol.Fragment.Size.MaxValue(mtu, false), p.MaxFragmentSize);
+                }
+            }
+        }
+
+        [Theory]
+        [InlineData(false)]
+        [InlineData(true)]
+        public void FragmentsAreSizedForTheNegotiatedMtuUnlessBothHostsDiscoverThePathMtu(bool pathMtuDiscovery)
+        {
+            const ushort mtu = 4000;
+
+            // The server sizes segments and fragments like a host unaware of path MTU discovery.
+            var serverSettings = new Host.Settings(1, maxTranmissionUnit: mtu, inProcess: true);
+            var clientSettings = new Host.Settings(0, maxTranmissionUnit: mtu, inProcess: true, pathMtuDiscovery: pathMtuDiscovery);
+
+            using (var server = new Host("SERVER"))
+            using (var client = new Host("CLIENT"))
+            {
+                server.Open(new IPEndPoint(IPAddress.Loopback, 0), in serverSettings, ConnectionTypes.Insecure);
+                client.Open(new IPEndPoint(IPAddress.Loopback, 0), in clientSettings);
+                Assert.False(server.PathMtuDiscovery);
+
+                client.Connect(new IPEndPoint(IPAddress.Loopback, server.EndPoint.Port), ConnectionMode.Insecure, out Peer peer);
+
+                // Large enough to be fragmented in both directions.
+                var data = new byte[10000];
+                for (int i = 0; i < data.Length; ++i)
+                    data[i] = (byte)i;
+
+                var remote = default(Peer);
+                var receivedByServer = default(byte[]);
+                var receivedByClient = default(byte[]);
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.Elapsed < TimeSpan.FromSeconds(10) && (receivedByServer == null || receivedByClient == null))
+                {
+                    while (client.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                        {
+                            peer.Send(data, Protocol.Delivery.Reliable);
+                        }
+                        else if (e.EventType == EventType.Data)
+                        {
+                            receivedByClient = new byte[e.Data.Length];
+                            e.Data.CopyTo(0, receivedByClient, 0, receivedByClient.Length);
+                            e.Data.Dispose();
+                        }
+                    }
+
+                    while (server.TryGetEvent(out Event e))
+                    {
+                        if (e.EventType == EventType.Connection)
+                        {
+                            remote = e.Peer;
+                            remote.Send(data, Protocol.Delivery.Reliable);
+                        }
+                        else if (e.EventType == EventType.Data)
+                        {
+                            receivedByServer = new byte[e.Data.Length];
+                            e.Data.CopyTo(0, receivedByServer, 0, receivedByServer.Length);
+                            e.Data.Dispose();
+                        }
+                    }
+
+                    Thread.Sleep(1);
+                }
+
+                Assert.NotNull(remote);
+                foreach (var p in new[] { peer, remote })
+                {
+                    Assert.False(p.PathMtuDiscovery);
+                    Assert.Equal(mtu, p.MaxTransmissionUnit);
+                    Assert.Equal(Protocol.Segment.Size.MaxValue(mtu, false), p.MaxSegmentSize);
+                    Assert.Equal(Protocol.Fragment.Size.MaxValue(mtu, false), p.MaxFragmentSize);
+                }
+
+                Assert.Equal(data, receivedByServer);
+                Assert.Equal(data, receivedByClient);
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Security.Cryptography;
+
+using Xunit;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net.Tests
+{
+    /// <summary>
+    /// Known-answer tests of the native keychain against the managed keychain. Remote peers may use either 
+    /// implementation so they must produce exactly the same keys. Native tests are inconclusive (and pass) 
+    /// if the native library is not available.
+    /// </summary>
+    public class KeychainTests
+    {
+        private static Key FromHex(string s)
+        {
+            var bytes = new byte[Key.Size];
+            for (int i = 0; i < bytes.Length; ++i)
+                bytes[i] = Convert.ToByte(s.Substring(2 * i, 2), 16);
+
+            return new Key(bytes);
+        }
+
+        // Test vectors in section 5.2 of RFC 7748. https://tools.ietf.org/html/rfc7748#section-5.2
+        public static IEnumerable<object[]> ScalarMultiplicationVectors()
+        {
+            yield return new object[] 
+            { 
+                "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4", 
+                "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c", 
+                "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552" 
+            };
+            yield return new object[] 
+            { 
+                "4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d", 
+                "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493", 
+                "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957" 
+            };
+        }
+
+        // Test vector in section 6.1 of RFC 7748. https://tools.ietf.org/html/rfc7748#section-6.1
+        private static readonly Key AlicePrivateKey = FromHex("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+        private static readonly Key AlicePublicKey = FromHex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+        private static readonly Key BobPrivateKey = FromHex("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb");
+        private static readonly Key BobPublicKey = FromHex("de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+        private static readonly Key SharedKey = FromHex("4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742");
+
+        private static IEnumerable<IKeychain> Keychains()
+        {
+            yield return new Keychain();
+            if (Native.Keychain.IsSupported)
+                yield return new Native.Keychain();
+        }
+
+        [Theory]
+        [MemberData(nameof(ScalarMultiplicationVectors))]
+        public void ScalarMultiplicationTestVector(string scalar, string point, string expected)
+        {
+            foreach (var keychain in Keychains())
+                Assert.Equal(FromHex(expected), keychain.CreateSharedKey(FromHex(scalar), FromHex(point)));
+        }
+
+        [Fact]
+        public void KeyAgreementTestVector()
+        {
+            foreach (var keychain in Keychains())
+            {
+                Assert.Equal(AlicePublicKey, keychain.CreatePublicKey(in AlicePrivateKey));
+                Assert.Equal(BobPublicKey, keychain.CreatePublicKey(in BobPrivateKey));
+                Assert.Equal(SharedKey, keychain.CreateSharedKey(in AlicePrivateKey, in BobPublicKey));
+                Assert.Equal(SharedKey, keychain.CreateSharedKey(in BobPrivateKey, in AlicePublicKey));
+            }
+        }
+
+        [Fact]
+        public void NativeMatchesManaged()
+        {
+            if (!Native.Keychain.IsSupported)
+                return;
+
+            var managed = new Keychain();
+            var native = new Native.Keychain();
+            var bytes = new byte[Key.Size];
+
+            using (var rng = RandomNumberGenerator.Create())
+            {
+                for (int i = 0; i < 32; ++i)
+                {
+                    rng.GetBytes(bytes);
+                    var privateKey = new Key(bytes);
+
+                    // Remote keys are not validated so they may be any 32 bytes including non-canonical values.
+                    rng.GetBytes(bytes);
+                    var remoteKey = new Key(bytes);
+
+                    Assert.Equal(managed.CreatePublicKey(in privateKey), native.CreatePublicKey(in privateKey));
+                    Assert.Equal(managed.CreateSharedKey(in privateKey, in remoteKey), native.CreateSharedKey(in privateKey, in remoteKey));
+                }
+            }
+        }
+    }
+}
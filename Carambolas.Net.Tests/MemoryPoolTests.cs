@@ -1,6 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Text;
+using System.Threading;
 
 using Xunit;
 
@@ -63,6 +64,46 @@ public void GetMultiple(int n)
                 for (int j = i + 1; j < n; ++j)
                     Assert.NotSame(m[i], m[j]);
         }
+
+        [Fact]
+        public void GetAfterReturnOnAnotherThread()
+        {
+            const int n = 1000;
+
+            var pool = new Carambolas.Net.Memory.Pool();
+
+            var returned = new HashSet<Net.Memory>();
+            for (int i = 0; i < n; ++i)
+            {
+                var m = pool.Get();
+                m.Length = 100;
+                returned.Add(m);
+            }
+
+            var thread = new Thread(() => { foreach (var m in returned) pool.Return(m); });
+            thread.Start();
+            thread.Join();
+
+            // Everything but what is left in the cache of the returning thread must have been made available.
+            var reused = new HashSet<Net.Memory>();
+            for (int i = 0; i < n; ++i)
+                Assert.True(reused.Add(pool.Get()));
+
+            reused.IntersectWith(returned);
+            Assert.InRange(reused.Count, n - 64, n);
+        }
+
+        [Fact]
+        public void GetAfterDispose()
+        {
+            var pool = new Carambolas.Net.Memory.Pool();
+            var m = pool.Get();
+
+            pool.Dispose();
+            pool.Return(m);
+
+            Assert.Throws<ObjectDisposedException>(() => pool.Get());
+        }
     }
 
 }
@@ -0,0 +1,126 @@
+﻿using System;
+using System.Threading;
+
+using Xunit;
+
+using Carambolas.Net.Sockets;
+
+namespace Carambolas.Net.Tests
+{
+    public class SocketTests
+    {
+        [Fact]
+        public void CountersTrackDatagramsSentAndReceived()
+        {
+            using (var receiver = new Socket(new IPEndPoint(IPAddress.Loopback, 0)))
+            using (var sender = new Socket(new IPEndPoint(IPAddress.Loopback, 0)))
+            {
+                var endPoint = new IPEndPoint(IPAddress.Loopback, receiver.LocalEndPoint.Port);
+                var buffer = new byte[256];
+
+                for (int i = 0; i < 3; ++i)
+                    Assert.Equal(100, sender.Send(buffer, 0, 100, 1000, in endPoint));
+
+                for (int i = 0; i < 2; ++i)
+                    Assert.Equal(100, receiver.Receive(buffer, 0, buffer.Length, 1000, out _));
+
+                // The last datagram does not fit in the buffer.
+                receiver.Receive(buffer, 0, 10, 1000, out _);
+
+                var sent = sender.Counters;
+                Assert.Equal(3, sent.SendCalls);
+                Assert.Equal(3, sent.Sent);
+                Assert.Equal(300, sent.SentBytes);
+                Assert.Equal(0, sent.SendErrors);
+
+                var received = receiver.Counters;
+                Assert.Equal(3, received.ReceiveCalls);
+                Assert.Equal(3, received.Received);
+                Assert.Equal(1, received.Truncated);
+                Assert.Equal(0, received.ReceiveErrors);
+
+                Assert.Equal(3, (sent + received).Sent);
+                Assert.Equal(3, (sent + received).Received);
+            }
+        }
+
+        [Fact]
+        public void CountersAreKeptAfterDispose()
+        {
+            var socket = new Socket(new IPEndPoint(IPAddress.Loopback, 0));
+            var endPoint = new IPEndPoint(IPAddress.Loopback, socket.LocalEndPoint.Port);
+            var buffer = new byte[32];
+
+            socket.Send(buffer, 0, buffer.Length, 1000, in endPoint);
+            socket.Close();
+
+            var counters = socket.Counters;
+            Assert.Equal(1, counters.Sent);
+            Assert.Equal(buffer.Length, counters.SentBytes);
+        }
+
+        [Fact]
+        public void InProcessSocketsExchangeDatagramsThroughMemory()
+        {
+            var settings = new Socket.Settings(8192, 8192, Timeout.Infinite, Timeout.Infinite, inProcess: true);
+            using (var receiver = new Socket(new IPEndPoint(IPAddress.Loopback, 0), in settings))
+            using (var sender = new Socket(new IPEndPoint(IPAddress.Loopback, 0), in settings))
+            {
+                var endPoint = new IPEndPoint(IPAddress.Loopback, receiver.LocalEndPoint.Port);
+                var buffer = new byte[256];
+                for (int i = 0; i < buffer.Length; ++i)
+                    buffer[i] = (byte)i;
+
+                Assert.Equal(100, sender.Send(buffer, 0, 100, 1000, in endPoint));
+
+                var received = new byte[256];
+                Assert.Equal(100, receiver.Receive(received, 0, received.Length, 1000, out IPEndPoint source));
+                Assert.Equal(sender.LocalEndPoint, source);
+                for (int i = 0; i < 100; ++i)
+                    Assert.Equal(buffer[i], received[i]);
+
+                // Nothing else is pending.
+                Assert.Equal(0, receiver.Receive(received, 0, received.Length, 0, out _));
+
+                // Datagrams that do not fit in the ring are dropped and counted by the receiver.
+                for (int i = 0; i < 100; ++i)
+                    sender.Send(buffer, 0, 10, 1000, in endPoint);
+
+                Assert.Equal(101, sender.Counters.Sent);
+                Assert.Equal(10, receiver.Available);
+                Assert.Equal(100 - 64, receiver.Counters.Overflows);
+            }
+        }
+
+        [Fact]
+        public void InProcessSocketsMarkCongestionWhenRingIsHalfFull()
+        {
+            var settings = new Socket.Settings(8192, 8192, Timeout.Infinite, Timeout.Infinite, inProcess: true, ecn: true);
+            using (var receiver = new Socket(new IPEndPoint(IPAddress.Loopback, 0), in settings))
+            using (var sender = new Socket(new IPEndPoint(IPAddress.Loopback, 0), in settings))
+            {
+                Assert.True(receiver.Ecn);
+                Assert.True(sender.Ecn);
+
+                var endPoint = new IPEndPoint(IPAddress.Loopback, receiver.LocalEndPoint.Port);
+                var buffer = new byte[10];
+                for (int i = 0; i < 40; ++i)
+                    sender.Send(buffer, 0, buffer.Length, 1000, in endPoint);
+
+                var received = new byte[40 * buffer.Length];
+                var endPoints = new IPEndPoint[40];
+                var lengths = new int[40];
+                var ages = new int[40];
+                var marks = new ECN[40];
+                Assert.Equal(40, receiver.ReceiveMany(received, 0, buffer.Length, 40, endPoints, lengths, ages, marks));
+
+                // The ring holds 64 datagrams so only those enqueued after the first 32 are marked.
+                for (int i = 0; i < 32; ++i)
+                    Assert.Equal(ECN.Capable0, marks[i]);
+
+                for (int i = 32; i < 40; ++i)
+                    Assert.Equal(ECN.CongestionExperienced, marks[i]);
+            }
+        }
+    }
+}
@@ -394,7 +394,7 @@ internal void UncheckedRead(out uint value)
         internal void UncheckedRead(out ulong value)
         {
             var i = position;
-            value = (ulong)((buffer[i] << 56) | (buffer[i + 1] << 48) | (buffer[i + 2] << 40) | (buffer[i + 3] << 32) | (buffer[i + 4] << 24) | (buffer[i + 5] << 16) | (buffer[i + 6] << 8) | buffer[i + 7]);
+            value = ((ulong)buffer[i] << 56) | ((ulong)buffer[i + 1] << 48) | ((ulong)buffer[i + 2] << 40) | ((ulong)buffer[i + 3] << 32) | ((ulong)buffer[i + 4] << 24) | ((ulong)buffer[i + 5] << 16) | ((ulong)buffer[i + 6] << 8) | buffer[i + 7];
             position = i + 8;
         }
 
@@ -0,0 +1,119 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+using Carambolas.Security.Cryptography;
+
+namespace Carambolas.Net
+{
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        /// <summary>
+        /// Native implementation of <see cref="Crc32C"/> that uses the SSE4.2 crc32 instruction when supported by the processor.
+        /// </summary>
+        public static class Checksum
+        {
+            /// <summary>
+            /// True if the native library could be loaded.
+            /// </summary>
+            public static readonly bool IsSupported = CheckSupport();
+
+            private static bool CheckSupport()
+            {
+                try
+                {
+                    GetChecksumImplementation();
+                    return true;
+                }
+                catch (DllNotFoundException)
+                {
+                    return false;
+                }
+                catch (EntryPointNotFoundException)
+                {
+                    return false;
+                }
+            }
+
+            public static Crc32C Compute(byte[] buffer, int offset, int length)
+            {
+                if (buffer == null)
+                    throw new ArgumentNullException(nameof(buffer));
+
+                if (offset < 0)
+                    throw new ArgumentOutOfRangeException(nameof(offset));
+
+                if (length < 0)
+                    throw new ArgumentOutOfRangeException(nameof(length));
+
+                if (offset > buffer.Length - length)
+                    throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanNumberOfElements, nameof(offset), nameof(length), nameof(buffer)), nameof(length));
+
+                return ComputeChecksum(buffer, offset, length);
+            }
+
+            /// <summary>
+            /// Verify a buffer with the crc appended as produced by <see cref="Crc32C.ComputeAndAppend(byte[], int, int)"/>
+            /// </summary>
+            public static bool Verify(byte[] buffer, int offset, int length) => Compute(buffer, offset, length) == 0x48674BC7;
+
+            /// <summary>
+            /// Verify a batch of <paramref name="count"/> datagrams received <paramref name="stride"/> bytes apart.
+            /// Insecure packets with an invalid checksum are dropped by setting their lengths to zero.
+            /// </summary>
+            /// <returns>Number of datagrams dropped.</returns>
+            public static int Filter(byte[] buffer, int offset, int stride, int count, int[] lengths)
+            {
+                if (buffer == null)
+                    throw new ArgumentNullException(nameof(buffer));
+
+                if (lengths == null)
+                    throw new ArgumentNullException(nameof(lengths));
+
+                if (offset < 0)
+                    throw new ArgumentOutOfRangeException(nameof(offset));
+
+                if (stride <= 0)
+                    throw new ArgumentOutOfRangeException(nameof(stride));
+
+                if (count < 0 || count > lengths.Length)
+                    throw new ArgumentOutOfRangeException(nameof(count));
+
+                if (offset > buffer.Length - (long)stride * count)
+                    throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanNumberOfElements, nameof(offset), $"{nameof(stride)} * {nameof(count)}", nameof(buffer)), nameof(count));
+
+                for (int i = 0; i < count; ++i)
+                    if (lengths[i] > stride)
+                        throw new ArgumentOutOfRangeException(nameof(lengths));
+
+                return FilterChecksum(buffer, offset, stride, count, lengths);
+            }
+        }
+
+        /// <summary>
+        /// Native checksum implementations in order of preference.
+        /// </summary>
+        public enum ChecksumImplementation
+        {
+            Portable = 0,
+            SSE42 = 1
+        }
+
+        /// <summary>
+        /// Select a checksum implementation. Implementations not supported by the processor are downgraded to the best supported.
+        /// </summary>
+        /// <returns>Implementation in effect.</returns>
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_crc32c_select", CallingConvention = CallingConvention.Cdecl)]
+        public static extern ChecksumImplementation SelectChecksum(ChecksumImplementation implementation);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_crc32c_implementation", CallingConvention = CallingConvention.Cdecl)]
+        public static extern ChecksumImplementation GetChecksumImplementation();
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_crc32c_compute", CallingConvention = CallingConvention.Cdecl)]
+        public static extern uint ComputeChecksum(byte[] buffer, int offset, int length);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_crc32c_filter", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int FilterChecksum(byte[] buffer, int offset, int stride, int count, [In, Out] int[] lengths);
+    }
+#endif
+}
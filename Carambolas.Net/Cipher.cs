@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Runtime.InteropServices;
 
 using Carambolas.Security.Cryptography;
 using Carambolas.Security.Cryptography.NaCl;
@@ -23,4 +24,104 @@ public Key Key
 
         public bool Verify(byte[] buffer, int offset, int aadLength, int textLength, in Nonce nonce, in Mac mac) => Poly1305.AEAD.Verify(new ArraySegment<byte>(buffer, offset, aadLength), new ArraySegment<byte>(buffer, offset + aadLength, textLength), cryptobox.CreateKey(in nonce), in mac);
     }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        /// <summary>
+        /// Native implementation of <see cref="Net.Cipher"/> that uses SIMD instructions when supported by the processor. 
+        /// Produces exactly the same output as the managed implementation so peers may use either one.
+        /// </summary>
+        public sealed class Cipher: ICipher
+        {
+            private Key key;
+
+            public Key Key
+            {
+                get => key;
+                set => key = value;
+            }
+
+            public void EncryptInPlace(byte[] buffer, int offset, int length, in Nonce nonce)
+            {
+                ValidateArguments(buffer, offset, length);
+                Native.Encrypt(in key, in nonce, buffer, offset, length);
+            }
+
+            public void DecryptInPlace(byte[] buffer, int offset, int length, in Nonce nonce)
+            {
+                ValidateArguments(buffer, offset, length);
+                Native.Encrypt(in key, in nonce, buffer, offset, length);
+            }
+
+            public void Sign(byte[] buffer, int offset, int aadLength, int textLength, in Nonce nonce, out Mac mac)
+            {
+                if (aadLength < 0)
+                    throw new ArgumentOutOfRangeException(nameof(aadLength));
+
+                ValidateArguments(buffer, offset, aadLength + textLength);
+                Native.Sign(in key, in nonce, buffer, offset, aadLength, textLength, out mac);
+            }
+
+            public bool Verify(byte[] buffer, int offset, int aadLength, int textLength, in Nonce nonce, in Mac mac)
+            {
+                if (aadLength < 0)
+                    throw new ArgumentOutOfRangeException(nameof(aadLength));
+
+                ValidateArguments(buffer, offset, aadLength + textLength);
+                return Native.Verify(in key, in nonce, buffer, offset, aadLength, textLength, in mac) != 0;
+            }
+
+            private static void ValidateArguments(byte[] buffer, int offset, int length)
+            {
+                if (buffer == null)
+                    throw new ArgumentNullException(nameof(buffer));
+
+                if (offset < 0)
+                    throw new ArgumentOutOfRangeException(nameof(offset));
+
+                if (length < 0)
+                    throw new ArgumentOutOfRangeException(nameof(length));
+
+                if (offset > buffer.Length - length)
+                    throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanNumberOfElements, nameof(offset), nameof(length), nameof(buffer)), nameof(length));
+            }
+        }
+
+        /// <summary>
+        /// Native cipher implementations in order of preference. 
+        /// </summary>
+        public enum CipherImplementation
+        {
+            Portable = 0,
+            SSE2 = 1,
+            AVX2 = 2
+        }
+
+#if __IOS__ || UNITY_IOS && !UNITY_EDITOR
+        private const string nativeLibrary = "__Internal";
+#else
+        private const string nativeLibrary = "Carambolas.Net.Native.dll";
+#endif
+
+        /// <summary>
+        /// Select a cipher implementation. Implementations not supported by the processor are downgraded to the best supported.
+        /// </summary>
+        /// <returns>Implementation in effect.</returns>
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_cipher_select", CallingConvention = CallingConvention.Cdecl)]
+        public static extern CipherImplementation SelectCipher(CipherImplementation implementation);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_cipher_implementation", CallingConvention = CallingConvention.Cdecl)]
+        public static extern CipherImplementation GetCipherImplementation();
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_cipher_encrypt", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void Encrypt(in Key key, in Nonce nonce, byte[] buffer, int offset, int length);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_cipher_sign", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void Sign(in Key key, in Nonce nonce, byte[] buffer, int offset, int aadLength, int textLength, out Mac mac);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_cipher_verify", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int Verify(in Key key, in Nonce nonce, byte[] buffer, int offset, int aadLength, int textLength, in Mac mac);
+    }
+#endif
 }
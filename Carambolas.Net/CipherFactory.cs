@@ -6,8 +6,49 @@ namespace Carambolas.Net
 {
     internal sealed class CipherFactory: ICipherFactory
     {
+        /// <summary>
+        /// Native cipher factory if the native library is available; otherwise the managed cipher factory.
+        /// </summary>
+#if USE_NATIVE_SOCKET
+        public static readonly ICipherFactory Default = Native.CipherFactory.IsSupported ? Native.CipherFactory.Default : new CipherFactory();
+#else
         public static readonly ICipherFactory Default = new CipherFactory();
+#endif
 
         public ICipher Create() => new Cipher();
     }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        public sealed class CipherFactory: ICipherFactory
+        {
+            public static readonly ICipherFactory Default = new CipherFactory();
+
+            /// <summary>
+            /// True if the native library could be loaded.
+            /// </summary>
+            public static readonly bool IsSupported = CheckSupport();
+
+            private static bool CheckSupport()
+            {
+                try
+                {
+                    GetCipherImplementation();
+                    return true;
+                }
+                catch (DllNotFoundException)
+                {
+                    return false;
+                }
+                catch (EntryPointNotFoundException)
+                {
+                    return false;
+                }
+            }
+
+            public ICipher Create() => new Cipher();
+        }
+    }
+#endif
 }
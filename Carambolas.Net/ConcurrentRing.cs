@@ -0,0 +1,242 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace Carambolas.Net
+{
+    /// <summary>
+    /// Head and tail positions of a <see cref="ConcurrentRing{T}"/> segment in separate cache lines to avoid 
+    /// false sharing between producers and consumers. Explicit layout is not allowed in generic types.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 3 * 64)]
+    internal struct ConcurrentRingPositions
+    {
+        [FieldOffset(64)]
+        public int Head;
+
+        [FieldOffset(128)]
+        public int Tail;
+    }
+
+    /// <summary>
+    /// A lock-free FIFO queue that supports multiple producers and multiple consumers.
+    /// </summary>
+    /// <remarks>
+    /// Items are kept in a bounded ring where each slot carries a sequence number that tells producers and
+    /// consumers whether it's free or holds an item for the position they want. When a ring fills up it's frozen
+    /// and a new ring twice as big is linked after it. Consumers drain the frozen ring before moving on so order
+    /// is preserved. Producers never block and in a steady state the same ring is reused indefinitely
+    /// without any allocation.
+    /// </remarks>
+    [DebuggerDisplay("IsEmpty = {IsEmpty}")]
+    internal sealed class ConcurrentRing<T>
+    {
+        private const int MaxSegmentLength = 1 << 20;
+
+        private struct Slot
+        {
+            public T Item;
+            public int Sequence;
+        }
+
+        private sealed class Segment
+        {
+            private readonly Slot[] slots;
+            private readonly int mask;
+
+            /// <summary>
+            /// Offset added to the tail when the segment is frozen so that no producer can ever succeed again.
+            /// </summary>
+            private int FreezeOffset => slots.Length * 2;
+
+            private ConcurrentRingPositions positions;
+            private bool frozen;
+
+            public Segment Next;
+
+            public int Length => slots.Length;
+
+            public Segment(int length)
+            {
+                slots = new Slot[length];
+                mask = length - 1;
+                for (int i = 0; i < slots.Length; ++i)
+                    slots[i].Sequence = i;
+            }
+
+            public bool IsEmpty
+            {
+                get
+                {
+                    var head = Volatile.Read(ref positions.Head);
+                    return Volatile.Read(ref slots[head & mask].Sequence) - (head + 1) < 0;
+                }
+            }
+
+            /// <summary>
+            /// True if the segment has been frozen and all its items have been dequeued.
+            /// </summary>
+            public bool IsDrained => Volatile.Read(ref frozen) && Volatile.Read(ref positions.Head) == Volatile.Read(ref positions.Tail) - FreezeOffset;
+
+            public bool TryEnqueue(in T item)
+            {
+                while (true)
+                {
+                    var tail = Volatile.Read(ref positions.Tail);
+                    var index = tail & mask;
+                    var diff = Volatile.Read(ref slots[index].Sequence) - tail;
+                    if (diff == 0)
+                    {
+                        if (Interlocked.CompareExchange(ref positions.Tail, tail + 1, tail) == tail)
+                        {
+                            slots[index].Item = item;
+                            Volatile.Write(ref slots[index].Sequence, tail + 1);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        // Full (or frozen)
+                        return false;
+                    }
+                }
+            }
+
+            public bool TryDequeue(out T item)
+            {
+                while (true)
+                {
+                    var head = Volatile.Read(ref positions.Head);
+                    var index = head & mask;
+                    var diff = Volatile.Read(ref slots[index].Sequence) - (head + 1);
+                    if (diff == 0)
+                    {
+                        if (Interlocked.CompareExchange(ref positions.Head, head + 1, head) == head)
+                        {
+                            item = slots[index].Item;
+                            slots[index].Item = default;
+                            Volatile.Write(ref slots[index].Sequence, head + slots.Length);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        // Empty (or the next item has not been completely written yet)
+                        item = default;
+                        return false;
+                    }
+                }
+            }
+
+            public void Freeze()
+            {
+                Volatile.Write(ref frozen, true);
+                Interlocked.Add(ref positions.Tail, FreezeOffset);
+            }
+        }
+
+        [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+        private Segment head;
+
+        [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+        private Segment tail;
+
+        [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+        private SpinLock growLock = new SpinLock(false);
+
+        /// <param name="capacity">Initial capacity rounded up to the next power of 2.</param>
+        public ConcurrentRing(int capacity)
+        {
+            if (capacity <= 0 || capacity > MaxSegmentLength)
+                throw new ArgumentOutOfRangeException(nameof(capacity));
+
+            var length = 1;
+            while (length < capacity)
+                length <<= 1;
+
+            head = tail = new Segment(length);
+        }
+
+        /// <summary>
+        /// True if there's no item that could be dequeued at the moment.
+        /// </summary>
+        public bool IsEmpty
+        {
+            get
+            {
+                for (var segment = Volatile.Read(ref head); segment != null; segment = Volatile.Read(ref segment.Next))
+                    if (!segment.IsEmpty)
+                        return false;
+
+                return true;
+            }
+        }
+
+        public void Enqueue(in T item)
+        {
+            while (true)
+            {
+                var segment = Volatile.Read(ref tail);
+                if (segment.TryEnqueue(in item))
+                    return;
+
+                // The segment is full. Freeze it and link a bigger one unless another producer has already done it.
+                var locked = false;
+                try
+                {
+                    growLock.Enter(ref locked);
+                    if (tail == segment)
+                    {
+                        segment.Freeze();
+                        var next = new Segment(Math.Min(segment.Length * 2, MaxSegmentLength));
+                        Volatile.Write(ref segment.Next, next);
+                        Volatile.Write(ref tail, next);
+                    }
+                }
+                finally
+                {
+                    if (locked)
+                        growLock.Exit(false);
+                }
+            }
+        }
+
+        public bool TryDequeue(out T item)
+        {
+            while (true)
+            {
+                var segment = Volatile.Read(ref head);
+                if (segment.TryDequeue(out item))
+                    return true;
+
+                var next = Volatile.Read(ref segment.Next);
+                if (next == null || !segment.IsDrained)
+                    return false;
+
+                Interlocked.CompareExchange(ref head, next, segment);
+            }
+        }
+
+        /// <summary>
+        /// Dequeue up to <paramref name="count"/> items into <paramref name="items"/> starting at <paramref name="index"/>.
+        /// </summary>
+        /// <returns>Number of items dequeued.</returns>
+        public int TryDequeue(T[] items, int index, int count)
+        {
+            var n = 0;
+            while (n < count && TryDequeue(out items[index + n]))
+                n++;
+
+            return n;
+        }
+
+        /// <summary>
+        /// Discard all items. Must not be called concurrently with any other method.
+        /// </summary>
+        public void Clear()
+        {
+            while (TryDequeue(out _)) { }
+        }
+    }
+}
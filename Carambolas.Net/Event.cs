@@ -19,12 +19,18 @@ public enum EventType: byte
         public readonly PeerReason Reason;
         public readonly Data Data;
 
+        /// <summary>
+        /// Ticks when the event was queued if the host is instrumented; otherwise zero.
+        /// </summary>
+        internal readonly long Ticks;
+
         internal Event(Peer peer)
         {
             Peer = peer;
             EventType = EventType.Connection;
             Reason = default;
             Data = default;
+            Ticks = default;
         }
 
         internal Event(Peer peer, PeerReason reason = default)
@@ -33,6 +39,7 @@ internal Event(Peer peer, PeerReason reason = default)
             EventType = EventType.Disconnection;
             Reason = reason;
             Data = default;
+            Ticks = default;
         }
 
         internal Event(Peer peer, in Data d)
@@ -41,6 +48,16 @@ internal Event(Peer peer, in Data d)
             EventType = EventType.Data;
             Reason = default;
             Data = d;
+            Ticks = default;
+        }
+
+        internal Event(in Event e, long ticks)
+        {
+            Peer = e.Peer;
+            EventType = e.EventType;
+            Reason = e.Reason;
+            Data = e.Data;
+            Ticks = ticks;
         }
 
         internal void Dispose() => Data.Dispose();
@@ -0,0 +1,230 @@
+﻿using System;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace Carambolas.Net
+{
+    /// <summary>
+    /// Number of received datagrams accepted and dropped by the admission filter of a host.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public readonly struct FilterCounters
+    {
+        /// <summary>
+        /// Datagrams that passed the filter.
+        /// </summary>
+        public readonly long Passed;
+
+        /// <summary>
+        /// Datagrams dropped for having invalid packet flags or an invalid length for the packet type.
+        /// </summary>
+        public readonly long Malformed;
+
+        /// <summary>
+        /// Insecure datagrams dropped for having an invalid checksum.
+        /// </summary>
+        public readonly long Corrupted;
+
+        /// <summary>
+        /// Connection requests dropped for exceeding the rate allowed per source end point.
+        /// </summary>
+        public readonly long Throttled;
+
+        public FilterCounters(long passed, long malformed, long corrupted, long throttled)
+        {
+            Passed = passed;
+            Malformed = malformed;
+            Corrupted = corrupted;
+            Throttled = throttled;
+        }
+
+        public static FilterCounters operator +(in FilterCounters a, in FilterCounters b) => new FilterCounters(a.Passed + b.Passed, a.Malformed + b.Malformed, a.Corrupted + b.Corrupted, a.Throttled + b.Throttled);
+
+        public override string ToString() => $"{nameof(Passed)}={Passed} {nameof(Malformed)}={Malformed} {nameof(Corrupted)}={Corrupted} {nameof(Throttled)}={Throttled}";
+    }
+
+    /// <summary>
+    /// Managed admission filter used when the native library is not available. Only drops insecure datagrams 
+    /// with an invalid checksum if supported (see <see cref="Protocol.Packet.Insecure.Checksum.Filter(byte[], int, int, int, int[], out int)"/>)
+    /// and leaves everything else to the host.
+    /// </summary>
+    internal sealed class Filter: IFilter
+    {
+        /// <summary>
+        /// Create a native filter if the native library is available; otherwise a managed filter.
+        /// </summary>
+        /// <param name="capacity">Number of source end points tracked.</param>
+        /// <param name="rate">Connection requests per second allowed from a single source end point. Zero disables the limit.</param>
+        /// <param name="burst">Connection requests that may be accepted from a single source end point in a row.</param>
+#if USE_NATIVE_SOCKET
+        public static IFilter Create(int capacity, int rate, int burst) => Native.Filter.IsSupported ? (IFilter)new Native.Filter(capacity, rate, burst) : new Filter();
+#else
+        public static IFilter Create(int capacity, int rate, int burst) => new Filter();
+#endif
+
+        private long passed;
+        private long corrupted;
+
+        public FilterCounters Counters => new FilterCounters(Interlocked.Read(ref passed), 0, Interlocked.Read(ref corrupted), 0);
+
+        public int Apply(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, out bool verified)
+        {
+            verified = Protocol.Packet.Insecure.Checksum.Filter(buffer, offset, stride, count, lengths, out int dropped);
+
+            var n = 0;
+            for (int i = 0; i < count; ++i)
+                if (lengths[i] > 0)
+                    n++;
+
+            Interlocked.Add(ref passed, n);
+            Interlocked.Add(ref corrupted, dropped);
+            return dropped;
+        }
+
+        public void Dispose() { }
+    }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        /// <summary>
+        /// Native admission filter applied to a batch of received datagrams before any of them is parsed.
+        /// Drops malformed datagrams, insecure datagrams with an invalid checksum (see <see cref="Checksum.Filter(byte[], int, int, int, int[])"/>)
+        /// and connection requests in excess of a maximum rate per source end point (token bucket).
+        /// <para/>
+        /// A filter is not thread-safe but counters may be read from any thread.
+        /// </summary>
+        public sealed class Filter: IFilter
+        {
+            /// <summary>
+            /// True if the native library could be loaded.
+            /// </summary>
+            public static readonly bool IsSupported = CheckSupport();
+
+            private static bool CheckSupport()
+            {
+                try
+                {
+                    DestroyFilter(IntPtr.Zero);
+                    return true;
+                }
+                catch (DllNotFoundException)
+                {
+                    return false;
+                }
+                catch (EntryPointNotFoundException)
+                {
+                    return false;
+                }
+            }
+
+            private IntPtr handle;
+
+            /// <summary>
+            /// Serializes reading counters with <see cref="Dispose"/> as they may be called from different threads.
+            /// </summary>
+            private readonly object sync = new object();
+
+            /// <summary>
+            /// Final counters kept after the filter is disposed.
+            /// </summary>
+            private FilterCounters counters;
+
+            /// <param name="capacity">Number of source end points tracked.</param>
+            /// <param name="rate">Connection requests per second allowed from a single source end point. Zero disables the limit.</param>
+            /// <param name="burst">Connection requests that may be accepted from a single source end point in a row.</param>
+            public Filter(int capacity, int rate, int burst)
+            {
+                var socketError = CreateFilter(capacity, rate, burst, out handle);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+            }
+
+            ~Filter() => Dispose();
+
+            public FilterCounters Counters
+            {
+                get
+                {
+                    lock (sync)
+                    {
+                        if (handle != IntPtr.Zero)
+                            GetFilterCounters(handle, out counters);
+
+                        return counters;
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Filter a batch of <paramref name="count"/> datagrams received <paramref name="stride"/> bytes apart.
+            /// Datagrams are dropped by setting their lengths to zero. On return <paramref name="verified"/> is always 
+            /// true because the checksum of every insecure datagram is verified.
+            /// </summary>
+            /// <returns>Number of datagrams dropped.</returns>
+            public int Apply(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, out bool verified)
+            {
+                if (handle == IntPtr.Zero)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (buffer == null)
+                    throw new ArgumentNullException(nameof(buffer));
+
+                if (endPoints == null)
+                    throw new ArgumentNullException(nameof(endPoints));
+
+                if (lengths == null)
+                    throw new ArgumentNullException(nameof(lengths));
+
+                if (offset < 0)
+                    throw new ArgumentOutOfRangeException(nameof(offset));
+
+                if (stride <= 0)
+                    throw new ArgumentOutOfRangeException(nameof(stride));
+
+                if (count < 0 || count > lengths.Length || count > endPoints.Length)
+                    throw new ArgumentOutOfRangeException(nameof(count));
+
+                if (offset > buffer.Length - (long)stride * count)
+                    throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanNumberOfElements, nameof(offset), $"{nameof(stride)} * {nameof(count)}", nameof(buffer)), nameof(count));
+
+                for (int i = 0; i < count; ++i)
+                    if (lengths[i] > stride)
+                        throw new ArgumentOutOfRangeException(nameof(lengths));
+
+                var dropped = ApplyFilter(handle, buffer, offset, stride, count, endPoints, lengths);
+                verified = true;
+                return dropped;
+            }
+
+            public void Dispose()
+            {
+                lock (sync)
+                {
+                    var value = handle;
+                    handle = IntPtr.Zero;
+                    if (value != IntPtr.Zero)
+                    {
+                        GetFilterCounters(value, out counters);
+                        DestroyFilter(value);
+                        GC.SuppressFinalize(this);
+                    }
+                }
+            }
+        }
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_filter_create", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError CreateFilter(int capacity, int rate, int burst, out IntPtr filter);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_filter_destroy", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void DestroyFilter(IntPtr filter);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_filter_apply", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int ApplyFilter(IntPtr filter, byte[] buffer, int offset, int stride, int count, [In] IPEndPoint[] endPoints, [In, Out] int[] lengths);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_filter_counters", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void GetFilterCounters(IntPtr filter, out FilterCounters counters);
+    }
+#endif
+}
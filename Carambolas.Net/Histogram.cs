@@ -0,0 +1,191 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.CompilerServices;
+using System.Text;
+using System.Threading;
+
+namespace Carambolas.Net
+{
+    /// <summary>
+    /// Log-linear histogram of non-negative values in the style of an HDR histogram. Values are counted in 
+    /// buckets that double in width every power of 2 with 32 linear sub-buckets each so the relative error 
+    /// of any percentile is under 1/32 (about 3%) from 0 up to <see cref="MaxValue"/>. Values outside of the 
+    /// range are clamped.
+    /// <para/>
+    /// All buckets are allocated up front and recording a value is a handful of arithmetic operations with no 
+    /// allocation. A histogram is meant to have a single writer but may be read from any thread while it's 
+    /// being written. Readers may observe a value that is partially recorded (e.g. counted but not yet summed) 
+    /// which only affects the result by a single sample.
+    /// </summary>
+    [DebuggerDisplay("Count = {Count}")]
+    public sealed class Histogram
+    {
+        private const int SubBucketBits = 5;
+        private const int SubBucketCount = 1 << SubBucketBits;
+        private const int MaxExponent = 39;
+
+        /// <summary>
+        /// Greatest value that can be recorded.
+        /// </summary>
+        public const long MaxValue = (1L << (MaxExponent + 1)) - 1;
+
+        private const int BucketCount = (MaxExponent - SubBucketBits + 2) * SubBucketCount;
+
+        private readonly long[] counts = new long[BucketCount];
+        private long count;
+        private long sum;
+        private long max;
+
+        /// <summary>
+        /// Number of values recorded.
+        /// </summary>
+        public long Count => Volatile.Read(ref count);
+
+        /// <summary>
+        /// Greatest value recorded (after clamping).
+        /// </summary>
+        public long Max => Volatile.Read(ref max);
+
+        public double Mean
+        {
+            get
+            {
+                var n = Volatile.Read(ref count);
+                return n > 0 ? (double)Volatile.Read(ref sum) / n : 0.0;
+            }
+        }
+
+        /// <summary>
+        /// Record a value. Must only be called by a single thread at a time.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public void Record(long value)
+        {
+            if (value < 0)
+                value = 0;
+            else if (value > MaxValue)
+                value = MaxValue;
+
+            var index = IndexOf(value);
+            Volatile.Write(ref counts[index], counts[index] + 1);
+            Volatile.Write(ref sum, sum + value);
+            if (value > max)
+                Volatile.Write(ref max, value);
+            Volatile.Write(ref count, count + 1);
+        }
+
+        /// <summary>
+        /// Add all values recorded by <paramref name="other"/> to this histogram. Must not be called concurrently 
+        /// with <see cref="Record(long)"/> on this histogram but <paramref name="other"/> may still be written.
+        /// </summary>
+        public void Add(Histogram other)
+        {
+            if (other == null)
+                throw new ArgumentNullException(nameof(other));
+
+            var n = 0L;
+            for (int i = 0; i < BucketCount; ++i)
+            {
+                var value = Volatile.Read(ref other.counts[i]);
+                counts[i] += value;
+                n += value;
+            }
+
+            // The count is taken from the buckets so that percentiles remain consistent even if the
+            // other histogram is being written.
+            count += n;
+            sum += Volatile.Read(ref other.sum);
+            max = Math.Max(max, Volatile.Read(ref other.max));
+        }
+
+        /// <summary>
+        /// Remove all values. Must not be called concurrently with <see cref="Record(long)"/>.
+        /// </summary>
+        public void Clear()
+        {
+            Array.Clear(counts, 0, counts.Length);
+            Volatile.Write(ref sum, 0);
+            Volatile.Write(ref max, 0);
+            Volatile.Write(ref count, 0);
+        }
+
+        /// <summary>
+        /// Smallest value that is greater than or equal to <paramref name="percentile"/> percent of all recorded values 
+        /// (within the precision of the histogram). Returns zero if no value has been recorded.
+        /// </summary>
+        /// <param name="percentile">A value between 0 and 100.</param>
+        public long Percentile(double percentile)
+        {
+            if (double.IsNaN(percentile) || percentile < 0.0 || percentile > 100.0)
+                throw new ArgumentOutOfRangeException(nameof(percentile));
+
+            var n = 0L;
+            for (int i = 0; i < BucketCount; ++i)
+                n += Volatile.Read(ref counts[i]);
+
+            if (n == 0)
+                return 0;
+
+            var rank = Math.Max(1L, (long)Math.Ceiling(percentile / 100.0 * n));
+            var accumulated = 0L;
+            for (int i = 0; i < BucketCount; ++i)
+            {
+                accumulated += Volatile.Read(ref counts[i]);
+                if (accumulated >= rank)
+                    return Math.Min(HighestEquivalentValue(i), Max);
+            }
+
+            return Max;
+        }
+
+        public override string ToString()
+        {
+            var builder = new StringBuilder();
+            builder.Append(nameof(Count)).Append('=').Append(Count);
+            builder.Append(" p50=").Append(Percentile(50.0));
+            builder.Append(" p90=").Append(Percentile(90.0));
+            builder.Append(" p99=").Append(Percentile(99.0));
+            builder.Append(" p99.9=").Append(Percentile(99.9));
+            builder.Append(' ').Append(nameof(Max)).Append('=').Append(Max);
+            return builder.ToString();
+        }
+
+        /// <summary>
+        /// Values below 2 * <see cref="SubBucketCount"/> have a bucket each. Above that the position of the most 
+        /// significant bit selects a group of <see cref="SubBucketCount"/> buckets and the following bits select 
+        /// the bucket in the group.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static int IndexOf(long value)
+        {
+            if (value < 2 * SubBucketCount)
+                return (int)value;
+
+            var shift = Log2((ulong)value) - SubBucketBits;
+            return (shift << SubBucketBits) + (int)(value >> shift);
+        }
+
+        private static long HighestEquivalentValue(int index)
+        {
+            if (index < 2 * SubBucketCount)
+                return index;
+
+            var shift = (index >> SubBucketBits) - 1;
+            var lowest = (long)((index & (SubBucketCount - 1)) | SubBucketCount) << shift;
+            return lowest + (1L << shift) - 1;
+        }
+
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private static int Log2(ulong value)
+        {
+            var n = 0;
+            if (value >= 1UL << 32) { value >>= 32; n += 32; }
+            if (value >= 1UL << 16) { value >>= 16; n += 16; }
+            if (value >= 1UL << 8) { value >>= 8; n += 8; }
+            if (value >= 1UL << 4) { value >>= 4; n += 4; }
+            if (value >= 1UL << 2) { value >>= 2; n += 2; }
+            if (value >= 1UL << 1) { n += 1; }
+            return n;
+        }
+    }
+}
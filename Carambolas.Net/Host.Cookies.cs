@@ -0,0 +1,47 @@
+﻿using System;
+
+using Carambolas.Security.Cryptography;
+using Carambolas.Security.Cryptography.NaCl;
+
+namespace Carambolas.Net
+{
+    public sealed partial class Host
+    {
+        /// <summary>
+        /// Stateless connection cookies akin to TCP SYN cookies. A host with <see cref="Settings.ConnectionCookies"/> 
+        /// answers a connection request from an unknown source with a CHALLENGE carrying a cookie and only allocates 
+        /// a peer once a connection request echoes a valid cookie back. Spoofed requests never get to allocate 
+        /// anything because the cookie only reaches the actual owner of the source end point.
+        /// <para/>
+        /// A cookie is its creation time (CTM) plus a 32-bit tag computed with a keyed pseudo-random function of the 
+        /// source end point, the remote session and CTM. The function is a cascade of two ChaCha20 blocks: the first 
+        /// keyed by the host secret over the source address and the second keyed by the output of the first over 
+        /// the address family, port, session and CTM. Inputs have a fixed length so the cascade is as good a PRF as 
+        /// ChaCha20 itself and no allocation is required.
+        /// <para/>
+        /// Not thread-safe. Each worker thread must have its own instance.
+        /// </summary>
+        internal sealed class Cookies
+        {
+            private readonly ChaCha20 outer = new ChaCha20();
+            private readonly ChaCha20 inner = new ChaCha20();
+
+            public Cookies(in Key secret) => outer.Key = secret;
+
+            public uint Compute(in IPEndPoint endPoint, uint remoteSession, Protocol.Time time)
+            {
+                var (msb, lsb) = (endPoint.Address.IPv6PackedAddress0, endPoint.Address.IPv6PackedAddress1);
+                inner.Key = outer.CreateKey(new Nonce((uint)(msb >> 32), (uint)msb, (uint)(lsb >> 32)), (uint)lsb);
+
+                var (t0, _, _, _, _, _, _, _) = inner.CreateKey(new Nonce((uint)endPoint.Address.AddressFamily << 16 | endPoint.Port, remoteSession, (uint)time));
+                return t0;
+            }
+
+            /// <summary>
+            /// True if the cookie was created by this host for the same end point and session and has not expired yet.
+            /// </summary>
+            public bool Verify(in IPEndPoint endPoint, uint remoteSession, Protocol.Time time, Protocol.Time cookieTime, uint tag)
+                => cookieTime <= time && (uint)(time - cookieTime) <= Protocol.Packet.Cookie.LifeTime && Compute(in endPoint, remoteSession, cookieTime) == tag;
+        }
+    }
+}
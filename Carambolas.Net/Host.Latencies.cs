@@ -0,0 +1,104 @@
+﻿using System;
+
+namespace Carambolas.Net
+{
+    public sealed partial class Host
+    {
+        /// <summary>
+        /// Latency histograms of a host opened with <see cref="Settings.Instrumentation"/>. All values are in microseconds.
+        /// <para/>
+        /// Each worker thread records into its own instance so recording requires no synchronization and no 
+        /// allocation. <see cref="GetLatencies"/> merges them into a new instance that can be inspected at leisure.
+        /// </summary>
+        public sealed class Latencies
+        {
+            /// <summary>
+            /// Time spent working in each frame not counting the time waiting for datagrams or for the next frame. 
+            /// A worker is overrun when this approaches the update period.
+            /// </summary>
+            public readonly Histogram Frame = new Histogram();
+
+            /// <summary>
+            /// Time spent in each frame updating peers and encoding (and encrypting) outgoing packets.
+            /// </summary>
+            public readonly Histogram Update = new Histogram();
+
+            /// <summary>
+            /// Time spent in each call that hands a batch of outgoing packets to the socket.
+            /// </summary>
+            public readonly Histogram Send = new Histogram();
+
+            /// <summary>
+            /// Time spent in each call that returned a batch of datagrams from a socket.
+            /// </summary>
+            public readonly Histogram Receive = new Histogram();
+
+            /// <summary>
+            /// Time spent applying the admission filter to each batch of datagrams received.
+            /// </summary>
+            public readonly Histogram Filter = new Histogram();
+
+            /// <summary>
+            /// Time spent parsing (and decrypting) each datagram that passed the admission filter, including 
+            /// the time to make any resulting events available to the user.
+            /// </summary>
+            public readonly Histogram Packet = new Histogram();
+
+            /// <summary>
+            /// Time each event waited in the event queue before it was retrieved by the user.
+            /// </summary>
+            public readonly Histogram Event = new Histogram();
+
+            /// <summary>
+            /// Round trip time of every acknowledgement received from any peer. Protocol timestamps have a 
+            /// resolution of one millisecond so values are always multiples of 1000.
+            /// </summary>
+            public readonly Histogram RoundTrip = new Histogram();
+
+            internal void Add(Latencies other)
+            {
+                Frame.Add(other.Frame);
+                Update.Add(other.Update);
+                Send.Add(other.Send);
+                Receive.Add(other.Receive);
+                Filter.Add(other.Filter);
+                Packet.Add(other.Packet);
+                Event.Add(other.Event);
+                RoundTrip.Add(other.RoundTrip);
+            }
+
+            public override string ToString() => $"{nameof(Frame)}: {Frame}; {nameof(Update)}: {Update}; {nameof(Send)}: {Send}; {nameof(Receive)}: {Receive}; "
+                                               + $"{nameof(Filter)}: {Filter}; {nameof(Packet)}: {Packet}; {nameof(Event)}: {Event}; {nameof(RoundTrip)}: {RoundTrip}";
+        }
+
+        /// <summary>
+        /// Events are dequeued by the user thread so their dwell time is kept apart from the worker threads.
+        /// </summary>
+        private Histogram eventLatencies;
+
+        /// <summary>
+        /// True if the host records latency histograms (see <see cref="Settings.Instrumentation"/>).
+        /// </summary>
+        public bool Instrumented => eventLatencies != null;
+
+        /// <summary>
+        /// Merge the latency histograms recorded by all worker threads since the host was opened. 
+        /// Returns null if the host is not open or was not opened with <see cref="Settings.Instrumentation"/>.
+        /// </summary>
+        public Latencies GetLatencies()
+        {
+            var current = shards;
+            var dwell = eventLatencies;
+            if (current == null || dwell == null)
+                return null;
+
+            var latencies = new Latencies();
+            foreach (var shard in current)
+                if (shard?.Latencies != null)
+                    latencies.Add(shard.Latencies);
+
+            latencies.Event.Add(dwell);
+            return latencies;
+        }
+    }
+}
@@ -0,0 +1,394 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+using Carambolas.Net.Sockets;
+
+namespace Carambolas.Net
+{
+    public sealed partial class Host
+    {
+        /// <summary>
+        /// Staging area for outgoing datagrams. Packets are encoded directly into consecutive slots
+        /// of one MTU each and transmitted in batches so that a whole frame worth of packets can
+        /// be handed to the socket with as few system calls as possible.
+        /// <para/>
+        /// Datagrams to a peer with a connected socket of its own (<see cref="Settings.ConnectedSockets"/>) 
+        /// are sent through that socket instead of the shared one.
+        /// <para/>
+        /// Path MTU probes that the socket rejects for being too large are reported back to the peer that sent them.
+        /// <para/>
+        /// Datagrams may be given a delay in microseconds to be released by the socket at a later time (see <see cref="Settings.Pacing"/>).
+        /// <para/>
+        /// If the shared socket supports zero copy (see <see cref="Settings.ZeroCopy"/>) slots are kept in a small rotation of pinned 
+        /// buffers. A large batch is then sent straight from its buffer which is set aside until the kernel reports all its send 
+        /// calls complete while the outbox moves on to the next free buffer. Batches are copied as usual if there's no free buffer 
+        /// to move on to, if they're too small to be worth it, or if the kernel has reported that it had to copy the data anyway.
+        /// </summary>
+        internal sealed class Outbox: IDisposable
+        {
+            /// <summary>
+            /// Number of pinned buffers in the zero copy rotation.
+            /// </summary>
+            private const int ZeroCopyBuffers = 4;
+
+            /// <summary>
+            /// Minimum number of bytes in a batch for zero copy to be worth the cost of pinning pages and handling completions.
+            /// </summary>
+            private const int ZeroCopyThreshold = 16 * 1024;
+
+            /// <summary>
+            /// Pinned buffer of the zero copy rotation and the range of send calls made from it still waiting for completion.
+            /// </summary>
+            internal sealed class Staging
+            {
+                public byte[] Buffer;
+                public GCHandle Handle;
+
+                /// <summary>
+                /// Sequence number of the first send call made from the buffer.
+                /// </summary>
+                public uint First;
+
+                /// <summary>
+                /// Number of send calls made from the buffer.
+                /// </summary>
+                public uint Count;
+
+                /// <summary>
+                /// Number of send calls reported complete.
+                /// </summary>
+                public uint Completed;
+
+                public bool Busy => Count > 0;
+
+                public void Allocate(int size)
+                {
+                    Free();
+                    Buffer = new byte[size];
+                    Handle = GCHandle.Alloc(Buffer, GCHandleType.Pinned);
+                }
+
+                public void Free()
+                {
+                    if (Handle.IsAllocated)
+                        Handle.Free();
+
+                    Buffer = null;
+                }
+
+                /// <summary>
+                /// Account for the send calls in the inclusive range [<paramref name="first"/>, <paramref name="last"/>] that were made from this buffer.
+                /// </summary>
+                /// <returns>True if all send calls made from the buffer are complete.</returns>
+                public bool Complete(uint first, uint last)
+                {
+                    // Sequence numbers wrap around so everything is relative to the first send call of the buffer.
+                    var a = first - First;
+                    var b = last - First;
+                    uint n;
+                    if (a <= b)
+                        n = (a < Count) ? Math.Min(b, Count - 1) - a + 1 : 0;
+                    else // range starts before the first send call of the buffer
+                        n = Math.Min(b + 1, Count) + ((a < Count) ? Count - a : 0);
+
+                    Completed += n;
+                    if (Completed < Count)
+                        return false;
+
+                    Count = 0;
+                    Completed = 0;
+                    return true;
+                }
+            }
+
+            private readonly Socket socket;
+            private readonly IPEndPoint[] endPoints;
+            private readonly IPEndPoint[] sources;
+            private readonly Socket[] sockets;
+            private readonly Peer[] probes;
+            private readonly int[] lengths;
+            private readonly int[] delays;
+            private byte[] buffer;
+            private int stride;
+            private int count;
+
+            /// <summary>
+            /// Zero copy rotation or null if the shared socket does not support zero copy.
+            /// </summary>
+            private readonly Staging[] staging;
+            private readonly uint[] ranges;
+
+            /// <summary>
+            /// Index of the buffer in the rotation currently used for slots.
+            /// </summary>
+            private int current;
+
+            /// <summary>
+            /// Sequence number of the next zero copy send call through the shared socket.
+            /// </summary>
+            private uint sequence;
+
+            /// <summary>
+            /// Number of buffers in the rotation waiting for completion.
+            /// </summary>
+            private int busy;
+
+            /// <summary>
+            /// False once the kernel has reported that zero copy sends had to be copied anyway (e.g. loopback or a device that 
+            /// cannot transmit from user pages) in which case zero copy only adds overhead.
+            /// </summary>
+            private bool zeroCopy;
+
+            /// <summary>
+            /// Writer positioned at the next free slot.
+            /// </summary>
+            public readonly BinaryWriter Writer;
+
+            /// <summary>
+            /// Number of datagrams waiting to be sent.
+            /// </summary>
+            public int Count => count;
+
+            public Outbox(Socket socket, int stride, int capacity)
+            {
+                this.socket = socket;
+                this.stride = stride;
+                if (socket.ZeroCopy)
+                {
+                    zeroCopy = true;
+                    ranges = new uint[2 * 16];
+                    staging = new Staging[ZeroCopyBuffers];
+                    for (int i = 0; i < staging.Length; ++i)
+                        staging[i] = new Staging();
+
+                    staging[0].Allocate(stride * capacity);
+                    buffer = staging[0].Buffer;
+                }
+                else
+                {
+                    buffer = new byte[stride * capacity];
+                }
+
+                endPoints = new IPEndPoint[capacity];
+                sources = new IPEndPoint[capacity];
+                sockets = new Socket[capacity];
+                probes = new Peer[capacity];
+                lengths = new int[capacity];
+                delays = new int[capacity];
+                Writer = new BinaryWriter(buffer, 0, stride);
+            }
+
+            /// <summary>
+            /// Ensure the slot under <see cref="Writer"/> can hold a datagram of <paramref name="size"/> bytes.
+            /// A remote peer may accept datagrams larger than the local MTU in which case pending datagrams are 
+            /// flushed and the slots are enlarged.
+            /// </summary>
+            public void Reserve(int size)
+            {
+                if (size > stride)
+                {
+                    Flush();
+                    stride = size;
+                    if (staging != null)
+                    {
+                        staging[current].Allocate(stride * endPoints.Length);
+                        buffer = staging[current].Buffer;
+                    }
+                    else
+                    {
+                        buffer = new byte[stride * endPoints.Length];
+                    }
+
+                    Writer.Reset(buffer, 0, stride);
+                }
+            }
+
+            /// <summary>
+            /// Enqueue the datagram currently held by <see cref="Writer"/> for transmission.
+            /// The outbox is automatically flushed when full.
+            /// </summary>
+            /// <param name="endPoint">Remote end point the datagram is sent to.</param>
+            /// <param name="socket">Connected socket to use instead of the shared socket or null.</param>
+            /// <param name="probe">Peer that must be notified if the datagram is a path MTU probe the socket rejects as too large or null.</param>
+            /// <param name="delay">Microseconds the socket should hold the datagram before releasing it, if supported.</param>
+            /// <param name="source">Local address the shared socket should send the datagram from, if supported, or default to let the platform choose.</param>
+            public void Commit(in IPEndPoint endPoint, Socket socket = null, Peer probe = null, int delay = 0, in IPEndPoint source = default)
+            {
+                endPoints[count] = endPoint;
+                sources[count] = source;
+                sockets[count] = socket;
+                probes[count] = probe;
+                lengths[count] = Writer.Count;
+                delays[count] = delay;
+                count++;
+
+                if (count == endPoints.Length)
+                    Flush();
+                else
+                    Writer.Reset(count * stride, stride);
+            }
+
+            /// <summary>
+            /// Enqueue a copy of a pre-encoded datagram for transmission. Datagrams larger than a slot are discarded.
+            /// </summary>
+            public void Add(Memory encoded, in IPEndPoint endPoint)
+            {
+                var length = encoded.Length;
+                if (length > stride)
+                    return;
+
+                encoded.CopyTo(buffer, count * stride, length);
+                endPoints[count] = endPoint;
+                sources[count] = default;
+                sockets[count] = null;
+                probes[count] = null;
+                lengths[count] = length;
+                delays[count] = 0;
+                count++;
+
+                if (count == endPoints.Length)
+                    Flush();
+                else
+                    Writer.Reset(count * stride, stride);
+            }
+
+            /// <summary>
+            /// Transmit all pending datagrams. Datagrams that the socket could not accept are dropped
+            /// as if lost in transit which is consistent with the behaviour of a single send.
+            /// </summary>
+            public void Flush()
+            {
+                // A batch worth sending without a copy needs a free buffer to move on to.
+                var spare = -1;
+                if (staging != null)
+                {
+                    Reclaim();
+                    if (zeroCopy)
+                    {
+                        var bytes = 0;
+                        for (int i = 0; i < count; ++i)
+                            if (sockets[i] == null)
+                                bytes += lengths[i];
+
+                        if (bytes >= ZeroCopyThreshold)
+                            spare = Free();
+                    }
+                }
+
+                var sent = 0;
+                while (sent < count)
+                {
+                    // Consecutive datagrams for the same socket go in the same batch.
+                    var target = sockets[sent];
+                    var end = sent + 1;
+                    while (end < count && sockets[end] == target)
+                        end++;
+
+                    // Only the shared socket sends zero copy as that is where bulk transfers to many peers add up. 
+                    // Sources only matter to the shared socket as well since a connected socket is bound to its route.
+                    var s = target ?? socket;
+                    while (sent < end)
+                    {
+                        int n;
+                        bool oversized;
+                        if (target == null && (spare >= 0 || s.PacketInformation))
+                        {
+                            n = s.UncheckedSendMany(buffer, 0, stride, sent, end - sent, endPoints, sources, lengths, delays, spare >= 0, out int notifications, out oversized);
+                            if (notifications > 0)
+                            {
+                                var stage = staging[current];
+                                if (!stage.Busy)
+                                    stage.First = sequence;
+
+                                stage.Count += (uint)notifications;
+                                sequence += (uint)notifications;
+                            }
+                        }
+                        else
+                        {
+                            n = s.UncheckedSendMany(buffer, 0, stride, sent, end - sent, endPoints, lengths, delays, out oversized);
+                        }
+
+                        if (oversized)
+                            probes[sent]?.OnProbeOversized();
+
+                        sent += Math.Max(1, n);
+                    }
+                }
+
+                Array.Clear(sockets, 0, count);
+                Array.Clear(probes, 0, count);
+                count = 0;
+
+                // The kernel may still be reading from the current buffer so move on to the spare.
+                if (spare >= 0 && staging[current].Busy)
+                {
+                    busy++;
+                    current = spare;
+                    if (staging[current].Buffer == null || staging[current].Buffer.Length < stride * endPoints.Length)
+                        staging[current].Allocate(stride * endPoints.Length);
+
+                    buffer = staging[current].Buffer;
+                    Writer.Reset(buffer, 0, stride);
+                }
+                else
+                {
+                    Writer.Reset(0, stride);
+                }
+            }
+
+            /// <summary>
+            /// Collect zero copy completions reported by the shared socket and release the buffers whose send calls are all complete.
+            /// </summary>
+            public void Reclaim()
+            {
+                if (busy == 0)
+                    return;
+
+                int n;
+                do
+                {
+                    n = socket.UncheckedReceiveCompletions(ranges, out int copied);
+                    if (copied > 0)
+                        zeroCopy = false;
+
+                    for (int i = 0; i < n; ++i)
+                    {
+                        foreach (var stage in staging)
+                        {
+                            if (stage.Busy && stage.Complete(ranges[2 * i], ranges[2 * i + 1]))
+                                busy--;
+                        }
+                    }
+                }
+                while (n == ranges.Length / 2 && busy > 0);
+            }
+
+            /// <summary>
+            /// Index of a buffer in the rotation other than the current that is not waiting for completion or -1 if none.
+            /// </summary>
+            private int Free()
+            {
+                for (int i = 1; i < staging.Length; ++i)
+                {
+                    var j = (current + i) % staging.Length;
+                    if (!staging[j].Busy)
+                        return j;
+                }
+
+                return -1;
+            }
+
+            /// <summary>
+            /// Unpin the zero copy rotation. Any send still in progress may transmit whatever ends up in the memory of its buffer 
+            /// which is harmless at this point as the socket is about to be closed.
+            /// </summary>
+            public void Dispose()
+            {
+                if (staging != null)
+                    foreach (var stage in staging)
+                        stage.Free();
+            }
+        }
+    }
+}
@@ -55,10 +55,117 @@ public sealed partial class Host
             /// </summary>
             public readonly int BlockSize;
 
-            public Settings(ushort capacity, byte maxChannel = Protocol.MTC.Default, ushort maxTranmissionUnit = Protocol.MTU.Default, uint maxBandwidth = Protocol.Bandwidth.MaxValue, int maxTransmissionBacklog = int.MaxValue, byte ttl = Protocol.TTL.Default, int blockSize = Protocol.Memory.Block.Size.Default, TOS tos = TOS.LowDelay)
-                : this(capacity, maxChannel, maxTranmissionUnit, maxBandwidth, maxTransmissionBacklog, in Host.Stream.Settings.Default, in Host.Stream.Settings.Default, ttl, blockSize) { }
+            /// <summary>
+            /// UDP offloads to request from the platform. Ignored where not supported.
+            /// </summary>
+            public readonly Offload Offload;
+
+            /// <summary>
+            /// Receive through a kernel completion queue where supported (currently io_uring on Linux).
+            /// Ignored where not supported.
+            /// </summary>
+            public readonly bool CompletionQueue;
+
+            /// <summary>
+            /// Number of worker threads. Each worker has its own socket bound to the same end point and handles 
+            /// a share of the peers. More than one worker requires port sharing with steering by source end point 
+            /// (SO_REUSEPORT on Linux) otherwise a single worker is used.
+            /// </summary>
+            public readonly int Workers;
+
+            /// <summary>
+            /// Give each connected peer a socket of its own bound to the host end point and connected to the peer 
+            /// so the kernel can deliver its datagrams directly and skip the route lookup of each datagram sent. 
+            /// Each socket has the same buffer sizes as the host socket. Requires port sharing with steering by 
+            /// source end point (SO_REUSEPORT on Linux) otherwise all peers share the host socket. Peers also 
+            /// share the host socket while the process is out of file descriptors.
+            /// </summary>
+            public readonly bool ConnectedSockets;
+
+            /// <summary>
+            /// Maximum sustained rate of connection requests per second accepted from a single source end point. 
+            /// Requests in excess are dropped by the native admission filter before they are parsed. A source may 
+            /// still send up to <see cref="ConnectionBurst"/> requests in a row. Zero means unlimited. Ignored if the 
+            /// native library is not available.
+            /// </summary>
+            public readonly int ConnectionRate;
+
+            /// <summary>
+            /// Maximum number of connection requests accepted in a row from a single source end point when 
+            /// <see cref="ConnectionRate"/> is limited. Should be at least as many requests as a single connection 
+            /// attempt can take so that legitimate retransmissions are never dropped (see <see cref="Protocol.Limits.Connection.Burst"/>).
+            /// </summary>
+            public readonly int ConnectionBurst;
+
+            /// <summary>
+            /// Answer connection requests from unknown sources with a cookie challenge and only allocate a peer 
+            /// once the remote host echoes the cookie back (see <see cref="Host.Cookies"/>). Costs one extra round 
+            /// trip per passive connection. Remote hosts must support cookies as well.
+            /// </summary>
+            public readonly bool ConnectionCookies;
+
+            /// <summary>
+            /// Record latency histograms of the worker threads, the event queue and the round trip time of each peer 
+            /// (see <see cref="Host.GetLatencies"/> and <see cref="Peer.RoundTripTimes"/>). Histograms are allocated 
+            /// up front and recording takes a few clock reads per frame and per datagram.
+            /// </summary>
+            public readonly bool Instrumentation;
+
+            /// <summary>
+            /// Use in-process sockets that can only reach other in-process hosts in the same process instead of UDP 
+            /// sockets. Useful to generate load and benchmark a host with many peers free of kernel noise. 
+            /// Only a single worker is supported and peers never get connected sockets.
+            /// </summary>
+            public readonly bool InProcess;
+
+            /// <summary>
+            /// Let each peer discover the path MTU and send packets larger than <see cref="Protocol.MTU.Default"/> up to the 
+            /// MTU negotiated with the remote host when the path allows it (see <see cref="Peer.MaxTransmissionUnit"/>). 
+            /// Packets start at <see cref="Protocol.MTU.Default"/> (or the negotiated MTU if lower) and are enlarged as padded 
+            /// probes are acknowledged. Only makes a difference if both hosts have an MTU greater than <see cref="Protocol.MTU.Default"/> 
+            /// and the remote host advertises path MTU discovery as well (see <see cref="Peer.PathMtuDiscovery"/>). A host that connects 
+            /// only advertises it if <see cref="MaxBandwidth"/> is <see cref="Protocol.Bandwidth.MaxValue"/> so that a remote host unaware 
+            /// of path MTU discovery does not misread its bandwidth. 
+            /// Ignored if datagrams cannot be sent with the don't fragment bit (see <see cref="Socket.MtuProbing"/>).
+            /// </summary>
+            public readonly bool PathMtuDiscovery;
+
+            /// <summary>
+            /// Send packets ECN-capable and echo to the remote host the number of packets received marked congestion 
+            /// experienced so that it can reduce its congestion window before routers start dropping packets 
+            /// (see <see cref="Peer.CongestionMarks"/>). Ignored if the ECN codepoint of a datagram received is not 
+            /// available (see <see cref="Socket.Ecn"/>), in which case congestion acks from the remote host are still honored.
+            /// </summary>
+            public readonly bool ExplicitCongestionNotification;
+
+            /// <summary>
+            /// Spread the packets sent to each peer in a frame over the frame period at the pace of the peer (see <see cref="Peer.PacingRate"/>) 
+            /// instead of sending them in a single burst. Each packet carries a launch time for the kernel where supported 
+            /// (SO_TXTIME on Linux with the fq qdisc) otherwise peers with a connected socket of their own 
+            /// (see <see cref="ConnectedSockets"/>) have their socket paced at a maximum rate. Ignored if neither is supported 
+            /// (see <see cref="Socket.Pacing"/>).
+            /// </summary>
+            public readonly bool Pacing;
+
+            /// <summary>
+            /// Let the kernel transmit large batches of packets directly from the send buffers of the host instead of copying 
+            /// them (MSG_ZEROCOPY on Linux). Worth it for bulk transfers of large fragmented messages where the copy dominates 
+            /// the cost of a send; small batches are always copied. Ignored if not supported (see <see cref="Socket.ZeroCopy"/>).
+            /// </summary>
+            public readonly bool ZeroCopy;
+
+            /// <summary>
+            /// Reply to each remote host from the local address it reached the host at (IP_PKTINFO/IPV6_PKTINFO on Linux) 
+            /// instead of letting the platform choose by route. Required by a multi-homed host bound to a wildcard address 
+            /// whose remote hosts drop packets coming from an address other than the one they sent to (e.g. behind a NAT). 
+            /// Takes precedence over <see cref="CompletionQueue"/>. Ignored if not supported (see <see cref="Socket.PacketInformation"/>).
+            /// </summary>
+            public readonly bool MultiHoming;
+
+            public Settings(ushort capacity, byte maxChannel = Protocol.MTC.Default, ushort maxTranmissionUnit = Protocol.MTU.Default, uint maxBandwidth = Protocol.Bandwidth.MaxValue, int maxTransmissionBacklog = int.MaxValue, byte ttl = Protocol.TTL.Default, int blockSize = Protocol.Memory.Block.Size.Default, TOS tos = TOS.LowDelay, Offload offload = Offload.Segmentation, bool completionQueue = false, int workers = 1, bool connectedSockets = false, int connectionRate = 0, bool connectionCookies = false, bool instrumentation = false, bool inProcess = false, bool pathMtuDiscovery = false, bool explicitCongestionNotification = false, bool pacing = false, bool zeroCopy = false, bool multiHoming = false, int connectionBurst = Protocol.Limits.Connection.Burst.Default)
+                : this(capacity, maxChannel, maxTranmissionUnit, maxBandwidth, maxTransmissionBacklog, in Host.Stream.Settings.Default, in Host.Stream.Settings.Default, ttl, blockSize, tos, offload, completionQueue, workers, connectedSockets, connectionRate, connectionCookies, instrumentation, inProcess, pathMtuDiscovery, explicitCongestionNotification, pacing, zeroCopy, multiHoming, connectionBurst) { }
 
-            public Settings(ushort capacity, byte maxChannel, ushort maxTransmissionUnit, uint maxBandwidth, int maxTransmissionBacklog, in Host.Stream.Settings upstream, in Host.Stream.Settings downstream, byte ttl = Protocol.TTL.Default, int blockSize = Protocol.Memory.Block.Size.Default, TOS tos = TOS.LowDelay)
+            public Settings(ushort capacity, byte maxChannel, ushort maxTransmissionUnit, uint maxBandwidth, int maxTransmissionBacklog, in Host.Stream.Settings upstream, in Host.Stream.Settings downstream, byte ttl = Protocol.TTL.Default, int blockSize = Protocol.Memory.Block.Size.Default, TOS tos = TOS.LowDelay, Offload offload = Offload.Segmentation, bool completionQueue = false, int workers = 1, bool connectedSockets = false, int connectionRate = 0, bool connectionCookies = false, bool instrumentation = false, bool inProcess = false, bool pathMtuDiscovery = false, bool explicitCongestionNotification = false, bool pacing = false, bool zeroCopy = false, bool multiHoming = false, int connectionBurst = Protocol.Limits.Connection.Burst.Default)
             {
                 Capacity = capacity;
                 MaxTransmissionUnit = maxTransmissionUnit;
@@ -70,9 +177,23 @@ public Settings(ushort capacity, byte maxChannel, ushort maxTransmissionUnit, ui
                 TTL = ttl;
                 TOS = tos;
                 BlockSize = blockSize;
+                Offload = offload;
+                CompletionQueue = completionQueue;
+                Workers = Math.Max(1, workers);
+                ConnectedSockets = connectedSockets;
+                ConnectionRate = Math.Max(0, connectionRate);
+                ConnectionBurst = Protocol.Limits.Connection.Burst.Clamp(connectionBurst);
+                ConnectionCookies = connectionCookies;
+                Instrumentation = instrumentation;
+                InProcess = inProcess;
+                PathMtuDiscovery = pathMtuDiscovery;
+                ExplicitCongestionNotification = explicitCongestionNotification;
+                Pacing = pacing;
+                ZeroCopy = zeroCopy;
+                MultiHoming = multiHoming;
             }
 
-            internal void CreateSocketSettings(out Socket.Settings settings) => settings = new Socket.Settings(Upstream.BufferSize, Downstream.BufferSize, Timeout.Infinite, Timeout.Infinite, TTL, Carambolas.Net.Sockets.SocketMode.NonBlocking, TOS);
+            internal void CreateSocketSettings(out Socket.Settings settings) => settings = new Socket.Settings(Upstream.BufferSize, Downstream.BufferSize, Timeout.Infinite, Timeout.Infinite, TTL, Carambolas.Net.Sockets.SocketMode.NonBlocking, TOS, Offload, Workers > 1 || ConnectedSockets, true, InProcess, PathMtuDiscovery, ExplicitCongestionNotification, Pacing, ZeroCopy, MultiHoming);
         }
     }
 }
@@ -0,0 +1,157 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Threading;
+
+using Carambolas.Net.Sockets;
+
+namespace Carambolas.Net
+{
+    public sealed partial class Host
+    {
+        /// <summary>
+        /// Partition of the host served by a single worker thread. A shard owns a socket bound to the host 
+        /// end point and the peers whose datagrams are delivered to that socket.
+        /// <para/>
+        /// A host opened with more than one worker has one shard per worker and all sockets share the same 
+        /// end point (SO_REUSEPORT). Incoming datagrams are steered by source end point 
+        /// (<see cref="Socket.Steer(in IPEndPoint, int)"/>) so that a remote host is always handled by the 
+        /// same shard and the shard of a new active connection can be determined in advance.
+        /// </summary>
+        internal sealed class Shard
+        {
+            public readonly Socket Socket;
+
+            /// <summary>
+            /// Admission filter applied to every batch of datagrams received by the worker thread.
+            /// </summary>
+            public readonly IFilter Filter;
+
+            /// <summary>
+            /// Cookie generator if connection requests must be challenged; otherwise null.
+            /// </summary>
+            public Cookies Cookies;
+
+            /// <summary>
+            /// Latency histograms recorded by the worker thread if the host is instrumented; otherwise null.
+            /// </summary>
+            public Latencies Latencies;
+
+            /// <summary>
+            /// An encoder with a separate buffer used to serialize output messages from the worker thread.
+            /// </summary>
+            public readonly BinaryWriter Encoder = new BinaryWriter();
+
+            public Thread Worker;
+
+            /// <summary>
+            /// Internal connections lock.
+            /// <para/>
+            /// A lock is needed because <see cref="Connect(in IPEndPoint, out Peer)"/>
+            /// runs on the user thread and may add a new connection.
+            /// </summary>
+            public SpinLock PeersLock = new SpinLock(false);
+
+            /// <summary>
+            /// Internal connections maintained by the worker thread. 
+            /// This is not the same collection observed by the user
+            /// (<see cref="publicPeers"/>).
+            /// </summary>
+            public readonly Dictionary<IPEndPoint, Peer> Peers = new Dictionary<IPEndPoint, Peer>();
+
+            /// <summary>
+            /// First item of the internal linked-list of connections.
+            /// </summary>
+            public Peer First;
+
+            /// <summary>
+            /// Counters of peers that have been removed and connected sockets that have been closed 
+            /// so that <see cref="Host.Counters"/> never goes backwards. Protected by <see cref="PeersLock"/>.
+            /// </summary>
+            public PeerCounters RetiredPeers;
+            public SocketCounters RetiredSockets;
+
+            private SpinLock resetsLock = new SpinLock(false);
+
+            /// <summary>
+            /// Collection of reset packets to send. Resets may be added by the user thread
+            /// as well as by any worker thread so they're swapped out under a lock before sending.
+            /// </summary>
+            private HashSet<Reset> resets = new HashSet<Reset>();
+            private HashSet<Reset> pending = new HashSet<Reset>();
+
+            public Shard(Socket socket, int mtu, IFilter filter)
+            {
+                Socket = socket;
+                Filter = filter;
+                Encoder.Reset(new byte[mtu], 0, mtu);
+            }
+
+            /// <summary>
+            /// Retain the counters of a connected socket that has been closed.
+            /// </summary>
+            public void Retire(Socket socket)
+            {
+                var counters = socket.Counters;
+                var locked = false;
+                try
+                {
+                    PeersLock.Enter(ref locked);
+                    RetiredSockets += counters;
+                }
+                finally
+                {
+                    if (locked)
+                        PeersLock.Exit(false);
+                }
+            }
+
+            public void Add(in Reset reset)
+            {
+                var locked = false;
+                try
+                {
+                    resetsLock.Enter(ref locked);
+                    resets.Add(reset);
+                }
+                finally
+                {
+                    if (locked)
+                        resetsLock.Exit(false);
+                }
+            }
+
+            /// <summary>
+            /// Take all resets added so far. The returned set must be cleared by the caller before the next call.
+            /// </summary>
+            public HashSet<Reset> TakeResets()
+            {
+                var locked = false;
+                try
+                {
+                    resetsLock.Enter(ref locked);
+                    var taken = resets;
+                    resets = pending;
+                    pending = taken;
+                    return taken;
+                }
+                finally
+                {
+                    if (locked)
+                        resetsLock.Exit(false);
+                }
+            }
+
+            public void Clear()
+            {
+                resets.Clear();
+                pending.Clear();
+
+                foreach (var kv in Peers)
+                    kv.Value.Dispose();
+
+                Peers.Clear();
+                First = default;
+            }
+        }
+    }
+}
@@ -10,7 +10,10 @@
 
 using Carambolas.Security.Cryptography;
 
+using ECN = Carambolas.Net.Sockets.ECN;
+using Poller = Carambolas.Net.Sockets.Poller;
 using Socket = Carambolas.Net.Sockets.Socket;
+using SocketCounters = Carambolas.Net.Sockets.SocketCounters;
 
 namespace Carambolas.Net
 {
@@ -30,6 +33,37 @@ public enum ConnectionMode
 
     public static class ConnectionTypesExtensions { public static bool Contains(this ConnectionTypes e, ConnectionTypes flags) => (e & flags) == flags; }
 
+    /// <summary>
+    /// Snapshot of the counters of a host. Counters of peers and connected sockets that are gone are retained 
+    /// so that values never go backwards while the host is open.
+    /// </summary>
+    public readonly struct HostCounters
+    {
+        /// <summary>
+        /// Operations performed by all sockets of the host including connected sockets.
+        /// </summary>
+        public readonly SocketCounters Sockets;
+
+        /// <summary>
+        /// Datagrams accepted and dropped by the admission filter.
+        /// </summary>
+        public readonly FilterCounters Filter;
+
+        /// <summary>
+        /// Packets and bytes transferred by all peers.
+        /// </summary>
+        public readonly PeerCounters Peers;
+
+        public HostCounters(in SocketCounters sockets, in FilterCounters filter, in PeerCounters peers)
+        {
+            Sockets = sockets;
+            Filter = filter;
+            Peers = peers;
+        }
+
+        public override string ToString() => $"{nameof(Sockets)}: {Sockets}; {nameof(Filter)}: {Filter}; {nameof(Peers)}: {Peers}";
+    }
+
     public sealed partial class Host: IDisposable
     {
         public Host(string name = "") : this(name, default, default, default) { }
@@ -56,7 +90,12 @@ public Host(string name, IRandomNumberGenerator random, ILog log, ICipherFactory
         internal readonly IKeychain Keychain;
 
         private bool enabled;
-        private Socket socket;
+        private Shard[] shards;
+
+        /// <summary>
+        /// Settings used to open a socket connected to each peer or null if peers share the shard sockets.
+        /// </summary>
+        private Socket.Settings? connectedSocketSettings;
         private Exception exception;
 
         internal (Key Private, Key Public) Keys;
@@ -72,11 +111,6 @@ public Host(string name, IRandomNumberGenerator random, ILog log, ICipherFactory
         /// </summary>
         internal readonly BinaryWriter UserEncoder = new BinaryWriter();
 
-        /// <summary>
-        /// An encoder with a separate buffer used to serialize output messages from the worker thread.
-        /// </summary>
-        internal readonly BinaryWriter WorkerEncoder = new BinaryWriter();
-
         public byte TTL { get; private set; }
 
         /// <summary>
@@ -95,7 +129,7 @@ public ushort UpdateRate
             set
             {
                 updateRate = value;
-                updatePeriod = (ushort)(Protocol.Update.Rate.MaxValue / Protocol.Update.Rate.Clamp(value));
+                updatePeriod = 1.0f / Protocol.Update.Rate.Clamp(value);
             }
         }
 
@@ -118,6 +152,33 @@ public ushort UpdateRate
         /// </summary>
         public ushort MaxTransmissionUnit { get; private set; }
 
+        /// <summary>
+        /// True if peers discover the path MTU to send packets larger than <see cref="Protocol.MTU.Default"/> 
+        /// (see <see cref="Settings.PathMtuDiscovery"/>).
+        /// </summary>
+        public bool PathMtuDiscovery { get; private set; }
+
+        /// <summary>
+        /// True if packets are sent ECN-capable and congestion marks received are echoed to the remote host 
+        /// (see <see cref="Settings.ExplicitCongestionNotification"/>).
+        /// </summary>
+        public bool ExplicitCongestionNotification { get; private set; }
+
+        /// <summary>
+        /// True if packets sent to each peer are spread over the frame period (see <see cref="Settings.Pacing"/>).
+        /// </summary>
+        public bool Pacing { get; private set; }
+
+        /// <summary>
+        /// True if large batches of packets are sent without the kernel copying them (see <see cref="Settings.ZeroCopy"/>).
+        /// </summary>
+        public bool ZeroCopy { get; private set; }
+
+        /// <summary>
+        /// True if packets are sent from the local address each peer reached the host at (see <see cref="Settings.MultiHoming"/>).
+        /// </summary>
+        public bool MultiHoming { get; private set; }
+
         /// <summary>
         /// Highest data channel supported.
         /// </summary>
@@ -151,23 +212,129 @@ public ushort UpdateRate
         /// </summary>
         public ConnectionTypes AcceptableConnetionTypes;        
 
-        public bool IsOpen => socket != null;
+        public bool IsOpen => shards != null;
+
+        /// <summary>
+        /// Number of received datagrams accepted and dropped by the admission filter since the host was opened.
+        /// </summary>
+        public FilterCounters FilterCounters
+        {
+            get
+            {
+                var counters = default(FilterCounters);
+                var current = shards;
+                if (current != null)
+                    foreach (var shard in current)
+                        if (shard != null)
+                            counters += shard.Filter.Counters;
+
+                return counters;
+            }
+        }
+
+        /// <summary>
+        /// Take a snapshot of the counters of all sockets, admission filters and peers of the host since it was opened.
+        /// Counters are maintained at all times so this is cheap enough to be polled periodically but it has to 
+        /// briefly lock the peers of each worker.
+        /// </summary>
+        public HostCounters Counters
+        {
+            get
+            {
+                var sockets = default(SocketCounters);
+                var filter = default(FilterCounters);
+                var peers = default(PeerCounters);
+
+                var current = shards;
+                if (current != null)
+                {
+                    foreach (var shard in current)
+                    {
+                        if (shard == null)
+                            continue;
+
+                        sockets += shard.Socket.Counters;
+                        filter += shard.Filter.Counters;
+
+                        var locked = false;
+                        try
+                        {
+                            shard.PeersLock.Enter(ref locked);
+                            sockets += shard.RetiredSockets;
+                            peers += shard.RetiredPeers;
+                            for (var peer = shard.First; peer != null; peer = peer.Next)
+                            {
+                                peers += peer.Counters;
+                                var socket = peer.Socket;
+                                if (socket != null)
+                                    sockets += socket.Counters;
+                            }
+                        }
+                        finally
+                        {
+                            if (locked)
+                                shard.PeersLock.Exit(false);
+                        }
+                    }
+                }
+
+                return new HostCounters(in sockets, in filter, in peers);
+            }
+        }
 
         public void Open() => Open(in IPEndPoint.Any);
         public void Open(in IPEndPoint localEndPoint, ConnectionTypes acceptableConnectionTypes = default) => Open(in localEndPoint, in Host.Settings.Default, acceptableConnectionTypes, Random.GetKey());
         public void Open(in IPEndPoint localEndPoint, in Host.Settings settings, ConnectionTypes acceptableConnectionTypes = default) => Open(in localEndPoint, in settings, acceptableConnectionTypes, Random.GetKey());
         public void Open(in IPEndPoint localEndPoint, in Host.Settings settings, ConnectionTypes acceptableConnectionTypes, in Key privateKey)
         {
-            if (socket != null)
+            if (shards != null)
                 throw new InvalidOperationException(SR.Host.AlreadyOpen);
 
             settings.CreateSocketSettings(out Socket.Settings socketopts);
-            socket = new Socket(in localEndPoint, in socketopts, Log);
+            var socket = new Socket(in localEndPoint, in socketopts, Log);
 
             Keys = (privateKey, Keychain.CreatePublicKey(in privateKey));
 
             try
             {
+                MaxTransmissionUnit = Protocol.MTU.Clamp(settings.MaxTransmissionUnit);
+
+                // Additional workers require every socket to share the same end point and datagrams to be steered 
+                // by source end point so that the worker in charge of a remote host is known in advance.
+                // Connected sockets share the end point as well and steering guarantees that datagrams from 
+                // unknown sources are never delivered to them.
+                var workers = 1;
+                connectedSocketSettings = null;
+                if (settings.Workers > 1 || settings.ConnectedSockets)
+                {
+                    var reason = !socket.ReusePort ? "Platform does not support port sharing."
+                        : !socket.TryAttachSteering(settings.Workers) ? "Platform does not support socket steering."
+                        : null;
+
+                    if (reason == null)
+                    {
+                        workers = settings.Workers;
+                        if (settings.ConnectedSockets)
+                            connectedSocketSettings = socketopts;
+                    }
+                    else
+                    {
+                        if (settings.Workers > 1)
+                            Log.Warn($"{reason} Using a single worker.");
+
+                        if (settings.ConnectedSockets)
+                            Log.Warn($"{reason} Using a single socket for all peers.");
+                    }
+                }
+
+                shards = new Shard[workers];
+                shards[0] = new Shard(socket, MaxTransmissionUnit, Filter.Create(FilterCapacity, settings.ConnectionRate, settings.ConnectionBurst));
+
+                // Sockets must be bound in order as the steering program selects them by index.
+                // Remaining sockets bind to the actual port in case the first was bound to an ephemeral port.
+                for (int i = 1; i < workers; ++i)
+                    shards[i] = new Shard(new Socket(socket.LocalEndPoint, in socketopts, Log), MaxTransmissionUnit, Filter.Create(FilterCapacity, settings.ConnectionRate, settings.ConnectionBurst));
+
                 // Sockets bound to a local IPv6 address are configured in AddressMode.Dual. 
                 // Only if it fails to bind that it will be downgraded to IPv6 only (AddressMode.IPv6).
                 // There's no point in offering IP stack mode as part of the settings because:
@@ -194,7 +361,6 @@ public void Open(in IPEndPoint localEndPoint, in Host.Settings settings, Connect
                 TTL = socket.TTL;
                 Capacity = settings.Capacity;
                 EndPoint = socket.LocalEndPoint;
-                MaxTransmissionUnit = Protocol.MTU.Clamp(settings.MaxTransmissionUnit);
                 MaxChannel = Protocol.MTC.Clamp(settings.MaxChannel);
                 MaxBandwidth = Protocol.Bandwidth.Clamp(settings.MaxBandwidth);
                 MaxTransmissionBacklog = Math.Max(0, settings.MaxTransmissionBacklog);
@@ -203,15 +369,62 @@ public void Open(in IPEndPoint localEndPoint, in Host.Settings settings, Connect
                 if (UserEncoder.Buffer.Length < MaxTransmissionUnit)
                     UserEncoder.Reset(new byte[MaxTransmissionUnit], 0, MaxTransmissionUnit);
 
-                if (WorkerEncoder.Buffer.Length < MaxTransmissionUnit)
-                    WorkerEncoder.Reset(new byte[MaxTransmissionUnit], 0, MaxTransmissionUnit);
-                
-                worker = new Thread(Work) { IsBackground = true, Name = $"{Name} Networking" };
+                PathMtuDiscovery = settings.PathMtuDiscovery && socket.MtuProbing;
+                ExplicitCongestionNotification = settings.ExplicitCongestionNotification && socket.Ecn;
+                Pacing = settings.Pacing && (socket.Pacing == Sockets.Pacing.LaunchTime || (socket.Pacing == Sockets.Pacing.Rate && settings.ConnectedSockets));
+                ZeroCopy = settings.ZeroCopy && socket.ZeroCopy;
+                MultiHoming = settings.MultiHoming && socket.PacketInformation;
+
+                if (settings.ConnectionCookies)
+                {
+                    var secret = Random.GetKey();
+                    foreach (var shard in shards)
+                        shard.Cookies = new Cookies(in secret);
+                }
+
+                if (settings.Instrumentation)
+                {
+                    foreach (var shard in shards)
+                        shard.Latencies = new Latencies();
+
+                    eventLatencies = new Histogram();
+                }
+                else
+                {
+                    eventLatencies = null;
+                }
+
+                // A completion queue does not report the local address of each datagram so it would leave 
+                // peers that reached the host at an alias address unable to recognize the replies.
+                if (settings.CompletionQueue && MultiHoming)
+                {
+                    Log.Warn("Completion queue is not compatible with multi-homing. Using regular socket operations.");
+                }
+                else if (settings.CompletionQueue)
+                {
+                    foreach (var shard in shards)
+                    {
+                        if (!shard.Socket.UseCompletionQueue(MaxTransmissionUnit, CompletionQueueCapacity))
+                        {
+                            Log.Warn("Platform does not support a completion queue. Using regular socket operations.");
+                            break;
+                        }
+                    }
+                }
+
                 enabled = true;
-                worker.Start();
+                for (int i = 0; i < shards.Length; ++i)
+                {
+                    var shard = shards[i];
+                    shard.Worker = new Thread(() => Work(shard)) { IsBackground = true, Name = shards.Length == 1 ? $"{Name} Networking" : $"{Name} Networking {i}" };
+                    shard.Worker.Start();
+                }
             }
             catch
             {
+                if (shards == null)
+                    socket.Close();
+
                 Close();
                 throw;
             }
@@ -220,11 +433,20 @@ public void Open(in IPEndPoint localEndPoint, in Host.Settings settings, Connect
         public void Close()
         {
             enabled = false;
-            worker?.Wait();
-            worker = default;
-            socket?.Close();
-            socket = default;
+            if (shards != null)
+            {
+                foreach (var shard in shards)
+                    shard?.Worker?.Wait();
+
+                foreach (var shard in shards)
+                {
+                    shard?.Socket.Close();
+                    shard?.Filter.Dispose();
+                }
+            }
+
             exception = default;
+            eventLatencies = default;
 
             Keys = default;
 
@@ -242,15 +464,17 @@ public void Close()
 
             publicPeers.Clear();
             events.Clear();
-            resets.Clear();
 
-            foreach (var kv in peers)
-                kv.Value.Dispose();
+            if (shards != null)
+            {
+                foreach (var shard in shards)
+                    shard?.Clear();
 
-            peers.Clear();
+                shards = default;
+            }
 
-            first = default;
-            acceptedCount = default;            
+            acceptedCount = default;
+            peerCount = default;
 
             Upstream.Reset();
             Downstream.Reset();
@@ -260,6 +484,11 @@ public void Close()
             Capacity = default;
             EndPoint = default;
             MaxTransmissionUnit = default;
+            PathMtuDiscovery = false;
+            ExplicitCongestionNotification = false;
+            Pacing = false;
+            ZeroCopy = false;
+            MultiHoming = false;
             MaxChannel = default;
             MaxBandwidth = default;
             MaxTransmissionBacklog = default;
@@ -317,15 +546,16 @@ public struct Enumerator: IEnumerator<Peer>
 
         #region Events
 
-        private SpinLock eventsLock = new SpinLock(false);
-
         /// <summary>
         /// A queue to preserve the order in which events are generated between connections
         /// without storing the events themselves. This way they can be released when a 
         /// remote host is disconnected witout affecting other connections or incurring an 
         /// expensive search and remove. 
+        /// <para/>
+        /// Worker threads (and the user thread when closing a connection) add to it while the user 
+        /// retrieves events so it must be lock-free to keep them from stalling each other.
         /// </summary>
-        private readonly Queue<Peer> events = new Queue<Peer>();
+        private readonly ConcurrentRing<Peer> events = new ConcurrentRing<Peer>(256);
 
         /// <summary>
         /// Gets an event from the buffer. Returns true if an event could be retrieved; otherwise, false.
@@ -335,32 +565,61 @@ public bool TryGetEvent(out Event e)
             if (exception != null)
                 throw new ThreadException(SR.Host.ThreadException,  exception);
 
-            if (socket == null)
+            if (shards == null)
                 throw new InvalidOperationException(SR.Host.NotOpen);
 
-            Peer peer;
+            return UncheckedTryGetEvent(out e);
+        }
 
-            var locked = false;
-            try
+        /// <summary>
+        /// Gets as many events from the buffer as available up to the length of <paramref name="events"/>.
+        /// </summary>
+        /// <returns>Number of events retrieved.</returns>
+        public int TryGetEvents(Event[] events) => TryGetEvents(events, 0, events?.Length ?? 0);
+
+        /// <summary>
+        /// Gets as many events from the buffer as available up to <paramref name="count"/>.
+        /// </summary>
+        /// <returns>Number of events retrieved.</returns>
+        public int TryGetEvents(Event[] events, int index, int count)
+        {
+            if (events == null)
+                throw new ArgumentNullException(nameof(events));
+
+            if (index < 0)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            if (count < 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            if (index > events.Length - count)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanNumberOfElements, nameof(index), nameof(count), nameof(events)), nameof(count));
+
+            if (exception != null)
+                throw new ThreadException(SR.Host.ThreadException, exception);
+
+            if (shards == null)
+                throw new InvalidOperationException(SR.Host.NotOpen);
+
+            var n = 0;
+            while (n < count && UncheckedTryGetEvent(out events[index + n]))
+                n++;
+
+            return n;
+        }
+
+        private bool UncheckedTryGetEvent(out Event e)
+        {
+            Peer peer;
+            do
             {
-                eventsLock.Enter(ref locked);
-                do
+                if (!events.TryDequeue(out peer))
                 {
-                    if (events.Count == 0)
-                    {
-                        e = default;
-                        return false;
-                    }
-
-                    peer = events.Dequeue();
+                    e = default;
+                    return false;
                 }
-                while (peer.State == PeerState.Disconnected);
-            }
-            finally
-            {
-                if (locked)
-                    eventsLock.Exit(false);
             }
+            while (peer.State == PeerState.Disconnected);
 
             if (peer.Terminated && peer.State == PeerState.Disconnecting)
             {
@@ -371,6 +630,9 @@ public bool TryGetEvent(out Event e)
             else
             {
                 peer.Dequeue(out e);
+                if (e.Ticks != 0)
+                    eventLatencies?.Record(TickCounter.TicksToMicroseconds(TickCounter.GetTicks() - e.Ticks));
+
                 switch (e.EventType)
                 {
                     case EventType.Connection:
@@ -392,19 +654,12 @@ public bool TryGetEvent(out Event e)
 
         internal void Add(in Event e)
         {
-            e.Peer.Enqueue(in e);
+            if (eventLatencies != null)
+                e.Peer.Enqueue(new Event(in e, TickCounter.GetTicks()));
+            else
+                e.Peer.Enqueue(in e);
 
-            var locked = false;
-            try
-            {
-                eventsLock.Enter(ref locked);
-                events.Enqueue(e.Peer);
-            }
-            finally
-            {
-                if (locked)
-                    eventsLock.Exit(false);
-            }
+            events.Enqueue(e.Peer);
         }
 
         #endregion
@@ -412,29 +667,40 @@ internal void Add(in Event e)
         #region Internal Connections
 
         /// <summary>
-        /// Internal connections lock.
-        /// <para/>
-        /// A lock is needed because <see cref="Connect(in IPEndPoint, out Peer)"/>
-        /// runs on the user thread and may add a new connection.
+        /// Number of passive (incoming) connections accepted by all worker threads.
         /// </summary>
-        private SpinLock peersLock = new SpinLock(false);
+        private int acceptedCount;
 
         /// <summary>
-        /// Internal connections maintained by the worker thread. 
-        /// This is not the same collection observed by the user
-        /// (<see cref="publicPeers"/>).
+        /// Number of internal connections across all shards.
         /// </summary>
-        private readonly Dictionary<IPEndPoint, Peer> peers = new Dictionary<IPEndPoint, Peer>();
+        private int peerCount;
 
         /// <summary>
-        /// First item of the internal linked-list of connections.
+        /// Shard in charge of a remote end point. This is the shard whose socket receives datagrams from the end point.
         /// </summary>
-        private Peer first;
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private Shard ShardOf(in IPEndPoint endPoint) => shards.Length == 1 ? shards[0] : shards[Socket.Steer(in endPoint, shards.Length)];
 
         /// <summary>
-        /// Number of passive (incoming) connections accepted by the worker thread.
+        /// Reserve one of the <see cref="Capacity"/> slots for passive connections. Workers may accept connections 
+        /// concurrently so the slot is reserved atomically. <paramref name="replacing"/> is the number of slots about to be 
+        /// freed by a disconnected peer that is going to be replaced.
         /// </summary>
-        private int acceptedCount;
+        private bool TryReserve(int replacing)
+        {
+            var accepted = Volatile.Read(ref acceptedCount);
+            while (accepted - replacing < Capacity)
+            {
+                var previous = Interlocked.CompareExchange(ref acceptedCount, accepted + 1, accepted);
+                if (previous == accepted)
+                    return true;
+
+                accepted = previous;
+            }
+
+            return false;
+        }
 
         /// <summary>
         /// Initiates a connection to a remote host.
@@ -462,13 +728,14 @@ private bool Connect(in IPEndPoint endPoint, SessionOptions options, in Key remo
             if (TryGetPeer(in endPoint, out peer))
                 return false;
 
+            var shard = ShardOf(in endPoint);
             var locked = false;
             try
             {
-                peersLock.Enter(ref locked);
+                shard.PeersLock.Enter(ref locked);
 
                 // Check if there has not been an incoming connection racing ahead.
-                if (peers.TryGetValue(endPoint, out peer))
+                if (shard.Peers.TryGetValue(endPoint, out peer))
                     return false;
 
                 var time = Timestamp();
@@ -480,14 +747,14 @@ private bool Connect(in IPEndPoint endPoint, SessionOptions options, in Key remo
 
                 peer.OnConnecting(time);
 
-                AddOrReplace(peer);
+                AddOrReplace(shard, peer);
                 publicPeers.Add(peer.EndPoint, peer);
                 return true;
             }
             finally
             {
                 if (locked)
-                    peersLock.Exit(false);
+                    shard.PeersLock.Exit(false);
             }
         }
 
@@ -508,32 +775,33 @@ private bool Connect(in IPEndPoint endPoint, SessionOptions options, in Key remo
         /// Note that the output parameter <paramref name="peer"/> is never null when this method returns false, 
         /// but may be null when this method returns true.
         /// </remarks>
-        private bool TryAccept(Protocol.Time time, Protocol.Time remoteTime, uint remoteSession, in Protocol.Message.Connect connect, in IPEndPoint endPoint, out Peer peer)
+        private bool TryAccept(Shard shard, Protocol.Time time, Protocol.Time remoteTime, uint remoteSession, in Protocol.Message.Connect connect, in IPEndPoint endPoint, in IPEndPoint destination, out Peer peer)
         {
             var locked = false;
             try
             {
-                peersLock.Enter(ref locked);
-                var accepted = acceptedCount;
-                if (peers.TryGetValue(endPoint, out peer))
+                shard.PeersLock.Enter(ref locked);
+                var replacing = 0;
+                if (shard.Peers.TryGetValue(endPoint, out peer))
                 {
                     if (peer.Session.State != Protocol.State.Disconnected)
                         return false;
 
-                    accepted--;
+                    if (peer.Mode == PeerMode.Passive)
+                        replacing = 1;
                 }
 
-                if (AcceptableConnetionTypes.Contains(ConnectionTypes.Insecure) && accepted < Capacity)
+                if (AcceptableConnetionTypes.Contains(ConnectionTypes.Insecure) && TryReserve(replacing))
                 {
                     peer = new Peer(this, time, in endPoint, PeerMode.Passive)
                     {
                         MaxTransmissionBacklog = MaxTransmissionBacklog,
-                        MaxTransmissionUnit = connect.MaximumTransmissionUnit,
-                        LatestRemoteTime = remoteTime
+                        LatestRemoteTime = remoteTime,
+                        LocalEndPoint = destination
                     };
 
                     peer.OnAccepting(time, remoteTime, remoteSession, in connect);
-                    AddOrReplace(peer);
+                    AddOrReplace(shard, peer);
                 }                
 
                 return true;
@@ -541,7 +809,7 @@ private bool TryAccept(Protocol.Time time, Protocol.Time remoteTime, uint remote
             finally
             {
                 if (locked)
-                    peersLock.Exit(false);
+                    shard.PeersLock.Exit(false);
             }
         }
 
@@ -549,34 +817,35 @@ private bool TryAccept(Protocol.Time time, Protocol.Time remoteTime, uint remote
         /// Try to accept an incoming secure connection request while enforcing mutual exclusion against concurrent calls to 
         /// <see cref="Connect(in IPEndPoint, out Peer)"/> from the user thread (due to the potential for receiving 
         /// a connection request from the same end point). 
-        /// <seealso cref="TryAccept(Protocol.Time, Protocol.Time, uint, in Protocol.Message.Connect, in IPEndPoint, out Peer)"/>
+        /// <seealso cref="TryAccept(Shard, Protocol.Time, Protocol.Time, uint, in Protocol.Message.Connect, in IPEndPoint, in IPEndPoint, out Peer)"/>
         /// </summary>
-        private bool TryAccept(Protocol.Time time, Protocol.Time remoteTime, uint remoteSession, in Protocol.Message.Connect connect, in Key remoteKey, in IPEndPoint endPoint, out Peer peer)
+        private bool TryAccept(Shard shard, Protocol.Time time, Protocol.Time remoteTime, uint remoteSession, in Protocol.Message.Connect connect, in Key remoteKey, in IPEndPoint endPoint, in IPEndPoint destination, out Peer peer)
         {
             var locked = false;
             try
             {
-                peersLock.Enter(ref locked);
-                var accepted = acceptedCount;
-                if (peers.TryGetValue(endPoint, out peer))
+                shard.PeersLock.Enter(ref locked);
+                var replacing = 0;
+                if (shard.Peers.TryGetValue(endPoint, out peer))
                 {
                     if (peer.Session.State != Protocol.State.Disconnected)
                         return false;
 
-                    accepted--;
+                    if (peer.Mode == PeerMode.Passive)
+                        replacing = 1;
                 }
 
-                if (AcceptableConnetionTypes.Contains(ConnectionTypes.Secure) && accepted < Capacity)
+                if (AcceptableConnetionTypes.Contains(ConnectionTypes.Secure) && TryReserve(replacing))
                 {
                     peer = new Peer(this, time, in endPoint, PeerMode.Passive, SessionOptions.Secure | SessionOptions.ValidateRemoteKey, in remoteKey)
                     {
                         MaxTransmissionBacklog = MaxTransmissionBacklog,
-                        MaxTransmissionUnit = connect.MaximumTransmissionUnit,
-                        LatestRemoteTime = remoteTime
+                        LatestRemoteTime = remoteTime,
+                        LocalEndPoint = destination
                     };
 
                     peer.OnAccepting(time, remoteTime, remoteSession, in connect);
-                    AddOrReplace(peer);
+                    AddOrReplace(shard, peer);
                 }
 
                 return true;
@@ -584,74 +853,115 @@ private bool TryAccept(Protocol.Time time, Protocol.Time remoteTime, uint remote
             finally
             {
                 if (locked)
-                    peersLock.Exit(false);
+                    shard.PeersLock.Exit(false);
             }
         }
 
-        private bool TryGet(in IPEndPoint endPoint, out Peer peer)
+        /// <summary>
+        /// Check the cookie of a connection request if the host requires cookies and the source end point is unknown. 
+        /// A request without a valid cookie is answered with a CHALLENGE and must be dropped without allocating anything.
+        /// The <paramref name="reader"/> must be positioned at the optional cookie.
+        /// </summary>
+        /// <returns>True if the request may proceed; otherwise false.</returns>
+        private bool TryPassChallenge(Shard shard, Outbox outbox, BinaryReader reader, in IPEndPoint endPoint, in IPEndPoint destination, Protocol.Time time, uint remoteSession)
+        {
+            var cookies = shard.Cookies;
+            if (cookies == null || TryGet(shard, in endPoint, out _))
+                return true;
+
+            if (reader.Available == Protocol.Packet.Cookie.Size + Protocol.Packet.Insecure.Checksum.Size)
+            {
+                reader.UncheckedRead(out Protocol.Time cookieTime);
+                reader.UncheckedRead(out uint tag);
+                if (cookies.Verify(in endPoint, remoteSession, time, cookieTime, tag))
+                    return true;
+            }
+
+            var writer = outbox.Writer;
+            writer.Reset();
+            writer.UncheckedWrite(time);
+            writer.UncheckedWrite(Protocol.PacketFlags.Challenge);
+            writer.UncheckedWrite(remoteSession);
+            writer.UncheckedWrite(cookies.Compute(in endPoint, remoteSession, time));
+            writer.UncheckedWrite(Protocol.Packet.Insecure.Checksum.Compute(writer.Buffer, writer.Offset, writer.Count));
+            outbox.Commit(in endPoint, source: in destination);
+            return false;
+        }
+
+        private bool TryGet(Shard shard, in IPEndPoint endPoint, out Peer peer)
         {
             var locked = false;
             try
             {
-                peersLock.Enter(ref locked);
-                return peers.TryGetValue(endPoint, out peer);
+                shard.PeersLock.Enter(ref locked);
+                return shard.Peers.TryGetValue(endPoint, out peer);
             }
             finally
             {
                 if (locked)
-                    peersLock.Exit(false);
+                    shard.PeersLock.Exit(false);
             }
         }
 
-        private void Remove(List<Peer> list)
+        private void Remove(Shard shard, List<Peer> list)
         {
             var locked = false;
             try
             {
-                peersLock.Enter(ref locked);
+                shard.PeersLock.Enter(ref locked);
                 foreach (var peer in list)
                 {
-                    if (!peers.TryGetValue(peer.EndPoint, out Peer stored) || peer != stored)
+                    if (!shard.Peers.TryGetValue(peer.EndPoint, out Peer stored) || peer != stored)
                         continue;
 
-                    peers.Remove(peer.EndPoint);
+                    shard.Peers.Remove(peer.EndPoint);
+                    shard.RetiredPeers += peer.Counters;
                     if (peer.Next != null)
                         peer.Next.Prev = peer.Prev;
 
-                    if (first == peer)
-                        first = peer.Next;
+                    if (shard.First == peer)
+                        shard.First = peer.Next;
                     else
                         peer.Prev.Next = peer.Next;
 
                     if (peer.Mode == PeerMode.Passive)
-                        acceptedCount--;
+                        Interlocked.Decrement(ref acceptedCount);
+
+                    Interlocked.Decrement(ref peerCount);
                 }
 
-                var count = peers.Count;
+                var count = Volatile.Read(ref peerCount);
                 Upstream.Count = count;
                 Downstream.Count = count;
             }
             finally
             {
                 if (locked)
-                    peersLock.Exit(false);
+                    shard.PeersLock.Exit(false);
             }
         }
 
-        private void AddOrReplace(Peer peer)
+        /// <summary>
+        /// Add a peer to the internal connections of a shard. Passive peers must have 
+        /// reserved a slot with <see cref="TryReserve(int)"/> beforehand.
+        /// </summary>
+        private void AddOrReplace(Shard shard, Peer peer)
         {
-            peers[peer.EndPoint] = peer;            
-            peer.Next = first;
-            if (first != null)
-                first.Prev = peer;
-            first = peer;
-
-            var count = peers.Count;
+            // A replaced peer is never found by Remove(Shard, List<Peer>) so its slot must be released here.
+            var replaced = shard.Peers.TryGetValue(peer.EndPoint, out Peer previous);
+            if (replaced && previous.Mode == PeerMode.Passive)
+                Interlocked.Decrement(ref acceptedCount);
+
+            shard.Peers[peer.EndPoint] = peer;
+            peer.Shard = shard;
+            peer.Next = shard.First;
+            if (shard.First != null)
+                shard.First.Prev = peer;
+            shard.First = peer;
+
+            var count = replaced ? Volatile.Read(ref peerCount) : Interlocked.Increment(ref peerCount);
             Upstream.Count = count;
             Downstream.Count = count;
-
-            if (peer.Mode == PeerMode.Passive)
-                acceptedCount++;
         }
 
         #endregion
@@ -703,44 +1013,111 @@ private void AddOrReplace(Peer peer)
         #region Resets
 
         /// <summary>
-        /// Collection of reset packets to send.
+        /// Queue a reset packet to be sent by the worker in charge of the destination.
         /// </summary>
-        private readonly HashSet<Reset> resets = new HashSet<Reset>();
-
-        internal void Add(in Reset reset) => resets.Add(reset);
+        internal void Add(in Reset reset) => ShardOf(in reset.EndPoint).Add(in reset);
 
         #endregion
 
         #region Worker Thread 
 
-        private Thread worker;
+        /// <summary>
+        /// Maximum number of datagrams received by the worker thread in a single socket operation.
+        /// This must be enough to hold the largest possible coalesced datagram (64 segments) when
+        /// the socket has <see cref="Sockets.Offload.Coalescing"/> enabled.
+        /// </summary>
+        private const int ReceiveBatchSize = 64;
+
+        /// <summary>
+        /// Maximum number of datagrams sent by the worker thread in a single socket operation.
+        /// </summary>
+        private const int SendBatchSize = 64;
+
+        /// <summary>
+        /// Number of receive buffers registered with the kernel when the socket uses a completion queue.
+        /// Datagrams that arrive while all buffers are in use wait in the socket receive buffer.
+        /// </summary>
+        private const int CompletionQueueCapacity = 512;
+
+        /// <summary>
+        /// Number of source end points tracked by the admission filter of each worker thread.
+        /// </summary>
+        private const int FilterCapacity = 16384;
 
-        private void Work()
+        private void Work(Shard shard)
         {
+            var socket = shard.Socket;
+
             // Collection of peers that have disconnected and must be removed.                        
             var disconnected = new List<Peer>();
 
-            // Shared buffer capable of handling the maximum MTU to avoid the 
-            // performance penalty of handling exceptions due to incoming 
-            // datagrams that are bigger than the receive buffer.
-            var buffer = new byte[Protocol.MTU.MaxValue];   
+            var stride = (int)MaxTransmissionUnit;
+
+            // Outgoing packets are encoded directly into the outbox and sent in batches at the end of 
+            // each frame (or earlier if the outbox fills up).
+            var outbox = new Outbox(socket, stride, SendBatchSize);
+            var writer = outbox.Writer;
+
+            // Receive buffer divided in slots of one MTU each so that a whole burst of datagrams can be 
+            // drained from the socket in a single call. Datagrams bigger than the MTU are discarded by 
+            // the socket and reported with zero length which is cheaper than handling an exception.
+            var receiveBuffer = new byte[stride * ReceiveBatchSize];
+            var receiveEndPoints = new IPEndPoint[ReceiveBatchSize];
+            var receiveLengths = new int[ReceiveBatchSize];
+            var receiveAges = new int[ReceiveBatchSize];
+            var receiveMarks = new ECN[ReceiveBatchSize];
+            var receiveDestinations = new IPEndPoint[ReceiveBatchSize];
+
+            var reader = new BinaryReader(receiveBuffer, 0, 0);
+
+            // Readiness may be edge-triggered so every socket must always be drained before waiting. Sockets 
+            // reported ready are drained in order (possibly across frames) and then the shard socket.
+            var poller = new Poller();
+            var ready = new Socket[connectedSocketSettings.HasValue ? ReceiveBatchSize : 1];
+            var readyIndex = 0;
+            var readyCount = 0;
+
+            // True if the last attempt to open a connected socket has failed. No other attempt is made until 
+            // a connected socket is released so that peers are not stuck retrying every frame.
+            var exhausted = false;
 
-            var reader = new BinaryReader(buffer, 0, 0);
-            var writer = new BinaryWriter(buffer);
+            // Latency histograms if the host is instrumented; otherwise null.
+            var latencies = shard.Latencies;
 
             try
             {
+                poller.Add(socket);
+
+                // Time in the poller clock when the next frame is due.
+                var deadline = poller.Now;
+
                 while (enabled)
                 {
-                    // Start ticks used to calculate the remaining frame time in the end of the loop.
+                    // Start ticks of the frame.
                     var start = timeSource.ElapsedTicks();
                     // Current timestamp
                     var time = timeSource.ElapsedTicksToTimestamp(start);    
 
+                    // Frames are scheduled on absolute deadlines one period apart so frame start times do not drift 
+                    // with the time spent in each frame. A worker that falls more than a whole period behind schedule 
+                    // skips the frames it missed instead of running them back to back.
+                    var period = (long)(updatePeriod * 1000000000.0);
+
+                    // Packets are never held back beyond the start of the next frame.
+                    var pacingLimit = (int)(period / 1000);
+                    var now = poller.Now;
+                    deadline += period;
+                    if (deadline <= now)
+                        deadline = now + period;
+
                     var receiveLimit = MaxReceivePacketsPerFrame;
                     var sendLimit = MaxSendPacketsPerFrame;
 
-                    for (var peer = first; peer != null; peer = peer.Next)
+                    // Ticks of the last phase boundary and ticks spent waiting in the frame (only if instrumented).
+                    var mark = start;
+                    var waited = 0L;
+
+                    for (var peer = shard.First; peer != null; peer = peer.Next)
                     {
                         switch (peer.Session.State)
                         {
@@ -753,10 +1130,11 @@ private void Work()
                                     continue;
                                 }
 
+                                outbox.Reserve(peer.MaxTransmissionUnit);
                                 if (sendLimit > 0 && peer.OnConnectingSend(time, writer))
                                 {
                                     var length = writer.Count;
-                                    socket.UncheckedSend(buffer, 0, length, in peer.EndPoint);
+                                    outbox.Commit(in peer.EndPoint, source: in peer.LocalEndPoint);
                                     sendLimit--;
 
                                     Interlocked.Increment(ref peer.packetsSent);
@@ -771,11 +1149,35 @@ private void Work()
                                     continue;
                                 }
 
-                                // Send as much data as possible
+                                if (peer.Socket == null && connectedSocketSettings.HasValue && !exhausted)
+                                    exhausted = !TryConnectSocket(peer, poller);
+
+                                outbox.Reserve(peer.NegotiatedTransmissionUnit);
+
+                                // Probes go first so they are never held back by the send window.
+                                if (sendLimit > 0 && peer.OnProbeSend(time, writer))
+                                {
+                                    var length = writer.Count;
+                                    outbox.Commit(in peer.EndPoint, peer.Socket, peer, 0, in peer.LocalEndPoint);
+                                    sendLimit--;
+
+                                    Interlocked.Increment(ref peer.packetsSent);
+                                    Interlocked.Add(ref peer.bytesSent, length);
+                                }
+
+                                // Send as much data as possible. When pacing, each packet is released after the bytes already 
+                                // sent to the same peer in this frame had time to leave at the pacing rate.
+                                var paced = 0L;
+                                var pacingRate = Pacing ? peer.PacingRate : 0;
+                                if (pacingRate > 0 && peer.Socket != null)
+                                    peer.Socket.PacingRate = pacingRate;
+
                                 while (sendLimit > 0 && peer.OnConnectedSend(time, writer))
                                 {
                                     var length = writer.Count;
-                                    socket.UncheckedSend(buffer, 0, length, in peer.EndPoint);
+                                    var delay = (pacingRate > 0) ? (int)Math.Min(pacingLimit, paced * 1000000 / pacingRate) : 0;
+                                    outbox.Commit(in peer.EndPoint, peer.Socket, null, delay, in peer.LocalEndPoint);
+                                    paced += length;
                                     sendLimit--;
 
                                     Interlocked.Increment(ref peer.packetsSent);
@@ -790,93 +1192,162 @@ private void Work()
                     // Remove disconnected connections
                     if (disconnected.Count > 0)
                     {
-                        Remove(disconnected);
+                        foreach (var peer in disconnected)
+                        {
+                            if (peer.Socket == null)
+                                continue;
+
+                            // The socket may still be waiting to be drained but anything left is for a dead peer anyway.
+                            for (int i = readyIndex; i < readyCount; ++i)
+                                if (ready[i] == peer.Socket)
+                                    ready[i] = socket;
+
+                            poller.Remove(peer.Socket);
+                            peer.Socket.Close();
+                            shard.Retire(peer.Socket);
+                            peer.Socket = null;
+                            exhausted = false;
+                        }
+
+                        Remove(shard, disconnected);
                         disconnected.Clear();
                     }
 
+                    if (latencies != null)
+                        latencies.Update.Record(TickCounter.TicksToMicroseconds(Lap(ref mark)));
+
                     // Send resets
+                    var resets = shard.TakeResets();
                     if (resets.Count > 0)
                     {
                         foreach (var reset in resets)
                         {
                             var encoded = reset.Encoded;
-                            var length = encoded.Length;
-                            
-                            encoded.CopyTo(buffer);
-                            socket.UncheckedSend(buffer, 0, length, in reset.EndPoint);
+                            outbox.Add(encoded, in reset.EndPoint);
                             encoded.Dispose();
                         }
 
                         resets.Clear();
                     }
 
-                    float elapsed, timeout;
-                    var ticks = timeSource.ElapsedTicks();
+                    // Send whatever is left in the outbox
+                    if (outbox.Count > 0)
+                    {
+                        outbox.Flush();
+                        if (latencies != null)
+                            latencies.Send.Record(TickCounter.TicksToMicroseconds(Lap(ref mark)));
+                    }
 
-                    // Read anything that may arrive until there's less than one millisecond remaining for this frame.
-                    if ((timeout = updatePeriod - (elapsed = (float)TickCounter.TicksToSeconds(ticks - start))) > 0.001)
+                    // Read anything that may arrive until the next frame is due.
+                    while (poller.Now < deadline)
                     {
-                        do
+                        // If the receive limit has been reached just sleep for the rest of the frame.
+                        if (receiveLimit == 0)
+                        {
+                            if (latencies != null)
+                                Lap(ref mark);
+
+                            poller.SleepUntil(deadline);
+
+                            if (latencies != null)
+                                waited += Lap(ref mark);
+                            break;
+                        }
+
+                        // The shard socket is skipped in the ready list because it's drained last anyway.
+                        while (readyIndex < readyCount && ready[readyIndex] == socket)
+                            readyIndex++;
+
+                        // Receive all immediately available data one batch at a time.
+                        var source = (readyIndex < readyCount) ? ready[readyIndex] : socket;
+                        if (latencies != null)
+                            Lap(ref mark);
+
+                        var count = source.UncheckedReceiveMany(receiveBuffer, 0, stride, (int)Math.Min(receiveLimit, ReceiveBatchSize), receiveEndPoints, receiveLengths, receiveAges, receiveMarks, receiveDestinations);
+                        if (count > 0)
                         {
-                            // If the receive limit has been reached just sleep for the rest of the frame.
-                            if (receiveLimit == 0)
+                            var ticks = timeSource.ElapsedTicks();
+                            if (latencies != null)
                             {
-                                Thread.Sleep((int)(timeout * 1000));
-                                break;
+                                latencies.Receive.Record(TickCounter.TicksToMicroseconds(ticks - mark));
+                                mark = ticks;
                             }
 
-                            // Receive all immediately available data 
-                            var available = socket.Available;
-                            if (available > 0)
+                            // Drop malformed, corrupted and excess connection packets in one pass before any of them is parsed.
+                            shard.Filter.Apply(receiveBuffer, 0, stride, count, receiveEndPoints, receiveLengths, out var verified);
+
+                            if (latencies != null)
+                                latencies.Filter.Record(TickCounter.TicksToMicroseconds(Lap(ref mark)));
+
+                            for (int i = 0; i < count; ++i)
                             {
-                                time = timeSource.ElapsedTicksToTimestamp(ticks);
-                                var nbytes = 0;
-                                while (nbytes < available)
+                                // A datagram steered to the wrong shard (e.g. IPv6 with extension headers) must be dropped 
+                                // because its peer, if any, is in charge of another worker thread.
+                                var length = receiveLengths[i];
+                                if (length > 0 && (shards.Length == 1 || ShardOf(in receiveEndPoints[i]) == shard))
                                 {
-                                    var length = socket.UncheckedReceive(buffer, 0, buffer.Length, out IPEndPoint sender);
-                                    if (length > 0)
-                                    {
-                                        nbytes += length;
-                                        if (length <= MaxTransmissionUnit)
-                                        {
-                                            reader.Reset(0, length);
-                                            OnReceive(in sender, time, reader);
-                                        }
-
-                                        receiveLimit--;
-                                        if (receiveLimit == 0)
-                                            break;
-                                    }
-                                }
+                                    // Stamp each datagram with its kernel arrival time (if known) so that RTT samples exclude 
+                                    // the time it waited in the socket while this thread was busy. It cannot be earlier than 
+                                    // the start of the frame though because peers have already been updated with that time.
+                                    time = timeSource.ElapsedTicksToTimestamp(Math.Max(start, ticks - TickCounter.MicrosecondsToTicks(receiveAges[i])));
+
+                                    reader.Reset(i * stride, length);
+                                    OnReceive(shard, outbox, in receiveEndPoints[i], in receiveDestinations[i], time, receiveMarks[i] == ECN.CongestionExperienced, verified, reader);
+                                    receiveLimit--;
 
-                                ticks = timeSource.ElapsedTicks();
+                                    if (latencies != null)
+                                        latencies.Packet.Record(TickCounter.TicksToMicroseconds(Lap(ref mark)));
+                                }
                             }
-                            else // if there's no data immediately available wait for more.
-                            {
-                                var microSeconds = (int)(timeout * 1000000);
-                                if (!socket.Poll(microSeconds, SelectMode.SelectRead))
-                                    break;
 
-                                ticks = timeSource.ElapsedTicks();
+                            // Send challenges right away instead of waiting for the next frame.
+                            if (outbox.Count > 0)
+                            {
+                                outbox.Flush();
+                                if (latencies != null)
+                                    latencies.Send.Record(TickCounter.TicksToMicroseconds(Lap(ref mark)));
                             }
                         }
-                        while ((timeout = updatePeriod - (elapsed = (float)TickCounter.TicksToSeconds(ticks - start))) > 0.001);
+                        else if (readyIndex < readyCount) // move on to the next ready socket.
+                        {
+                            readyIndex++;
+                        }
+                        else // if there's no data immediately available wait for more.
+                        {
+                            readyIndex = 0;
+                            if (latencies != null)
+                                Lap(ref mark);
+
+                            readyCount = poller.WaitUntil(deadline, ready);
+
+                            // Zero copy completions also wake up the poller. Reclaim them right away to release the send buffers.
+                            outbox.Reclaim();
+
+                            if (latencies != null)
+                                waited += Lap(ref mark);
+
+                            if (readyCount == 0)
+                                break;
+                        }
                     }
+
+                    if (latencies != null)
+                        latencies.Frame.Record(TickCounter.TicksToMicroseconds(timeSource.ElapsedTicks() - start - waited));
                 }
 
                 // If the thread has stopped normally (by Host.Close() instead of an exception), 
                 // try to send any last minute RESETS.
                 // There's no need to clear resets here as they're going to be cleared by Host.Close() anyway.
-                foreach (var reset in resets)
+                foreach (var reset in shard.TakeResets())
                 {
                     var encoded = reset.Encoded;
-                    var length = encoded.Length;
-
-                    encoded.CopyTo(buffer);
-                    socket.UncheckedSend(buffer, 0, length, in reset.EndPoint);
+                    outbox.Add(encoded, in reset.EndPoint);
                     encoded.Dispose();
                 }
 
+                if (outbox.Count > 0)
+                    outbox.Flush();
+
                 // Give the socket a chance to flush those RESETs.
                 Thread.Sleep(100);
             }
@@ -904,9 +1375,63 @@ private void Work()
                 exception = e;
                 Log.Exception(e);
             }
+            finally
+            {
+                for (var peer = shard.First; peer != null; peer = peer.Next)
+                {
+                    if (peer.Socket != null)
+                    {
+                        peer.Socket.Close();
+                        shard.Retire(peer.Socket);
+                        peer.Socket = null;
+                    }
+                }
+
+                poller.Dispose();
+                outbox.Dispose();
+            }
+        }
+
+        /// <summary>
+        /// Ticks elapsed since <paramref name="mark"/> which is then moved to the current ticks.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        private long Lap(ref long mark)
+        {
+            var ticks = timeSource.ElapsedTicks();
+            var elapsed = ticks - mark;
+            mark = ticks;
+            return elapsed;
+        }
+
+        /// <summary>
+        /// Open a socket bound to the host end point and connected to <paramref name="peer"/>.
+        /// </summary>
+        /// <returns>False if a socket could not be opened (e.g. the process has run out of file descriptors).</returns>
+        private bool TryConnectSocket(Peer peer, Poller poller)
+        {
+            Socket socket = null;
+            try
+            {
+                var settings = connectedSocketSettings.Value;
+                socket = new Socket(EndPoint, in settings, Log);
+                if (socket.TryConnect(in peer.EndPoint))
+                {
+                    poller.Add(socket);
+                    peer.Socket = socket;
+                    return true;
+                }
+            }
+            catch (SocketException e)
+            {
+                Log.Warn($"Could not open a socket connected to {peer.EndPoint} ({e.SocketErrorCode}). Using the shared socket until another is released.");
+            }
+
+            socket?.Close();
+            return false;
         }
 
-        private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader reader)
+        private void OnReceive(Shard shard, Outbox outbox, in IPEndPoint endPoint, in IPEndPoint destination, Protocol.Time time, bool congested, bool verified, BinaryReader reader)
         {
             if (reader.Available < Protocol.Packet.Header.Size)
                 return;
@@ -915,10 +1440,11 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
 
             // Packet grammar. The number in parenthesis is the atom size in bytes. Square brackets denote optional elements. Curly brackets denote encrypted elements.
             // 
-            // STM(4) PFLAGS(1) <CON | SECCON | ACC | SECACC | DAT | SECDAT | RST | SECRST>
+            // STM(4) PFLAGS(1) <CON | SECCON | CHL | ACC | SECACC | DAT | SECDAT | RST | SECRST>
             // 
-            //     CON ::= SSN(4) MTU(2) MTC(1) MBW(4) CRC(4)
-            //  SECCON ::= SSN(4) MTU(2) MTC(1) MBW(4) PUBKEY(32) CRC(4)
+            //     CON ::= SSN(4) MTU(2) MTC(1) MBW(4) [COOKIE] CRC(4)
+            //  SECCON ::= SSN(4) MTU(2) MTC(1) MBW(4) PUBKEY(32) [COOKIE] CRC(4)
+            //     CHL ::= SSN(4) TAG(4) CRC(4)
             //     ACC ::= SSN(4) MTU(2) MTC(1) MBW(4) ATM(4) RW(2) ASSN(4) CRC(4)
             //  SECACC ::= SSN(4) MTU(2) MTC(1) MBW(4) ATM(4) {RW(2)} PUBKEY(32) NONCE(8) MAC(16)16)
             //     DAT ::= SSN(4) RW(2) MSGS CRC(4)
@@ -935,16 +1461,19 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
             //  DUPGAP ::= CH(1) CNT(2) NEXT(2) LAST(2) ATM(4)
             //     SEG ::= CH(1) SEQ(2) RSN(2) SEGLEN(2) PAYLOAD(N)
             //    FRAG ::= CH(1) SEQ(2) RSN(2) SEGLEN(2) FRAGINDEX(1) FRAGLEN(2) PAYLOAD(N)
+            //
+            //  COOKIE ::= CTM(4) TAG(4)
 
             reader.UncheckedRead(out Protocol.Time remoteTime);
             reader.UncheckedRead(out Protocol.PacketFlags pflags);
 
             switch (pflags)
             {
-                case Protocol.PacketFlags.Connect: // SSN(4) MTU(2) MTC(1) MBW(4) CRC(4)
-                    if (reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Insecure.Checksum.Size)) 
+                case Protocol.PacketFlags.Connect: // SSN(4) MTU(2) MTC(1) MBW(4) [CTM(4) TAG(4)] CRC(4)
+                    if (reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Insecure.Checksum.Size)
+                        || reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Cookie.Size + Protocol.Packet.Insecure.Checksum.Size)) 
                     {
-                        if (!Protocol.Packet.Insecure.Checksum.Verify(buffer, offset, length))
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
                             break;
 
                         reader.UncheckedRead(out uint remoteSession);
@@ -966,13 +1495,17 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                             mtc = MaxChannel;
 
                         reader.UncheckedRead(out uint mbw);
-                        mbw = Protocol.Bandwidth.Clamp(mbw);
+                        var pmtud = (mbw & Protocol.MTU.Probe.Flag) != 0;
+                        mbw = Protocol.Bandwidth.Clamp(mbw & ~Protocol.MTU.Probe.Flag);
+
+                        var connect = new Protocol.Message.Connect(mtu, mtc, mbw, pmtud);
 
-                        var connect = new Protocol.Message.Connect(mtu, mtc, mbw);
+                        if (!TryPassChallenge(shard, outbox, reader, in endPoint, in destination, time, remoteSession))
+                            break;
 
                         // Try to accept as a new peer, if failed then the peer already exists.
                         TryAccept:                        
-                        if (!TryAccept(time, remoteTime, remoteSession, in connect, in endPoint, out Peer peer))
+                        if (!TryAccept(shard, time, remoteTime, remoteSession, in connect, in endPoint, in destination, out Peer peer))
                         {
                             // Insecure CONNECT must be ignored by secure sessions.
                             if (peer.Session.Options.Contains(SessionOptions.Secure))
@@ -1008,10 +1541,11 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                         }
                     }
                     break;
-                case Protocol.PacketFlags.Secure | Protocol.PacketFlags.Connect: // SSN(4) MTU(2) MTC(1) MBW(4) PUBKEY(32) CRC(4)
-                    if (reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Secure.Key.Size + Protocol.Packet.Insecure.Checksum.Size))
+                case Protocol.PacketFlags.Secure | Protocol.PacketFlags.Connect: // SSN(4) MTU(2) MTC(1) MBW(4) PUBKEY(32) [CTM(4) TAG(4)] CRC(4)
+                    if (reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Secure.Key.Size + Protocol.Packet.Insecure.Checksum.Size)
+                        || reader.Available == (sizeof(uint) + Protocol.Message.Connect.Size + Protocol.Packet.Secure.Key.Size + Protocol.Packet.Cookie.Size + Protocol.Packet.Insecure.Checksum.Size))
                     {
-                        if (!Protocol.Packet.Insecure.Checksum.Verify(buffer, offset, length))
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
                             break;
 
                         reader.UncheckedRead(out uint remoteSession);
@@ -1033,15 +1567,19 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                             mtc = MaxChannel;
 
                         reader.UncheckedRead(out uint mbw);
-                        mbw = Protocol.Bandwidth.Clamp(mbw);
+                        var pmtud = (mbw & Protocol.MTU.Probe.Flag) != 0;
+                        mbw = Protocol.Bandwidth.Clamp(mbw & ~Protocol.MTU.Probe.Flag);
 
                         reader.UncheckedRead(out Key remoteKey);
 
-                        var connect = new Protocol.Message.Connect(mtu, mtc, mbw);
+                        var connect = new Protocol.Message.Connect(mtu, mtc, mbw, pmtud);
+
+                        if (!TryPassChallenge(shard, outbox, reader, in endPoint, in destination, time, remoteSession))
+                            break;
 
                         TryAccept:
                         // Try to accept as a new peer, if failed then the peer already exists.
-                        if (!TryAccept(time, remoteTime, remoteSession, in connect, in remoteKey, in endPoint, out Peer peer))
+                        if (!TryAccept(shard, time, remoteTime, remoteSession, in connect, in remoteKey, in endPoint, in destination, out Peer peer))
                         {
                             Interlocked.Increment(ref peer.packetsReceived);
                             Interlocked.Add(ref peer.bytesReceived, length);
@@ -1100,16 +1638,16 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                 case Protocol.PacketFlags.Accept: // SSN(4) MTU(2) MTC(1) MBW(4) ATM(4) RW(2) ASSN(4) CRC(4)
                     if (reader.Available == (sizeof(uint) + Protocol.Message.Accept.Size + sizeof(ushort) + sizeof(uint) + Protocol.Packet.Insecure.Checksum.Size)) 
                     {
-                        if (!Protocol.Packet.Insecure.Checksum.Verify(buffer, offset, length))
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
                             break;
 
                         reader.UncheckedRead(out uint remoteSession);
 
                         // If a peer wasn't found the remote host must be in a half-open insecure session.
-                        if (!TryGet(in endPoint, out Peer peer) 
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
                             || peer.Session.State == Protocol.State.Disconnected)
                         {
-                            Add(new Reset(endPoint, remoteSession, EncodeReset(WorkerEncoder, time, remoteSession)));
+                            shard.Add(new Reset(endPoint, remoteSession, EncodeReset(shard.Encoder, time, remoteSession)));
                             break;
                         }
 
@@ -1146,7 +1684,8 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                             mtc = MaxChannel;
 
                         reader.UncheckedRead(out uint mbw);
-                        mbw = Protocol.Bandwidth.Clamp(mbw);
+                        var pmtud = (mbw & Protocol.MTU.Probe.Flag) != 0;
+                        mbw = Protocol.Bandwidth.Clamp(mbw & ~Protocol.MTU.Probe.Flag);
 
                         reader.UncheckedRead(out uint atm);
 
@@ -1165,7 +1704,7 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                                 peer.LatestRemoteTime = remoteTime;
                                 peer.RemoteWindow = remoteWindow;
 
-                                peer.OnConnected(time, remoteTime, remoteSession, new Protocol.Message.Accept(mtu, mtc, mbw, atm));
+                                peer.OnConnected(time, remoteTime, remoteSession, new Protocol.Message.Accept(mtu, mtc, mbw, atm, pmtud));
                                 Add(new Event(peer));
                             }
                             else
@@ -1207,7 +1746,7 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                     {
                         // If a peer wasn't found the remote host must be in a half-open secure session.
                         // It's expected to ignore any insecure resets and there's no way to send it a secure reset anymore.
-                        if (!TryGet(in endPoint, out Peer peer) 
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
                             || peer.Session.State == Protocol.State.Disconnected)
                             break;
 
@@ -1243,7 +1782,8 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                             mtc = MaxChannel;
 
                         reader.UncheckedRead(out uint mbw);
-                        mbw = Protocol.Bandwidth.Clamp(mbw);
+                        var pmtud = (mbw & Protocol.MTU.Probe.Flag) != 0;
+                        mbw = Protocol.Bandwidth.Clamp(mbw & ~Protocol.MTU.Probe.Flag);
 
                         reader.UncheckedRead(out uint atm);
 
@@ -1294,7 +1834,7 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                             peer.LatestRemoteTime = remoteTime;
                             peer.RemoteWindow = remoteWindow;
 
-                            peer.OnConnected(time, remoteTime, remoteSession, new Protocol.Message.Accept(mtu, mtc, mbw, atm));
+                            peer.OnConnected(time, remoteTime, remoteSession, new Protocol.Message.Accept(mtu, mtc, mbw, atm, pmtud));
                             Add(new Event(peer));
                         }
                         else
@@ -1340,16 +1880,16 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                 case Protocol.PacketFlags.Data: // SSN(4) RW(2) MSGS(N) CRC(4)
                     if (reader.Available > (sizeof(uint) + sizeof(ushort) + Protocol.Packet.Insecure.Checksum.Size)) 
                     {
-                        if (!Protocol.Packet.Insecure.Checksum.Verify(buffer, offset, length))
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
                             break;
                         
                         reader.UncheckedRead(out uint remoteSession);
 
                         // If a peer wasn't found the remote host must be in a half-open connection.
-                        if (!TryGet(in endPoint, out Peer peer) 
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
                             || peer.Session.State == Protocol.State.Disconnected)
                         {
-                            Add(new Reset(endPoint, remoteSession, EncodeReset(WorkerEncoder, time, remoteSession)));
+                            shard.Add(new Reset(endPoint, remoteSession, EncodeReset(shard.Encoder, time, remoteSession)));
                             break;
                         }
 
@@ -1371,12 +1911,16 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                         reader.UncheckedTruncate(Protocol.Packet.Insecure.Checksum.Size);
                         reader.UncheckedRead(out ushort remoteWindow);
                         
-                        // Update latest remote time and remote window. 
+                        // Update latest remote time, remote window and the local address to reply from. 
                         if (peer.LatestRemoteTime < remoteTime)
                         {
                             peer.LatestRemoteTime = remoteTime;
                             peer.RemoteWindow = remoteWindow;
+                            peer.LocalEndPoint = destination;
                         }
+
+                        if (congested)
+                            peer.OnCongestionExperienced();
                         
                         OnReceive(peer, time, remoteTime, reader);
                     }
@@ -1384,7 +1928,7 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                 case Protocol.PacketFlags.Secure | Protocol.PacketFlags.Data: // {RW(2) MSGS(N)} NONCE(8) MAC(16)
                     if (reader.Available > (sizeof(ushort) + Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size)) 
                     {
-                        if (!TryGet(in endPoint, out Peer peer)
+                        if (!TryGet(shard, in endPoint, out Peer peer)
                             || peer.Session.State == Protocol.State.Disconnected)
                             break;
 
@@ -1422,26 +1966,54 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                         reader.UncheckedReset(position, count);
                         reader.UncheckedRead(out ushort remoteWindow);
 
-                        // Update latest remote time and remote window. 
+                        // Update latest remote time, remote window and the local address to reply from. 
                         if (peer.LatestRemoteTime < remoteTime)
                         {
                             peer.LatestRemoteTime = remoteTime;
                             peer.RemoteWindow = remoteWindow;
+                            peer.LocalEndPoint = destination;
                         }                        
 
+                        if (congested)
+                            peer.OnCongestionExperienced();
+
                         OnReceive(peer, time, remoteTime, reader);
 
                     }
                     break;
+                case Protocol.PacketFlags.Challenge: // SSN(4) TAG(4) CRC(4)
+                    if (reader.Available == (sizeof(uint) + sizeof(uint) + Protocol.Packet.Insecure.Checksum.Size))
+                    {
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
+                            break;
+
+                        reader.UncheckedRead(out uint session);
+
+                        // CHALLENGE is only meaningful for a connection request still waiting for an answer.
+                        // It's not authenticated (just like CONNECT) so a secure session accepts it as well.
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
+                            || peer.Session.State != Protocol.State.Connecting 
+                            || peer.Session.Local != session)
+                            break;
+
+                        // The source time of the CHALLENGE is the cookie time.
+                        reader.UncheckedRead(out uint tag);
+
+                        Interlocked.Increment(ref peer.packetsReceived);
+                        Interlocked.Add(ref peer.bytesReceived, length);
+
+                        peer.OnChallenged(remoteTime, tag);
+                    }
+                    break;
                 case Protocol.PacketFlags.Reset: // SSN(4) CRC(4)
                     if (reader.Available == (sizeof(uint) + Protocol.Packet.Insecure.Checksum.Size)) 
                     {
-                        if (!Protocol.Packet.Insecure.Checksum.Verify(buffer, offset, length))
+                        if (!Protocol.Packet.Insecure.Checksum.VerifyFiltered(buffer, offset, length, verified))
                             break;
 
                         reader.UncheckedRead(out uint session);
 
-                        if (!TryGet(in endPoint, out Peer peer) 
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
                             || peer.Session.State == Protocol.State.Disconnected 
                             || peer.Session.Local != session)
                             break;
@@ -1460,7 +2032,7 @@ private void OnReceive(in IPEndPoint endPoint, Protocol.Time time, BinaryReader
                 case Protocol.PacketFlags.Secure | Protocol.PacketFlags.Reset: // PUBKEY(32) NONCE(8) MAC(16)
                     if (reader.Available == (Protocol.Packet.Secure.Key.Size + Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size)) 
                     {
-                        if (!TryGet(in endPoint, out Peer peer) 
+                        if (!TryGet(shard, in endPoint, out Peer peer) 
                             || peer.Session.State == Protocol.State.Disconnected)
                             break;
 
@@ -1546,6 +2118,38 @@ bool TrySetUsed(byte channel, in Span<uint> from)
                 
                 switch (mflags)
                 {
+                    case Protocol.MessageFlags.Probe: // SIZE(2) PAD(N)
+                        if (reader.Available >= Protocol.Message.Probe.Size)
+                        {
+                            reader.UncheckedRead(out ushort size);
+                            if (peer.Session.State >= Protocol.State.Connected)
+                                peer.OnProbe(size);
+
+                            // Padding takes up the rest of the packet.
+                            reader.UncheckedSkip(reader.Available);
+                            continue;
+                        }
+                        goto Incomplete;
+                    case Protocol.MessageFlags.Ack | Protocol.MessageFlags.Probe: // SIZE(2)
+                        if (reader.Available >= Protocol.Message.Probe.Ack.Size)
+                        {
+                            reader.UncheckedRead(out ushort size);
+                            if (peer.Session.State >= Protocol.State.Connected)
+                                peer.OnProbeAck(time, size);
+
+                            continue;
+                        }
+                        goto Incomplete;
+                    case Protocol.MessageFlags.Ack | Protocol.MessageFlags.Congestion: // CNT(2)
+                        if (reader.Available >= Protocol.Message.Congestion.Ack.Size)
+                        {
+                            reader.UncheckedRead(out ushort count);
+                            if (peer.Session.State >= Protocol.State.Connected)
+                                peer.OnCongestionAck(time, count);
+
+                            continue;
+                        }
+                        goto Incomplete;
                     case Protocol.MessageFlags.Ack | Protocol.MessageFlags.Data: // CH(1) NEXT(2) ATM(4)
                         if (reader.Available >= Protocol.Message.Ack.Size) 
                         {
@@ -0,0 +1,24 @@
+﻿using System;
+
+namespace Carambolas.Net
+{
+    /// <summary>
+    /// Admission filter applied to each batch of received datagrams before any of them is parsed.
+    /// </summary>
+    internal interface IFilter: IDisposable
+    {
+        /// <summary>
+        /// Counters since the filter was created. May be read from any thread.
+        /// </summary>
+        FilterCounters Counters { get; }
+
+        /// <summary>
+        /// Filter a batch of <paramref name="count"/> datagrams received <paramref name="stride"/> bytes apart.
+        /// Datagrams are dropped by setting their lengths to zero. On return <paramref name="verified"/> is true 
+        /// if the checksum of every insecure datagram that passed has been verified; otherwise checksums must 
+        /// be verified by the caller.
+        /// </summary>
+        /// <returns>Number of datagrams dropped.</returns>
+        int Apply(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, out bool verified);
+    }
+}
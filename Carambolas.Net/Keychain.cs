@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Runtime.InteropServices;
 
 using Carambolas.Security.Cryptography;
 using Carambolas.Security.Cryptography.NaCl;
@@ -7,10 +8,69 @@ namespace Carambolas.Net
 {
     internal sealed class Keychain: IKeychain
     {
+        /// <summary>
+        /// Native keychain if the native library is available; otherwise the managed keychain.
+        /// </summary>
+#if USE_NATIVE_SOCKET
+        public static IKeychain Default => Native.Keychain.IsSupported ? (IKeychain)new Native.Keychain() : new Keychain();
+#else
         public static IKeychain Default => new Keychain();
+#endif
 
         public Key CreatePublicKey(in Key privateKey) => Curve25519.CreatePublicKey(in privateKey);
 
         public Key CreateSharedKey(in Key privateKey, in Key remoteKey) => Curve25519.CreateSharedKey(in privateKey, in remoteKey);
     }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        /// <summary>
+        /// Native implementation of <see cref="Net.Keychain"/> (X25519 with 64-bit limbs). 
+        /// Produces exactly the same output as the managed implementation so peers may use either one.
+        /// </summary>
+        public sealed class Keychain: IKeychain
+        {
+            /// <summary>
+            /// True if the native library could be loaded.
+            /// </summary>
+            public static readonly bool IsSupported = CheckSupport();
+
+            private static bool CheckSupport()
+            {
+                try
+                {
+                    Native.CreatePublicKey(default, out Key _);
+                    return true;
+                }
+                catch (DllNotFoundException)
+                {
+                    return false;
+                }
+                catch (EntryPointNotFoundException)
+                {
+                    return false;
+                }
+            }
+
+            public Key CreatePublicKey(in Key privateKey)
+            {
+                Native.CreatePublicKey(in privateKey, out Key publicKey);
+                return publicKey;
+            }
+
+            public Key CreateSharedKey(in Key privateKey, in Key remoteKey)
+            {
+                Native.CreateSharedKey(in privateKey, in remoteKey, out Key sharedKey);
+                return sharedKey;
+            }
+        }
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_keychain_create_public_key", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void CreatePublicKey(in Key privateKey, out Key publicKey);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_keychain_create_shared_key", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void CreateSharedKey(in Key privateKey, in Key remoteKey, out Key sharedKey);
+    }
+#endif
 }
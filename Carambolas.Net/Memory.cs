@@ -13,115 +13,148 @@ internal sealed class Memory
     {
         internal const int BlockCount = 4;
 
-        [DebuggerDisplay("Count = {queue.Count}")]
         internal sealed class Pool: IDisposable
         {
-            [DebuggerDisplay("BlockSize = {BlockSize}; Count = {queue.Count}")]
-            public sealed class Level: IDisposable
+            /// <summary>
+            /// Free list with a lock-free cache per thread in front of a shared depot.
+            /// </summary>
+            /// <remarks>
+            /// Worker threads allocate and release without ever contending for the same lock. Instances
+            /// released on one thread and allocated on another (e.g. received data disposed by the user)
+            /// only move through the depot in batches of <see cref="BatchSize"/>.
+            /// </remarks>
+            [DebuggerDisplay("Count = {depot.Count}")]
+            public sealed class FreeList<T>: IDisposable where T: class
             {
-                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-                private SpinLock queueLock = new SpinLock(false);
+                private const int BatchSize = 32;
 
-                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-                private Queue<byte[]> queue = new Queue<byte[]>(32);
+                private sealed class Cache
+                {
+                    public readonly T[] Items = new T[BatchSize * 2];
+                    public int Count;
+                }
 
                 [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-                public readonly ushort BlockSize;
-
-                public Level(ushort blockSize) => BlockSize = blockSize;
+                private ThreadLocal<Cache> caches = new ThreadLocal<Cache>(() => new Cache());
 
-                public byte[] Get()
-                {
-                    var locked = false;
-                    try
-                    {
-                        queueLock.Enter(ref locked);
-                        if ((queue ?? throw new ObjectDisposedException(GetType().FullName)).Count > 0)
-                            return queue.Dequeue();
-                    }
-                    finally
-                    {
-                        if (locked)
-                            queueLock.Exit(false);
-                    }
+                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+                private SpinLock depotLock = new SpinLock(false);
 
-                    return new byte[BlockSize];
-                }
+                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+                private Queue<T> depot = new Queue<T>(BatchSize);
 
-                public void Return(byte[] block)
+                /// <summary>
+                /// Take a free instance or null if there's none available.
+                /// </summary>
+                public T Get()
                 {
-                    if (queue != null)
+                    var cache = (caches ?? throw new ObjectDisposedException(GetType().FullName)).Value;
+                    if (cache.Count == 0)
                     {
                         var locked = false;
                         try
                         {
-                            queueLock.Enter(ref locked);
-                            queue.Enqueue(block);
+                            depotLock.Enter(ref locked);
+                            var n = Math.Min(BatchSize, depot.Count);
+                            for (int i = 0; i < n; ++i)
+                                cache.Items[cache.Count++] = depot.Dequeue();
                         }
                         finally
                         {
                             if (locked)
-                                queueLock.Exit(false);
+                                depotLock.Exit(false);
                         }
+
+                        if (cache.Count == 0)
+                            return null;
                     }
+
+                    var item = cache.Items[--cache.Count];
+                    cache.Items[cache.Count] = null;
+                    return item;
                 }
 
-                public void Return(byte[][] blocks)
+                public void Return(T item)
                 {
-                    if (queue != null)
+                    var cache = caches?.Value;
+                    if (cache == null)
+                        return;
+
+                    if (cache.Count == cache.Items.Length)
                     {
                         var locked = false;
                         try
                         {
-                            queueLock.Enter(ref locked);
-                            for (int i = 0; i < blocks.Length; ++i)
+                            depotLock.Enter(ref locked);
+                            for (int i = 0; i < BatchSize; ++i)
                             {
-                                var block = blocks[i];
-                                if (block == null)
-                                    break;
-
-                                queue.Enqueue(block);
-                                blocks[i] = null;
+                                depot.Enqueue(cache.Items[--cache.Count]);
+                                cache.Items[cache.Count] = null;
                             }
                         }
                         finally
                         {
                             if (locked)
-                                queueLock.Exit(false);
+                                depotLock.Exit(false);
                         }
                     }
+
+                    cache.Items[cache.Count++] = item;
                 }
 
-                public void Dispose() => queue = null;
+                /// <summary>
+                /// Thread caches are left for the garbage collector because other threads may still be using them.
+                /// </summary>
+                public void Dispose() => caches = null;
             }
 
-            [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-            private SpinLock queueLock = new SpinLock(false);
+            [DebuggerDisplay("BlockSize = {BlockSize}")]
+            public sealed class Level: IDisposable
+            {
+                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+                private FreeList<byte[]> blocks = new FreeList<byte[]>();
 
-            [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-            private Queue<Memory> queue = new Queue<Memory>(32);
+                [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+                public readonly ushort BlockSize;
 
-            [DebuggerBrowsable(DebuggerBrowsableState.Never)]
-            public readonly Level[] Levels = { new Level(64), new Level(256), new Level(1024), new Level(4096), new Level(16384) };
+                public Level(ushort blockSize) => BlockSize = blockSize;
 
-            public Memory Get()
-            {
-                var locked = false;                
-                try
+                public byte[] Get() => (blocks ?? throw new ObjectDisposedException(GetType().FullName)).Get() ?? new byte[BlockSize];
+
+                public void Return(byte[] block) => blocks?.Return(block);
+
+                public void Return(byte[][] blocks)
                 {
-                    queueLock.Enter(ref locked);
-                    if ((queue ?? throw new ObjectDisposedException(GetType().FullName)).Count > 0)
-                        return queue.Dequeue();
+                    var list = this.blocks;
+                    if (list != null)
+                    {
+                        for (int i = 0; i < blocks.Length; ++i)
+                        {
+                            var block = blocks[i];
+                            if (block == null)
+                                break;
+
+                            list.Return(block);
+                            blocks[i] = null;
+                        }
+                    }
                 }
-                finally
+
+                public void Dispose()
                 {
-                    if (locked)
-                        queueLock.Exit(false);
+                    blocks?.Dispose();
+                    blocks = null;
                 }
-
-                return new Memory(this);
             }
 
+            [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+            private FreeList<Memory> instances = new FreeList<Memory>();
+
+            [DebuggerBrowsable(DebuggerBrowsableState.Never)]
+            public readonly Level[] Levels = { new Level(64), new Level(256), new Level(1024), new Level(4096), new Level(16384) };
+
+            public Memory Get() => (instances ?? throw new ObjectDisposedException(GetType().FullName)).Get() ?? new Memory(this);
+
             public void Return(Memory instance)
             {
                 instance.Version++;
@@ -131,25 +164,13 @@ public void Return(Memory instance)
                 instance.level?.Return(instance.blocks);
                 instance.level = default;
 
-                if (queue != null)
-                {
-                    var locked = false;                    
-                    try
-                    {
-                        queueLock.Enter(ref locked);
-                        queue.Enqueue(instance);
-                    }
-                    finally
-                    {
-                        if (locked)
-                            queueLock.Exit(false);
-                    }
-                }
+                instances?.Return(instance);
             }
 
             public void Dispose()
             {
-                queue = null;
+                instances?.Dispose();
+                instances = null;
                 for (int i = 0; i < Levels.Length; ++i)
                 {
                     Levels[i]?.Dispose();
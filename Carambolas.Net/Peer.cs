@@ -25,6 +25,44 @@ internal enum Acknowledgment
         Accept
     }
 
+    /// <summary>
+    /// Packets and bytes transferred by one or more peers and the number of retransmissions required.
+    /// </summary>
+    public readonly struct PeerCounters
+    {
+        public readonly long PacketsSent;
+        public readonly long PacketsReceived;
+        public readonly long PacketsDropped;
+        public readonly long BytesSent;
+        public readonly long BytesReceived;
+        public readonly long DataSent;
+        public readonly long DataReceived;
+        public readonly long FastRetransmissions;
+        public readonly long Timeouts;
+        public readonly long CongestionMarks;
+
+        public PeerCounters(long packetsSent, long packetsReceived, long packetsDropped, long bytesSent, long bytesReceived, long dataSent, long dataReceived, long fastRetransmissions, long timeouts, long congestionMarks)
+        {
+            PacketsSent = packetsSent;
+            PacketsReceived = packetsReceived;
+            PacketsDropped = packetsDropped;
+            BytesSent = bytesSent;
+            BytesReceived = bytesReceived;
+            DataSent = dataSent;
+            DataReceived = dataReceived;
+            FastRetransmissions = fastRetransmissions;
+            Timeouts = timeouts;
+            CongestionMarks = congestionMarks;
+        }
+
+        public static PeerCounters operator +(in PeerCounters a, in PeerCounters b) => new PeerCounters(
+            a.PacketsSent + b.PacketsSent, a.PacketsReceived + b.PacketsReceived, a.PacketsDropped + b.PacketsDropped, a.BytesSent + b.BytesSent, a.BytesReceived + b.BytesReceived,
+            a.DataSent + b.DataSent, a.DataReceived + b.DataReceived, a.FastRetransmissions + b.FastRetransmissions, a.Timeouts + b.Timeouts, a.CongestionMarks + b.CongestionMarks);
+
+        public override string ToString() => $"{nameof(PacketsSent)}={PacketsSent} {nameof(PacketsReceived)}={PacketsReceived} {nameof(PacketsDropped)}={PacketsDropped} {nameof(BytesSent)}={BytesSent} {nameof(BytesReceived)}={BytesReceived} "
+                                           + $"{nameof(DataSent)}={DataSent} {nameof(DataReceived)}={DataReceived} {nameof(FastRetransmissions)}={FastRetransmissions} {nameof(Timeouts)}={Timeouts} {nameof(CongestionMarks)}={CongestionMarks}";
+    }
+
     public class Peer
     {
         internal Peer(Host host, Protocol.Time time, in IPEndPoint endPoint, PeerMode mode)
@@ -34,6 +72,9 @@ internal Peer(Host host, Protocol.Time time, in IPEndPoint endPoint, PeerMode mo
             State = PeerState.Connecting;
             Mode = mode;
 
+            if (host.Instrumented)
+                RoundTripTimes = new Histogram();
+
             lastOrdinalWindowTimesAdjustment = time;
         }
 
@@ -54,6 +95,17 @@ internal Peer(Host host, Protocol.Time time, in IPEndPoint endPoint, PeerMode mo
         internal volatile Peer Next;
         internal Peer Prev;
 
+        /// <summary>
+        /// Shard in charge of this peer. Assigned when the peer is added to the internal connections of the host.
+        /// </summary>
+        internal Host.Shard Shard;
+
+        /// <summary>
+        /// Socket connected to this peer or null if the peer uses the shard socket. 
+        /// Owned by the worker thread of the shard (see <see cref="Host.Settings.ConnectedSockets"/>).
+        /// </summary>
+        internal Sockets.Socket Socket;
+
         public readonly Host Host;
         public readonly IPEndPoint EndPoint;
 
@@ -84,23 +136,58 @@ public int MaxTransmissionBacklog
         }
 
         private ushort maxTransmissionUnit;
+
+        /// <summary>
+        /// Maximum size in bytes of the packets currently sent to the remote host. Assigning a value sets the MTU 
+        /// negotiated in the handshake. If path MTU discovery is in effect (see <see cref="PathMtuDiscovery"/>) 
+        /// packets start at <see cref="Protocol.MTU.Default"/> and may grow up to the negotiated MTU as the path allows.
+        /// </summary>
         public ushort MaxTransmissionUnit
         {
             get => maxTransmissionUnit;
+            internal set => SetTransmissionUnit(value, false);
+        }
 
-            internal set
-            {
-                maxTransmissionUnit = value;
-                MaxSegmentSize = Protocol.Segment.Size.MaxValue(value, Secure);
-                MaxFragmentSize = Protocol.Fragment.Size.MaxValue(value, Secure);
-
-                Debug.Assert(MaxFragmentSize >= Protocol.Fragment.Size.MinValue, $"Maximum fragment size must be greater than or equal to {Protocol.Fragment.Size.MinValue} bytes.");
-                Debug.Assert(MaxFragmentSize < MaxSegmentSize, "Maximum fragment must be less than maximum segment size.");
+        /// <summary>
+        /// True if both this host and the remote host advertised path MTU discovery in the handshake 
+        /// (see <see cref="Host.PathMtuDiscovery"/>).
+        /// </summary>
+        public bool PathMtuDiscovery { get; private set; }
 
-                InitialCongestionWindow = (ushort)Min(65535, (Protocol.FastRetransmit.Threshold + 1) * MaxSegmentSize);
-            }
+        private void SetTransmissionUnit(ushort value, bool pmtud)
+        {
+            // Fragments must be sized the same way by both ends. With path MTU discovery both ends size them for no more than 
+            // the default MTU so that any fragmented message still fits if packets must shrink. Otherwise, as with any host 
+            // unaware of path MTU discovery, they are sized for the negotiated MTU.
+            var mtu = pmtud ? (ushort)Min(value, Protocol.MTU.Default) : value;
+
+            PathMtuDiscovery = pmtud;
+            NegotiatedTransmissionUnit = value;
+            baseTransmissionUnit = mtu;
+            maxTransmissionUnit = mtu;
+            MaxSegmentSize = Protocol.Segment.Size.MaxValue(mtu, Secure);
+            MaxFragmentSize = Protocol.Fragment.Size.MaxValue(mtu, Secure);
+
+            Debug.Assert(MaxFragmentSize >= Protocol.Fragment.Size.MinValue, $"Maximum fragment size must be greater than or equal to {Protocol.Fragment.Size.MinValue} bytes.");
+            Debug.Assert(MaxFragmentSize < MaxSegmentSize, "Maximum fragment must be less than maximum segment size.");
+
+            InitialCongestionWindow = (ushort)Min(65535, (Protocol.FastRetransmit.Threshold + 1) * MaxSegmentSize);
         }
 
+        /// <summary>
+        /// MTU negotiated in the handshake. Upper bound of <see cref="MaxTransmissionUnit"/>.
+        /// </summary>
+        internal ushort NegotiatedTransmissionUnit { get; private set; }
+
+        /// <summary>
+        /// Packet size that does not depend on path MTU discovery. Packets never shrink below this.
+        /// </summary>
+        private ushort baseTransmissionUnit;
+
+        /// <summary>
+        /// Maximum size of an unfragmented segment. With path MTU discovery this is sized for the packets the peer starts with 
+        /// and does not grow with them so that any segment still fits if packets must shrink again. Larger packets just carry more segments.
+        /// </summary>
         public ushort MaxSegmentSize { get; private set; }
         public ushort MaxFragmentSize { get; private set; }
 
@@ -129,8 +216,7 @@ private void SetMaxChannel(byte mtc, Protocol.Time remoteTime)
 
         #region Events  
 
-        private SpinLock eventsLock = new SpinLock(false);
-        private Queue<Event> events = new Queue<Event>();
+        private ConcurrentRing<Event> events = new ConcurrentRing<Event>(8);
 
         /// <summary>
         /// Retrieve an event from the queue. 
@@ -141,19 +227,11 @@ private void SetMaxChannel(byte mtc, Protocol.Time remoteTime)
         /// </summary>
         internal void Dequeue(out Event e)
         {
-            var locked = false;
-            try
-            {
-                eventsLock.Enter(ref locked);
-
-                Debug.Assert(events.Count > 0, "Peer must have one or more events in the queue.");
-                e = events.Dequeue();
-            }
-            finally
-            {
-                if (locked)
-                    eventsLock.Exit(false);
-            }
+            // An event added by another thread may still be in the course of being written ahead 
+            // of the one that caused this peer to be retrieved. Wait for it.
+            var spinner = new SpinWait();
+            while (!events.TryDequeue(out e))
+                spinner.SpinOnce();
         }
 
         /// <summary>
@@ -161,20 +239,7 @@ internal void Dequeue(out Event e)
         /// guarantee that for every occurance of a peer in the host event queue 
         /// there's going to be an event in that peer's event queue.
         /// </summary>
-        internal void Enqueue(in Event e)
-        {
-            var locked = false;
-            try
-            {
-                eventsLock.Enter(ref locked);
-                events.Enqueue(e);
-            }
-            finally
-            {
-                if (locked)
-                    eventsLock.Exit(false);
-            }
-        }
+        internal void Enqueue(in Event e) => events.Enqueue(in e);
 
         #endregion
 
@@ -189,11 +254,24 @@ internal void Enqueue(in Event e)
 
         private uint roundTripTimeVariance;
 
+        /// <summary>
+        /// Histogram of the round trip time in microseconds of every acknowledgement received from the remote host 
+        /// if the host is instrumented (see <see cref="Host.Settings.Instrumentation"/>); otherwise null. 
+        /// Values are multiples of 1000 as protocol timestamps have a resolution of one millisecond.
+        /// </summary>
+        public Histogram RoundTripTimes { get; }
+
         /// <summary>
         /// Latest remote time received
         /// </summary>
         internal Protocol.Time LatestRemoteTime;
 
+        /// <summary>
+        /// Local address (with port zero) the latest packet from the remote host was received on or default if unknown. 
+        /// Packets to the remote host are sent from this address (see <see cref="Host.Settings.MultiHoming"/>).
+        /// </summary>
+        internal IPEndPoint LocalEndPoint;
+
         /// <summary>
         /// Receive window advertised to the remote host.
         /// </summary>
@@ -244,6 +322,12 @@ internal void Enqueue(in Event e)
         /// </summary>
         public int SendWindow { get; private set; }
 
+        /// <summary>
+        /// Rate in bytes per second at which packets are released when the host paces its output (see <see cref="Host.Settings.Pacing"/>). 
+        /// A whole <see cref="CongestionWindow"/> is spread over a round trip but never faster than <see cref="RemoteBandwidth"/>.
+        /// </summary>
+        public uint PacingRate { get; private set; }
+
         /// <summary>
         /// Number of bytes sent but not yet acknowledged.
         /// </summary>
@@ -316,6 +400,14 @@ internal void Enqueue(in Event e)
         internal long timeouts;
         public long Timeouts => Interlocked.Read(ref timeouts);
 
+        /// <summary>
+        /// Number of packets received from the remote host marked congestion experienced by the network.
+        /// </summary>
+        internal long congestionMarks;
+        public long CongestionMarks => Interlocked.Read(ref congestionMarks);
+
+        public PeerCounters Counters => new PeerCounters(PacketsSent, PacketsReceived, PacketsDropped, BytesSent, BytesReceived, DataSent, DataReceived, FastRetransmissions, Timeouts, CongestionMarks);
+
         /// <summary>
         /// Estimated rate of packet loss. This is an aproximation because the only way to determine 
         /// the exact packet loss is to inspect the network from both endpoints simulateneously.
@@ -326,6 +418,11 @@ internal void Enqueue(in Event e)
 
         private (Command Command, Protocol.Time AcceptanceTime, Acknowledgment Ack, Protocol.Time AcknowledgedTime) control;
 
+        /// <summary>
+        /// Latest cookie received in a CHALLENGE to be echoed back in every CONNECT from now on.
+        /// </summary>
+        private (Protocol.Time Time, uint Tag)? cookie;
+
         /// <summary>
         /// Asynchronously send a connect packet.
         /// </summary>
@@ -398,6 +495,12 @@ private void OnAckReceived(Protocol.Time time, Protocol.Time acknowledgedTime)
         {
             var rtt = (uint)(time - acknowledgedTime);
 
+            if (RoundTripTimes != null)
+            {
+                RoundTripTimes.Record(rtt * 1000L);
+                Shard?.Latencies?.RoundTrip.Record(rtt * 1000L);
+            }
+
             // Update roundtrip time following Jacobson/Karels's algorithm
             if (RoundTripTime == 0)
             {
@@ -441,6 +544,10 @@ private void OnAckTimeout(Protocol.Time time)
             {
                 // Reset RTT estimate as it's probably too wrong now
                 RoundTripTime = 0;
+
+                // Packets may have become too large for the path (black hole).
+                if (maxTransmissionUnit > baseTransmissionUnit)
+                    OnBlackHole(time);
             }
 
             // If there's a control command waiting for an ack, flag it for retransmission otherwise set every channel to retransmit. 
@@ -504,6 +611,20 @@ internal void OnConnecting(Protocol.Time time)
             Connect();
         }
 
+        /// <summary>
+        /// The remote host requires a cookie to accept the connection. The connection request is sent again right 
+        /// away with the cookie and the ack timer restarted as this is an answer and not a timeout.
+        /// </summary>
+        internal void OnChallenged(Protocol.Time cookieTime, uint tag)
+        {
+            if (control.Command.Contains(Command.Connect))
+            {
+                cookie = (cookieTime, tag);
+                control.Command |= Command.Transmit;
+                ackDeadline = default;
+            }
+        }
+
         internal void OnAccepting(Protocol.Time time, Protocol.Time remoteTime, uint remoteSession, in Protocol.Message.Connect connect)
         {
             Session.State = Protocol.State.Accepting;
@@ -512,6 +633,7 @@ internal void OnAccepting(Protocol.Time time, Protocol.Time remoteTime, uint rem
 
             SetMaxChannel(connect.MaximumTransmissionChannel, remoteTime);
 
+            SetTransmissionUnit(connect.MaximumTransmissionUnit, Host.PathMtuDiscovery && connect.PathMtuDiscovery);
             RemoteBandwidth = connect.MaximumBandwidth >> 3;
             CongestionWindow = InitialCongestionWindow;
 
@@ -535,7 +657,7 @@ internal void OnCrossConnecting(Protocol.Time time, Protocol.Time remoteTime, ui
 
             SetMaxChannel(connect.MaximumTransmissionChannel, remoteTime);
 
-            MaxTransmissionUnit = connect.MaximumTransmissionUnit;            
+            SetTransmissionUnit(connect.MaximumTransmissionUnit, Host.PathMtuDiscovery && connect.PathMtuDiscovery);
             RemoteBandwidth = connect.MaximumBandwidth >> 3;
             CongestionWindow = InitialCongestionWindow;
 
@@ -551,7 +673,7 @@ internal void OnConnected(Protocol.Time time, Protocol.Time remoteTime, uint rem
 
             SetMaxChannel(accept.MaximumTransmissionChannel, remoteTime);
 
-            MaxTransmissionUnit = accept.MaximumTransmissionUnit;
+            SetTransmissionUnit(accept.MaximumTransmissionUnit, Host.PathMtuDiscovery && accept.PathMtuDiscovery);
             RemoteBandwidth = accept.MaximumBandwidth >> 3;
             CongestionWindow = InitialCongestionWindow;
 
@@ -559,6 +681,8 @@ internal void OnConnected(Protocol.Time time, Protocol.Time remoteTime, uint rem
 
             control.Command = default;
             OnAckMatched(time, accept.AcknowledgedTime);
+
+            StartProbing(time);
         }
 
         internal void OnAccepted(Protocol.Time time, Protocol.Time acknowledgedTime)
@@ -569,6 +693,8 @@ internal void OnAccepted(Protocol.Time time, Protocol.Time acknowledgedTime)
         
             control.Command = default;
             OnAckMatched(time, acknowledgedTime);
+
+            StartProbing(time);
         }
 
         private void OnUpdate(Protocol.Time time)
@@ -628,6 +754,8 @@ internal void OnConnectedUpdate(Protocol.Time time)
             // Maximum number of user data bytes that can be in flight this frame.
             SendWindow = (ushort)Min(bwnd, Max(MaxSegmentSize, Min(Host.Upstream.BufferShare, CongestionWindow, RemoteWindow)));
 
+            PacingRate = (RoundTripTime > 0) ? (uint)Min(RemoteBandwidth, (long)CongestionWindow * 1000 / RoundTripTime) : RemoteBandwidth;
+
             // Flush messages sent by the user thread, if any, and updates the list of channels to send.
             mediator.Flush(channels, ref channels[currentChannelIndex]);
         }
@@ -713,6 +841,18 @@ public void Send(byte[] data, int offset, int length, in Protocol.QoS qos, byte
             }            
         }
 
+        /// <summary>
+        /// Value of the MBW field of a CONNECT. Only carries <see cref="Protocol.MTU.Probe.Flag"/> if this host performs path MTU discovery 
+        /// and has no bandwidth limit so that a remote host unaware of the flag, which clamps the field, still reads the same bandwidth.
+        /// </summary>
+        private uint ConnectBandwidth => Host.PathMtuDiscovery && Host.MaxBandwidth == Protocol.Bandwidth.MaxValue ? Host.MaxBandwidth | Protocol.MTU.Probe.Flag : Host.MaxBandwidth;
+
+        /// <summary>
+        /// Value of the MBW field of an ACCEPT. Only carries <see cref="Protocol.MTU.Probe.Flag"/> if the CONNECT it answers carried the flag 
+        /// as well (see <see cref="PathMtuDiscovery"/>) so it never reaches a remote host unaware of it.
+        /// </summary>
+        private uint AcceptBandwidth => PathMtuDiscovery ? Host.MaxBandwidth | Protocol.MTU.Probe.Flag : Host.MaxBandwidth;
+
         /// <summary>
         /// Send connection handshake packets. 
         /// Returns true if a packet was written and must be transmitted; otherwise false (yielding to the next peer).
@@ -731,7 +871,7 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
 
                     // There's no need to reserve space for the checksum because a CONNECT 
                     // (secure or insecure) must be way below the minimum MTU.
-                    packet.Reset(MaxTransmissionUnit);
+                    packet.Reset(packet.Offset, MaxTransmissionUnit);
 
                     if (Session.Options.Contains(SessionOptions.Secure))
                     {
@@ -740,7 +880,7 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
                         packet.UncheckedWrite(Session.Local);
                         packet.UncheckedWrite(Host.MaxTransmissionUnit);
                         packet.UncheckedWrite(Host.MaxChannel);
-                        packet.UncheckedWrite(Host.MaxBandwidth);
+                        packet.UncheckedWrite(ConnectBandwidth);
                         packet.UncheckedWrite(in Host.Keys.Public);
                     }
                     else
@@ -750,7 +890,13 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
                         packet.UncheckedWrite(Session.Local);
                         packet.UncheckedWrite(Host.MaxTransmissionUnit);
                         packet.UncheckedWrite(Host.MaxChannel);
-                        packet.UncheckedWrite(Host.MaxBandwidth);
+                        packet.UncheckedWrite(ConnectBandwidth);
+                    }
+
+                    if (cookie.HasValue)
+                    {
+                        packet.UncheckedWrite(cookie.Value.Time);
+                        packet.UncheckedWrite(cookie.Value.Tag);
                     }
 
                     packet.UncheckedWrite(Protocol.Packet.Insecure.Checksum.Compute(packet.Buffer, packet.Offset, packet.Count));
@@ -768,7 +914,7 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
 
                     // There's no need to reserve space for the checksum (or nonce/mac) because an ACCEPT
                     // (secure or insecure) must be way below the minimum MTU.
-                    packet.Reset(MaxTransmissionUnit);
+                    packet.Reset(packet.Offset, MaxTransmissionUnit);
 
                     if (Session.Options.Contains(SessionOptions.Secure))
                     {
@@ -777,7 +923,7 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
                         packet.UncheckedWrite(Session.Local);
                         packet.UncheckedWrite(Host.MaxTransmissionUnit);
                         packet.UncheckedWrite(Host.MaxChannel);
-                        packet.UncheckedWrite(Host.MaxBandwidth);
+                        packet.UncheckedWrite(AcceptBandwidth);
                         packet.UncheckedWrite(control.AcceptanceTime);
 
                         var (buffer, offset, position, count) = (packet.Buffer, packet.Offset, packet.Position, sizeof(ushort));
@@ -800,7 +946,7 @@ internal bool OnConnectingSend(uint time, BinaryWriter packet)
                         packet.UncheckedWrite(Session.Local);
                         packet.UncheckedWrite(Host.MaxTransmissionUnit);
                         packet.UncheckedWrite(Host.MaxChannel);
-                        packet.UncheckedWrite(Host.MaxBandwidth);
+                        packet.UncheckedWrite(AcceptBandwidth);
                         packet.UncheckedWrite(control.AcceptanceTime);
                         packet.UncheckedWrite(ReceiveWindow);
                         packet.UncheckedWrite(Session.Remote);
@@ -835,22 +981,7 @@ void EnsureDataPacketIsCreated()
                 if (!created)
                 {
                     created = true;
-
-                    if (Session.Options.Contains(SessionOptions.Secure))
-                    {
-                        packet.Reset(MaxTransmissionUnit - (Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size));
-                        packet.UncheckedWrite(time);
-                        packet.UncheckedWrite(Protocol.PacketFlags.Secure | Protocol.PacketFlags.Data);
-                        packet.UncheckedWrite(ReceiveWindow);
-                    }
-                    else
-                    {
-                        packet.Reset(MaxTransmissionUnit - Protocol.Packet.Insecure.Checksum.Size);
-                        packet.UncheckedWrite(time);
-                        packet.UncheckedWrite(Protocol.PacketFlags.Data);
-                        packet.UncheckedWrite(Session.Local);
-                        packet.UncheckedWrite(ReceiveWindow);
-                    }
+                    BeginDataPacket(time, packet, MaxTransmissionUnit);
                 }
             }
 
@@ -868,6 +999,24 @@ void EnsureDataPacketIsCreated()
                 default:
                     break;
             }
+
+            // Send probe ack
+            if (probeAck > 0)
+            {
+                EnsureDataPacketIsCreated();
+                packet.UncheckedWrite(Protocol.MessageFlags.Ack | Protocol.MessageFlags.Probe);
+                packet.UncheckedWrite(probeAck);
+                probeAck = 0;
+            }
+
+            // Send congestion ack
+            if (congestionCount != congestionEchoed)
+            {
+                EnsureDataPacketIsCreated();
+                packet.UncheckedWrite(Protocol.MessageFlags.Ack | Protocol.MessageFlags.Congestion);
+                packet.UncheckedWrite(congestionCount);
+                congestionEchoed = congestionCount;
+            }
             
             if((uint)sendCapacity > 0) // Send both data and acks
             {
@@ -1055,7 +1204,7 @@ void EnsureDataPacketIsCreated()
                             switch (transmit.Delivery)
                             {
                                 case Protocol.Delivery.Unreliable:
-                                    var position = packet.Count + 2;
+                                    var position = packet.Position + 2;
                                     packet.UncheckedWrite(transmit.Encoded, 0, length);
                                     packet.UncheckedOverwrite(seq, position);
                                     packet.UncheckedOverwrite(channel.TX.NextReliableSequenceNumber, position + 2);
@@ -1121,7 +1270,7 @@ void EnsureDataPacketIsCreated()
                         {
                             EnsureDataPacketIsCreated();
 
-                            var encoder = Host.WorkerEncoder;
+                            var encoder = Shard.Encoder;
                             encoder.Reset();
                             encoder.Ensure(sizeof(Protocol.MessageFlags) + Protocol.Message.Segment.MinSize);
                             encoder.UncheckedWrite(Protocol.MessageFlags.Reliable | Protocol.MessageFlags.Data | Protocol.MessageFlags.Segment);
@@ -1221,28 +1370,56 @@ void EnsureDataPacketIsCreated()
             }
 
             if (created)
+                EndDataPacket(time, packet);
+
+            return created;
+        }
+
+        /// <summary>
+        /// Reset <paramref name="packet"/> to hold a data packet of at most <paramref name="size"/> bytes and write the packet header.
+        /// </summary>
+        private void BeginDataPacket(uint time, BinaryWriter packet, int size)
+        {
+            if (Session.Options.Contains(SessionOptions.Secure))
             {
-                if (Session.Options.Contains(SessionOptions.Secure))
-                {
-                    var nonce64 = ++Session.Nonce;
-                    var nonce = new Nonce(time, nonce64);
-                    var (buffer, position, count) = (packet.Buffer, packet.Offset + Protocol.Packet.Header.Size, packet.Count - Protocol.Packet.Header.Size);
-                    Session.Cipher.EncryptInPlace(buffer, position, count, in nonce);
-                    Session.Cipher.Sign(packet.Buffer, packet.Offset, Protocol.Packet.Header.Size, count, in nonce, out Mac mac);
-                    packet.Expand(Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size);
-                    packet.UncheckedWrite(nonce64);
-                    packet.UncheckedWrite(in mac);
-                }
-                else
-                {
-                    var (buffer, offset, count) = (packet.Buffer, packet.Offset, packet.Count);
-                    var crc = Protocol.Packet.Insecure.Checksum.Compute(buffer, offset, count);
-                    packet.Expand(Protocol.Packet.Insecure.Checksum.Size);
-                    packet.UncheckedWrite(crc);
-                }
+                packet.Reset(packet.Offset, size - (Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size));
+                packet.UncheckedWrite(time);
+                packet.UncheckedWrite(Protocol.PacketFlags.Secure | Protocol.PacketFlags.Data);
+                packet.UncheckedWrite(ReceiveWindow);
             }
+            else
+            {
+                packet.Reset(packet.Offset, size - Protocol.Packet.Insecure.Checksum.Size);
+                packet.UncheckedWrite(time);
+                packet.UncheckedWrite(Protocol.PacketFlags.Data);
+                packet.UncheckedWrite(Session.Local);
+                packet.UncheckedWrite(ReceiveWindow);
+            }
+        }
 
-            return created;
+        /// <summary>
+        /// Encrypt and sign (secure) or append the checksum (insecure) of a data packet started with <see cref="BeginDataPacket"/>.
+        /// </summary>
+        private void EndDataPacket(uint time, BinaryWriter packet)
+        {
+            if (Session.Options.Contains(SessionOptions.Secure))
+            {
+                var nonce64 = ++Session.Nonce;
+                var nonce = new Nonce(time, nonce64);
+                var (buffer, position, count) = (packet.Buffer, packet.Offset + Protocol.Packet.Header.Size, packet.Count - Protocol.Packet.Header.Size);
+                Session.Cipher.EncryptInPlace(buffer, position, count, in nonce);
+                Session.Cipher.Sign(packet.Buffer, packet.Offset, Protocol.Packet.Header.Size, count, in nonce, out Mac mac);
+                packet.Expand(Protocol.Packet.Secure.N64.Size + Protocol.Packet.Secure.Mac.Size);
+                packet.UncheckedWrite(nonce64);
+                packet.UncheckedWrite(in mac);
+            }
+            else
+            {
+                var (buffer, offset, count) = (packet.Buffer, packet.Offset, packet.Count);
+                var crc = Protocol.Packet.Insecure.Checksum.Compute(buffer, offset, count);
+                packet.Expand(Protocol.Packet.Insecure.Checksum.Size);
+                packet.UncheckedWrite(crc);
+            }
         }
 
         private Channel.Outbound.Message CreateSegment(BinaryWriter encoder, byte channel, Protocol.Delivery delivery, Protocol.Time expiration, byte[] data, int offset, ushort length)
@@ -1329,6 +1506,214 @@ private Channel.Outbound.Message CreatePing(BinaryWriter encoder)
 
         #endregion
 
+        #region Path MTU Discovery
+
+        /// <summary>
+        /// Largest packet size confirmed to reach the remote host.
+        /// </summary>
+        private ushort probeLow;
+
+        /// <summary>
+        /// Largest packet size that has not been found to be too large yet.
+        /// </summary>
+        private ushort probeHigh;
+
+        /// <summary>
+        /// Size of the probe waiting to be acknowledged or zero.
+        /// </summary>
+        private ushort probeSize;
+
+        /// <summary>
+        /// Number of times a probe of the current size has been sent.
+        /// </summary>
+        private byte probeAttempts;
+
+        /// <summary>
+        /// Time the latest probe was sent.
+        /// </summary>
+        private Protocol.Time probeTime;
+
+        /// <summary>
+        /// Time of the next probe or null if path MTU discovery is not in effect.
+        /// </summary>
+        private Protocol.Time? probeDeadline;
+
+        /// <summary>
+        /// Size of the latest probe received from the remote host to be acknowledged or zero.
+        /// </summary>
+        private ushort probeAck;
+
+        private void StartProbing(Protocol.Time time)
+        {
+            if (!PathMtuDiscovery || NegotiatedTransmissionUnit <= baseTransmissionUnit)
+                return;
+
+            probeLow = baseTransmissionUnit;
+            probeHigh = NegotiatedTransmissionUnit;
+            probeSize = 0;
+            probeAttempts = 0;
+            probeDeadline = time;
+        }
+
+        /// <summary>
+        /// Upper bound of the search imposed by the path MTU known by the platform. Only available if the peer has a connected socket.
+        /// </summary>
+        private ushort GetPathLimit()
+        {
+            var pmtu = Socket?.PathMtu ?? 0;
+            if (pmtu <= 0)
+                return NegotiatedTransmissionUnit;
+
+            var header = (EndPoint.Address.AddressFamily == System.Net.Sockets.AddressFamily.InterNetwork ? 20 : 40) + Protocol.UDP.Header.Size;
+            return (ushort)Max(baseTransmissionUnit, Min(NegotiatedTransmissionUnit, pmtu - header));
+        }
+
+        /// <summary>
+        /// Send a path MTU probe if one is due. The probe is a data packet padded to the size being tested that carries nothing else.
+        /// Returns true if a packet was written and must be transmitted; otherwise false.
+        /// </summary>
+        internal bool OnProbeSend(uint time, BinaryWriter packet)
+        {
+            if (!(probeDeadline <= time))
+                return false;
+
+            if (probeSize > 0 && probeAttempts >= Protocol.MTU.Probe.Attempts) // Too many probes of the same size lost.
+            {
+                probeHigh = (ushort)(probeSize - 1);
+                probeSize = 0;
+            }
+
+            if (probeSize == 0)
+            {
+                probeHigh = (ushort)Min(probeHigh, GetPathLimit());
+                if (probeHigh - probeLow < Protocol.MTU.Probe.Granularity)
+                {
+                    // Search complete. Try again later in case the path has changed.
+                    probeHigh = NegotiatedTransmissionUnit;
+                    probeDeadline = time + Protocol.MTU.Probe.Interval;
+                    return false;
+                }
+
+                probeSize = (ushort)((probeLow + probeHigh + 1) >> 1);
+                probeAttempts = 0;
+            }
+
+            probeAttempts++;
+            probeTime = time;
+            probeDeadline = time + Max(Protocol.MTU.Probe.Timeout, RoundTripTime << 1);
+
+            BeginDataPacket(time, packet, probeSize);
+            packet.UncheckedWrite(Protocol.MessageFlags.Probe);
+            packet.UncheckedWrite(probeSize);
+            packet.UncheckedWrite(0, packet.Available);
+            EndDataPacket(time, packet);
+
+            return true;
+        }
+
+        /// <summary>
+        /// The socket rejected the latest probe for being larger than the local interface allows.
+        /// </summary>
+        internal void OnProbeOversized()
+        {
+            if (probeSize == 0)
+                return;
+
+            probeHigh = (ushort)(probeSize - 1);
+            probeSize = 0;
+
+            // Move on to the next size right away.
+            probeDeadline = probeTime;
+        }
+
+        internal void OnProbe(ushort size) => probeAck = size;
+
+        internal void OnProbeAck(Protocol.Time time, ushort size)
+        {
+            if (probeSize == 0 || size != probeSize)
+                return;
+
+            probeLow = size;
+            probeSize = 0;
+            probeDeadline = time;
+
+            if (maxTransmissionUnit < size)
+                maxTransmissionUnit = size;
+        }
+
+        /// <summary>
+        /// Consecutive ack timeouts with packets larger than the base size. Fall back to the base size and search again 
+        /// below the size that may have stopped going through.
+        /// </summary>
+        private void OnBlackHole(Protocol.Time time)
+        {
+            probeHigh = (ushort)(maxTransmissionUnit - 1);
+            probeLow = baseTransmissionUnit;
+            probeSize = 0;
+            probeDeadline = time + Protocol.MTU.Probe.Timeout;
+
+            maxTransmissionUnit = baseTransmissionUnit;
+        }
+
+        #endregion
+
+        #region Congestion Notification
+
+        /// <summary>
+        /// Number of packets received marked congestion experienced (modulo 2^16) to be echoed to the remote host.
+        /// </summary>
+        private ushort congestionCount;
+
+        /// <summary>
+        /// Latest <see cref="congestionCount"/> echoed to the remote host.
+        /// </summary>
+        private ushort congestionEchoed;
+
+        /// <summary>
+        /// Latest count echoed by the remote host.
+        /// </summary>
+        private ushort congestionAcked;
+
+        /// <summary>
+        /// Time until which further congestion acks do not reduce the congestion window again.
+        /// </summary>
+        private Protocol.Time? congestionDeadline;
+
+        /// <summary>
+        /// A data packet from the remote host arrived marked congestion experienced by a router on the path.
+        /// </summary>
+        internal void OnCongestionExperienced()
+        {
+            congestionCount++;
+            Interlocked.Increment(ref congestionMarks);
+        }
+
+        /// <summary>
+        /// The remote host echoed the number of packets it has received marked congestion experienced. 
+        /// A mark indicates a queue building up so the reaction is the same as for a loss but without 
+        /// retransmitting anything and at most once per round trip as all marks in a window are due to the 
+        /// same congestion event.
+        /// </summary>
+        internal void OnCongestionAck(Protocol.Time time, ushort count)
+        {
+            // Ignore repeated or reordered acks.
+            var n = (ushort)(count - congestionAcked);
+            if (n == 0 || n > short.MaxValue)
+                return;
+
+            congestionAcked = count;
+
+            if (congestionDeadline > time)
+                return;
+
+            LinkCapacity = (ushort)Max(CongestionWindow >> 1, InitialCongestionWindow);
+            CongestionWindow = (ushort)Max(CongestionWindow >> 1, MaxSegmentSize);
+
+            congestionDeadline = time + (RoundTripTime > 0 ? RoundTripTime : ackTimeout);
+        }
+
+        #endregion
+
         #region Data Receiving 
 
         internal void OnReceive(Protocol.Time time, Protocol.Time remoteTime, in Protocol.Message.Ack ack)
@@ -2058,7 +2443,7 @@ internal void Dispose()
             StopTime = DateTime.Now;
 
             if (events != null)
-                foreach (var e in events)
+                while (events.TryDequeue(out Event e))
                     e.Dispose();
 
             if (channels != null)
@@ -2067,13 +2452,16 @@ internal void Dispose()
             
             RoundTripTime = default;
             RemoteWindow = default;
+            LocalEndPoint = default;
             RemoteBandwidth = default;
             LinkCapacity = ushort.MaxValue;
             CongestionWindow = default;
             SendWindow = default;
+            PacingRate = default;
             BytesInFlight = default;
 
             transmissionBacklog = 0;
+            cookie = default;
             events = null;
             channels = null;
         }
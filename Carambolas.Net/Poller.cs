@@ -0,0 +1,416 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace Carambolas.Net.Sockets
+{
+    /// <summary>
+    /// Waits for any of a number of sockets to become readable with a single operation.
+    /// </summary>
+    /// <remarks>
+    /// Readiness may be edge-triggered (a socket is only reported again after new data arrives) so 
+    /// the caller must receive from a ready socket until no data is immediately available before 
+    /// waiting again.
+    /// </remarks>
+    public sealed class Poller: IDisposable
+    {
+        private IPoller poller;
+
+        /// <summary>
+        /// Registered sockets indexed by token. Slots of removed sockets are null and reused.
+        /// </summary>
+        private readonly List<Socket> sockets = new List<Socket>();
+
+        private int[] tokens = Array.Empty<int>();
+
+        public int Count { get; private set; }
+
+        public Poller()
+        {
+#if USE_NATIVE_SOCKET
+            try
+            {
+                poller = new Native.Poller();
+            }
+            catch (DllNotFoundException)
+            {
+                poller = new Fallback.Poller();
+            }
+            catch (SocketException e) when (e.SocketErrorCode == SocketError.OperationNotSupported)
+            {
+                poller = new Fallback.Poller();
+            }
+#else
+            poller = new Fallback.Poller();
+#endif
+        }
+
+        public void Add(Socket socket)
+        {
+            if (socket == null)
+                throw new ArgumentNullException(nameof(socket));
+
+            if (sockets.Contains(socket))
+                throw new ArgumentException(SR.Poller.AlreadyRegistered, nameof(socket));
+
+#if USE_NATIVE_SOCKET
+            // In-process sockets have no descriptor to watch. The poller can still switch to 
+            // the fallback implementation as long as no other socket has been added yet.
+            if (socket.Implementation is Loopback.Socket && !(poller is Fallback.Poller) && Count == 0)
+            {
+                poller.Dispose();
+                poller = new Fallback.Poller();
+            }
+#endif
+
+            var token = sockets.IndexOf(null);
+            if (token < 0)
+            {
+                token = sockets.Count;
+                sockets.Add(socket);
+            }
+            else
+            {
+                sockets[token] = socket;
+            }
+
+            try
+            {
+                poller.Add(socket.Implementation, token);
+            }
+            catch
+            {
+                sockets[token] = null;
+                throw;
+            }
+
+            Count++;
+        }
+
+        public bool Remove(Socket socket)
+        {
+            if (socket == null)
+                throw new ArgumentNullException(nameof(socket));
+
+            var token = sockets.IndexOf(socket);
+            if (token < 0)
+                return false;
+
+            poller.Remove(socket.Implementation);
+            sockets[token] = null;
+            Count--;
+            return true;
+        }
+
+        /// <summary>
+        /// Waits up to <paramref name="microSeconds"/> for any registered socket to become readable. 
+        /// A negative value waits indefinitely.
+        /// </summary>
+        /// <returns>Number of ready sockets stored in <paramref name="ready"/>.</returns>
+        public int Wait(int microSeconds, Socket[] ready)
+        {
+            if (ready == null)
+                throw new ArgumentNullException(nameof(ready));
+
+            if (ready.Length == 0)
+                throw new ArgumentException(string.Format(SR.ArgumentIsLessThanMinimum, $"{nameof(ready)}.{nameof(ready.Length)}", 1), nameof(ready));
+
+            if (tokens.Length < ready.Length)
+                tokens = new int[ready.Length];
+
+            return Collect(poller.Wait(microSeconds, tokens, ready.Length), ready);
+        }
+
+        /// <summary>
+        /// Current time in nanoseconds of the monotonic clock used for deadlines. 
+        /// The origin is arbitrary so only differences are meaningful.
+        /// </summary>
+        public long Now => poller.Now;
+
+        /// <summary>
+        /// Waits until <paramref name="deadline"/> (see <see cref="Now"/>) for any registered socket to become readable. 
+        /// Returns immediately if the deadline has already passed. Where supported (timerfd on Linux) the deadline 
+        /// is enforced by a kernel timer so the wait is not extended by any delay before it actually starts.
+        /// </summary>
+        /// <returns>Number of ready sockets stored in <paramref name="ready"/>.</returns>
+        public int WaitUntil(long deadline, Socket[] ready)
+        {
+            if (ready == null)
+                throw new ArgumentNullException(nameof(ready));
+
+            if (ready.Length == 0)
+                throw new ArgumentException(string.Format(SR.ArgumentIsLessThanMinimum, $"{nameof(ready)}.{nameof(ready.Length)}", 1), nameof(ready));
+
+            if (tokens.Length < ready.Length)
+                tokens = new int[ready.Length];
+
+            return Collect(poller.WaitUntil(deadline, tokens, ready.Length), ready);
+        }
+
+        /// <summary>
+        /// Suspends the calling thread until <paramref name="deadline"/> (see <see cref="Now"/>) regardless of socket readiness.
+        /// </summary>
+        public void SleepUntil(long deadline) => poller.SleepUntil(deadline);
+
+        private int Collect(int n, Socket[] ready)
+        {
+            var count = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                var socket = sockets[tokens[i]];
+                if (socket != null)
+                    ready[count++] = socket;
+            }
+
+            return count;
+        }
+
+        public void Dispose() => poller.Dispose();
+    }
+
+    internal interface IPoller: IDisposable
+    {
+        void Add(ISocket socket, int token);
+
+        void Remove(ISocket socket);
+
+        int Wait(int microSeconds, int[] tokens, int count);
+
+        long Now { get; }
+
+        int WaitUntil(long deadline, int[] tokens, int count);
+
+        void SleepUntil(long deadline);
+    }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        public sealed class Poller: IPoller
+        {
+            private int handle;
+
+            /// <summary>
+            /// Timer registered with the poller to enforce deadlines or -1 if not supported by the platform.
+            /// </summary>
+            private int timer = -1;
+
+            public Poller()
+            {
+                var socketError = Native.OpenPoller(out handle);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                // Deadlines are converted to relative timeouts without a timer.
+                socketError = Native.OpenPollerTimer(handle, out timer);
+                if (socketError != SocketError.Success && socketError != SocketError.OperationNotSupported)
+                {
+                    Native.ClosePoller(handle);
+                    throw new SocketException((int)socketError);
+                }
+            }
+
+            public void Add(ISocket socket, int token)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (!(socket is Socket s))
+                    throw new NotSupportedException();
+
+                var socketError = Native.AddToPoller(handle, s.EventHandle, token);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+            }
+
+            public void Remove(ISocket socket)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (!(socket is Socket s))
+                    throw new NotSupportedException();
+
+                // A socket that has already been closed is automatically removed.
+                if (s.Handle < 0)
+                    return;
+
+                var socketError = Native.RemoveFromPoller(handle, s.EventHandle);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+            }
+
+            public int Wait(int microSeconds, int[] tokens, int count)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.WaitPoller(handle, microSeconds, tokens, count, out int nready);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nready;
+            }
+
+            public long Now => Native.GetClock();
+
+            public int WaitUntil(long deadline, int[] tokens, int count)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.WaitPollerUntil(handle, timer, deadline, tokens, count, out int nready);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nready;
+            }
+
+            public void SleepUntil(long deadline) => Native.SleepUntil(deadline);
+
+            public void Dispose()
+            {
+                OnDisposed(true);
+                GC.SuppressFinalize(this);
+            }
+
+            ~Poller() => OnDisposed(false);
+
+            private void OnDisposed(bool disposing)
+            {
+                var value = Interlocked.Exchange(ref handle, -1);
+                if (value < 0)
+                    return;
+
+                Native.ClosePollerTimer(timer);
+                timer = -1;
+
+                Native.ClosePoller(value);
+            }
+        }
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_open", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError OpenPoller(out int pollfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_close", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void ClosePoller(int pollfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_add", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError AddToPoller(int pollfd, int sockfd, int token);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_remove", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError RemoveFromPoller(int pollfd, int sockfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_wait", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError WaitPoller(int pollfd, int microSeconds, [Out] int[] tokens, int count, out int nready);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_timer_open", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError OpenPollerTimer(int pollfd, out int timerfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_timer_close", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void ClosePollerTimer(int timerfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_poller_wait_until", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError WaitPollerUntil(int pollfd, int timerfd, long deadline, [Out] int[] tokens, int count, out int nready);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_clock_now", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long GetClock();
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_clock_sleep_until", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SleepUntil(long deadline);
+    }
+#endif
+
+    internal static partial class Fallback
+    {
+        /// <summary>
+        /// Portable poller for platforms without a native readiness API. Level-triggered.
+        /// </summary>
+        public sealed class Poller: IPoller
+        {
+            /// <summary>
+            /// Maximum time in microseconds spent waiting on a single socket when there are several to watch.
+            /// </summary>
+            private const int Slice = 1000;
+
+            private readonly List<(ISocket Socket, int Token)> entries = new List<(ISocket, int)>();
+
+            public void Add(ISocket socket, int token) => entries.Add((socket, token));
+
+            public void Remove(ISocket socket)
+            {
+                for (int i = 0; i < entries.Count; ++i)
+                {
+                    if (entries[i].Socket == socket)
+                    {
+                        entries.RemoveAt(i);
+                        return;
+                    }
+                }
+            }
+
+            public int Wait(int microSeconds, int[] tokens, int count)
+            {
+                if (entries.Count == 0)
+                {
+                    if (microSeconds > 0)
+                        Thread.Sleep(microSeconds / 1000);
+
+                    return 0;
+                }
+
+                // A single socket can be polled directly for the whole timeout.
+                if (entries.Count == 1)
+                    return entries[0].Socket.Poll(microSeconds, SelectMode.SelectRead) ? Ready(0, tokens) : 0;
+
+                var start = Environment.TickCount;
+                while (true)
+                {
+                    var n = 0;
+                    for (int i = 0; i < entries.Count && n < count; ++i)
+                        if (entries[i].Socket.Available > 0)
+                            n = Ready(i, tokens, n);
+
+                    if (n > 0)
+                        return n;
+
+                    var remaining = (microSeconds < 0) ? Slice : microSeconds - (Environment.TickCount - start) * 1000;
+                    if (remaining <= 0)
+                        return 0;
+
+                    if (entries[0].Socket.Poll(Math.Min(remaining, Slice), SelectMode.SelectRead))
+                        return Ready(0, tokens);
+                }
+            }
+
+            private static readonly double TicksToNanosecondsFactor = 1000000000.0 / Stopwatch.Frequency;
+
+            public long Now => (long)(Stopwatch.GetTimestamp() * TicksToNanosecondsFactor);
+
+            public int WaitUntil(long deadline, int[] tokens, int count)
+            {
+                // Round up so that the deadline is never anticipated.
+                var remaining = deadline - Now;
+                return (remaining > 0) ? Wait((int)Math.Min(int.MaxValue, (remaining + 999) / 1000), tokens, count) : 0;
+            }
+
+            public void SleepUntil(long deadline)
+            {
+                var remaining = deadline - Now;
+                if (remaining > 0)
+                    Thread.Sleep((int)Math.Min(int.MaxValue, (remaining + 999999) / 1000000));
+            }
+
+            private int Ready(int index, int[] tokens, int n = 0)
+            {
+                tokens[n] = entries[index].Token;
+                return n + 1;
+            }
+
+            public void Dispose() => entries.Clear();
+        }
+    }
+}
@@ -146,6 +146,21 @@ public static class Timeout
                 {
                     public const uint Default = 30000;
                 }
+
+                /// <summary>
+                /// Connection requests that may be accepted in a row from a single source end point when the rate of 
+                /// connection requests is limited (see <see cref="Host.Settings.ConnectionRate"/>). The default covers 
+                /// every retransmission of a single connection attempt (see <see cref="Ack.Fail.Default"/>).
+                /// </summary>
+                public static class Burst
+                {
+                    public const int Default = 10;
+
+                    public const int MinValue = 1;
+                    public const int MaxValue = 65535;
+
+                    public static int Clamp(int value) => Math.Max(MinValue, Math.Min(value, MaxValue));
+                }
             }
 
             public static class Ack
@@ -230,6 +245,40 @@ public static class MTU
             public const ushort MaxValue = 65535;
 
             public static ushort Clamp(ushort value) => Math.Max(MinValue, Math.Min(value, MaxValue));
+
+            /// <summary>
+            /// Path MTU discovery parameters (see <see cref="Host.Settings.PathMtuDiscovery"/>).
+            /// </summary>
+            public static class Probe
+            {
+                /// <summary>
+                /// Number of consecutive probes of the same size that may go unacknowledged before the size is considered too large.
+                /// </summary>
+                public const int Attempts = 3;
+
+                /// <summary>
+                /// Minimum time in milliseconds to wait for a probe to be acknowledged.
+                /// </summary>
+                public const uint Timeout = 1000;
+
+                /// <summary>
+                /// The search stops when the largest size confirmed is less than this many bytes 
+                /// below the smallest size known to be too large.
+                /// </summary>
+                public const ushort Granularity = 16;
+
+                /// <summary>
+                /// Time in milliseconds after which a complete search is resumed to detect a path MTU increase.
+                /// </summary>
+                public const uint Interval = 600000;
+
+                /// <summary>
+                /// Bit of the MBW field of a CONNECT or ACCEPT set by a host that performs path MTU discovery. Never part of a valid 
+                /// bandwidth (see <see cref="Bandwidth.MaxValue"/>) so a host unaware of it clamps the field to <see cref="Bandwidth.MaxValue"/>. 
+                /// That is why a CONNECT only carries it if the source has no bandwidth limit anyway and an ACCEPT only if the CONNECT did.
+                /// </summary>
+                public const uint Flag = 0x80000000;
+            }
         }
 
         /// <summary>
@@ -291,15 +340,68 @@ public static class Mac
                 }
             }
 
+            /// <summary>
+            /// Connection cookie sent in a CHALLENGE and echoed back in a CONNECT. The cookie time (CTM) is the source time 
+            /// of the CHALLENGE so that a CHALLENGE is never larger than the CONNECT it answers and cannot be used for 
+            /// amplification. The tag has 32 bits like a TCP SYN cookie; a blind guess is unlikely to succeed before the 
+            /// cookie expires.
+            /// </summary>
+            public static class Cookie
+            {
+                public const int Size = 8; // CTM(4) TAG(4)
+
+                /// <summary>
+                /// Maximum age in milliseconds of a cookie accepted by a host. A connection request with an expired 
+                /// cookie is challenged again so this only has to cover a few retransmissions.
+                /// </summary>
+                public const uint LifeTime = 10000;
+            }
+
             public static class Insecure
             {
                 public static class Checksum
                 {
                     public const int Size = Crc32C.Size;
 
+#if USE_NATIVE_SOCKET
+                    internal static Crc32C Compute(byte[] buffer, int offset, int length) => Native.Checksum.IsSupported ? Native.Checksum.Compute(buffer, offset, length) : Crc32C.Compute(buffer, offset, length);
+
+                    internal static bool Verify(byte[] buffer, int offset, int length) => Native.Checksum.IsSupported ? Native.Checksum.Verify(buffer, offset, length) : Crc32C.Verify(buffer, offset, length);
+
+                    /// <summary>
+                    /// Drop received insecure packets with an invalid checksum by setting their lengths to zero
+                    /// if supported by the native library; otherwise do nothing. On return <paramref name="dropped"/> 
+                    /// holds the number of packets dropped.
+                    /// </summary>
+                    /// <returns>True if checksums have been verified; otherwise false.</returns>
+                    internal static bool Filter(byte[] buffer, int offset, int stride, int count, int[] lengths, out int dropped)
+                    {
+                        if (Native.Checksum.IsSupported)
+                        {
+                            dropped = Native.Checksum.Filter(buffer, offset, stride, count, lengths);
+                            return true;
+                        }
+
+                        dropped = 0;
+                        return false;
+                    }
+#else
                     internal static Crc32C Compute(byte[] buffer, int offset, int length) => Crc32C.Compute(buffer, offset, length);
 
                     internal static bool Verify(byte[] buffer, int offset, int length) => Crc32C.Verify(buffer, offset, length);
+
+                    internal static bool Filter(byte[] buffer, int offset, int stride, int count, int[] lengths, out int dropped)
+                    {
+                        dropped = 0;
+                        return false;
+                    }
+#endif
+
+                    /// <summary>
+                    /// Verify a received packet unless its checksum has already been <paramref name="verified"/> 
+                    /// by the admission filter applied to the batch it was received in.
+                    /// </summary>
+                    internal static bool VerifyFiltered(byte[] buffer, int offset, int length, bool verified) => verified || Verify(buffer, offset, length);
                 }
             }
         }
@@ -659,6 +761,7 @@ internal enum PacketFlags: byte
         {
             None = 0x00,
             Accept = 0x0A,
+            Challenge = 0x0B,
             Connect = 0x0C,
             Data = 0x0D,
             Reset = 0x0F,
@@ -682,7 +785,13 @@ internal enum MessageFlags: byte
             Segment = 0x00,
             Fragment = 0x10,
             Data = 0x20,
-            Reliable = 0x40
+            Reliable = 0x40,
+
+            // Probe flags ({Probe} => path MTU probe, {Ack | Probe} => probe ack)
+            Probe = 0x01,
+
+            // Congestion flags ({Ack | Congestion} => congestion ack)
+            Congestion = 0x04
         }
 
         internal static class Message
@@ -698,11 +807,14 @@ internal static class Message
 
                 public readonly uint MaximumBandwidth;
 
-                public Connect(ushort mtu, byte mtc, uint mbw)
+                public readonly bool PathMtuDiscovery;
+
+                public Connect(ushort mtu, byte mtc, uint mbw, bool pmtud)
                 {
                     MaximumTransmissionUnit = mtu;
                     MaximumTransmissionChannel = mtc;
                     MaximumBandwidth = mbw;
+                    PathMtuDiscovery = pmtud;
                 }
             }
 
@@ -724,12 +836,36 @@ public static class Ack
 
                 public readonly uint AcknowledgedTime;
 
-                public Accept(ushort mtu, byte mtc, uint mbw, uint atm)
+                public readonly bool PathMtuDiscovery;
+
+                public Accept(ushort mtu, byte mtc, uint mbw, uint atm, bool pmtud)
                 {
                     MaximumTransmissionUnit = mtu;
                     MaximumTransmissionChannel = mtc;
                     MaximumBandwidth = mbw;
                     AcknowledgedTime = atm;
+                    PathMtuDiscovery = pmtud;
+                }
+            }
+
+            internal static class Probe
+            {
+                /// <summary>
+                /// Size of the message parameters not counting flags and padding.
+                /// </summary>
+                public const int Size = 2; // SIZE(2)
+
+                internal static class Ack
+                {
+                    public const int Size = 2; // SIZE(2)
+                }
+            }
+
+            internal static class Congestion
+            {
+                internal static class Ack
+                {
+                    public const int Size = 2; // CNT(2)
                 }
             }
 
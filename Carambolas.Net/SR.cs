@@ -34,6 +34,11 @@ public static class Peer
             public const string TransmissionBacklogLimitExceeded = "Transmission backlog limit exceeded";
         }
 
+        public static class Poller
+        {
+            public const string AlreadyRegistered = "Socket already registered";
+        }
+
         public static class Socket
         {
             public const string AddressFamilyNotSupported = "Address family not supported: {0}";
@@ -13,6 +13,63 @@ public enum TOS: byte
         LowCost = 0x02
     }
 
+    /// <summary>
+    /// Explicit congestion notification codepoint carried in the two least significant bits of the 
+    /// IPv4 TOS byte or the IPv6 traffic class (RFC 3168).
+    /// </summary>
+    public enum ECN: byte
+    {
+        NotCapable = 0x00,
+        Capable1 = 0x01,
+        Capable0 = 0x02,
+        CongestionExperienced = 0x03
+    }
+
+    /// <summary>
+    /// How the platform paces outgoing datagrams.
+    /// </summary>
+    public enum Pacing
+    {
+        /// <summary>
+        /// Datagrams leave as soon as possible.
+        /// </summary>
+        None = 0,
+
+        /// <summary>
+        /// Each datagram may carry its own launch time (SO_TXTIME) honored by a time-aware queueing discipline 
+        /// such as fq or etf on Linux.
+        /// </summary>
+        LaunchTime = 1,
+
+        /// <summary>
+        /// The socket as a whole is paced at a maximum rate (SO_MAX_PACING_RATE) by the fq queueing discipline on Linux.
+        /// </summary>
+        Rate = 2
+    }
+
+    /// <summary>
+    /// UDP offloads that may be delegated to the platform.
+    /// </summary>
+    [Flags]
+    public enum Offload
+    {
+        None = 0,
+
+        /// <summary>
+        /// Consecutive datagrams of the same size to the same destination are handed to the 
+        /// network stack as a single buffer that is segmented by the kernel or the network device (GSO).
+        /// </summary>
+        Segmentation = 1,
+
+        /// <summary>
+        /// Consecutive datagrams of the same size from the same source may be delivered by the 
+        /// network stack as a single buffer that is split back into datagrams before it reaches the caller (GRO).
+        /// </summary>
+        Coalescing = 2,
+
+        All = Segmentation | Coalescing
+    }
+
     public sealed partial class Socket: IDisposable
     {
         [StructLayout(LayoutKind.Auto)]
@@ -31,7 +88,62 @@ public sealed partial class Socket: IDisposable
             public readonly byte TTL;
             public readonly TOS TOS;
 
-            public Settings(int sendBufferSize, int receiveBufferSize, int sendTimeout, int receiveTimeout, byte ttl = Protocol.TTL.Default, SocketMode mode = default, TOS tos = TOS.LowDelay)
+            public readonly Offload Offload;
+
+            /// <summary>
+            /// Allow other sockets with the same option to bind to the same end point and have incoming 
+            /// datagrams distributed among them (SO_REUSEPORT). Ignored where not supported.
+            /// </summary>
+            public readonly bool ReusePort;
+
+            /// <summary>
+            /// Have the kernel timestamp each datagram on arrival (SO_TIMESTAMPNS) so that its age 
+            /// can be reported by <see cref="ReceiveMany(byte[], int, int, int, IPEndPoint[], int[], int[])"/>. 
+            /// Ignored where not supported.
+            /// </summary>
+            public readonly bool Timestamping;
+
+            /// <summary>
+            /// Exchange datagrams through memory with other in-process sockets only (see <see cref="Loopback.Socket"/>) 
+            /// instead of the network. Intended for load generation and benchmarks.
+            /// </summary>
+            public readonly bool InProcess;
+
+            /// <summary>
+            /// Send every datagram with the don't fragment bit and leave path MTU estimation to the application 
+            /// (IP_PMTUDISC_PROBE on Linux) so that datagrams larger than the path MTU are dropped instead of 
+            /// fragmented and datagrams larger than the local interface MTU fail with <see cref="System.Net.Sockets.SocketError.MessageSize"/>. 
+            /// Ignored where not supported.
+            /// </summary>
+            public readonly bool MtuProbing;
+
+            /// <summary>
+            /// Send every datagram as ECN-capable (ECT(0)) so that routers with active queue management may mark it 
+            /// <see cref="ECN.CongestionExperienced"/> instead of dropping it, and report the ECN codepoint of each datagram 
+            /// received (IP_RECVTOS and IPV6_RECVTCLASS on Linux). Ignored where not supported.
+            /// </summary>
+            public readonly bool Ecn;
+
+            /// <summary>
+            /// Let the platform release datagrams at a later time so that a batch can be spread out instead of leaving in a 
+            /// burst (see <see cref="Sockets.Pacing"/>). Ignored where not supported.
+            /// </summary>
+            public readonly bool Pacing;
+
+            /// <summary>
+            /// Let the kernel transmit datagrams directly from the send buffer instead of copying them (SO_ZEROCOPY on Linux) 
+            /// when requested by the caller (see <see cref="Socket.ZeroCopy"/>). Ignored where not supported.
+            /// </summary>
+            public readonly bool ZeroCopy;
+
+            /// <summary>
+            /// Report the local address each datagram was received on and allow datagrams to be sent from a chosen local address 
+            /// (IP_PKTINFO and IPV6_RECVPKTINFO on Linux) so that a host bound to a wildcard address replies from the same address 
+            /// it was reached at. Ignored where not supported.
+            /// </summary>
+            public readonly bool PacketInformation;
+
+            public Settings(int sendBufferSize, int receiveBufferSize, int sendTimeout, int receiveTimeout, byte ttl = Protocol.TTL.Default, SocketMode mode = default, TOS tos = TOS.LowDelay, Offload offload = Offload.Segmentation, bool reusePort = false, bool timestamping = false, bool inProcess = false, bool mtuProbing = false, bool ecn = false, bool pacing = false, bool zeroCopy = false, bool packetInformation = false)
             {
                 Mode = mode;
 
@@ -43,6 +155,15 @@ public Settings(int sendBufferSize, int receiveBufferSize, int sendTimeout, int
 
                 TTL = ttl;
                 TOS = tos;
+                Offload = offload;
+                ReusePort = reusePort;
+                Timestamping = timestamping;
+                InProcess = inProcess;
+                MtuProbing = mtuProbing;
+                Ecn = ecn;
+                Pacing = pacing;
+                ZeroCopy = zeroCopy;
+                PacketInformation = packetInformation;
             }
         }
     }
@@ -1,4 +1,7 @@
 ﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
 using System.Net;
 using System.Net.Sockets;
 using System.Runtime.InteropServices;
@@ -23,6 +26,111 @@ public enum AddressMode
         Dual
     }
 
+    /// <summary>
+    /// Number of system calls, datagrams and bytes transferred by a socket and the reasons some of them failed.
+    /// <para/>
+    /// Layout matches the native stats block where receive and send counters occupy separate cache lines.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 128)]
+    public readonly struct SocketCounters
+    {
+        /// <summary>
+        /// System calls made to receive datagrams.
+        /// </summary>
+        [FieldOffset(0)]
+        public readonly long ReceiveCalls;
+
+        /// <summary>
+        /// Datagrams received including truncated datagrams.
+        /// </summary>
+        [FieldOffset(8)]
+        public readonly long Received;
+
+        /// <summary>
+        /// Bytes received excluding truncated datagrams.
+        /// </summary>
+        [FieldOffset(16)]
+        public readonly long ReceivedBytes;
+
+        /// <summary>
+        /// Datagrams discarded for being larger than the receive buffer.
+        /// </summary>
+        [FieldOffset(24)]
+        public readonly long Truncated;
+
+        /// <summary>
+        /// Datagrams dropped by the operating system because the socket receive buffer was full. 
+        /// Only available on Linux.
+        /// </summary>
+        [FieldOffset(32)]
+        public readonly long Overflows;
+
+        /// <summary>
+        /// Receive calls that found no datagram available.
+        /// </summary>
+        [FieldOffset(40)]
+        public readonly long ReceiveWouldBlock;
+
+        /// <summary>
+        /// Receive calls that failed for any other reason.
+        /// </summary>
+        [FieldOffset(48)]
+        public readonly long ReceiveErrors;
+
+        /// <summary>
+        /// System calls made to send datagrams.
+        /// </summary>
+        [FieldOffset(64)]
+        public readonly long SendCalls;
+
+        /// <summary>
+        /// Datagrams sent.
+        /// </summary>
+        [FieldOffset(72)]
+        public readonly long Sent;
+
+        /// <summary>
+        /// Bytes sent.
+        /// </summary>
+        [FieldOffset(80)]
+        public readonly long SentBytes;
+
+        /// <summary>
+        /// Send calls that failed because the socket send buffer was full.
+        /// </summary>
+        [FieldOffset(88)]
+        public readonly long SendWouldBlock;
+
+        /// <summary>
+        /// Send calls that failed for any other reason.
+        /// </summary>
+        [FieldOffset(96)]
+        public readonly long SendErrors;
+
+        public SocketCounters(long receiveCalls, long received, long receivedBytes, long truncated, long overflows, long receiveWouldBlock, long receiveErrors, long sendCalls, long sent, long sentBytes, long sendWouldBlock, long sendErrors)
+        {
+            ReceiveCalls = receiveCalls;
+            Received = received;
+            ReceivedBytes = receivedBytes;
+            Truncated = truncated;
+            Overflows = overflows;
+            ReceiveWouldBlock = receiveWouldBlock;
+            ReceiveErrors = receiveErrors;
+            SendCalls = sendCalls;
+            Sent = sent;
+            SentBytes = sentBytes;
+            SendWouldBlock = sendWouldBlock;
+            SendErrors = sendErrors;
+        }
+
+        public static SocketCounters operator +(in SocketCounters a, in SocketCounters b) => new SocketCounters(
+            a.ReceiveCalls + b.ReceiveCalls, a.Received + b.Received, a.ReceivedBytes + b.ReceivedBytes, a.Truncated + b.Truncated, a.Overflows + b.Overflows, a.ReceiveWouldBlock + b.ReceiveWouldBlock, a.ReceiveErrors + b.ReceiveErrors,
+            a.SendCalls + b.SendCalls, a.Sent + b.Sent, a.SentBytes + b.SentBytes, a.SendWouldBlock + b.SendWouldBlock, a.SendErrors + b.SendErrors);
+
+        public override string ToString() => $"{nameof(ReceiveCalls)}={ReceiveCalls} {nameof(Received)}={Received} {nameof(ReceivedBytes)}={ReceivedBytes} {nameof(Truncated)}={Truncated} {nameof(Overflows)}={Overflows} {nameof(ReceiveWouldBlock)}={ReceiveWouldBlock} {nameof(ReceiveErrors)}={ReceiveErrors} "
+                                           + $"{nameof(SendCalls)}={SendCalls} {nameof(Sent)}={Sent} {nameof(SentBytes)}={SentBytes} {nameof(SendWouldBlock)}={SendWouldBlock} {nameof(SendErrors)}={SendErrors}";
+    }
+
     public sealed partial class Socket: IDisposable
     {
         public static bool OSSupportsIPv4 => SystemSocket.OSSupportsIPv4;
@@ -30,6 +138,8 @@ public sealed partial class Socket: IDisposable
 
         private readonly ISocket socket;
 
+        internal ISocket Implementation => socket;
+
         /// <summary>
         /// Indicates the type of internet protocol stack under use.
         /// Note that some operating systems may not support dual stack mode 
@@ -41,13 +151,87 @@ public sealed partial class Socket: IDisposable
 
         public IPEndPoint LocalEndPoint => socket.LocalEndPoint;
 
+        /// <summary>
+        /// End point the socket is connected to or default if not connected.
+        /// </summary>
+        public IPEndPoint RemoteEndPoint => socket.RemoteEndPoint;
+
         public readonly bool Blocking;
         public readonly byte TTL;
         public readonly int ReceiveBufferSize;
         public readonly int SendBufferSize;        
 
+        /// <summary>
+        /// UDP offloads in effect. May be less than requested if not supported by the platform.
+        /// </summary>
+        public readonly Offload Offload;
+
+        /// <summary>
+        /// True if other sockets may bind to the same end point (SO_REUSEPORT). 
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool ReusePort;
+
+        /// <summary>
+        /// True if datagrams are timestamped by the kernel on arrival.
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool Timestamping;
+
+        /// <summary>
+        /// True if datagrams are sent with the don't fragment bit and the path MTU is left for the application to discover.
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool MtuProbing;
+
+        /// <summary>
+        /// True if datagrams are sent ECN-capable and the ECN codepoint of each datagram received is reported.
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool Ecn;
+
+        /// <summary>
+        /// How outgoing datagrams are paced. May be <see cref="Sockets.Pacing.None"/> despite requested if not supported by the platform.
+        /// </summary>
+        public readonly Pacing Pacing;
+
+        /// <summary>
+        /// Maximum rate in bytes per second at which datagrams leave the socket if <see cref="Pacing"/> is 
+        /// <see cref="Sockets.Pacing.Rate"/> or zero if unlimited. Ignored otherwise.
+        /// </summary>
+        public uint PacingRate
+        {
+            get => socket.PacingRate;
+            set => socket.PacingRate = value;
+        }
+
+        /// <summary>
+        /// True if datagrams may be sent without the kernel copying them (see <see cref="UncheckedSendMany(byte[], int, int, int, int, IPEndPoint[], IPEndPoint[], int[], int[], bool, out int, out bool)"/>).
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool ZeroCopy;
+
+        /// <summary>
+        /// True if the local address each datagram was received on is reported and datagrams may be sent from a chosen 
+        /// local address so that a multi-homed host replies from the address it was reached at. 
+        /// May be false despite requested if not supported by the platform.
+        /// </summary>
+        public readonly bool PacketInformation;
+
+        /// <summary>
+        /// Path MTU in bytes (including IP and UDP headers) currently known by the platform for the remote end point 
+        /// of a connected socket or zero if unknown.
+        /// </summary>
+        public int PathMtu => socket.PathMtu;
+
         public int Available => socket.Available;
 
+        /// <summary>
+        /// Counters of all operations performed since the socket was created. Counters are maintained by the thread 
+        /// that operates the socket and may be read from any thread at any time (even after the socket is closed).
+        /// </summary>
+        public SocketCounters Counters => socket.Counters;
+
         public Socket(in IPEndPoint endPoint) : this(in endPoint, in Settings.Default, Log.Default) { }
         public Socket(in IPEndPoint endPoint, in Settings settings) : this(in endPoint, in settings, Log.Default) { }
 
@@ -69,20 +253,27 @@ public Socket(in IPEndPoint endPoint, in Settings settings, ILog log)
             if (socket != null)
                 throw new SocketException((int)SocketError.IsConnected);
 
-#if USE_NATIVE_SOCKET
-            try
+            if (settings.InProcess)
             {
-                socket = new Native.Socket(addressFamily);
-                if (logged == 0 && Interlocked.Exchange(ref logged, 1) == 0)
-                    log.Info($"Using {typeof(Native.Socket).FullName}");
+                socket = new Loopback.Socket(addressFamily);
             }
-            catch (DllNotFoundException)
+            else
             {
-                socket = new Fallback.Socket(addressFamily);
-            }
+#if USE_NATIVE_SOCKET
+                try
+                {
+                    socket = new Native.Socket(addressFamily);
+                    if (logged == 0 && Interlocked.Exchange(ref logged, 1) == 0)
+                        log.Info($"Using {typeof(Native.Socket).FullName}");
+                }
+                catch (DllNotFoundException)
+                {
+                    socket = new Fallback.Socket(addressFamily);
+                }
 #else       
-            socket = new Fallback.Socket(addressFamily);
+                socket = new Fallback.Socket(addressFamily);
 #endif
+            }
 
             try
             {                
@@ -149,8 +340,57 @@ public Socket(in IPEndPoint endPoint, in Settings settings, ILog log)
                     TTL = (byte)socket.GetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.HopLimit);
                 }
 
+                if (settings.Offload != Offload.None)
+                    socket.Offload = settings.Offload;
+
+                Offload = socket.Offload;
+
+                if (settings.Timestamping)
+                {
+                    socket.Timestamping = true;
+                    Timestamping = socket.Timestamping;
+                }
+
+                if (settings.MtuProbing)
+                {
+                    socket.MtuProbing = true;
+                    MtuProbing = socket.MtuProbing;
+                }
+
+                if (settings.Ecn)
+                {
+                    socket.Ecn = true;
+                    Ecn = socket.Ecn;
+                }
+
+                if (settings.Pacing)
+                {
+                    socket.Pacing = Pacing.LaunchTime;
+                    Pacing = socket.Pacing;
+                }
+
+                if (settings.ZeroCopy)
+                {
+                    socket.ZeroCopy = true;
+                    ZeroCopy = socket.ZeroCopy;
+                }
+
+                if (settings.PacketInformation)
+                {
+                    socket.PacketInformation = true;
+                    PacketInformation = socket.PacketInformation;
+                }
+
                 socket.SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReuseAddress, false);
-                socket.ExclusiveAddressUse = true;
+
+                if (settings.ReusePort)
+                {
+                    socket.ReusePort = true;
+                    ReusePort = socket.ReusePort;
+                }
+
+                if (!ReusePort)
+                    socket.ExclusiveAddressUse = true;
 
                 try
                 {
@@ -180,6 +420,90 @@ public Socket(in IPEndPoint endPoint, in Settings settings, ILog log)
 
         public bool Poll(int microSeconds, SelectMode mode) => socket.Poll(microSeconds, mode);
 
+        /// <summary>
+        /// True if datagrams are received through a kernel completion queue.
+        /// </summary>
+        public bool CompletionQueue => socket.CompletionQueue;
+
+        /// <summary>
+        /// Receive datagrams through a kernel completion queue (io_uring) with <paramref name="capacity"/> buffers 
+        /// of <paramref name="size"/> bytes each registered in advance. Incoming datagrams are then collected 
+        /// by the kernel as they arrive and draining them does not require a system call per batch.
+        /// Only supported by non-blocking sockets without <see cref="Offload.Coalescing"/>.
+        /// </summary>
+        /// <returns>True if the completion queue is in use; false if not supported by the platform in which case the socket remains unchanged.</returns>
+        public bool UseCompletionQueue(int size, int capacity)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (size <= 0)
+                throw new ArgumentOutOfRangeException(nameof(size));
+
+            if (capacity <= 0)
+                throw new ArgumentOutOfRangeException(nameof(capacity));
+
+            return socket.UseCompletionQueue(size, capacity);
+        }
+
+        /// <summary>
+        /// Distribute datagrams among <paramref name="count"/> sockets sharing the same end point by source end point 
+        /// so that datagrams from a remote host are always delivered to the same socket, namely the socket bound 
+        /// in position <see cref="Steer(in IPEndPoint, int)"/>. Affects all sockets sharing the end point. 
+        /// Requires <see cref="ReusePort"/>.
+        /// </summary>
+        /// <returns>True if steering is in effect; false if not supported by the platform.</returns>
+        public bool TryAttachSteering(int count)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (count <= 0)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            return ReusePort && socket.AttachSteering(count);
+        }
+
+        /// <summary>
+        /// Position of the socket that receives datagrams from <paramref name="endPoint"/> among <paramref name="count"/> 
+        /// sockets sharing the same end point with steering attached (<see cref="TryAttachSteering(int)"/>).
+        /// </summary>
+        /// <remarks>
+        /// This must be kept in sync with the steering program in the native library. The key of an IPv4 
+        /// (or IPv4-mapped) address is the address itself and the key of an IPv6 address is the exclusive-or 
+        /// of its four 32-bit words, both in network byte order.
+        /// </remarks>
+        public static int Steer(in IPEndPoint endPoint, int count)
+        {
+            var address = endPoint.Address;
+            var key = (address.AddressFamily == AddressFamily.InterNetwork || (address.IPv6PackedAddress0 == 0 && (uint)address.IPv6PackedAddress1 == 0xFFFF0000u))
+                ? address.IPv4PackedAddress
+                : (uint)address.IPv6PackedAddress0 ^ (uint)(address.IPv6PackedAddress0 >> 32) ^ (uint)address.IPv6PackedAddress1 ^ (uint)(address.IPv6PackedAddress1 >> 32);
+
+            // Packed addresses hold the first byte in the least significant position so the key must be 
+            // reversed to match the value loaded by the steering program in network byte order.
+            key = (key >> 24) | ((key >> 8) & 0x0000FF00u) | ((key << 8) & 0x00FF0000u) | (key << 24);
+
+            var hash = unchecked((key ^ endPoint.Port) * 0x9E3779B1u);
+            return (int)((hash >> 16) % (uint)count);
+        }
+
+        /// <summary>
+        /// Connect the socket to <paramref name="endPoint"/>. A connected socket only receives datagrams from 
+        /// <paramref name="endPoint"/> and sends every datagram to it regardless of the end points passed to 
+        /// <see cref="SendMany(byte[], int, int, int, int, IPEndPoint[], int[])"/> which spares the kernel a 
+        /// route lookup per datagram. If the socket shares its end point with other sockets (<see cref="ReusePort"/>), 
+        /// datagrams from <paramref name="endPoint"/> are delivered to this socket instead.
+        /// </summary>
+        /// <returns>True if connected; false if not supported by the platform.</returns>
+        public bool TryConnect(in IPEndPoint endPoint)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            return socket.Connect(in endPoint);
+        }
+
         public int Receive(byte[] buffer, out IPEndPoint endPoint) => Receive(buffer, 0, buffer?.Length ?? throw new ArgumentNullException(nameof(buffer)), out endPoint);
         public int Receive(byte[] buffer, int offset, int size, out IPEndPoint endPoint) => (socket != null) ? UncheckedReceive(buffer, offset, size, out endPoint) : throw new ObjectDisposedException(GetType().FullName);
         public int Receive(byte[] buffer, int offset, int size, int millisecondsTimeout, out IPEndPoint endPoint)
@@ -218,595 +542,2726 @@ internal int UncheckedReceive(byte[] buffer, int offset, int size, out IPEndPoin
             }
         }
 
-        public int Send(byte[] buffer, in IPEndPoint endPoint) => Send(buffer, 0, buffer.Length, endPoint);
-        public int Send(byte[] buffer, int offset, int size, in IPEndPoint endPoint) => (socket != null) ? UncheckedSend(buffer, offset, size, in endPoint) : throw new ObjectDisposedException(GetType().FullName);
-        public int Send(byte[] buffer, int offset, int size, int millisecondsTimeout, in IPEndPoint endPoint)
-        {
-            if (millisecondsTimeout > int.MaxValue / 1000)
-                throw new ArgumentOutOfRangeException(string.Format(SR.ArgumentIsGreaterThanMaximum, nameof(millisecondsTimeout), int.MaxValue / 1000), nameof(millisecondsTimeout));
-
-            return socket.Poll(millisecondsTimeout * 1000, SelectMode.SelectWrite) ? UncheckedSend(buffer, offset, size, in endPoint) : 0;
-        }
+        /// <summary>
+        /// Receives a datagram that may have been coalesced by the network stack from a train of datagrams of 
+        /// <paramref name="segmentSize"/> bytes each (except the last which may be shorter). If <see cref="Offload.Coalescing"/> 
+        /// is not in effect <paramref name="segmentSize"/> is always equal to the number of bytes received.
+        /// </summary>
+        public int ReceiveSegmented(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize) => (socket != null) ? UncheckedReceiveSegmented(buffer, offset, size, out endPoint, out segmentSize) : throw new ObjectDisposedException(GetType().FullName);
 
-        internal int UncheckedSend(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
+        internal int UncheckedReceiveSegmented(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize)
         {
             try
             {
-                return socket.SendTo(buffer, offset, size, in endPoint);
+                return socket.ReceiveFrom(buffer, offset, size, out endPoint, out segmentSize);
             }
             catch (SocketException e)
             {
                 switch (e.SocketErrorCode)
                 {
                     case SocketError.MessageSize:
-                        // Datagram is never going to be delivered so it's as good as dropped. Assume sent and lost.
-                        return size;
-                    case SocketError.ConnectionReset:
                     case SocketError.NoBufferSpaceAvailable:
                     case SocketError.TimedOut:
                     case SocketError.WouldBlock:
-                        // Datagram still has a chance to be delivered if the caller is interested in retrying so return 0 to let the caller know.
+                        endPoint = default;
+                        segmentSize = 0;
                         return 0;
                     default:
                         throw;
                 }
             }
-        }       
-    }
-
-    internal interface ISocket: IDisposable
-    {
-        AddressFamily AddressFamily { get; }
-
-        IPEndPoint LocalEndPoint { get; }
+        }
 
-        bool Blocking { get; set; }
+        /// <summary>
+        /// Receives up to <paramref name="count"/> datagrams in a single operation. Each datagram is stored in a slice of 
+        /// <paramref name="buffer"/> of size <paramref name="stride"/> starting at <paramref name="offset"/>. The length of each 
+        /// datagram and its source are stored in <paramref name="lengths"/> and <paramref name="endPoints"/> respectively.
+        /// Datagrams that do not fit in a slice are discarded and reported with a length of zero.
+        /// </summary>
+        /// <returns>Number of datagrams received.</returns>
+        public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
 
-        int Available { get; }
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
 
-        bool IsBound { get; }
+            if (endPoints == null)
+                throw new ArgumentNullException(nameof(endPoints));
 
-        bool ExclusiveAddressUse { get; set; }
+            if (lengths == null)
+                throw new ArgumentNullException(nameof(lengths));
 
-        int ReceiveBufferSize { get; set; }
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
 
-        int SendBufferSize { get; set; }
+            if (stride <= 0)
+                throw new ArgumentOutOfRangeException(nameof(stride));
 
-        int ReceiveTimeout { get; set; }
+            if (count <= 0 || count > endPoints.Length || count > lengths.Length)
+                throw new ArgumentOutOfRangeException(nameof(count));
 
-        int SendTimeout { get; set; }
+            if (offset > buffer.Length - (long)stride * count)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(count)), nameof(count));
 
-        short Ttl { get; set; }
+            return UncheckedReceiveMany(buffer, offset, stride, count, endPoints, lengths);
+        }
 
-        bool DontFragment { get; set; }
+        internal int UncheckedReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths)
+        {
+            try
+            {
+                return socket.ReceiveMany(buffer, offset, stride, count, endPoints, lengths);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }
 
-        bool DualMode { get; set; }
+        /// <summary>
+        /// Receives up to <paramref name="count"/> datagrams in a single operation like <see cref="ReceiveMany(byte[], int, int, int, IPEndPoint[], int[])"/> 
+        /// and also stores in <paramref name="ages"/> the number of microseconds elapsed between the arrival of each datagram, as 
+        /// timestamped by the kernel, and the moment it was received. Ages are zero if <see cref="Timestamping"/> is not in effect 
+        /// or the datagram has no timestamp.
+        /// </summary>
+        /// <returns>Number of datagrams received.</returns>
+        public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
 
-        void SetIPProtectionLevel(IPProtectionLevel level);
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
 
-        void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue);
+            if (endPoints == null)
+                throw new ArgumentNullException(nameof(endPoints));
 
-        void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue);
+            if (lengths == null)
+                throw new ArgumentNullException(nameof(lengths));
 
-        int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName);
+            if (ages == null)
+                throw new ArgumentNullException(nameof(ages));
 
-        void Bind(in IPEndPoint endPoint);
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
 
-        bool Poll(int microSeconds, SelectMode mode);
+            if (stride <= 0)
+                throw new ArgumentOutOfRangeException(nameof(stride));
 
-        int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint);
+            if (count <= 0 || count > endPoints.Length || count > lengths.Length || count > ages.Length)
+                throw new ArgumentOutOfRangeException(nameof(count));
 
-        int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint);
+            if (offset > buffer.Length - (long)stride * count)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(count)), nameof(count));
 
-        void Close();
-    }
+            return UncheckedReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages);
+        }
 
-#if USE_NATIVE_SOCKET
-    internal static class Native
-    {
-        public sealed class Socket: ISocket
+        internal int UncheckedReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages)
         {
-            private static readonly object sync = new object();
-            private static bool initialized;
-
-            private static void Initialize()
+            try
             {
-                if (initialized)
-                    return;
-
-                lock (sync)
+                return socket.ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
                 {
-                    if (initialized)
-                        return;
-
-                    if (Native.Initialize() != 0)
-                        throw new SocketException((int)SocketError.SocketError);
-
-                    initialized = true;
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
                 }
             }
+        }
 
-            public Socket(AddressFamily addressFamily)
-            {
-                Initialize();
-                var socketError = Native.Open(addressFamily, out handle);
+        /// <summary>
+        /// Receives up to <paramref name="count"/> datagrams in a single operation like <see cref="ReceiveMany(byte[], int, int, int, IPEndPoint[], int[], int[])"/> 
+        /// and also stores in <paramref name="marks"/> the ECN codepoint of each datagram. Marks are <see cref="ECN.NotCapable"/> 
+        /// if <see cref="Ecn"/> is not in effect or the codepoint is unknown.
+        /// </summary>
+        /// <returns>Number of datagrams received.</returns>
+        public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
+
+            if (endPoints == null)
+                throw new ArgumentNullException(nameof(endPoints));
+
+            if (lengths == null)
+                throw new ArgumentNullException(nameof(lengths));
+
+            if (ages == null)
+                throw new ArgumentNullException(nameof(ages));
+
+            if (marks == null)
+                throw new ArgumentNullException(nameof(marks));
+
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+
+            if (stride <= 0)
+                throw new ArgumentOutOfRangeException(nameof(stride));
+
+            if (count <= 0 || count > endPoints.Length || count > lengths.Length || count > ages.Length || count > marks.Length)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            if (offset > buffer.Length - (long)stride * count)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(count)), nameof(count));
+
+            return UncheckedReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks);
+        }
+
+        internal int UncheckedReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks) 
+            => UncheckedReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, null);
+
+        /// <summary>
+        /// Receives up to <paramref name="count"/> datagrams in a single operation like <see cref="ReceiveMany(byte[], int, int, int, IPEndPoint[], int[], int[], ECN[])"/> 
+        /// and also stores in <paramref name="destinations"/> the local address (with port zero) each datagram was sent to. 
+        /// Destinations are <see cref="IPEndPoint"/> default if <see cref="PacketInformation"/> is not in effect or the address is unknown.
+        /// </summary>
+        /// <returns>Number of datagrams received.</returns>
+        public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
+
+            if (endPoints == null)
+                throw new ArgumentNullException(nameof(endPoints));
+
+            if (lengths == null)
+                throw new ArgumentNullException(nameof(lengths));
+
+            if (ages == null)
+                throw new ArgumentNullException(nameof(ages));
+
+            if (marks == null)
+                throw new ArgumentNullException(nameof(marks));
+
+            if (destinations == null)
+                throw new ArgumentNullException(nameof(destinations));
+
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+
+            if (stride <= 0)
+                throw new ArgumentOutOfRangeException(nameof(stride));
+
+            if (count <= 0 || count > endPoints.Length || count > lengths.Length || count > ages.Length || count > marks.Length || count > destinations.Length)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            if (offset > buffer.Length - (long)stride * count)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(count)), nameof(count));
+
+            return UncheckedReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, destinations);
+        }
+
+        internal int UncheckedReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations)
+        {
+            try
+            {
+                return socket.ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, destinations);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }
+
+        public int Send(byte[] buffer, in IPEndPoint endPoint) => Send(buffer, 0, buffer.Length, endPoint);
+        public int Send(byte[] buffer, int offset, int size, in IPEndPoint endPoint) => (socket != null) ? UncheckedSend(buffer, offset, size, in endPoint) : throw new ObjectDisposedException(GetType().FullName);
+        public int Send(byte[] buffer, int offset, int size, int millisecondsTimeout, in IPEndPoint endPoint)
+        {
+            if (millisecondsTimeout > int.MaxValue / 1000)
+                throw new ArgumentOutOfRangeException(string.Format(SR.ArgumentIsGreaterThanMaximum, nameof(millisecondsTimeout), int.MaxValue / 1000), nameof(millisecondsTimeout));
+
+            return socket.Poll(millisecondsTimeout * 1000, SelectMode.SelectWrite) ? UncheckedSend(buffer, offset, size, in endPoint) : 0;
+        }
+
+        /// <summary>
+        /// Sends <paramref name="size"/> bytes as a train of datagrams of <paramref name="segmentSize"/> bytes each 
+        /// (except the last which may be shorter). If <see cref="Offload.Segmentation"/> is in effect the whole train 
+        /// is handed to the network stack as a single buffer; otherwise datagrams are sent one at a time.
+        /// </summary>
+        /// <returns>Number of bytes sent.</returns>
+        public int SendSegmented(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
+
+            if (offset < 0 || size < 0 || offset > buffer.Length - size)
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(size)), nameof(size));
+
+            if (segmentSize <= 0)
+                throw new ArgumentOutOfRangeException(nameof(segmentSize));
+
+            return UncheckedSendSegmented(buffer, offset, size, segmentSize, in endPoint);
+        }
+
+        /// <summary>
+        /// Sends up to <paramref name="count"/> datagrams in a single operation starting with the datagram at <paramref name="index"/>. 
+        /// Each datagram is stored in a slice of <paramref name="buffer"/> of size <paramref name="stride"/> starting at <paramref name="offset"/>. 
+        /// The length and destination of each datagram are taken from <paramref name="lengths"/> and <paramref name="endPoints"/> respectively.
+        /// </summary>
+        /// <returns>Number of datagrams sent.</returns>
+        public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths)
+        {
+            if (socket == null)
+                throw new ObjectDisposedException(GetType().FullName);
+
+            if (buffer == null)
+                throw new ArgumentNullException(nameof(buffer));
+
+            if (endPoints == null)
+                throw new ArgumentNullException(nameof(endPoints));
+
+            if (lengths == null)
+                throw new ArgumentNullException(nameof(lengths));
+
+            if (offset < 0)
+                throw new ArgumentOutOfRangeException(nameof(offset));
+
+            if (stride <= 0)
+                throw new ArgumentOutOfRangeException(nameof(stride));
+
+            if (index < 0)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            if (count <= 0 || index > endPoints.Length - count || index > lengths.Length - count)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            if (offset > buffer.Length - (long)stride * (index + count))
+                throw new ArgumentException(string.Format(SR.IndexOutOfRangeOrLengthIsGreaterThanBuffer, nameof(offset), nameof(count)), nameof(count));
+
+            for (int i = index; i < index + count; ++i)
+                if (lengths[i] < 0 || lengths[i] > stride)
+                    throw new ArgumentOutOfRangeException(nameof(lengths));
+
+            return UncheckedSendMany(buffer, offset, stride, index, count, endPoints, lengths);
+        }
+
+        /// <summary>
+        /// Returns the number of datagrams sent. If the first datagram could not be sent the return value is
+        /// the same as that of <see cref="UncheckedSend(byte[], int, int, in IPEndPoint)"/>: 1 if the datagram 
+        /// is never going to be delivered (as good as dropped) or 0 if the caller may retry.
+        /// </summary>
+        internal int UncheckedSendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths) => UncheckedSendMany(buffer, offset, stride, index, count, endPoints, lengths, out _);
+
+        /// <summary>
+        /// Same as <see cref="UncheckedSendMany(byte[], int, int, int, int, IPEndPoint[], int[])"/> but also indicates 
+        /// whether the first datagram was dropped for being larger than the socket allows (e.g. larger than the MTU of 
+        /// the outgoing interface when <see cref="MtuProbing"/> is in effect).
+        /// </summary>
+        internal int UncheckedSendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, out bool oversized) => UncheckedSendMany(buffer, offset, stride, index, count, endPoints, lengths, null, out oversized);
+
+        /// <summary>
+        /// Same as <see cref="UncheckedSendMany(byte[], int, int, int, int, IPEndPoint[], int[], out bool)"/> but each datagram 
+        /// is released <paramref name="delays"/> microseconds from now if <see cref="Pacing"/> is <see cref="Sockets.Pacing.LaunchTime"/>. 
+        /// Delays are ignored otherwise and may be null.
+        /// </summary>
+        internal int UncheckedSendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, int[] delays, out bool oversized)
+        {
+            oversized = false;
+            try
+            {
+                return socket.SendMany(buffer, offset, stride, index, count, endPoints, lengths, delays);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.MessageSize:
+                        // Datagram is never going to be delivered so it's as good as dropped. Assume sent and lost.
+                        oversized = true;
+                        return 1;
+                    case SocketError.ConnectionReset:
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Same as <see cref="UncheckedSendMany(byte[], int, int, int, int, IPEndPoint[], int[], int[], out bool)"/> but each datagram 
+        /// is sent from the local address in <paramref name="sources"/> (if known) when <see cref="PacketInformation"/> is in effect 
+        /// and the kernel may transmit datagrams directly from <paramref name="buffer"/> if <paramref name="zeroCopy"/> is requested 
+        /// and <see cref="ZeroCopy"/> is in effect. The buffer must then be pinned and its contents left untouched until the 
+        /// <paramref name="notifications"/> send calls made are reported complete by <see cref="UncheckedReceiveCompletions(uint[], out int)"/>.
+        /// </summary>
+        /// <param name="buffer">Datagrams to send, one per slot.</param>
+        /// <param name="offset">Position in <paramref name="buffer"/> of the first slot.</param>
+        /// <param name="stride">Size of a slot in bytes.</param>
+        /// <param name="index">Index of the first datagram to send.</param>
+        /// <param name="count">Number of datagrams to send starting at <paramref name="index"/>.</param>
+        /// <param name="endPoints">Remote end point of each datagram. Ignored by a connected socket.</param>
+        /// <param name="sources">Local addresses to send from (ports are ignored) or null to let the platform choose.</param>
+        /// <param name="lengths">Length in bytes of each datagram.</param>
+        /// <param name="delays">Microseconds from now each datagram should be released (see <see cref="Pacing"/>) or null.</param>
+        /// <param name="zeroCopy">True to send without a kernel copy if <see cref="ZeroCopy"/> is in effect.</param>
+        /// <param name="notifications">Number of completion notifications the kernel is going to report for this call.</param>
+        /// <param name="oversized">True if the first datagram was rejected for being larger than the path MTU.</param>
+        /// <returns>Number of datagrams sent, or dropped as if lost in transit.</returns>
+        internal int UncheckedSendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, IPEndPoint[] sources, int[] lengths, int[] delays, bool zeroCopy, out int notifications, out bool oversized)
+        {
+            oversized = false;
+            try
+            {
+                return socket.SendMany(buffer, offset, stride, index, count, endPoints, sources, lengths, delays, zeroCopy, out notifications);
+            }
+            catch (SocketException e)
+            {
+                notifications = 0;
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.MessageSize:
+                        oversized = true;
+                        return 1;
+                    case SocketError.ConnectionReset:
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }
+
+        /// <summary>
+        /// Collect the completion notifications of zero copy send calls that are immediately available. Send calls are 
+        /// numbered from zero in the order they were made and each notification is an inclusive range [first, last] 
+        /// stored in a pair of consecutive elements of <paramref name="ranges"/>.
+        /// </summary>
+        /// <param name="ranges">Receives the ranges; its length must be even and determines how many can be collected.</param>
+        /// <param name="copied">Number of notifications indicating that the kernel had to copy the data anyway.</param>
+        /// <returns>Number of notifications (ranges) stored.</returns>
+        internal int UncheckedReceiveCompletions(uint[] ranges, out int copied) => socket.ReceiveCompletions(ranges, out copied);
+
+        internal int UncheckedSend(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
+        {
+            try
+            {
+                return socket.SendTo(buffer, offset, size, in endPoint);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.MessageSize:
+                        // Datagram is never going to be delivered so it's as good as dropped. Assume sent and lost.
+                        return size;
+                    case SocketError.ConnectionReset:
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        // Datagram still has a chance to be delivered if the caller is interested in retrying so return 0 to let the caller know.
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }       
+
+        internal int UncheckedSendSegmented(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint)
+        {
+            try
+            {
+                return socket.SendTo(buffer, offset, size, segmentSize, in endPoint);
+            }
+            catch (SocketException e)
+            {
+                switch (e.SocketErrorCode)
+                {
+                    case SocketError.MessageSize:
+                        // Datagrams are never going to be delivered so they're as good as dropped. Assume sent and lost.
+                        return size;
+                    case SocketError.ConnectionReset:
+                    case SocketError.NoBufferSpaceAvailable:
+                    case SocketError.TimedOut:
+                    case SocketError.WouldBlock:
+                        return 0;
+                    default:
+                        throw;
+                }
+            }
+        }
+    }
+
+    internal interface ISocket: IDisposable
+    {
+        AddressFamily AddressFamily { get; }
+
+        IPEndPoint LocalEndPoint { get; }
+
+        IPEndPoint RemoteEndPoint { get; }
+
+        bool Blocking { get; set; }
+
+        int Available { get; }
+
+        SocketCounters Counters { get; }
+
+        bool IsBound { get; }
+
+        bool ExclusiveAddressUse { get; set; }
+
+        int ReceiveBufferSize { get; set; }
+
+        int SendBufferSize { get; set; }
+
+        int ReceiveTimeout { get; set; }
+
+        int SendTimeout { get; set; }
+
+        short Ttl { get; set; }
+
+        bool DontFragment { get; set; }
+
+        bool DualMode { get; set; }
+
+        Offload Offload { get; set; }
+
+        bool CompletionQueue { get; }
+
+        bool ReusePort { get; set; }
+
+        bool Timestamping { get; set; }
+
+        bool MtuProbing { get; set; }
+
+        bool Ecn { get; set; }
+
+        Pacing Pacing { get; set; }
+
+        uint PacingRate { get; set; }
+
+        bool ZeroCopy { get; set; }
+
+        bool PacketInformation { get; set; }
+
+        int PathMtu { get; }
+
+        bool AttachSteering(int count);
+
+        bool UseCompletionQueue(int size, int capacity);
+
+        void SetIPProtectionLevel(IPProtectionLevel level);
+
+        void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue);
+
+        void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue);
+
+        int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName);
+
+        void Bind(in IPEndPoint endPoint);
+
+        bool Connect(in IPEndPoint endPoint);
+
+        bool Poll(int microSeconds, SelectMode mode);
+
+        int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint);
+
+        int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize);
+
+        int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths);
+
+        int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages);
+
+        int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations);
+
+        int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint);
+
+        int SendTo(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint);
+
+        int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths);
+
+        int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, int[] delays);
+
+        int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, IPEndPoint[] sources, int[] lengths, int[] delays, bool zeroCopy, out int notifications);
+
+        int ReceiveCompletions(uint[] ranges, out int copied);
+
+        void Close();
+    }
+
+#if USE_NATIVE_SOCKET
+    internal static partial class Native
+    {
+        public sealed class Socket: ISocket
+        {
+            private static readonly object sync = new object();
+            private static bool initialized;
+
+            private static void Initialize()
+            {
+                if (initialized)
+                    return;
+
+                lock (sync)
+                {
+                    if (initialized)
+                        return;
+
+                    if (Native.Initialize() != 0)
+                        throw new SocketException((int)SocketError.SocketError);
+
+                    initialized = true;
+                }
+            }
+
+            public Socket(AddressFamily addressFamily)
+            {
+                Initialize();
+                var socketError = Native.Open(addressFamily, out handle);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                this.addressFamily = addressFamily;
+
+                // The stats block must be aligned to a cache line so that it doesn't share one with anything else.
+                statsBlock = Marshal.AllocHGlobal(StatsSize + StatsAlignment - 1);
+                stats = new IntPtr((statsBlock.ToInt64() + StatsAlignment - 1) & ~(long)(StatsAlignment - 1));
+                for (int i = 0; i < StatsSize; i += sizeof(long))
+                    Marshal.WriteInt64(stats, i, 0);
+            }
+
+            private int handle;
+
+            internal int Handle => handle;
+
+            private const int StatsSize = 128;
+            private const int StatsAlignment = 64;
+
+            /// <summary>
+            /// Native stats block (see <see cref="SocketCounters"/>) updated by every receive and send operation.
+            /// </summary>
+            private IntPtr stats;
+            private IntPtr statsBlock;
+
+            /// <summary>
+            /// Serializes reading counters with <see cref="Dispose"/> as they may be called from different threads.
+            /// </summary>
+            private readonly object statsLock = new object();
+
+            /// <summary>
+            /// Final counters kept after the socket is disposed.
+            /// </summary>
+            private SocketCounters counters;
+
+            public SocketCounters Counters
+            {
+                get
+                {
+                    lock (statsLock)
+                    {
+                        if (stats != IntPtr.Zero)
+                            counters = Marshal.PtrToStructure<SocketCounters>(stats);
+
+                        return counters;
+                    }
+                }
+            }
+
+            private IntPtr ring;
+            private int ringHandle = -1;
+
+            /// <summary>
+            /// Descriptor that becomes readable when datagrams are available. 
+            /// This is the completion queue if one is in use, otherwise the socket itself.
+            /// </summary>
+            internal int EventHandle => ringHandle < 0 ? handle : ringHandle;
+
+            private bool blocking;
+
+            public bool Blocking
+            {
+                get => blocking;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetBlocking(handle, value ? 1 : 0);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    blocking = value;
+                }
+            }
+
+            #pragma warning disable IDE0044
+            private AddressFamily addressFamily;
+            public AddressFamily AddressFamily => addressFamily;
+            #pragma warning restore IDE0044
+
+            public int Available
+            {
+                get
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.Available(handle, out int value);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    return value;
+                }
+            }
+
+            public IPEndPoint LocalEndPoint { get; private set; }
+
+            public bool IsBound => LocalEndPoint != default;
+
+            public bool ExclusiveAddressUse
+            {
+                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ExclusiveAddressUse) != 0;
+
+                set
+                {
+                    if (IsBound)
+                        throw new InvalidOperationException(SR.Socket.AlreadyBound);
+
+                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ExclusiveAddressUse, value ? 1 : 0);
+                }
+            }
+
+            public int ReceiveBufferSize
+            {
+                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveBuffer);
+
+                set
+                {
+                    if (value < 0)
+                        throw new ArgumentOutOfRangeException(nameof(value));
+
+                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveBuffer, value);
+                }
+            }
+
+            public int SendBufferSize
+            {
+                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendBuffer);
+
+                set
+                {
+                    if (value < 0)
+                        throw new ArgumentOutOfRangeException(nameof(value));
+
+                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendBuffer, value);
+                }
+            }
+
+            public int ReceiveTimeout
+            {
+                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveTimeout);
+
+                set
+                {
+                    if (value < -1)
+                        throw new ArgumentOutOfRangeException(nameof(value));
+
+                    if (value == -1)
+                        value = 0;
+
+                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveTimeout, value);
+                }
+            }
+
+            public int SendTimeout
+            {
+                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendTimeout);
+
+                set
+                {
+                    if (value < -1)
+                        throw new ArgumentOutOfRangeException(nameof(value));
+                    if (value == -1)
+                        value = 0;
+
+                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendTimeout, value);
+                }
+            }
+
+            public short Ttl
+            {
+                get
+                {
+                    if (addressFamily == AddressFamily.InterNetwork)
+                        return (short)GetSocketOption(SocketOptionLevel.IP, SocketOptionName.IpTimeToLive);
+
+                    if (addressFamily == AddressFamily.InterNetworkV6)
+                        return (short)GetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IpTimeToLive);
+
+                    throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+                }
+
+                set
+                {
+                    if (value < 0 || value > byte.MaxValue)
+                        throw new ArgumentOutOfRangeException(nameof(value));
+
+                    if (addressFamily == AddressFamily.InterNetwork)
+                        SetSocketOption(SocketOptionLevel.IP, SocketOptionName.IpTimeToLive, (int)value);
+                    else if (addressFamily == AddressFamily.InterNetworkV6)
+                        SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IpTimeToLive, (int)value);
+                    else
+                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+                }
+            }
+
+            public bool DontFragment
+            {
+                get => addressFamily == AddressFamily.InterNetwork && GetSocketOption(SocketOptionLevel.IP, SocketOptionName.DontFragment) != 0;
+
+                set
+                {
+                    if (addressFamily != AddressFamily.InterNetwork)
+                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+
+                    SetSocketOption(SocketOptionLevel.IP, SocketOptionName.DontFragment, value ? 1 : 0);
+                }
+            }
+
+            public bool DualMode
+            {
+                get => (addressFamily == AddressFamily.InterNetworkV6) && GetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPv6Only) == 0;
+
+                set
+                {
+                    if (addressFamily != AddressFamily.InterNetworkV6)
+                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+
+                    SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPv6Only, value ? 0 : 1);
+                }
+            }
+
+            private Offload offload;
+
+            public Offload Offload
+            {
+                get => offload;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetOffload(handle, value, out Offload enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    offload = enabled;
+                }
+            }
+
+            public bool CompletionQueue => ring != IntPtr.Zero;
+
+            private bool reusePort;
+
+            public bool ReusePort
+            {
+                get => reusePort;
+                set
+                {
+                    if (IsBound)
+                        throw new InvalidOperationException(SR.Socket.AlreadyBound);
+
+                    var socketError = Native.SetReusePort(handle, value ? 1 : 0);
+                    if (socketError == SocketError.Success)
+                        reusePort = value;
+                    else if (socketError != SocketError.OperationNotSupported)
+                        throw new SocketException((int)socketError);
+                }
+            }
+
+            private bool timestamping;
+
+            public bool Timestamping
+            {
+                get => timestamping;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetTimestamping(handle, value ? 1 : 0, out int enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    timestamping = enabled != 0;
+                }
+            }
+
+            private bool mtuProbing;
+
+            public bool MtuProbing
+            {
+                get => mtuProbing;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetMtuProbing(handle, value ? 1 : 0, out int enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    mtuProbing = enabled != 0;
+                }
+            }
+
+            private bool ecn;
+
+            public bool Ecn
+            {
+                get => ecn;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetEcn(handle, value ? 1 : 0, out int enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    ecn = enabled != 0;
+                }
+            }
+
+            private Pacing pacing;
+
+            /// <summary>
+            /// Any value other than <see cref="Pacing.None"/> enables the best pacing supported by the platform.
+            /// </summary>
+            public Pacing Pacing
+            {
+                get => pacing;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetPacing(handle, value != Pacing.None ? 1 : 0, out Pacing mode);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    pacing = mode;
+                    pacingRate = 0;
+                }
+            }
+
+            private uint pacingRate;
+
+            public uint PacingRate
+            {
+                get => pacingRate;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    // Only a rate actually changed is worth a system call.
+                    if (pacing != Pacing.Rate || value == pacingRate)
+                        return;
+
+                    var socketError = Native.SetPacingRate(handle, value);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    pacingRate = value;
+                }
+            }
+
+            private bool zeroCopy;
+
+            public bool ZeroCopy
+            {
+                get => zeroCopy;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetZeroCopy(handle, value ? 1 : 0, out int enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    zeroCopy = enabled != 0;
+                }
+            }
+
+            private bool packetInformation;
+
+            public bool PacketInformation
+            {
+                get => packetInformation;
+                set
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    var socketError = Native.SetPacketInformation(handle, value ? 1 : 0, out int enabled);
+                    if (socketError != SocketError.Success)
+                        throw new SocketException((int)socketError);
+
+                    packetInformation = enabled != 0;
+                }
+            }
+
+            /// <summary>
+            /// Only known for a connected socket. Zero if not connected or not supported by the platform.
+            /// </summary>
+            public int PathMtu
+            {
+                get
+                {
+                    if (handle < 0)
+                        throw new ObjectDisposedException(GetType().FullName);
+
+                    return Native.GetMtu(handle, out int mtu) == SocketError.Success ? mtu : 0;
+                }
+            }
+
+            public bool AttachSteering(int count)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.SetSteering(handle, count);
+                if (socketError == SocketError.Success)
+                    return true;
+
+                // Kernel may not support reuseport programs or forbid them.
+                if (socketError == SocketError.OperationNotSupported || socketError == SocketError.ProtocolOption || socketError == SocketError.AccessDenied)
+                    return false;
+
+                throw new SocketException((int)socketError);
+            }
+
+            public bool UseCompletionQueue(int size, int capacity)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (ring != IntPtr.Zero)
+                    return true;
+
+                // A completion queue never blocks and cannot split coalesced datagrams.
+                if (blocking || (offload & Offload.Coalescing) != 0)
+                    return false;
+
+                var socketError = Native.OpenRing(handle, size, capacity, out ring, out ringHandle);
+                if (socketError == SocketError.Success)
+                    return true;
+
+                ring = IntPtr.Zero;
+                ringHandle = -1;
+
+                // Kernel does not support it (or it has been disabled) so keep using the socket directly.
+                if (socketError == SocketError.OperationNotSupported || socketError == SocketError.AccessDenied)
+                    return false;
+
+                throw new SocketException((int)socketError);
+            }
+
+            public void SetIPProtectionLevel(IPProtectionLevel level)
+            {
+                if (level == IPProtectionLevel.Unspecified)
+                    throw new ArgumentException("Invalid value", nameof(level));
+
+                if (addressFamily == AddressFamily.InterNetwork)
+                    SetSocketOption(SocketOptionLevel.IP, SocketOptionName.IPProtectionLevel, (int)level);
+                else if (addressFamily == AddressFamily.InterNetworkV6)
+                    SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPProtectionLevel, (int)level);
+
+                throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+            }
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue) => SetSocketOption(optionLevel, optionName, optionValue ? 1 : 0);
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                CheckSetOptionPermissions(optionLevel, optionName);
+
+                var socketError = Native.SetSocketOption(handle, optionLevel, optionName, optionValue);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+            }
+
+            public int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.GetSocketOption(handle, optionLevel, optionName, out int optionValue);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return optionValue;
+            }
+
+            private static void CheckSetOptionPermissions(SocketOptionLevel optionLevel, SocketOptionName optionName)
+            {
+                if (optionLevel == SocketOptionLevel.Udp && (optionName == SocketOptionName.Debug || optionName == SocketOptionName.ChecksumCoverage)
+                 || optionLevel == SocketOptionLevel.Socket && (optionName == SocketOptionName.ReuseAddress || optionName == SocketOptionName.DontLinger || optionName == SocketOptionName.SendBuffer || optionName == SocketOptionName.ReceiveBuffer || optionName == SocketOptionName.SendTimeout || optionName == SocketOptionName.ExclusiveAddressUse || optionName == SocketOptionName.ReceiveTimeout)
+                 || optionLevel == SocketOptionLevel.IP && (optionName == SocketOptionName.TypeOfService || optionName == SocketOptionName.IpTimeToLive || optionName == SocketOptionName.DontFragment)
+                 || optionLevel == SocketOptionLevel.IPv6 && (optionName == SocketOptionName.IpTimeToLive || optionName == SocketOptionName.IPProtectionLevel || optionName == SocketOptionName.IPv6Only || optionName == SocketOptionName.HopLimit))
+                    return;
+
+                throw new NotSupportedException();
+            }
+
+            public void Bind(in IPEndPoint endPoint)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                IPEndPoint localEndPoint = endPoint;
+                var socketError = Native.Bind(handle, ref localEndPoint);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                LocalEndPoint = localEndPoint;
+            }
+
+            public IPEndPoint RemoteEndPoint { get; private set; }
+
+            public bool Connect(in IPEndPoint endPoint)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.Connect(handle, in endPoint);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                RemoteEndPoint = endPoint;
+                return true;
+            }
+
+            public bool Poll(int microSeconds, SelectMode mode)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                // Datagrams are consumed by the completion queue as they arrive so the socket itself never becomes readable.
+                var socketError = (ring != IntPtr.Zero && mode == SelectMode.SelectRead)
+                    ? Native.WaitRing(ring, microSeconds, out int result)
+                    : Native.Poll(handle, microSeconds, mode, out result);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return result > 0;
+            }
+
+            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (ring != IntPtr.Zero)
+                {
+                    var endPoints = new IPEndPoint[1];
+                    var lengths = new int[1];
+                    var error = Native.ReceiveMany(ring, buffer, offset, size, 1, endPoints, lengths, out int _, stats);
+                    if (error != SocketError.Success)
+                        throw new SocketException((int)error);
+
+                    endPoint = endPoints[0];
+                    return lengths[0];
+                }
+
+                var socketError = Native.ReceiveFrom(handle, buffer, offset, size, out endPoint, out int nbytes, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nbytes;
+            }
+
+            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (ring != IntPtr.Zero)
+                {
+                    // Datagrams are never coalesced when received through a completion queue.
+                    segmentSize = ReceiveFrom(buffer, offset, size, out endPoint);
+                    return segmentSize;
+                }
+
+                var socketError = Native.ReceiveFrom(handle, buffer, offset, size, out endPoint, out int nbytes, out segmentSize, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nbytes;
+            }
+
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                // Coalesced datagrams must be split in native code so they can be delivered one per slot.
+                var socketError = (ring != IntPtr.Zero)
+                    ? Native.ReceiveMany(ring, buffer, offset, stride, count, endPoints, lengths, out int nmessages, stats)
+                    : (offload & Offload.Coalescing) == 0
+                    ? Native.ReceiveMany(handle, buffer, offset, stride, count, endPoints, lengths, out nmessages, stats)
+                    : Native.ReceiveManySegmented(handle, buffer, offset, stride, count, endPoints, lengths, out nmessages, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nmessages;
+            }
+
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, null);
+
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, null);
+
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations)
+            {
+                // Timestamps, ECN marks and destinations are only collected by the plain batch receive. A completion queue or 
+                // coalesced datagrams are reported as if they had just arrived, were not marked and were sent to an unknown address.
+                if (!(timestamping || (ecn && marks != null) || (packetInformation && destinations != null)) || ring != IntPtr.Zero || (offload & Offload.Coalescing) != 0)
+                {
+                    var n = ReceiveMany(buffer, offset, stride, count, endPoints, lengths);
+                    if (ages != null)
+                        Array.Clear(ages, 0, n);
+                    if (marks != null)
+                        Array.Clear(marks, 0, n);
+                    if (destinations != null)
+                        Array.Clear(destinations, 0, n);
+                    return n;
+                }
+
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.ReceiveManyAddressed(handle, buffer, offset, stride, count, endPoints, lengths, ages, marks, destinations, out int nmessages, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nmessages;
+            }
+
+            public int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.SendTo(handle, buffer, offset, size, in endPoint, out int nbytes, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nbytes;
+            }
+
+            public int SendTo(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.SendTo(handle, buffer, offset, size, segmentSize, in endPoint, out int nbytes, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nbytes;
+            }
+
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths) => SendMany(buffer, offset, stride, index, count, endPoints, lengths, null);
+
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, int[] delays)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                // A connected socket sends without addresses so that the kernel can use its cached route.
+                if (RemoteEndPoint != default)
+                    endPoints = null;
+
+                // Datagrams with launch times of their own cannot be coalesced.
+                if (delays != null && pacing == Pacing.LaunchTime)
+                {
+                    var error = Native.SendManyPaced(handle, buffer, offset, stride, index, count, endPoints, lengths, delays, out int n, stats);
+                    if (error != SocketError.Success)
+                        throw new SocketException((int)error);
+
+                    return n;
+                }
+
+                // Trains of datagrams to the same destination are coalesced in native code.
+                var socketError = (offload & Offload.Segmentation) == 0
+                    ? Native.SendMany(handle, buffer, offset, stride, index, count, endPoints, lengths, out int nmessages, stats)
+                    : Native.SendManySegmented(handle, buffer, offset, stride, index, count, endPoints, lengths, out nmessages, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nmessages;
+            }
+
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, IPEndPoint[] sources, int[] lengths, int[] delays, bool zeroCopy, out int notifications)
+            {
+                // A connected socket is bound to its route so sources only apply to an unconnected socket.
+                if (!packetInformation || RemoteEndPoint != default)
+                    sources = null;
+
+                if (!(zeroCopy && this.zeroCopy) && sources == null)
+                {
+                    notifications = 0;
+                    return SendMany(buffer, offset, stride, index, count, endPoints, lengths, delays);
+                }
+
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                if (RemoteEndPoint != default)
+                    endPoints = null;
+
+                var socketError = Native.SendManySourced(handle, buffer, offset, stride, index, count, endPoints, sources, lengths, pacing == Pacing.LaunchTime ? delays : null, 
+                    (zeroCopy && this.zeroCopy) ? 1 : 0, (offload & Offload.Segmentation) != 0 ? 1 : 0, out int nmessages, out notifications, stats);
+                if (socketError != SocketError.Success)
+                    throw new SocketException((int)socketError);
+
+                return nmessages;
+            }
+
+            public int ReceiveCompletions(uint[] ranges, out int copied)
+            {
+                if (handle < 0)
+                    throw new ObjectDisposedException(GetType().FullName);
+
+                var socketError = Native.ReceiveZeroCopyCompletions(handle, ranges, ranges.Length / 2, out int nranges, out copied);
                 if (socketError != SocketError.Success)
                     throw new SocketException((int)socketError);
 
-                this.addressFamily = addressFamily;
-            }
+                return nranges;
+            }
+
+            public void Close() => Dispose();
+
+            public void Dispose()
+            {
+                OnDisposed(true);
+                GC.SuppressFinalize(this);
+            }
+
+            ~Socket() => OnDisposed(false);
+
+            private void OnDisposed(bool disposing)
+            {
+                var value = Interlocked.Exchange(ref handle, -1);
+                if (value < 0)
+                    return;
+
+                // The completion queue must be closed first as it holds a pending receive on the socket.
+                var queue = ring;
+                ring = IntPtr.Zero;
+                ringHandle = -1;
+                Native.CloseRing(queue);
+
+                Native.Close(value);
+
+                lock (statsLock)
+                {
+                    if (stats != IntPtr.Zero)
+                    {
+                        counters = Marshal.PtrToStructure<SocketCounters>(stats);
+                        Marshal.FreeHGlobal(statsBlock);
+                        stats = IntPtr.Zero;
+                        statsBlock = IntPtr.Zero;
+                    }
+                }
+            }
+        }
+
+#if __IOS__ || UNITY_IOS && !UNITY_EDITOR
+        private const string nativeLibrary = "__Internal";
+#else
+        private const string nativeLibrary = "Carambolas.Net.Native.dll";
+#endif
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_initialize", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int Initialize();
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_open", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError Open(AddressFamily addressFamily, out int sockfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_close", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void Close(int sockfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setsockopt", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetSocketOption(int sockfd, SocketOptionLevel level, SocketOptionName optionName, int optionValue);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_getsockopt", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError GetSocketOption(int sockfd, SocketOptionLevel level, SocketOptionName optionName, out int optionValue);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setblocking", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetBlocking(int sockfd, int value);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setoffload", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetOffload(int sockfd, Offload flags, out Offload enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_settimestamping", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetTimestamping(int sockfd, int value, out int enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setmtuprobing", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetMtuProbing(int sockfd, int value, out int enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setecn", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetEcn(int sockfd, int value, out int enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setpacing", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetPacing(int sockfd, int value, out Pacing mode);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setpacingrate", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetPacingRate(int sockfd, uint rate);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setzerocopy", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetZeroCopy(int sockfd, int value, out int enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setpacketinfo", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetPacketInformation(int sockfd, int value, out int enabled);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_zerocopy_completions", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveZeroCopyCompletions(int sockfd, [Out] uint[] ranges, int capacity, out int nranges, out int ncopied);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_getmtu", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError GetMtu(int sockfd, out int mtu);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setreuseport", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetReusePort(int sockfd, int value);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setsteering", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetSteering(int sockfd, int count);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setconnreset", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SetConnReset(int sockfd, int value);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_bind", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError Bind(int sockfd, ref IPEndPoint endPoint);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_connect", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError Connect(int sockfd, in IPEndPoint endPoint);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_available", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError Available(int sockfd, out int value);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_poll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError Poll(int sockfd, int microSeconds, SelectMode mode, out int result);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvfrom", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveFrom(int sockfd, byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int nbytes, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvmany", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveMany(int sockfd, byte[] buffer, int offset, int stride, int count, [Out] IPEndPoint[] endPoints, [Out] int[] lengths, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvmany_addressed", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveManyAddressed(int sockfd, byte[] buffer, int offset, int stride, int count, [Out] IPEndPoint[] endPoints, [Out] int[] lengths, [Out] int[] ages, [Out] ECN[] marks, [Out] IPEndPoint[] destinations, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvfrom_segmented", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveFrom(int sockfd, byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int nbytes, out int segment, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvmany_segmented", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveManySegmented(int sockfd, byte[] buffer, int offset, int stride, int count, [Out] IPEndPoint[] endPoints, [Out] int[] lengths, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendto", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendTo(int sockfd, byte[] buffer, int offset, int size, in IPEndPoint endPoint, out int nbytes, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendmany", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendMany(int sockfd, byte[] buffer, int offset, int stride, int index, int count, [In] IPEndPoint[] endPoints, [In] int[] lengths, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendmany_paced", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendManyPaced(int sockfd, byte[] buffer, int offset, int stride, int index, int count, [In] IPEndPoint[] endPoints, [In] int[] lengths, [In] int[] delays, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendto_segmented", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendTo(int sockfd, byte[] buffer, int offset, int size, int segment, in IPEndPoint endPoint, out int nbytes, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendmany_segmented", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendManySegmented(int sockfd, byte[] buffer, int offset, int stride, int index, int count, [In] IPEndPoint[] endPoints, [In] int[] lengths, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendmany_sourced", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError SendManySourced(int sockfd, byte[] buffer, int offset, int stride, int index, int count, [In] IPEndPoint[] endPoints, [In] IPEndPoint[] sources, [In] int[] lengths, [In] int[] delays, int zerocopy, int segmented, out int nmessages, out int nnotifications, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_ring_open", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError OpenRing(int sockfd, int size, int capacity, out IntPtr ring, out int ringfd);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_ring_close", CallingConvention = CallingConvention.Cdecl)]
+        public static extern void CloseRing(IntPtr ring);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_ring_recvmany", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError ReceiveMany(IntPtr ring, byte[] buffer, int offset, int stride, int count, [Out] IPEndPoint[] endPoints, [Out] int[] lengths, out int nmessages, IntPtr stats);
+
+        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_ring_wait", CallingConvention = CallingConvention.Cdecl)]
+        public static extern SocketError WaitRing(IntPtr ring, int microSeconds, out int result);
+    }
+
+#endif
+    
+    internal static partial class Fallback
+    {
+        public sealed class Socket: ISocket
+        {
+            private SystemSocket socket;
+
+            public Socket(AddressFamily addressFamily) => socket = new SystemSocket(addressFamily, SocketType.Dgram, ProtocolType.Udp);
+
+            private long receiveCalls;
+            private long received;
+            private long receivedBytes;
+            private long truncated;
+            private long receiveWouldBlock;
+            private long receiveErrors;
+            private long sendCalls;
+            private long sent;
+            private long sentBytes;
+            private long sendWouldBlock;
+            private long sendErrors;
+
+            public SocketCounters Counters => new SocketCounters(
+                Interlocked.Read(ref receiveCalls), Interlocked.Read(ref received), Interlocked.Read(ref receivedBytes), Interlocked.Read(ref truncated), 0, Interlocked.Read(ref receiveWouldBlock), Interlocked.Read(ref receiveErrors),
+                Interlocked.Read(ref sendCalls), Interlocked.Read(ref sent), Interlocked.Read(ref sentBytes), Interlocked.Read(ref sendWouldBlock), Interlocked.Read(ref sendErrors));
+            
+            public bool Blocking
+            {
+                get => socket.Blocking;
+                set => socket.Blocking = value;
+            }
+
+            public AddressFamily AddressFamily => socket.AddressFamily;
+
+            public int Available => socket.Available;
+
+            public IPEndPoint LocalEndPoint { get; private set; }
+
+            public bool IsBound => socket.IsBound;
+
+            public bool ExclusiveAddressUse
+            {
+                get => socket.ExclusiveAddressUse;
+                set => socket.ExclusiveAddressUse = value;
+            }
+
+            public int ReceiveBufferSize
+            {
+                get => socket.ReceiveBufferSize;
+                set => socket.ReceiveBufferSize = value;
+            }
+
+            public int SendBufferSize
+            {
+                get => socket.SendBufferSize;
+                set => socket.SendBufferSize = value;
+            }
+
+            public int ReceiveTimeout
+            {
+                get => socket.ReceiveTimeout;
+                set => socket.ReceiveTimeout = value;
+            }
+
+            public int SendTimeout
+            {
+                get => socket.SendTimeout;
+                set => socket.ReceiveTimeout = value;
+            }
+
+            public short Ttl
+            {
+                get => socket.Ttl;
+                set => socket.Ttl = value;
+            }
+
+            public bool DontFragment
+            {
+                get => socket.DontFragment;
+
+                set => socket.DontFragment = value;
+            }
+
+            public bool DualMode
+            {
+                get => socket.DualMode;
+
+                set => socket.DualMode = value;
+            }
+
+            /// <summary>
+            /// UDP offloads are not available through System.Net.Sockets so this is always <see cref="Offload.None"/>.
+            /// </summary>
+            public Offload Offload
+            {
+                get => Offload.None;
+
+                set { }
+            }
+
+            /// <summary>
+            /// There's no completion queue in System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool CompletionQueue => false;
+
+            public bool UseCompletionQueue(int size, int capacity) => false;
+
+            /// <summary>
+            /// Port sharing with load distribution cannot be portably requested through System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool ReusePort
+            {
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// Kernel timestamps are not available through System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool Timestamping
+            {
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// Path MTU discovery modes are not available through System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool MtuProbing
+            {
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// The ECN codepoint of a datagram received is not available through System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool Ecn
+            {
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// Pacing options are not available through System.Net.Sockets so this is always <see cref="Pacing.None"/>.
+            /// </summary>
+            public Pacing Pacing
+            {
+                get => Pacing.None;
+
+                set { }
+            }
+
+            public uint PacingRate
+            {
+                get => 0;
+
+                set { }
+            }
+
+            /// <summary>
+            /// Zero copy send is not available through System.Net.Sockets so this is always false.
+            /// </summary>
+            public bool ZeroCopy
+            {
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// Packet information is not exposed by System.Net.Sockets in a way that can be used with batches 
+            /// so this is always false.
+            /// </summary>
+            public bool PacketInformation
+            {
+                get => false;
+
+                set { }
+            }
+
+            public int PathMtu => 0;
+
+            public bool AttachSteering(int count) => false;
+
+            public IPEndPoint RemoteEndPoint => default;
+
+            /// <summary>
+            /// Not supported. Sending to an explicit end point is not allowed on a connected socket on some 
+            /// platforms and System.Net.Sockets has no batch send that could omit it.
+            /// </summary>
+            public bool Connect(in IPEndPoint endPoint) => false;
+
+            public void SetIPProtectionLevel(IPProtectionLevel level) => socket.SetIPProtectionLevel(level);
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue) => socket.SetSocketOption(optionLevel, optionName, optionValue);
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue) => socket.SetSocketOption(optionLevel, optionName, optionValue);
+
+            public int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName) => (int)socket.GetSocketOption(optionLevel, optionName);
+
+            private readonly byte[] ipv4 = new byte[4];
+            private readonly byte[] ipv6 = new byte[16];
+
+            private static readonly SystemIPEndPoint anyIPv4 = new SystemIPEndPoint(SystemIPAddress.Any, 0);
+            private static readonly SystemIPEndPoint anyIPv6 = new SystemIPEndPoint(SystemIPAddress.IPv6Any, 0);
+
+            private const int SIO_UDP_CONNRESET = -1744830452; //SIO_UDP_CONNRESET = IOC_IN | IOC_VENDOR | 12
+            private readonly static byte[] DISABLED = new byte[] { 0 };
+
+            public void Bind(in IPEndPoint endPoint)
+            {
+                if (endPoint.Address.AddressFamily == AddressFamily.InterNetwork)
+                {
+                    endPoint.Address.SerializeIPv4(ipv4);
+                    socket.Bind(new SystemIPEndPoint(new SystemIPAddress(ipv4), endPoint.Port));
+                }
+                else
+                {
+                    endPoint.Address.SerializeIPv6(ipv6);
+                    socket.Bind(new SystemIPEndPoint(new SystemIPAddress(ipv6), endPoint.Port));
+                }
+
+                // Ignore ICMP PORT_UNREACHABLE packets.
+                if (RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
+                    socket.IOControl(SIO_UDP_CONNRESET, DISABLED, null);
+
+                LocalEndPoint = new IPEndPoint(socket.LocalEndPoint as SystemIPEndPoint);
+            }
+
+            public bool Poll(int microSeconds, SelectMode mode) => socket.Poll(microSeconds, mode);
+
+            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint)
+            {
+                var ep = (EndPoint)(socket.AddressFamily == AddressFamily.InterNetworkV6 ? anyIPv6 : anyIPv4);
+                int length;
+
+                Interlocked.Increment(ref receiveCalls);
+                try
+                {
+                    length = socket.ReceiveFrom(buffer, offset, size, SocketFlags.None, ref ep);
+                }
+                catch (SocketException e)
+                {
+                    switch (e.SocketErrorCode)
+                    {
+                        case SocketError.MessageSize:
+                            Interlocked.Increment(ref received);
+                            Interlocked.Increment(ref truncated);
+                            break;
+                        case SocketError.WouldBlock:
+                        case SocketError.TimedOut:
+                            Interlocked.Increment(ref receiveWouldBlock);
+                            break;
+                        default:
+                            Interlocked.Increment(ref receiveErrors);
+                            break;
+                    }
+
+                    throw;
+                }
 
-            private int handle;
-            private bool blocking;
+                Interlocked.Increment(ref received);
+                Interlocked.Add(ref receivedBytes, length);
 
-            public bool Blocking
-            {
-                get => blocking;
-                set
+                if (ep is SystemIPEndPoint ip)
                 {
-                    if (handle < 0)
-                        throw new ObjectDisposedException(GetType().FullName);
-
-                    var socketError = Native.SetBlocking(handle, value ? 1 : 0);
-                    if (socketError != SocketError.Success)
-                        throw new SocketException((int)socketError);
-
-                    blocking = value;
+                    endPoint = new IPEndPoint(new IPAddress(ip.Address.GetAddressBytes()), (ushort)ip.Port);
+                    return length;
                 }
+
+                endPoint = default;
+                return 0;
             }
 
-            #pragma warning disable IDE0044
-            private AddressFamily addressFamily;
-            public AddressFamily AddressFamily => addressFamily;
-            #pragma warning restore IDE0044
+            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize)
+            {
+                // Datagrams are never coalesced.
+                segmentSize = ReceiveFrom(buffer, offset, size, out endPoint);
+                return segmentSize;
+            }
 
-            public int Available
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths)
             {
-                get
+                // There's no batch receive in System.Net.Sockets so just drain what is immediately available.
+                var n = 0;
+                do
                 {
-                    if (handle < 0)
-                        throw new ObjectDisposedException(GetType().FullName);
+                    try
+                    {
+                        lengths[n] = ReceiveFrom(buffer, offset + n * stride, stride, out endPoints[n]);
+                    }
+                    catch (SocketException e)
+                    {
+                        if (e.SocketErrorCode != SocketError.MessageSize)
+                        {
+                            if (n > 0)
+                                break;
 
-                    var socketError = Native.Available(handle, out int value);
-                    if (socketError != SocketError.Success)
-                        throw new SocketException((int)socketError);
+                            throw;
+                        }
 
-                    return value;
+                        // Datagram was truncated so it's as good as lost.
+                        endPoints[n] = default;
+                        lengths[n] = 0;
+                    }
+
+                    n++;
                 }
+                while (n < count && socket.Available > 0);
+
+                return n;
             }
 
-            public IPEndPoint LocalEndPoint { get; private set; }
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, null);
 
-            public bool IsBound => LocalEndPoint != default;
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, null);
 
-            public bool ExclusiveAddressUse
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations)
             {
-                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ExclusiveAddressUse) != 0;
+                var n = ReceiveMany(buffer, offset, stride, count, endPoints, lengths);
+                if (ages != null)
+                    Array.Clear(ages, 0, n);
+                if (marks != null)
+                    Array.Clear(marks, 0, n);
+                if (destinations != null)
+                    Array.Clear(destinations, 0, n);
+                return n;
+            }
 
-                set
+            public int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
+            {
+                SystemIPEndPoint ip;
+                if (endPoint.Address.AddressFamily == AddressFamily.InterNetwork)
                 {
-                    if (IsBound)
-                        throw new InvalidOperationException(SR.Socket.AlreadyBound);
+                    endPoint.Address.SerializeIPv4(ipv4);
+                    ip = new SystemIPEndPoint(new SystemIPAddress(ipv4), endPoint.Port);
+                }
+                else
+                {
+                    endPoint.Address.SerializeIPv6(ipv6);
+                    ip = new SystemIPEndPoint(new SystemIPAddress(ipv6), endPoint.Port);
+                }
+            
+                Interlocked.Increment(ref sendCalls);
+                try
+                {
+                    var n = socket.SendTo(buffer, offset, size, SocketFlags.None, ip);
+                    Interlocked.Increment(ref sent);
+                    Interlocked.Add(ref sentBytes, n);
+                    return n;
+                }
+                catch (SocketException e)
+                {
+                    if (e.SocketErrorCode == SocketError.WouldBlock || e.SocketErrorCode == SocketError.NoBufferSpaceAvailable)
+                        Interlocked.Increment(ref sendWouldBlock);
+                    else
+                        Interlocked.Increment(ref sendErrors);
 
-                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ExclusiveAddressUse, value ? 1 : 0);
+                    throw;
                 }
             }
 
-            public int ReceiveBufferSize
+            public int SendTo(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint)
             {
-                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveBuffer);
-
-                set
+                // There's no segmentation offload in System.Net.Sockets so just send one segment at a time.
+                var n = 0;
+                while (n < size)
                 {
-                    if (value < 0)
-                        throw new ArgumentOutOfRangeException(nameof(value));
+                    try
+                    {
+                        n += SendTo(buffer, offset + n, Math.Min(segmentSize, size - n), in endPoint);
+                    }
+                    catch (SocketException)
+                    {
+                        if (n > 0)
+                            break;
 
-                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveBuffer, value);
+                        throw;
+                    }
                 }
-            }
 
-            public int SendBufferSize
-            {
-                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendBuffer);
+                return n;
+            }
 
-                set
-                {
-                    if (value < 0)
-                        throw new ArgumentOutOfRangeException(nameof(value));
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, int[] delays) => SendMany(buffer, offset, stride, index, count, endPoints, lengths);
 
-                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendBuffer, value);
-                }
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, IPEndPoint[] sources, int[] lengths, int[] delays, bool zeroCopy, out int notifications)
+            {
+                notifications = 0;
+                return SendMany(buffer, offset, stride, index, count, endPoints, lengths);
             }
 
-            public int ReceiveTimeout
+            public int ReceiveCompletions(uint[] ranges, out int copied)
             {
-                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveTimeout);
+                copied = 0;
+                return 0;
+            }
 
-                set
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths)
+            {
+                // There's no batch send in System.Net.Sockets so just send one datagram at a time.
+                var n = 0;
+                do
                 {
-                    if (value < -1)
-                        throw new ArgumentOutOfRangeException(nameof(value));
+                    var i = index + n;
+                    try
+                    {
+                        SendTo(buffer, offset + i * stride, lengths[i], in endPoints[i]);
+                    }
+                    catch (SocketException)
+                    {
+                        if (n > 0)
+                            break;
 
-                    if (value == -1)
-                        value = 0;
+                        throw;
+                    }
 
-                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.ReceiveTimeout, value);
+                    n++;
                 }
+                while (n < count);
+
+                return n;
             }
+            public void Close() => socket.Close();
 
-            public int SendTimeout
-            {
-                get => GetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendTimeout);
+            public void Dispose() => socket.Dispose();
+        }
+    }
 
-                set
-                {
-                    if (value < -1)
-                        throw new ArgumentOutOfRangeException(nameof(value));
-                    if (value == -1)
-                        value = 0;
+    /// <summary>
+    /// In-process transport for load generation and deterministic benchmarks. Sockets exchange datagrams through 
+    /// memory without ever reaching the network stack so any number of hosts in the same process can talk to each 
+    /// other free of kernel noise and without consuming file descriptors.
+    /// <para/>
+    /// All sockets share a single port namespace regardless of address family or address so a datagram sent to 
+    /// any address reaches the socket bound to the destination port, if any. Datagrams sent to a port that is not 
+    /// bound are silently lost like they would be over UDP.
+    /// </summary>
+    internal static partial class Loopback
+    {
+        /// <summary>
+        /// Range of ports assigned to sockets bound to port zero.
+        /// </summary>
+        private const int EphemeralPortMin = 49152;
+        private const int EphemeralPortCount = 65536 - EphemeralPortMin;
 
-                    SetSocketOption(SocketOptionLevel.Socket, SocketOptionName.SendTimeout, value);
-                }
+        private static readonly ConcurrentDictionary<ushort, Socket> ports = new ConcurrentDictionary<ushort, Socket>();
+
+        private static int ephemeralPort = -1;
+
+        /// <summary>
+        /// Silently drop datagrams larger than <paramref name="size"/> bytes sent from <paramref name="port"/> like a path 
+        /// that does not report its MTU would (a black hole). Zero removes the limit. Only meant for tests.
+        /// </summary>
+        internal static void SetBlackHole(ushort port, int size)
+        {
+            if (ports.TryGetValue(port, out Socket socket))
+                socket.BlackHole = size;
+        }
+
+        /// <summary>
+        /// Single-producer single-consumer queue of datagrams from one socket to another. Only the thread 
+        /// sending on the source socket may enqueue and only the thread receiving on the target socket may dequeue.
+        /// </summary>
+        private sealed class Ring
+        {
+            /// <summary>
+            /// Minimum size of a slot buffer so that it's not reallocated for most datagrams.
+            /// </summary>
+            private const int MinSlotSize = Protocol.MTU.Default;
+
+            public readonly Socket Owner;
+            public readonly Socket Target;
+
+            /// <summary>
+            /// Source end point reported to the target.
+            /// </summary>
+            public readonly IPEndPoint EndPoint;
+
+            private readonly byte[][] buffers;
+            private readonly int[] lengths;
+            private readonly long[] stamps;
+            private readonly ECN[] marks;
+            private readonly int mask;
+
+            private ConcurrentRingPositions positions;
+
+            /// <param name="owner">Socket that sends through the ring.</param>
+            /// <param name="target">Socket that receives from the ring.</param>
+            /// <param name="endPoint">Source end point reported to the target.</param>
+            /// <param name="capacity">Maximum number of datagrams. Must be a power of 2.</param>
+            public Ring(Socket owner, Socket target, in IPEndPoint endPoint, int capacity)
+            {
+                Owner = owner;
+                Target = target;
+                EndPoint = endPoint;
+                buffers = new byte[capacity][];
+                lengths = new int[capacity];
+                stamps = new long[capacity];
+                marks = new ECN[capacity];
+                mask = capacity - 1;
             }
 
-            public short Ttl
+            public bool IsEmpty => Volatile.Read(ref positions.Tail) == Volatile.Read(ref positions.Head);
+
+            /// <summary>
+            /// Length of the next datagram or -1 if the ring is empty. Must only be called by the consumer.
+            /// </summary>
+            public int Peek()
             {
-                get
-                {
-                    if (addressFamily == AddressFamily.InterNetwork)
-                        return (short)GetSocketOption(SocketOptionLevel.IP, SocketOptionName.IpTimeToLive);
+                var head = positions.Head;
+                return (Volatile.Read(ref positions.Tail) == head) ? -1 : lengths[head & mask];
+            }
 
-                    if (addressFamily == AddressFamily.InterNetworkV6)
-                        return (short)GetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IpTimeToLive);
+            /// <summary>
+            /// An ECN-capable datagram is marked <see cref="ECN.CongestionExperienced"/> if the ring is at least half full 
+            /// like a router with active queue management would do before it has to drop anything.
+            /// </summary>
+            public bool TryEnqueue(byte[] buffer, int offset, int size, long stamp, ECN mark)
+            {
+                var tail = positions.Tail;
+                var length = tail - Volatile.Read(ref positions.Head);
+                if (length == buffers.Length)
+                    return false;
+
+                if (mark != ECN.NotCapable && length >= buffers.Length >> 1)
+                    mark = ECN.CongestionExperienced;
+
+                var index = tail & mask;
+                var slot = buffers[index];
+                if (slot == null || slot.Length < size)
+                    buffers[index] = slot = new byte[Math.Max(size, MinSlotSize)];
+
+                Buffer.BlockCopy(buffer, offset, slot, 0, size);
+                lengths[index] = size;
+                stamps[index] = stamp;
+                marks[index] = mark;
+
+                Volatile.Write(ref positions.Tail, tail + 1);
+                return true;
+            }
 
-                    throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+            /// <summary>
+            /// Copy the next datagram into <paramref name="buffer"/> up to <paramref name="size"/> bytes.
+            /// </summary>
+            /// <returns>Length of the datagram (that may be greater than <paramref name="size"/>) or -1 if the ring is empty.</returns>
+            public int TryDequeue(byte[] buffer, int offset, int size, out long stamp, out ECN mark)
+            {
+                var head = positions.Head;
+                if (Volatile.Read(ref positions.Tail) == head)
+                {
+                    stamp = 0;
+                    mark = ECN.NotCapable;
+                    return -1;
                 }
 
-                set
-                {
-                    if (value < 0 || value > byte.MaxValue)
-                        throw new ArgumentOutOfRangeException(nameof(value));
+                var index = head & mask;
+                var length = lengths[index];
+                Buffer.BlockCopy(buffers[index], 0, buffer, offset, Math.Min(length, size));
+                stamp = stamps[index];
+                mark = marks[index];
 
-                    if (addressFamily == AddressFamily.InterNetwork)
-                        SetSocketOption(SocketOptionLevel.IP, SocketOptionName.IpTimeToLive, (int)value);
-                    else if (addressFamily == AddressFamily.InterNetworkV6)
-                        SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IpTimeToLive, (int)value);
-                    else
-                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
-                }
+                Volatile.Write(ref positions.Head, head + 1);
+                return length;
             }
+        }
 
-            public bool DontFragment
-            {
-                get => addressFamily == AddressFamily.InterNetwork && GetSocketOption(SocketOptionLevel.IP, SocketOptionName.DontFragment) != 0;
+        /// <summary>
+        /// A socket that delivers datagrams to other sockets in the same process through a ring per pair of sockets. 
+        /// Each ring holds as many datagrams as the receive buffer of the target would if they were 
+        /// <see cref="AverageDatagramSize"/> bytes on average and any datagram that does not fit is dropped and 
+        /// counted as an overflow of the target.
+        /// <para/>
+        /// Rings are single-producer single-consumer so, like the host does with any socket, a socket must only be used 
+        /// to send by one thread at a time and to receive by one thread at a time. There is no descriptor to wait on 
+        /// so sockets can only be watched by <see cref="Fallback.Poller"/>.
+        /// </summary>
+        public sealed class Socket: ISocket
+        {
+            private const int AverageDatagramSize = 128;
+            private const int MinRingCapacity = 64;
+            private const int MaxRingCapacity = 8192;
 
-                set
-                {
-                    if (addressFamily != AddressFamily.InterNetwork)
-                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+            private static readonly double TicksToMicrosecondsFactor = 1000000.0 / Stopwatch.Frequency;
 
-                    SetSocketOption(SocketOptionLevel.IP, SocketOptionName.DontFragment, value ? 1 : 0);
-                }
+            /// <summary>
+            /// Guards <see cref="incoming"/> updates and is used to wait for datagrams.
+            /// </summary>
+            private readonly object sync = new object();
+
+            /// <summary>
+            /// Non-zero while the receiving thread is (about to be) waiting on <see cref="sync"/>.
+            /// </summary>
+            private int waiting;
+
+            private bool closed;
+
+            private int blackHole;
+
+            /// <summary>
+            /// Datagrams larger than this are lost if non-zero (see <see cref="SetBlackHole"/>).
+            /// </summary>
+            internal int BlackHole
+            {
+                get => Volatile.Read(ref blackHole);
+                set => Volatile.Write(ref blackHole, value);
             }
 
-            public bool DualMode
+            /// <summary>
+            /// Rings from every socket that has sent something to this one. Replaced as a whole (copy-on-write) 
+            /// so the receiving thread can iterate without locking.
+            /// </summary>
+            private Ring[] incoming = Array.Empty<Ring>();
+
+            /// <summary>
+            /// Index of the next ring to receive from so that sources are served in turns.
+            /// </summary>
+            private int cursor;
+
+            /// <summary>
+            /// Rings to every socket this one has sent something to by destination port. Only used by the sending thread.
+            /// </summary>
+            private readonly Dictionary<ushort, Ring> outgoing = new Dictionary<ushort, Ring>();
+
+            private readonly Dictionary<(SocketOptionLevel, SocketOptionName), int> options = new Dictionary<(SocketOptionLevel, SocketOptionName), int>();
+
+            private long receiveCalls;
+            private long received;
+            private long receivedBytes;
+            private long truncated;
+            private long overflows;
+            private long receiveWouldBlock;
+            private long receiveErrors;
+            private long sendCalls;
+            private long sent;
+            private long sentBytes;
+
+            public Socket(AddressFamily addressFamily)
             {
-                get => (addressFamily == AddressFamily.InterNetworkV6) && GetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPv6Only) == 0;
+                if (addressFamily != AddressFamily.InterNetwork && addressFamily != AddressFamily.InterNetworkV6)
+                    throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
 
-                set
+                AddressFamily = addressFamily;
+            }
+
+            public SocketCounters Counters => new SocketCounters(
+                Interlocked.Read(ref receiveCalls), Interlocked.Read(ref received), Interlocked.Read(ref receivedBytes), Interlocked.Read(ref truncated), Interlocked.Read(ref overflows), Interlocked.Read(ref receiveWouldBlock), Interlocked.Read(ref receiveErrors),
+                Interlocked.Read(ref sendCalls), Interlocked.Read(ref sent), Interlocked.Read(ref sentBytes), 0, 0);
+
+            public bool Blocking { get; set; } = true;
+
+            public AddressFamily AddressFamily { get; }
+
+            public int Available
+            {
+                get
                 {
-                    if (addressFamily != AddressFamily.InterNetworkV6)
-                        throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+                    var rings = Volatile.Read(ref incoming);
+                    for (int i = 0; i < rings.Length; ++i)
+                    {
+                        var length = rings[i].Peek();
+                        if (length >= 0)
+                            return length;
+                    }
 
-                    SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPv6Only, value ? 0 : 1);
+                    return 0;
                 }
             }
 
-            public void SetIPProtectionLevel(IPProtectionLevel level)
-            {
-                if (level == IPProtectionLevel.Unspecified)
-                    throw new ArgumentException("Invalid value", nameof(level));
+            public IPEndPoint LocalEndPoint { get; private set; }
 
-                if (addressFamily == AddressFamily.InterNetwork)
-                    SetSocketOption(SocketOptionLevel.IP, SocketOptionName.IPProtectionLevel, (int)level);
-                else if (addressFamily == AddressFamily.InterNetworkV6)
-                    SetSocketOption(SocketOptionLevel.IPv6, SocketOptionName.IPProtectionLevel, (int)level);
+            public bool IsBound { get; private set; }
 
-                throw new NotSupportedException(string.Format(SR.Socket.AddressFamilyNotSupported, addressFamily));
+            public bool ExclusiveAddressUse { get; set; }
+
+            public int ReceiveBufferSize { get; set; } = 8192;
+
+            public int SendBufferSize { get; set; } = 8192;
+
+            public int ReceiveTimeout { get; set; }
+
+            public int SendTimeout { get; set; }
+
+            public short Ttl { get; set; } = Protocol.TTL.Default;
+
+            public bool DontFragment { get; set; }
+
+            public bool DualMode { get; set; }
+
+            /// <summary>
+            /// Datagrams are copied one by one so there's nothing to offload and this is always <see cref="Offload.None"/>.
+            /// </summary>
+            public Offload Offload
+            {
+                get => Offload.None;
+
+                set { }
             }
 
-            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue) => SetSocketOption(optionLevel, optionName, optionValue ? 1 : 0);
+            public bool CompletionQueue => false;
 
-            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue)
+            public bool UseCompletionQueue(int size, int capacity) => false;
+
+            /// <summary>
+            /// Ports cannot be shared so this is always false.
+            /// </summary>
+            public bool ReusePort
             {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
+                get => false;
 
-                CheckSetOptionPermissions(optionLevel, optionName);
+                set { }
+            }
 
-                var socketError = Native.SetSocketOption(handle, optionLevel, optionName, optionValue);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+            /// <summary>
+            /// Datagrams are timestamped when they are enqueued by the sender.
+            /// </summary>
+            public bool Timestamping { get; set; }
+
+            /// <summary>
+            /// Datagrams are never fragmented in memory so probing is always possible.
+            /// </summary>
+            public bool MtuProbing { get; set; }
+
+            /// <summary>
+            /// Datagrams are ECN-capable if both sender and receiver have it enabled and are marked when the ring 
+            /// to the receiver is at least half full.
+            /// </summary>
+            public bool Ecn { get; set; }
+
+            /// <summary>
+            /// Datagrams are delivered in memory as soon as they are sent so this is always <see cref="Pacing.None"/>.
+            /// </summary>
+            public Pacing Pacing
+            {
+                get => Pacing.None;
+
+                set { }
             }
 
-            public int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName)
+            public uint PacingRate
             {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
+                get => 0;
 
-                var socketError = Native.GetSocketOption(handle, optionLevel, optionName, out int optionValue);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+                set { }
+            }
 
-                return optionValue;
+            /// <summary>
+            /// Datagrams are always copied into the ring of the receiver so this is always false.
+            /// </summary>
+            public bool ZeroCopy
+            {
+                get => false;
+
+                set { }
             }
 
-            private static void CheckSetOptionPermissions(SocketOptionLevel optionLevel, SocketOptionName optionName)
+            /// <summary>
+            /// Every socket has a single address so there's no source to choose and this is always false.
+            /// </summary>
+            public bool PacketInformation
             {
-                if (optionLevel == SocketOptionLevel.Udp && (optionName == SocketOptionName.Debug || optionName == SocketOptionName.ChecksumCoverage)
-                 || optionLevel == SocketOptionLevel.Socket && (optionName == SocketOptionName.ReuseAddress || optionName == SocketOptionName.DontLinger || optionName == SocketOptionName.SendBuffer || optionName == SocketOptionName.ReceiveBuffer || optionName == SocketOptionName.SendTimeout || optionName == SocketOptionName.ExclusiveAddressUse || optionName == SocketOptionName.ReceiveTimeout)
-                 || optionLevel == SocketOptionLevel.IP && (optionName == SocketOptionName.TypeOfService || optionName == SocketOptionName.IpTimeToLive || optionName == SocketOptionName.DontFragment)
-                 || optionLevel == SocketOptionLevel.IPv6 && (optionName == SocketOptionName.IpTimeToLive || optionName == SocketOptionName.IPProtectionLevel || optionName == SocketOptionName.IPv6Only || optionName == SocketOptionName.HopLimit))
-                    return;
+                get => false;
+
+                set { }
+            }
+
+            /// <summary>
+            /// There's no path to speak of so this is always zero.
+            /// </summary>
+            public int PathMtu => 0;
+
+            public bool AttachSteering(int count) => false;
 
-                throw new NotSupportedException();
-            }
+            public IPEndPoint RemoteEndPoint => default;
+
+            /// <summary>
+            /// Not supported. There's no route lookup to save in process.
+            /// </summary>
+            public bool Connect(in IPEndPoint endPoint) => false;
+
+            public void SetIPProtectionLevel(IPProtectionLevel level) { }
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue) => SetSocketOption(optionLevel, optionName, optionValue ? 1 : 0);
+
+            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue) => options[(optionLevel, optionName)] = optionValue;
+
+            public int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName) => options.TryGetValue((optionLevel, optionName), out int value) ? value : 0;
 
             public void Bind(in IPEndPoint endPoint)
             {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
+                ThrowIfClosed();
 
-                IPEndPoint localEndPoint = endPoint;
-                var socketError = Native.Bind(handle, ref localEndPoint);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+                if (IsBound)
+                    throw new SocketException((int)SocketError.InvalidArgument);
 
-                LocalEndPoint = localEndPoint;
+                var port = endPoint.Port;
+                if (port == 0)
+                {
+                    var i = 0;
+                    for (; i < EphemeralPortCount; ++i)
+                    {
+                        port = (ushort)(EphemeralPortMin + (Interlocked.Increment(ref ephemeralPort) & int.MaxValue) % EphemeralPortCount);
+                        if (ports.TryAdd(port, this))
+                            break;
+                    }
+
+                    if (i == EphemeralPortCount)
+                        throw new SocketException((int)SocketError.AddressAlreadyInUse);
+                }
+                else if (!ports.TryAdd(port, this))
+                {
+                    throw new SocketException((int)SocketError.AddressAlreadyInUse);
+                }
+
+                // Receivers see datagrams coming from a loopback address rather than the wildcard.
+                var address = endPoint.Address;
+                if (address == IPAddress.Any)
+                    address = IPAddress.Loopback;
+                else if (address == IPAddress.IPv6Any)
+                    address = IPAddress.IPv6Loopback;
+
+                LocalEndPoint = new IPEndPoint(address, port);
+                IsBound = true;
             }
 
             public bool Poll(int microSeconds, SelectMode mode)
             {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
-
-                var socketError = Native.Poll(handle, microSeconds, mode, out int result);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+                ThrowIfClosed();
 
-                return result > 0;
+                switch (mode)
+                {
+                    case SelectMode.SelectRead:
+                        return Wait(microSeconds);
+                    case SelectMode.SelectWrite:
+                        return true;
+                    default:
+                        return false;
+                }
             }
 
             public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint)
             {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
+                ThrowIfClosed();
 
-                var socketError = Native.ReceiveFrom(handle, buffer, offset, size, out endPoint, out int nbytes);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+                Interlocked.Increment(ref receiveCalls);
 
-                return nbytes;
-            }
+                var length = Dequeue(buffer, offset, size, out endPoint, out _, out _);
+                if (length < 0 && Blocking && Wait(ReceiveTimeout > 0 ? ReceiveTimeout * 1000 : Timeout.Infinite))
+                    length = Dequeue(buffer, offset, size, out endPoint, out _, out _);
 
-            public int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
-            {
-                if (handle < 0)
-                    throw new ObjectDisposedException(GetType().FullName);
+                if (length < 0)
+                {
+                    Interlocked.Increment(ref receiveWouldBlock);
+                    throw new SocketException((int)(Blocking ? SocketError.TimedOut : SocketError.WouldBlock));
+                }
 
-                var socketError = Native.SendTo(handle, buffer, offset, size, in endPoint, out int nbytes);
-                if (socketError != SocketError.Success)
-                    throw new SocketException((int)socketError);
+                Interlocked.Increment(ref received);
+                if (length > size)
+                {
+                    Interlocked.Increment(ref truncated);
+                    throw new SocketException((int)SocketError.MessageSize);
+                }
 
-                return nbytes;
+                Interlocked.Add(ref receivedBytes, length);
+                return length;
             }
 
-            public void Close() => Dispose();
-
-            public void Dispose()
+            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int segmentSize)
             {
-                OnDisposed(true);
-                GC.SuppressFinalize(this);
+                // Datagrams are never coalesced.
+                segmentSize = ReceiveFrom(buffer, offset, size, out endPoint);
+                return segmentSize;
             }
 
-            ~Socket() => OnDisposed(false);
-
-            private void OnDisposed(bool disposing)
-            {
-                var value = Interlocked.Exchange(ref handle, -1);
-                if (value < 0)
-                    return;
-
-                Native.Close(value);
-            }
-        }
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, null, null);
 
-#if __IOS__ || UNITY_IOS && !UNITY_EDITOR
-        private const string nativeLibrary = "__Internal";
-#else
-        private const string nativeLibrary = "Carambolas.Net.Native.dll";
-#endif
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, null);
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_initialize", CallingConvention = CallingConvention.Cdecl)]
-        public static extern int Initialize();
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks) => ReceiveMany(buffer, offset, stride, count, endPoints, lengths, ages, marks, null);
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_open", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError Open(AddressFamily addressFamily, out int sockfd);
+            /// <summary>
+            /// Unlike a system socket, returns zero instead of failing with <see cref="SocketError.WouldBlock"/> 
+            /// if there's no datagram available in non-blocking mode as there's no system call to fail. 
+            /// Destinations are always unknown as every socket has a single address.
+            /// </summary>
+            public int ReceiveMany(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks, IPEndPoint[] destinations)
+            {
+                ThrowIfClosed();
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_close", CallingConvention = CallingConvention.Cdecl)]
-        public static extern void Close(int sockfd);
+                Interlocked.Increment(ref receiveCalls);
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setsockopt", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError SetSocketOption(int sockfd, SocketOptionLevel level, SocketOptionName optionName, int optionValue);
+                var n = Receive(buffer, offset, stride, count, endPoints, lengths, ages, marks);
+                if (n == 0 && Blocking)
+                {
+                    if (!Wait(ReceiveTimeout > 0 ? ReceiveTimeout * 1000 : Timeout.Infinite))
+                    {
+                        Interlocked.Increment(ref receiveWouldBlock);
+                        throw new SocketException((int)SocketError.TimedOut);
+                    }
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_getsockopt", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError GetSocketOption(int sockfd, SocketOptionLevel level, SocketOptionName optionName, out int optionValue);
+                    n = Receive(buffer, offset, stride, count, endPoints, lengths, ages, marks);
+                }
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setblocking", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError SetBlocking(int sockfd, int value);
+                if (n == 0)
+                    Interlocked.Increment(ref receiveWouldBlock);
+                else if (destinations != null)
+                    Array.Clear(destinations, 0, n);
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_setconnreset", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError SetConnReset(int sockfd, int value);
+                return n;
+            }
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_bind", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError Bind(int sockfd, ref IPEndPoint endPoint);
+            private int Receive(byte[] buffer, int offset, int stride, int count, IPEndPoint[] endPoints, int[] lengths, int[] ages, ECN[] marks)
+            {
+                var now = (ages != null && Timestamping) ? Stopwatch.GetTimestamp() : 0;
+                var bytes = 0L;
+                var ntruncated = 0;
+                var n = 0;
+                for (; n < count; ++n)
+                {
+                    var length = Dequeue(buffer, offset + n * stride, stride, out endPoints[n], out long stamp, out ECN mark);
+                    if (length < 0)
+                        break;
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_available", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError Available(int sockfd, out int value);
+                    if (length > stride)
+                    {
+                        // Datagram was truncated so it's as good as lost.
+                        endPoints[n] = default;
+                        length = 0;
+                        ntruncated++;
+                    }
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_poll", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError Poll(int sockfd, int microSeconds, SelectMode mode, out int result);
+                    lengths[n] = length;
+                    bytes += length;
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_recvfrom", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError ReceiveFrom(int sockfd, byte[] buffer, int offset, int size, out IPEndPoint endPoint, out int nbytes);
+                    if (ages != null)
+                        ages[n] = (now == 0 || stamp == 0) ? 0 : (int)Math.Min(int.MaxValue, (now - stamp) * TicksToMicrosecondsFactor);
 
-        [DllImport(nativeLibrary, EntryPoint = "carambolas_net_socket_sendto", CallingConvention = CallingConvention.Cdecl)]
-        public static extern SocketError SendTo(int sockfd, byte[] buffer, int offset, int size, in IPEndPoint endPoint, out int nbytes);
-    }
+                    if (marks != null)
+                        marks[n] = mark;
+                }
 
-#endif
-    
-    internal static class Fallback
-    {
-        public sealed class Socket: ISocket
-        {
-            private SystemSocket socket;
+                if (n > 0)
+                {
+                    Interlocked.Add(ref received, n);
+                    Interlocked.Add(ref receivedBytes, bytes);
+                    if (ntruncated > 0)
+                        Interlocked.Add(ref truncated, ntruncated);
+                }
 
-            public Socket(AddressFamily addressFamily) => socket = new SystemSocket(addressFamily, SocketType.Dgram, ProtocolType.Udp);
-            
-            public bool Blocking
-            {
-                get => socket.Blocking;
-                set => socket.Blocking = value;
+                return n;
             }
 
-            public AddressFamily AddressFamily => socket.AddressFamily;
+            /// <summary>
+            /// Take the next datagram serving each source in turns.
+            /// </summary>
+            /// <returns>Length of the datagram (that may be greater than <paramref name="size"/>) or -1 if there's none.</returns>
+            private int Dequeue(byte[] buffer, int offset, int size, out IPEndPoint endPoint, out long stamp, out ECN mark)
+            {
+                var rings = Volatile.Read(ref incoming);
+                if (cursor >= rings.Length)
+                    cursor = 0;
 
-            public int Available => socket.Available;
+                for (int i = 0; i < rings.Length; ++i)
+                {
+                    var k = cursor + i;
+                    if (k >= rings.Length)
+                        k -= rings.Length;
 
-            public IPEndPoint LocalEndPoint { get; private set; }
+                    var ring = rings[k];
+                    var length = ring.TryDequeue(buffer, offset, size, out stamp, out mark);
+                    if (length >= 0)
+                    {
+                        cursor = k + 1;
+                        endPoint = ring.EndPoint;
+                        return length;
+                    }
 
-            public bool IsBound => socket.IsBound;
+                    // A ring from a closed socket can be discarded once it has been drained.
+                    if (Volatile.Read(ref ring.Owner.closed))
+                        Detach(ring);
+                }
 
-            public bool ExclusiveAddressUse
-            {
-                get => socket.ExclusiveAddressUse;
-                set => socket.ExclusiveAddressUse = value;
+                endPoint = default;
+                stamp = 0;
+                mark = ECN.NotCapable;
+                return -1;
             }
 
-            public int ReceiveBufferSize
+            public int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
             {
-                get => socket.ReceiveBufferSize;
-                set => socket.ReceiveBufferSize = value;
-            }
+                ThrowIfClosed();
+                
+                Interlocked.Increment(ref sendCalls);
 
-            public int SendBufferSize
-            {
-                get => socket.SendBufferSize;
-                set => socket.SendBufferSize = value;
+                var target = Enqueue(buffer, offset, size, endPoint.Port);
+                target?.Notify();
+
+                Interlocked.Increment(ref sent);
+                Interlocked.Add(ref sentBytes, size);
+                return size;
             }
 
-            public int ReceiveTimeout
+            public int SendTo(byte[] buffer, int offset, int size, int segmentSize, in IPEndPoint endPoint)
             {
-                get => socket.ReceiveTimeout;
-                set => socket.ReceiveTimeout = value;
+                ThrowIfClosed();
+
+                if (segmentSize <= 0)
+                    throw new SocketException((int)SocketError.InvalidArgument);
+
+                Interlocked.Increment(ref sendCalls);
+
+                Socket target = null;
+                var n = 0;
+                for (int i = 0; i < size; i += segmentSize, ++n)
+                    target = Enqueue(buffer, offset + i, Math.Min(segmentSize, size - i), endPoint.Port);
+
+                target?.Notify();
+
+                Interlocked.Add(ref sent, n);
+                Interlocked.Add(ref sentBytes, size);
+                return size;
             }
 
-            public int SendTimeout
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths, int[] delays) => SendMany(buffer, offset, stride, index, count, endPoints, lengths);
+
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, IPEndPoint[] sources, int[] lengths, int[] delays, bool zeroCopy, out int notifications)
             {
-                get => socket.SendTimeout;
-                set => socket.ReceiveTimeout = value;
+                notifications = 0;
+                return SendMany(buffer, offset, stride, index, count, endPoints, lengths);
             }
 
-            public short Ttl
+            public int ReceiveCompletions(uint[] ranges, out int copied)
             {
-                get => socket.Ttl;
-                set => socket.Ttl = value;
+                copied = 0;
+                return 0;
             }
 
-            public bool DontFragment
+            public int SendMany(byte[] buffer, int offset, int stride, int index, int count, IPEndPoint[] endPoints, int[] lengths)
             {
-                get => socket.DontFragment;
+                ThrowIfClosed();
 
-                set => socket.DontFragment = value;
-            }
+                Interlocked.Increment(ref sendCalls);
 
-            public bool DualMode
-            {
-                get => socket.DualMode;
+                // Targets are only notified once for each run of datagrams to the same destination.
+                Socket pending = null;
+                var bytes = 0L;
+                for (int i = index; i < index + count; ++i)
+                {
+                    var target = Enqueue(buffer, offset + i * stride, lengths[i], endPoints[i].Port);
+                    if (target != pending)
+                    {
+                        pending?.Notify();
+                        pending = target;
+                    }
 
-                set => socket.DualMode = value;
+                    bytes += lengths[i];
+                }
+
+                pending?.Notify();
+
+                Interlocked.Add(ref sent, count);
+                Interlocked.Add(ref sentBytes, bytes);
+                return count;
             }
 
-            public void SetIPProtectionLevel(IPProtectionLevel level) => socket.SetIPProtectionLevel(level);
+            /// <summary>
+            /// Copy a datagram into the ring to the socket bound to <paramref name="port"/>. 
+            /// </summary>
+            /// <returns>The socket that has to be notified or null if the datagram was lost.</returns>
+            private Socket Enqueue(byte[] buffer, int offset, int size, ushort port)
+            {
+                // Like a system socket, an unbound socket is implicitly bound to an ephemeral port by the first send.
+                if (!IsBound)
+                    Bind(AddressFamily == AddressFamily.InterNetworkV6 ? IPEndPoint.IPv6Any : IPEndPoint.Any);
 
-            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, bool optionValue) => socket.SetSocketOption(optionLevel, optionName, optionValue);
+                var limit = BlackHole;
+                if (limit > 0 && size > limit)
+                    return null;
 
-            public void SetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName, int optionValue) => socket.SetSocketOption(optionLevel, optionName, optionValue);
+                if (!outgoing.TryGetValue(port, out Ring ring) || Volatile.Read(ref ring.Target.closed))
+                {
+                    if (!ports.TryGetValue(port, out Socket socket))
+                    {
+                        outgoing.Remove(port);
+                        return null;
+                    }
 
-            public int GetSocketOption(SocketOptionLevel optionLevel, SocketOptionName optionName) => (int)socket.GetSocketOption(optionLevel, optionName);
+                    ring = socket.Attach(this);
+                    outgoing[port] = ring;
+                }
 
-            private readonly byte[] ipv4 = new byte[4];
-            private readonly byte[] ipv6 = new byte[16];
+                var target = ring.Target;
+                if (!ring.TryEnqueue(buffer, offset, size, target.Timestamping ? Stopwatch.GetTimestamp() : 0, (Ecn && target.Ecn) ? ECN.Capable0 : ECN.NotCapable))
+                {
+                    Interlocked.Increment(ref target.overflows);
+                    return null;
+                }
 
-            private const int SIO_UDP_CONNRESET = -1744830452; //SIO_UDP_CONNRESET = IOC_IN | IOC_VENDOR | 12
-            private readonly static byte[] DISABLED = new byte[] { 0 };
+                return target;
+            }
 
-            public void Bind(in IPEndPoint endPoint)
+            private Ring Attach(Socket owner)
             {
-                if (endPoint.Address.AddressFamily == AddressFamily.InterNetwork)
+                var capacity = MinRingCapacity;
+                while (capacity < MaxRingCapacity && capacity * AverageDatagramSize < ReceiveBufferSize)
+                    capacity <<= 1;
+
+                var ring = new Ring(owner, this, owner.LocalEndPoint, capacity);
+                lock (sync)
                 {
-                    endPoint.Address.SerializeIPv4(ipv4);
-                    socket.Bind(new SystemIPEndPoint(new SystemIPAddress(ipv4), endPoint.Port));
+                    var rings = new Ring[incoming.Length + 1];
+                    Array.Copy(incoming, rings, incoming.Length);
+                    rings[incoming.Length] = ring;
+                    Volatile.Write(ref incoming, rings);
                 }
-                else
+
+                return ring;
+            }
+
+            private void Detach(Ring ring)
+            {
+                lock (sync)
                 {
-                    endPoint.Address.SerializeIPv6(ipv6);
-                    socket.Bind(new SystemIPEndPoint(new SystemIPAddress(ipv6), endPoint.Port));
+                    var index = Array.IndexOf(incoming, ring);
+                    if (index < 0)
+                        return;
+
+                    var rings = new Ring[incoming.Length - 1];
+                    Array.Copy(incoming, 0, rings, 0, index);
+                    Array.Copy(incoming, index + 1, rings, index, rings.Length - index);
+                    Volatile.Write(ref incoming, rings);
                 }
+            }
 
-                // Ignore ICMP PORT_UNREACHABLE packets.
-                if (RuntimeInformation.IsOSPlatform(OSPlatform.Windows))
-                    socket.IOControl(SIO_UDP_CONNRESET, DISABLED, null);
+            private bool HasData
+            {
+                get
+                {
+                    var rings = Volatile.Read(ref incoming);
+                    for (int i = 0; i < rings.Length; ++i)
+                        if (!rings[i].IsEmpty)
+                            return true;
 
-                LocalEndPoint = new IPEndPoint(socket.LocalEndPoint as SystemIPEndPoint);
+                    return false;
+                }
             }
 
-            public bool Poll(int microSeconds, SelectMode mode) => socket.Poll(microSeconds, mode);
-
-            public int ReceiveFrom(byte[] buffer, int offset, int size, out IPEndPoint endPoint)
+            /// <summary>
+            /// Wake up the receiving thread if it's waiting. Called by a sender after enqueuing datagrams.
+            /// </summary>
+            private void Notify()
             {
-                var ep = default(EndPoint);
-                var length = socket.ReceiveFrom(buffer, offset, size, SocketFlags.None, ref ep);
-                if (ep is SystemIPEndPoint ip)
+                // The tail written by the sender must be visible before the flag is read or the receiver 
+                // could go to sleep after having checked for data without the sender noticing.
+                Thread.MemoryBarrier();
+                if (Volatile.Read(ref waiting) != 0)
                 {
-                    endPoint = new IPEndPoint(new IPAddress(ip.Address.GetAddressBytes()), (ushort)ip.Port);
-                    return length;
+                    lock (sync)
+                        Monitor.Pulse(sync);
                 }
-
-                endPoint = default;
-                return 0;
             }
 
-            public int SendTo(byte[] buffer, int offset, int size, in IPEndPoint endPoint)
+            /// <summary>
+            /// Waits up to <paramref name="microSeconds"/> (rounded up to milliseconds) for a datagram. 
+            /// A negative value waits indefinitely.
+            /// </summary>
+            private bool Wait(int microSeconds)
             {
-                SystemIPEndPoint ip;
-                if (endPoint.Address.AddressFamily == AddressFamily.InterNetwork)
+                if (HasData)
+                    return true;
+
+                if (microSeconds == 0)
+                    return false;
+
+                var timeout = (microSeconds < 0) ? Timeout.Infinite : (int)Math.Min(int.MaxValue, (microSeconds + 999L) / 1000);
+                var start = Environment.TickCount;
+                lock (sync)
                 {
-                    endPoint.Address.SerializeIPv4(ipv4);
-                    ip = new SystemIPEndPoint(new SystemIPAddress(ipv4), endPoint.Port);
+                    Interlocked.Exchange(ref waiting, 1);
+                    try
+                    {
+                        while (!HasData)
+                        {
+                            ThrowIfClosed();
+
+                            var remaining = (timeout < 0) ? Timeout.Infinite : timeout - (Environment.TickCount - start);
+                            if (timeout >= 0 && remaining <= 0)
+                                return false;
+
+                            Monitor.Wait(sync, remaining);
+                        }
+
+                        return true;
+                    }
+                    finally
+                    {
+                        Volatile.Write(ref waiting, 0);
+                    }
                 }
-                else
+            }
+
+            private void ThrowIfClosed()
+            {
+                if (Volatile.Read(ref closed))
+                    throw new ObjectDisposedException(GetType().FullName);
+            }
+
+            public void Close()
+            {
+                lock (sync)
                 {
-                    endPoint.Address.SerializeIPv6(ipv6);
-                    ip = new SystemIPEndPoint(new SystemIPAddress(ipv6), endPoint.Port);
+                    if (closed)
+                        return;
+
+                    Volatile.Write(ref closed, true);
+
+                    // Wake up any thread waiting for data so it can observe the socket is closed.
+                    Monitor.PulseAll(sync);
                 }
-            
-                return socket.SendTo(buffer, offset, size, SocketFlags.None, ip);
+
+                if (IsBound)
+                    ((ICollection<KeyValuePair<ushort, Socket>>)ports).Remove(new KeyValuePair<ushort, Socket>(LocalEndPoint.Port, this));
             }
-            public void Close() => socket.Close();
 
-            public void Dispose() => socket.Dispose();
+            public void Dispose() => Close();
         }
     }
 }
@@ -27,6 +27,18 @@ namespace Carambolas.Net
         [MethodImpl(MethodImplOptions.AggressiveInlining)]
         public static double TicksToMilliseconds(long ticks) => ticks * TicksToMillisecondsFactor;
 
+        /// <summary>
+        /// Converts ticks to microseconds.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public static long TicksToMicroseconds(long ticks) => (long)(ticks * TicksToMillisecondsFactor * 1000.0);
+
+        /// <summary>
+        /// Converts microseconds to ticks.
+        /// </summary>
+        [MethodImpl(MethodImplOptions.AggressiveInlining)]
+        public static long MicrosecondsToTicks(long microseconds) => (long)(microseconds / (TicksToMillisecondsFactor * 1000.0));
+
         public TickCounter(long start = 0) => this.start = start;
 
         private readonly long start;